@@ -0,0 +1,92 @@
+#include "onyx/cms/content_manager.h"
+#include "onyx/data/annotation_io.h"
+
+
+using namespace cms;
+
+void ShowUsage()
+{
+    printf("\nannotation_index rebuild [file_path...]\n");
+    printf("annotation_index search words\n");
+}
+
+static QString nodePath(const ContentNode & node)
+{
+    return QDir(node.location()).filePath(node.name());
+}
+
+/// Index the given documents, or all documents of the content database.
+static int rebuild(ContentManager & mgr, QStringList paths)
+{
+    if (paths.isEmpty())
+    {
+        cms_ids ids;
+        mgr.allNodes(ids);
+        for (cms_ids_iter it = ids.begin(); it != ids.end(); ++it)
+        {
+            ContentNode node;
+            if (mgr.getContentNode(*it, node))
+            {
+                paths.push_back(nodePath(node));
+            }
+        }
+    }
+
+    int count = 0;
+    QTime t; t.start();
+    foreach(const QString & path, paths)
+    {
+        if (DataBase::isDBExist(path) && anno::AnnotationIO::rebuildIndex(mgr, path))
+        {
+            ++count;
+        }
+    }
+    qDebug("%d documents indexed in %d ms, %d annotations",
+           count, t.elapsed(), mgr.annotationIndexSize());
+    return 0;
+}
+
+static int search(ContentManager & mgr, const QString & text)
+{
+    AnnotationHits hits;
+    QTime t; t.start();
+    if (!mgr.searchAnnotations(text, hits))
+    {
+        return 1;
+    }
+    int elapsed = t.elapsed();
+
+    foreach(const AnnotationHit & hit, hits)
+    {
+        qDebug("%s page %d: %s", qPrintable(hit.document), hit.page, qPrintable(hit.title));
+    }
+    qDebug("%d annotations found in %d ms", hits.size(), elapsed);
+    return 0;
+}
+
+int main(int argc, char * argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+    if (args.size() < 2 || (args[1] != "rebuild" && args[1] != "search"))
+    {
+        ShowUsage();
+        return 0;
+    }
+
+    QString db_path;
+    cms::getDatabasePath("", db_path);
+
+    ContentManager mgr;
+    if (!mgr.open(db_path))
+    {
+        qFatal("Could not open db %s", qPrintable(db_path));
+        return 0;
+    }
+
+    if (args[1] == "rebuild")
+    {
+        return rebuild(mgr, args.mid(2));
+    }
+    return search(mgr, QStringList(args.mid(2)).join(" "));
+}
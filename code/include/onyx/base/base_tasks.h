@@ -23,21 +23,21 @@ class BaseTask
 public:
     BaseTask(): status_(TASK_RUN), type_(0) {}
     BaseTask(int t) : status_(TASK_RUN), type_(t) {}
-    BaseTask(const BaseTask & right) : status_(right.status_), type_(right.type_) {}
+    BaseTask(const BaseTask & right) : status_(right.status()), type_(right.type_) {}
     virtual ~BaseTask() {}
 
     // operations
     virtual void exec() = 0;
 
-    void abort() { status_ = TASK_STOP; }
-    void pause() { status_ = TASK_PAUSE; }
-    void start() { status_ = TASK_RUN; }
+    void abort() { status_.fetchAndStoreRelease(TASK_STOP); }
+    void pause() { status_.fetchAndStoreRelease(TASK_PAUSE); }
+    void start() { status_.fetchAndStoreRelease(TASK_RUN); }
 
-    TaskStatus status() const { return status_; }
+    TaskStatus status() const { return static_cast<TaskStatus>(status_.fetchAndAddAcquire(0)); }
     int        type() const   { return type_; }
 
 private:
-    TaskStatus status_;    // status of the task
+    mutable QAtomicInt status_; // status of the task, set from other threads
     int        type_;      // type of the task
 };
 
@@ -0,0 +1,104 @@
+#ifndef NABOO_TASK_SCHEDULER_H_
+#define NABOO_TASK_SCHEDULER_H_
+
+#include "onyx/base/base_tasks.h"
+
+namespace vbf
+{
+
+/// Priority classes of the scheduler. Lower value runs first.
+enum TaskPriority
+{
+    TASK_PRIORITY_RENDER = 0,   ///< Render the visible page.
+    TASK_PRIORITY_PRERENDER,    ///< Render pages around the visible one.
+    TASK_PRIORITY_SEARCH,       ///< Search in document.
+    TASK_PRIORITY_INDEXING,     ///< Background indexing.
+    TASK_PRIORITY_COUNT
+};
+
+class TaskWorker;
+
+/// TaskScheduler runs BaseTask on a bounded pool of worker threads.
+/// Like TasksHandler, a task's exec() is called again and again while its
+/// status is TASK_RUN. Between two calls the worker yields to a task of
+/// higher priority if all workers are busy. Paused tasks go to the back
+/// of their priority class.
+///
+/// Cancelling all tasks of a type costs O(1): queued tasks are left in
+/// place and dropped when a worker reaches them.
+///
+/// Every task added produces exactly one taskFinished() signal, emitted
+/// in the thread owning the scheduler. The task is deleted right after
+/// the signal. Tasks must be safe to execute in worker threads.
+class TaskScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TaskScheduler(int workers = 0, QObject *parent = 0);
+    ~TaskScheduler();
+
+    int workerCount() const { return workers_.size(); }
+
+    void setTypePriority(int type, TaskPriority priority);
+    TaskPriority typePriority(int type) const;
+
+    void addTask(BaseTask *task);
+    void addTask(BaseTask *task, TaskPriority priority, bool front = false);
+
+    void cancelTasks(int type);
+    void cancelAll();
+    void abortRunning();
+    void pauseRunning();
+
+    int pendingCount() const;
+    int runningCount() const;
+    int unfinishedCount() const;
+    bool isIdle() const;
+    bool waitForIdle(int timeout = -1);
+
+Q_SIGNALS:
+    /// The task is finished or cancelled. The task is deleted when the
+    /// signal returns.
+    void taskFinished(vbf::BaseTask *task, bool cancelled);
+
+protected:
+    bool event(QEvent *e);
+
+private:
+    struct Entry
+    {
+        BaseTask *task;
+        int priority;
+        unsigned int type_generation;
+        unsigned int generation;
+    };
+    typedef std::list<Entry> Queue;
+
+private:
+    friend class TaskWorker;
+    void run();
+    bool takeNext(Entry & entry);
+    bool isStale(const Entry & entry) const;
+    bool shouldYield(int priority) const;
+    void finish(const Entry & entry, bool cancelled);
+
+private:
+    mutable QMutex mutex_;
+    QWaitCondition has_work_;
+    QWaitCondition idle_;
+    Queue queues_[TASK_PRIORITY_COUNT];
+    QHash<int, unsigned int> type_generations_;
+    QHash<int, TaskPriority> type_priorities_;
+    unsigned int generation_;
+    int queued_;        ///< Queued entries, including cancelled ones.
+    int unfinished_;    ///< Tasks not reported by taskFinished yet.
+    QList<Entry> running_;
+    QList<TaskWorker *> workers_;
+    bool stopping_;
+
+    NO_COPY_AND_ASSIGN(TaskScheduler);
+};
+
+};  // namespace vbf
+#endif
@@ -2,6 +2,7 @@
 #define NABOO_TASKS_HANDLER_H_
 
 #include "onyx/base/base_tasks.h"
+#include "onyx/base/task_scheduler.h"
 
 using namespace ui;
 
@@ -15,6 +16,11 @@ namespace vbf
 /// 3. Page rendering
 /// 4. Searching(search all for now)
 /// NOTICE: this class is not thread-safe
+///
+/// When a TaskScheduler is set, the same API forwards new tasks to the
+/// scheduler's worker pool instead of running them on the GUI thread.
+/// There is no single current task in the pool, so abortCurTask,
+/// pauseCurTask and clearTasks also apply to all tasks running there.
 class TasksHandler : public QObject
 {
     Q_OBJECT
@@ -37,6 +43,9 @@ public:
     void retrieveNextTask();
     bool isEmpty();
 
+    void setScheduler(TaskScheduler *scheduler);
+    TaskScheduler * scheduler() { return scheduler_; }
+
 private Q_SLOTS:
     /// Task executing function
     void execute();
@@ -57,6 +66,9 @@ private:
 
     /// reference to current executing task
     BaseTask* cur_task_;
+
+    /// worker pool the tasks are forwarded to, not owned
+    TaskScheduler* scheduler_;
 };
 
 };  // namespace vbf
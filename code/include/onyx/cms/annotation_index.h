@@ -0,0 +1,57 @@
+#ifndef CMS_ANNOTATION_INDEX_H_
+#define CMS_ANNOTATION_INDEX_H_
+
+#include <QtSql/QtSql>
+#include "onyx/base/base.h"
+
+namespace cms
+{
+
+/// An annotation found by the index. For a note, document is the note
+/// name and page and annotation are -1.
+struct AnnotationHit
+{
+    AnnotationHit() : page(-1), annotation(-1) {}
+
+    QString document;
+    int page;
+    int annotation;     ///< Index of the annotation in the page.
+    QString title;
+};
+typedef QVector<AnnotationHit> AnnotationHits;
+
+/// Word index of the annotations of all documents and of the note names,
+/// so that they can be searched without opening the database of every
+/// document. Kept in the content database and updated page by page when
+/// the annotations are saved.
+///
+/// Text is split in words of letters and digits, lower case. Chinese,
+/// Japanese and Korean characters are words by themselves. A search
+/// matches the annotations that have every word of the query as a
+/// prefix of one of their words.
+class AnnotationIndex
+{
+    friend class ContentManager;
+public:
+    AnnotationIndex(void);
+    ~AnnotationIndex(void);
+
+    static QStringList tokenize(const QString & text);
+
+private:
+    static bool makeSureTableExist(QSqlDatabase &);
+    static bool removeTable(QSqlDatabase &database);
+
+    static bool updatePage(QSqlDatabase &, const QString & document,
+                           int page, const QStringList & titles);
+    static bool removeDocument(QSqlDatabase &, const QString & document);
+    static bool search(QSqlDatabase &, const QString & text,
+                       AnnotationHits & hits, int limit);
+    static int count(QSqlDatabase &);
+
+    static bool removeRows(QSqlQuery &, const QString & document, int page);
+};
+
+}
+
+#endif  // CMS_ANNOTATION_INDEX_H_
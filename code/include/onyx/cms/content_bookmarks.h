@@ -6,7 +6,22 @@
 namespace cms
 {
 
-/// Use content id as the primary key.
+/// Title and data of a bookmark.
+typedef QPair<QString, QVariant> BookmarkEntry;
+typedef QList<BookmarkEntry> BookmarkEntries;
+
+/// Bookmarks are stored one row per bookmark, with a position key
+/// taken from numeric data, so a bookmark is added or removed without
+/// rewriting the others and the bookmarks of a page range are read
+/// through the (content id, position) index. All the bookmarks of a
+/// content are read in the order they were saved, a bookmark added
+/// alone being placed by its position; a position range is read in
+/// position order, bookmarks without a numeric position being out of
+/// any range.
+///
+/// The blob table, one blob per content id, is still there for old
+/// callers. Blobs found when the database is opened are moved to the
+/// rows.
 class ContentBookmarks
 {
     friend class ContentManager;
@@ -22,6 +37,20 @@ private:
     static bool createBookmarks(QSqlDatabase &, const cms_long, const cms_blob &);
     static bool removeBookmarks(QSqlDatabase &, const cms_long);
     static bool updateBookmarks(QSqlDatabase &, const cms_long, const cms_blob &);
+
+    static bool checkColumns(QSqlDatabase &);
+    static bool migrate(QSqlDatabase &);
+    static QVariant position(const QVariant & data);
+    static bool insertEntry(QSqlQuery &, const cms_long, const BookmarkEntry &, int sequence);
+
+    static bool getEntries(QSqlDatabase &, const cms_long, BookmarkEntries &);
+    static bool getEntries(QSqlDatabase &, const cms_long,
+                           double first, double last, BookmarkEntries &);
+    static bool replaceEntries(QSqlDatabase &, const cms_long, const BookmarkEntries &);
+    static bool addEntry(QSqlDatabase &, const cms_long, const BookmarkEntry &);
+    static bool removeEntry(QSqlDatabase &, const cms_long, const BookmarkEntry &);
+    static bool removeEntries(QSqlDatabase &, const cms_long);
+    static int entryCount(QSqlDatabase &, const cms_long);
 };
 
 }
@@ -11,6 +11,8 @@
 #include <QtSql/QtSql>
 #include "content_node.h"
 #include "content_category.h"
+#include "content_bookmarks.h"
+#include "annotation_index.h"
 #include "cms_utils.h"
 #include "notes_manager.h"
 
@@ -32,7 +34,7 @@ public:
     static const cms_long READING_LISTS_ID;
 
 public:
-    explicit ContentManager();
+    explicit ContentManager(const QString & connection = "cms");
     ~ContentManager(void);
 
 public:
@@ -98,12 +100,22 @@ public:
     bool removeBookmarks(const cms_long id);
     bool updateBookmarks(const cms_long id, const cms_blob & Options);
 
+    bool getBookmarkEntries(const cms_long id, BookmarkEntries & entries);
+    bool getBookmarkEntries(const cms_long id, double first, double last,
+                            BookmarkEntries & entries);
+    bool replaceBookmarkEntries(const cms_long id, const BookmarkEntries & entries);
+    bool addBookmarkEntry(const cms_long id, const BookmarkEntry & entry);
+    bool removeBookmarkEntry(const cms_long id, const BookmarkEntry & entry);
+    int bookmarkCount(const cms_long id);
+
     // Recent docuemnts.
     bool addToRecentDocuments(const QString &doc_path);
     bool removeRecentDocument(const QString &doc_path);
     bool addToRecentDocuments(const cms_long id);
     QString latestReading();
     bool getRecentDocuments(cms_ids & documents);
+    bool getRecentDocuments(ContentNodes & nodes, int offset = 0, int limit = -1);
+    int recentDocumentCount();
     bool clearRecentDocuments();
     void sortRecentDocuments(cms_ids & documents);
 
@@ -118,11 +130,25 @@ public:
     // Notes.
     QString suggestedNoteName();
     int  allNotes(Notes &notes);
+    bool listNotes(Notes &notes, int offset = 0, int count = -1);
+    int  noteCount();
+    bool noteThumbnail(const QString & name, QImage & image);
+    bool loadNoteThumbnails(Notes &notes);
     bool addNoteIndex(const NoteInfo & note);
     bool removeNote(const QString & name);
     bool removeAllNotes();
     bool removeAllNotesIndex();
 
+    // Annotation search.
+    bool updateAnnotationIndex(const QString & doc_path,
+                               int page,
+                               const QStringList & titles);
+    bool removeAnnotationIndex(const QString & doc_path);
+    bool searchAnnotations(const QString & text,
+                           AnnotationHits & hits,
+                           int limit = -1);
+    int annotationIndexSize();
+
     /// Remove all tables in the database. Just for test.
     void dropAllTables();
 
@@ -147,6 +173,7 @@ private:
 
 private:
     scoped_ptr<QSqlDatabase> database_;     ///< sqlite qt wrapper.
+    QString connection_;    ///< One per thread using the database.
 
     // Not very clear yet.
     ContentCategory root_category_;
@@ -64,7 +64,8 @@ public:
     /// The last access time. Caller should provide the time
     /// in correct format, usually, it should be:
     /// YYYY-MM-DD HH:MM:SS so that they can be compared in
-    /// string format.
+    /// string format. The database also keeps it as seconds in
+    /// an indexed column, to sort the recent documents.
     const QString & last_access() const { return last_access_; }
     QString & mutable_last_access() { return last_access_; }
 
@@ -161,6 +162,15 @@ private:
     static bool updateContentNodeByUrl(QSqlDatabase&, const ContentNode &, const QString & url);
     static bool allNodes(QSqlDatabase&, cms_ids & list);
 
+    // Nodes of a category, most recently accessed first.
+    static bool getCategoryNodes(QSqlDatabase&, const cms_long category,
+                                 int offset, int limit,
+                                 std::vector<ContentNode> & nodes);
+    static bool getCategoryIds(QSqlDatabase&, const cms_long category,
+                               cms_ids & list);
+    static int categoryNodeCount(QSqlDatabase&, const cms_long category);
+    static void readNode(const QSqlQuery &, ContentNode &);
+
     static bool createContentNode(QSqlDatabase&, ContentNode&);
     static bool updateContentNode(QSqlDatabase&, const ContentNode &);
     static bool removeContentNode(QSqlDatabase&, ContentNode&);
@@ -25,7 +25,8 @@ bool makeThumbnail(const QString & path, ThumbnailType type = THUMBNAIL_LARGE);
 class ContentThumbnail
 {
 public:
-    explicit ContentThumbnail(const QString &folder, bool open = true);
+    explicit ContentThumbnail(const QString &folder, bool open = true,
+                              const QString & connection = QString());
     ~ContentThumbnail(void);
 
     bool open();
@@ -43,6 +44,7 @@ private:
 private:
     scoped_ptr<QSqlDatabase> database_;
     QDir dir_;
+    QString connection_;
     static const QString DB_NAME;
 };
 
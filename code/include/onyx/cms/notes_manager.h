@@ -33,6 +33,11 @@ typedef QVector<NoteInfo> Notes;
 
 /// Store all notes index. It does not really store the notes data.
 /// It maintains all notes index in center database.
+///
+/// Names are unique. The number of the notes named by suggestedName is
+/// stored in the sequence column, so that the next name is given by the
+/// index instead of parsing every name. list() does not read the
+/// thumbnails, they are loaded for the notes displayed.
 class NotesManager
 {
     friend class ContentManager;
@@ -42,10 +47,16 @@ public:
 
 private:
     static bool makeSureTableExist(QSqlDatabase &);
+    static bool checkColumns(QSqlDatabase &);
     static bool removeTable(QSqlDatabase &database);
 
+    static int  sequence(const QString & name);
     static QString suggestedName(QSqlDatabase &);
     static int  all(QSqlDatabase &, Notes &notes);
+    static bool list(QSqlDatabase &, Notes &notes, int offset, int count);
+    static int  count(QSqlDatabase &);
+    static bool thumbnail(QSqlDatabase &, const QString & name, QImage & image);
+    static bool loadThumbnails(QSqlDatabase &, Notes &notes);
     static bool addIndex(QSqlDatabase &, const NoteInfo & note);
     static bool removeIndex(QSqlDatabase &, const QString & name);
     static bool removeAll(QSqlDatabase &);
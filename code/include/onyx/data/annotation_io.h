@@ -5,6 +5,7 @@
 #include "onyx/data/annotation.h"
 #include "onyx/data/annotation_page.h"
 #include "onyx/data/annotation_document.h"
+#include "onyx/cms/content_manager.h"
 
 namespace anno
 {
@@ -33,6 +34,9 @@ public:
 
     static shared_ptr<AnnotationIO> getIO( const QString & doc_name, bool create = true );
 
+    // search index
+    static bool rebuildIndex( cms::ContentManager & db, const QString & doc_name );
+
 private:
     // initialize
     bool initialTable();
@@ -41,6 +45,8 @@ private:
     bool createPage( AnnotationPagePtr page, const blob & data );
     bool updatePage( AnnotationPagePtr page, const blob & data );
     bool removePage( AnnotationPagePtr page );
+    void indexPage( AnnotationPagePtr page );
+    cms::ContentManager * indexDatabase();
 
 private:
     typedef QMap< QString, shared_ptr<AnnotationIO> > IOMap;
@@ -48,6 +54,8 @@ private:
 
 private:
     shared_ptr<DataBase> db_;
+    QString              doc_name_;
+    scoped_ptr<cms::ContentManager> index_db_;  ///< Opened by the first saved page.
     static IOMap         io_map_;    ///< map of all the io instances
 };
 
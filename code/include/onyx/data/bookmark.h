@@ -3,6 +3,7 @@
 #ifndef BASE_BOOKMARK_H_
 #define BASE_BOOKMARK_H_
 
+#include <algorithm>
 #include "onyx/base/base.h"
 #include <QString>
 #include <QVariant>
@@ -61,7 +62,9 @@ typedef Bookmarks::const_iterator ConstBookmarksIter;
 
 /// Insert a bookmark into bookmark vector and make sure
 /// the new inserted bookmark is in correct position(pre-order).
-/// Caller is able to define its own compare function.
+/// Caller is able to define its own compare function. The vector
+/// must be sorted by the same function, the position is found by
+/// binary search.
 /// \return This function returns false when the same bookmark is found
 /// in the bookmark list. Otherwise it returns true.
 /// \notice For template reason, I have to implement this function in the
@@ -72,15 +75,12 @@ bool insertBookmark(Bookmarks & bookmarks,
                     Comp cmp)
 {
     BookmarksIter begin = bookmarks.begin();
-    BookmarksIter end   = bookmarks.end();
-    BookmarksIter iter  = begin;
-    for(; iter != end; ++iter)
+    BookmarksIter iter  = std::upper_bound(begin, bookmarks.end(), new_bookmark, cmp);
+
+    // Same bookmark can only be among the equivalent ones.
+    for(BookmarksIter prev = iter; prev != begin && !cmp(*(prev - 1), new_bookmark); --prev)
     {
-        if (cmp(new_bookmark, *iter))
-        {
-            break;
-        }
-        else if (new_bookmark == *iter)
+        if (new_bookmark == *(prev - 1))
         {
             return false;
         }
@@ -96,13 +96,29 @@ bool removeBookmark(Bookmarks & bookmarks, const Bookmark & bookmark);
 /// Store bookmark for the document.
 bool loadBookmarks(cms::ContentManager & db,
                    const QString &document_path,
-                   Bookmarks & bookmarks);
+                   Bookmarks & bookmarks,
+                   bool create = true);
 
 /// Load bookmarks for the document.
 bool saveBookmarks(cms::ContentManager & db,
                    const QString &document_path,
                    const Bookmarks & bookmarks);
 
+/// Load the bookmarks whose position is in [first, last].
+bool loadBookmarks(cms::ContentManager & db,
+                   const QString &document_path,
+                   double first,
+                   double last,
+                   Bookmarks & bookmarks);
+
+/// Store or remove a single bookmark of the document.
+bool addBookmark(cms::ContentManager & db,
+                 const QString &document_path,
+                 const Bookmark & bookmark);
+bool removeBookmark(cms::ContentManager & db,
+                    const QString &document_path,
+                    const Bookmark & bookmark);
+
 }
 
 #endif
@@ -0,0 +1,115 @@
+#ifndef DOCUMENT_SESSION_H_
+#define DOCUMENT_SESSION_H_
+
+#include "onyx/base/base.h"
+#include "onyx/data/configuration.h"
+#include "onyx/data/bookmark.h"
+#include "onyx/cms/content_thumbnail.h"
+
+namespace anno
+{
+class AnnotationAgent;
+}
+
+namespace sketch
+{
+class SketchProxy;
+}
+
+namespace vbf
+{
+
+/// Per-document state loaded by DocumentSession.
+enum DocumentPiece
+{
+    PIECE_OPTIONS = 0,      ///< Configuration, with the content node.
+    PIECE_BOOKMARKS,
+    PIECE_THUMBNAIL,
+    PIECE_NOTES,            ///< Annotation and sketch database read ahead.
+    PIECE_COUNT
+};
+
+class SessionThread;
+
+/// DocumentSession loads the state of a document on worker threads as
+/// soon as the document is opened, instead of one piece after another
+/// in the viewer thread. Each worker has its own database connection.
+///
+/// Every piece works like a future: isReady() polls, waitFor() blocks
+/// and pieceReady() is emitted in the session's thread. The result of
+/// a piece may be used once it's ready.
+///
+/// Annotations and sketches are kept in process wide connections that
+/// belong to the viewer thread, so they can not be opened by a worker.
+/// The worker reads their database ahead, and they are opened in the
+/// viewer thread after firstPageShown(), so the first page does not
+/// wait for them.
+class DocumentSession : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DocumentSession(const QString & doc_path,
+                             ThumbnailType thumbnail_type = THUMBNAIL_LARGE,
+                             QObject *parent = 0);
+    ~DocumentSession();
+
+    const QString & path() const { return path_; }
+
+    bool isReady(DocumentPiece piece) const;
+    bool waitFor(DocumentPiece piece, int timeout = -1);
+    bool waitForAll(int timeout = -1);
+
+    Configuration & configuration() { return configuration_; }
+    Bookmarks & bookmarks() { return bookmarks_; }
+    const QImage & thumbnail() const { return thumbnail_; }
+
+    void setNotes(anno::AnnotationAgent *agent, sketch::SketchProxy *proxy);
+    bool areNotesOpened() const;
+    void firstPageShown();
+
+    int elapsed(DocumentPiece piece) const;
+    int timeToFirstPage() const;
+
+public Q_SLOTS:
+    void openNotes();
+
+Q_SIGNALS:
+    void pieceReady(int piece);
+    void notesOpened();
+
+private:
+    friend class SessionThread;
+    void load(DocumentPiece piece);
+    void readOptions();
+    void readBookmarks();
+    void readThumbnail();
+    void readNotesAhead();
+    QString connectionName(DocumentPiece piece) const;
+
+private:
+    QString path_;
+    ThumbnailType thumbnail_type_;
+    QTime clock_;
+
+    Configuration configuration_;
+    Bookmarks bookmarks_;
+    QImage thumbnail_;
+
+    anno::AnnotationAgent *annotation_agent_;
+    sketch::SketchProxy *sketch_proxy_;
+    bool notes_opened_;
+
+    mutable QMutex mutex_;
+    QWaitCondition ready_;
+    int elapsed_[PIECE_COUNT];      ///< Milliseconds, -1 until ready.
+    int first_page_;
+
+    QList<SessionThread *> threads_;
+
+    NO_COPY_AND_ASSIGN(DocumentSession);
+};
+
+}   // namespace vbf
+
+#endif  // DOCUMENT_SESSION_H_
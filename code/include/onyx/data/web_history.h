@@ -13,6 +13,16 @@
 namespace webhistory
 {
 
+/// Pages visited with the web browser, most recently visited first.
+///
+/// Each page is one row keyed by url, with its title and the time of the
+/// last visit, to the minute. The pages are kept in the order given to
+/// saveConf(), and a visit moves the page first. Only the first
+/// maxCount() pages are kept.
+/// The thumbnails are in their own table: listing the pages does not read
+/// them, thumbnail() loads one when it's displayed. A database written by
+/// a previous version, with one serialized ThumbnailItem by row, is
+/// converted when it's opened.
 class WebHistory
 {
 public:
@@ -20,6 +30,13 @@ public:
     ~WebHistory();
 
 public:
+    bool visit(const QUrl & url, const QString & title);
+    bool setThumbnail(const QUrl & url, const QImage & image);
+    QImage thumbnail(const QUrl & url);
+    bool remove(const QUrl & url);
+    bool loadPages(QVariantList & pages);
+    int count();
+
     // conf.
     bool loadConf(QVariantList & conf);
     bool saveConf(const QVariantList & conf);
@@ -32,7 +49,12 @@ private:
     bool open(const QString & app_name);
     bool close();
     void makeSureTableExist(QSqlDatabase& database);
+    bool migrate(QSqlDatabase& database);
     bool clear(QSqlDatabase& database);
+    bool load(QVariantList & pages, bool with_thumbnails);
+    bool insertItems(QSqlQuery & query, const QVariantList & items);
+    bool saveThumbnail(QSqlQuery & query, const QString & url, const QByteArray & data);
+    bool trim(QSqlQuery & query);
 
 private:
     scoped_ptr<QSqlDatabase> database_;
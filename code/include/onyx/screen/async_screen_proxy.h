@@ -0,0 +1,119 @@
+// -*- mode: c++; c-basic-offset: 4; -*-
+
+#ifndef ASYNC_SCREEN_PROXY_H_
+#define ASYNC_SCREEN_PROXY_H_
+
+#include <QtNetwork/QtNetwork>
+
+#include "onyx/base/base.h"
+#include "onyx/screen/screen_proxy.h"
+
+namespace onyx
+{
+namespace screen
+{
+
+/// Non-blocking variant of ScreenProxy.
+/// Every command is tagged with a sequence number and written to the
+/// screen server immediately. The caller gets the sequence number back
+/// and is notified through commandFinished() when the server has processed
+/// the command. Up to window() commands can be in flight at the same time,
+/// further commands are queued locally and sent as soon as a slot is free.
+///
+/// The sequence number travels in ScreenCommand::SEQUENCE_POINT and the
+/// server echoes it in the reply, so a lost or duplicated reply does not
+/// shift the matching of the following ones. The wire format is the same
+/// ScreenCommand used by ScreenProxy.
+class AsyncScreenProxy : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int DEFAULT_WINDOW = 4;
+    static const int DEFAULT_TIMEOUT = 3000;
+
+    explicit AsyncScreenProxy(const QString & server = QString(),
+                              int window = DEFAULT_WINDOW,
+                              QObject *parent = 0);
+    ~AsyncScreenProxy();
+
+    bool isConnected() const;
+
+    void setWindow(int window);
+    int window() const { return window_; }
+
+    void setTimeout(int ms) { timeout_ = ms; }
+    int timeout() const { return timeout_; }
+
+    void setDefaultWaveform(ScreenProxy::Waveform w = ScreenProxy::GC);
+    ScreenProxy::Waveform defaultWaveform() const { return waveform_; }
+
+    int inFlightCount() const { return in_flight_.size(); }
+    int pendingCount() const { return pending_.size(); }
+    bool isIdle() const { return in_flight_.isEmpty() && pending_.isEmpty(); }
+    bool isFinished(unsigned int sequence) const;
+
+    unsigned int sync(const QWidget *widget, const QRect * region = 0);
+    unsigned int updateWidget(const QWidget *widget,
+                              ScreenProxy::Waveform w = ScreenProxy::INVALID,
+                              bool whole = true,
+                              ScreenCommand::WaitMode wait = ScreenCommand::WAIT_BEFORE_UPDATE);
+    unsigned int updateWidgetRegion(const QWidget *widget,
+                                    const QRect & rect,
+                                    ScreenProxy::Waveform w = ScreenProxy::INVALID,
+                                    bool whole = true,
+                                    ScreenCommand::WaitMode wait = ScreenCommand::WAIT_BEFORE_UPDATE);
+    unsigned int updateScreenRegion(const QRect & rect,
+                                    ScreenProxy::Waveform w = ScreenProxy::INVALID,
+                                    bool whole = true,
+                                    ScreenCommand::WaitMode wait = ScreenCommand::WAIT_BEFORE_UPDATE);
+    unsigned int updateScreen(ScreenProxy::Waveform w = ScreenProxy::INVALID,
+                              ScreenCommand::WaitMode wait = ScreenCommand::WAIT_BEFORE_UPDATE);
+    unsigned int ensureUpdateFinished();
+
+    unsigned int send(const ScreenCommand & command);
+
+    bool waitForFinished(unsigned int sequence, int timeout = DEFAULT_TIMEOUT);
+    bool waitForAll(int timeout = DEFAULT_TIMEOUT);
+
+Q_SIGNALS:
+    void commandFinished(unsigned int sequence, bool ok);
+
+private Q_SLOTS:
+    void onReadyRead();
+    void onTimeout();
+
+private:
+    struct Request
+    {
+        unsigned int sequence;
+        ScreenCommand command;
+        QTime sent;
+    };
+
+private:
+    unsigned int regionCommand(ScreenCommand::Type type,
+                               const QRect & rc,
+                               ScreenProxy::Waveform w,
+                               bool whole,
+                               ScreenCommand::WaitMode wait);
+    void dispatch();
+    void finish(unsigned int sequence, bool ok);
+    void restartTimer();
+
+private:
+    QIODevice *socket_;
+    int window_;
+    int timeout_;
+    ScreenProxy::Waveform waveform_;
+    unsigned int next_sequence_;
+    QQueue<Request> pending_;
+    QQueue<Request> in_flight_;
+    QByteArray read_buffer_;
+    QTimer timer_;
+};
+
+}  // namespace screen
+}  // namespace onyx
+
+#endif
@@ -12,6 +12,9 @@ namespace onyx
 namespace screen
 {
 
+class SharedFrameBuffer;
+class WaveformScheduler;
+
 struct ScreenCommand
 {
     enum Type {
@@ -22,6 +25,10 @@ struct ScreenCommand
         DRAW_LINE,
         DRAW_LINES,
         FILL_SCREEN,
+        SHM_ATTACH,             ///< Use the client's shared frame buffer.
+        SHM_DETACH,
+        SHM_SYNC,               ///< Copy damaged region from shared frame buffer.
+        SHM_SYNC_AND_UPDATE,
     };
 
     enum WaitMode {
@@ -37,7 +44,18 @@ struct ScreenCommand
         PARTIAL_UPDATE
     };
 
+    /// For SHM_ATTACH, color holds the client pid, size the segment size and
+    /// width, height the frame size. The server sets point_count to
+    /// SHM_ACCEPTED in the reply. For SHM_SYNC and SHM_SYNC_AND_UPDATE,
+    /// size holds the frame sequence and the region is the damage bounds.
+    static const int SHM_ACCEPTED = 1;
+
     static const int MAX_POINTS = 15;
+
+    /// AsyncScreenProxy puts its sequence number in the x of this point,
+    /// which the server sends back unchanged. Only DRAW_LINES with
+    /// MAX_POINTS points uses it.
+    static const int SEQUENCE_POINT = MAX_POINTS - 1;
     Type type;
     int waveform;
     UpdateMode update_flags;               ///< Partial update or full screen update.
@@ -51,6 +69,10 @@ struct ScreenCommand
 
 extern const int PORT;
 
+QRect mapToScreen(const QWidget *widget, const QRect * region = 0);
+QRect mapToScreen(const QRect & rect, const QRect & desk, int degree);
+QImage mapToScreen(const QImage & image, int degree);
+
 /// Screen proxy is a proxy used to talk with the screen manager daemon.
 class ScreenProxy
 {
@@ -116,6 +138,17 @@ public:
     void flush(int timeout = 3000);
 
     QRect & sync(const QWidget *widget, const QRect * region = 0);
+    QRect & sync(const QWidget *widget, const QImage & rendered, const QRect * region = 0);
+
+    bool openSharedFrameBuffer(int width = 0, int height = 0);
+    void closeSharedFrameBuffer();
+    SharedFrameBuffer * sharedFrameBuffer() { return shared_fb_.get(); }
+    bool publish(const QImage & image,
+                 const QPoint & pos,
+                 const QVector<QRect> & damage,
+                 bool update = false,
+                 Waveform w = INVALID,
+                 ScreenCommand::WaitMode wait = ScreenCommand::WAIT_BEFORE_UPDATE);
     void updateWidget(const QWidget *widget,
                       Waveform w = INVALID,
                       bool whole = true,
@@ -132,8 +165,11 @@ public:
     void drawLines(QPoint * points, const int size, unsigned char color, int width);
     void fillScreen(unsigned char color);
 
+    /// Partial updates a region of the screen takes before it's
+    /// refreshed with GC by updateWidgetWithGCInterval.
     void setGCInterval(const int interval);
     void resetGUCount();
+    WaveformScheduler & waveformScheduler() { return *scheduler_; }
     void updateWidgetWithGCInterval(const QWidget *widget,
                                    const QRect * rect = 0,
                                    Waveform w = INVALID,
@@ -145,6 +181,10 @@ private:
     ScreenProxy(ScreenProxy & ref){}
 
     QRect & screenRegion(const QWidget *widget, const QRect * region = 0);
+    void updateScreenRegion(const QRect & rect,
+                            Waveform w,
+                            bool whole,
+                            ScreenCommand::WaitMode wait);
 
     bool enable_update_;    ///< Enable update or not.
     WaveformPolicy policy_; ///< Waveform selection policy
@@ -152,12 +192,8 @@ private:
     Waveform previous_waveform_;     ///< Stored waveform.
     QRect rect_;            ///< The update region.
     int user_data_;         ///< User data.
-    int gc_interval_;     ///< The interval for screen update with GC waveform
-    int gu_count_;              ///< Count the screen update with GU waveform
-
-private:
-    void increaseGUCount();
-
+    scoped_ptr<WaveformScheduler> scheduler_;  ///< Chooses GC tile by tile.
+    scoped_ptr<SharedFrameBuffer> shared_fb_;  ///< Frame buffer shared with server.
 };
 
 /// Is screen update enabled.
@@ -0,0 +1,95 @@
+// -*- mode: c++; c-basic-offset: 4; -*-
+
+#ifndef SHARED_FRAMEBUFFER_H_
+#define SHARED_FRAMEBUFFER_H_
+
+#include <QtGui/QtGui>
+
+#include "onyx/base/base.h"
+
+namespace onyx
+{
+namespace screen
+{
+
+/// Layout of the header at the beginning of the shared segment.
+/// Pixels follow the header, 8-bit grayscale, stride bytes per line.
+struct SharedFrameHeader
+{
+    static const unsigned int MAGIC = 0x4f4e5846;   ///< "ONXF"
+    static const unsigned int VERSION = 1;
+    static const int MAX_DAMAGE = 16;
+
+    struct Rect
+    {
+        int left, top, width, height;
+    };
+
+    unsigned int magic;
+    unsigned int version;
+    int width;
+    int height;
+    int stride;
+    int header_size;
+    volatile unsigned int published;    ///< Sequence of the last published frame.
+    volatile unsigned int consumed;     ///< Sequence of the last frame read by server.
+    int damage_count;
+    Rect damage[MAX_DAMAGE];
+};
+
+/// POSIX shared memory segment holding a rendered frame.
+/// The client creates the segment and writes pixels into it, then
+/// publishes a damage list. The screen server attaches to the same
+/// segment, reads the damaged pixels directly from the mapping and marks
+/// the frame as consumed. Only one frame is in the segment at a time, so
+/// the client waits for the previous frame to be consumed before writing.
+class SharedFrameBuffer
+{
+public:
+    SharedFrameBuffer();
+    ~SharedFrameBuffer();
+
+    static QString segmentName(int pid);
+
+    bool create(const QString & name, int width, int height);
+    bool attach(const QString & name);
+    void close();
+
+    bool isValid() const { return header_ != 0; }
+    const QString & name() const { return name_; }
+    int width() const { return header_ ? header_->width : 0; }
+    int height() const { return header_ ? header_->height : 0; }
+    int stride() const { return header_ ? header_->stride : 0; }
+    size_t size() const { return size_; }
+
+    uchar * scanLine(int y) { return pixels_ + y * stride(); }
+    const uchar * scanLine(int y) const { return pixels_ + y * stride(); }
+
+    bool waitForConsumed(int timeout = 3000);
+    void copyFrom(const QImage & image, const QPoint & pos);
+    unsigned int publish(const QVector<QRect> & damage);
+
+    unsigned int published() const;
+    unsigned int consumed() const;
+    QVector<QRect> damage() const;
+    void markConsumed(unsigned int frame);
+
+private:
+    bool map(int fd, size_t size);
+
+private:
+    QString name_;
+    bool owner_;
+    size_t size_;
+    uchar *data_;
+    SharedFrameHeader *header_;
+    uchar *pixels_;
+    uchar gray_table_[256];
+
+    NO_COPY_AND_ASSIGN(SharedFrameBuffer);
+};
+
+}  // namespace screen
+}  // namespace onyx
+
+#endif
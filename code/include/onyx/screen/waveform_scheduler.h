@@ -0,0 +1,94 @@
+// -*- mode: c++; c-basic-offset: 4; -*-
+
+#ifndef WAVEFORM_SCHEDULER_H_
+#define WAVEFORM_SCHEDULER_H_
+
+#include <QtGui/QtGui>
+
+#include "onyx/screen/screen_proxy.h"
+
+namespace onyx
+{
+namespace screen
+{
+
+/// A region of the screen and the waveform to update it with.
+struct WaveformUpdate
+{
+    WaveformUpdate() : waveform(ScreenProxy::INVALID) {}
+    WaveformUpdate(const QRect & r, ScreenProxy::Waveform w) : rect(r), waveform(w) {}
+
+    QRect rect;
+    ScreenProxy::Waveform waveform;
+};
+typedef QVector<WaveformUpdate> WaveformUpdates;
+
+/// Chooses the waveform of screen updates tile by tile.
+///
+/// Every partial update (GU, GC4, A2) leaves some ghosting in the
+/// pixels it changes. The screen is divided in square tiles and the
+/// scheduler counts the partial updates of every tile. When a tile
+/// reaches the budget, it is refreshed with GC and its count starts
+/// again, while the rest of the update keeps the fast waveform. An
+/// update with a clearing waveform resets the tiles it covers.
+///
+/// DW updates are not counted, as they are always followed by a normal
+/// update of the same region, like the ones of ScreenProxy before.
+class WaveformScheduler
+{
+public:
+    static const int DEFAULT_TILE_SIZE = 64;
+    static const int DEFAULT_BUDGET = 8;
+
+    explicit WaveformScheduler(int tile_size = DEFAULT_TILE_SIZE,
+                               int budget = DEFAULT_BUDGET);
+    ~WaveformScheduler();
+
+    void setTileSize(int size);
+    int tileSize() const { return tile_size_; }
+
+    /// Number of partial updates a tile takes before GC. 0 means never.
+    void setBudget(int budget) { budget_ = budget; }
+    int budget() const { return budget_; }
+
+    /// Promoted tiles are clipped to the screen when it's known.
+    void setScreenRect(const QRect & rect) { screen_ = rect; }
+
+    void schedule(const QRect & rect,
+                  ScreenProxy::Waveform waveform,
+                  WaveformUpdates & updates);
+    void clean(const QRect & rect);
+    void reset();
+
+    int partialUpdates(const QPoint & pos) const;
+
+    /// Pixels updated with a partial waveform and with GC because a
+    /// tile was promoted, since the last resetStatistics.
+    qint64 partialArea() const { return partial_area_; }
+    qint64 promotedArea() const { return promoted_area_; }
+    void resetStatistics();
+
+    static bool isClearing(ScreenProxy::Waveform waveform);
+    static bool isCounted(ScreenProxy::Waveform waveform);
+
+private:
+    typedef QPair<int, int> Tile;       ///< Row and column.
+
+    int tileIndex(int coordinate) const;
+    QRect tileRect(const Tile & tile) const;
+
+private:
+    int tile_size_;
+    int budget_;
+    QRect screen_;
+    QHash<Tile, int> counts_;           ///< Partial updates of dirty tiles.
+    qint64 partial_area_;
+    qint64 promoted_area_;
+
+    NO_COPY_AND_ASSIGN(WaveformScheduler);
+};
+
+}  // namespace screen
+}  // namespace onyx
+
+#endif  // WAVEFORM_SCHEDULER_H_
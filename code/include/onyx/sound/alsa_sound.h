@@ -2,12 +2,13 @@
 #define ONYX_ALSA_SOUND_H_
 
 #include <QtCore/QtCore>
+#include "onyx/sound/pcm_stream.h"
 
 #ifdef BUILD_WITH_TFT
 #include "alsa/asoundlib.h"
 #endif
 
-class AlsaSound
+class AlsaSound : public PcmDevice
 {
 public:
     AlsaSound();
@@ -32,6 +33,14 @@ public:
     /// all parameters of sound chip are correctly configured.
     bool play(unsigned char *data, int size);
 
+    /// Streaming sink with its own playback thread, created on first use.
+    /// Call updateParameters() before.
+    PcmStream & stream();
+
+    /// Post-processing of play() and the stream. The formats follow
+    /// updateParameters(), the gain and cross-feed can be set there.
+    PcmProcessor & processor() { return processor_; }
+
     /// Check if the device is enabled or not.
     inline bool isEnabled() { return enable_; }
     inline void enable(bool enable = true) { enable_ = enable; }
@@ -44,9 +53,12 @@ public:
 
     bool updateParameters();
 
-private:
-   int mono2Stereo(const unsigned char* mono_buf, long unsigned int frames, unsigned char* stereo_buf);
+public:
+    // PcmDevice, also used by play().
+    PcmProcessor & streamProcessor() { return processor_; }
+    bool writeDevice(const char *data, int size);
 
+private:
    bool setParams(unsigned int bitspersample, unsigned int channels, unsigned int samplerate);
 private:
 #ifdef BUILD_WITH_TFT
@@ -62,8 +74,8 @@ private:
     int           byte_per_frames_;
     int           audio_data_per_ms_;
     bool          conv2stereo_;
-    int           stereo_buff_len_;
-    unsigned char *stereo_buff_;
+    PcmProcessor  processor_;
+    scoped_ptr<PcmStream> stream_;
 };
 
 
@@ -0,0 +1,130 @@
+#ifndef ONYX_PCM_PROCESSOR_H_
+#define ONYX_PCM_PROCESSOR_H_
+
+#include <QtCore/QtCore>
+
+/// Duplicate each sample of mono into stereo, which must hold twice size
+/// bytes. Returns the bytes written to stereo. For formats the processor
+/// does not handle.
+int monoToStereo(const char *mono, int size, int bytes_per_sample, char *stereo);
+
+/// Cross-feed filter state, in the layout of the SIMD kernels:
+/// lowpass left and right, highboost left and right.
+struct PcmCrossFeed
+{
+    float a0[4];
+    float a1[4];
+    float b1[4];
+    float state[4];
+    float last[2];      ///< Previous input of the highboost filters.
+    float gain;         ///< Makes up for the bass boost.
+};
+
+/// Parameters of one pass over a block of frames.
+struct PcmKernelParams
+{
+    int in_channels;    ///< 1 or 2
+    int out_channels;   ///< 1 or 2
+    float gain;
+    bool soft_clip;     ///< Above unity gain, peaks are bent instead of cut.
+    PcmCrossFeed *cross_feed;   ///< Stereo output only, 0 if disabled.
+};
+
+/// Fused inner loop: channel expansion, cross-feed, gain and clipping in
+/// one pass over 16 bits samples.
+struct PcmKernels
+{
+    const char *name;
+    void (*run)(const PcmKernelParams & params, const qint16 *in, int frames, qint16 *out);
+};
+
+/// Post-processing of 16 bits PCM before it reaches the device: mono to
+/// stereo, linear interpolation to the device sample rate, optional
+/// bs2b style cross-feed and software gain with soft clipping. All the
+/// stages run in one pass over the samples, with SSE2 or NEON when the
+/// CPU has it. The SIMD kernels match the scalar one within one LSB.
+/// Other sample sizes only get their channels expanded.
+///
+/// The processor keeps the filter and resampler state from one call of
+/// process() to the next, so a stream must be fed in order.
+class PcmProcessor
+{
+public:
+    enum Kernel
+    {
+        KERNEL_AUTO = 0,    ///< The fastest one, or $ONYX_PCM_KERNEL.
+        KERNEL_SCALAR,
+        KERNEL_SSE2,
+        KERNEL_NEON,
+        KERNEL_COUNT
+    };
+
+    /// 0 if the kernel is not compiled in or the CPU lacks it.
+    static const PcmKernels *kernels(Kernel kernel);
+
+    PcmProcessor();
+    ~PcmProcessor();
+
+public:
+    /// A rate of 0 means the same as the other side.
+    void setInput(int rate, int channels, int bits = 16);
+    void setOutput(int rate, int channels);
+
+    /// 1.0 is unity. Above it, samples are soft clipped.
+    void setGain(float gain);
+    float gain() const { return gain_; }
+
+    /// bs2b parameters: cut frequency in Hz, feed level in tenths of dB.
+    /// Only for stereo output.
+    void setCrossFeed(bool enable, int cut_hz = 700, int feed_db10 = 45);
+    bool isCrossFeedEnabled() const { return cross_feed_enabled_; }
+
+    bool setKernel(Kernel kernel);
+    const char *kernelName() const { return kernels_->name; }
+
+    /// Nothing to do, the input can go to the device as is.
+    bool isIdentity() const;
+    bool isResampling() const;
+    bool isCrossFeeding() const;
+
+    int inputFrameBytes() const;
+
+    /// Bytes of output for at most input_bytes of input.
+    int maxOutputBytes(int input_bytes) const;
+
+    /// Converts whole input frames and writes them to out, which must hold
+    /// maxOutputBytes(size). Returns the bytes written.
+    int process(const char *in, int size, char *out);
+
+    /// Converts in and appends it to out.
+    void process(const char *in, int size, QByteArray & out);
+
+    /// Forgets the filter and resampler state, before unrelated data.
+    void reset();
+
+private:
+    int resample(const qint16 *in, int frames, qint16 *out);
+    void updateCrossFeed();
+
+private:
+    const PcmKernels *kernels_;
+    int in_rate_;
+    int in_channels_;
+    int in_bits_;
+    int out_rate_;
+    int out_channels_;
+    float gain_;
+
+    bool cross_feed_enabled_;
+    int cross_feed_cut_;
+    int cross_feed_level_;
+    PcmCrossFeed cross_feed_;
+
+    quint32 step_;          ///< Input frames per output frame, 16.16.
+    quint32 phase_;         ///< Position between last_ and the next frame, 16.16.
+    qint16 last_[2];        ///< Last input frame, for interpolation.
+    bool has_last_;
+    QVector<qint16> resampled_;
+};
+
+#endif // ONYX_PCM_PROCESSOR_H_
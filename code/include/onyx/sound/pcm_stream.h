@@ -0,0 +1,155 @@
+#ifndef ONYX_PCM_STREAM_H_
+#define ONYX_PCM_STREAM_H_
+
+#include "onyx/base/base.h"
+#include <QtCore/QtCore>
+#include "onyx/sound/pcm_processor.h"
+
+/// Single producer, single consumer ring buffer of PCM bytes. The
+/// producer and the consumer never take a lock: each of them owns one
+/// index and publishes it with a release store. The capacity is rounded
+/// up to a power of two.
+class PcmRingBuffer
+{
+public:
+    explicit PcmRingBuffer(int capacity);
+    ~PcmRingBuffer();
+
+public:
+    int capacity() const { return mask_ + 1; }
+
+    /// Bytes the consumer can read.
+    int available() const;
+
+    /// Bytes the producer can write.
+    int space() const;
+
+    /// Producer. Copies as much of data as fits, returns the bytes copied.
+    int write(const char *data, int size);
+
+    /// Consumer. Points data at the readable bytes which are contiguous
+    /// in memory, without copying them, and returns their count.
+    int peek(const char *& data) const;
+
+    /// Consumer. Releases bytes returned by peek().
+    void consume(int size);
+
+    /// Consumer. Drops everything written so far, returns the bytes dropped.
+    int discard();
+
+private:
+    char *data_;
+    int mask_;
+    mutable QAtomicInt read_;       ///< Written by the consumer only.
+    mutable QAtomicInt write_;      ///< Written by the producer only.
+
+    NO_COPY_AND_ASSIGN(PcmRingBuffer);
+};
+
+/// Device behind a PcmStream. Called in the playback thread only, or by
+/// the play() of the device, but not both at once.
+class PcmDevice
+{
+public:
+    virtual ~PcmDevice() {}
+
+    /// From the format written to the stream to the device layout.
+    virtual PcmProcessor & streamProcessor() = 0;
+
+    /// Blocking write of whole frames in the device layout.
+    virtual bool writeDevice(const char *data, int size) = 0;
+
+    /// Bytes per frame of the PCM written to the stream.
+    int streamFrameBytes() { return streamProcessor().inputFrameBytes(); }
+
+    /// Runs whole frames of the stream format through the processor, a
+    /// slice at a time on the stack, and writes them to the device.
+    bool writeStream(const char *data, int size);
+};
+
+/// Streaming sink for a sound device. The producer writes PCM with
+/// write(); a dedicated playback thread moves it from the ring buffer to
+/// the device, through the PcmProcessor of the device, so the only copy
+/// of the caller's data is the one into the ring.
+///
+/// write() and drain() must be called from one producer thread at a
+/// time. stop() is safe to call from any thread while write() or drain()
+/// is blocked, and makes them return.
+class PcmStream
+{
+public:
+    struct Stats
+    {
+        int capacity;
+        int buffered;           ///< Bytes waiting in the ring.
+        qint64 written;         ///< Bytes accepted by write().
+        qint64 played;          ///< Bytes handed to the device.
+        int underruns;          ///< The ring ran empty, then more data came without drain().
+        int device_errors;
+    };
+
+    /// Default ring, about 370ms of 16 bits mono at 22.05KHz.
+    static const int DEFAULT_CAPACITY = 16 * 1024;
+
+    PcmStream(PcmDevice & device, int capacity = DEFAULT_CAPACITY);
+    ~PcmStream();
+
+public:
+    /// Copies data into the ring, waiting for room when it's full.
+    /// Returns the bytes written, less than size only after stop() or
+    /// timeout.
+    int write(const char *data, int size, int timeout_ms = -1);
+
+    /// Waits until everything written has been played. Call it at the end
+    /// of the data, so that the ring running empty there is not counted as
+    /// an underrun.
+    bool drain(int timeout_ms = -1);
+
+    /// Drops the data not played yet, and makes write() and drain()
+    /// return. Thread-safe against them.
+    void stop();
+
+    Stats stats() const;
+    void resetStats();
+
+private:
+    class PlaybackThread;
+    friend class PlaybackThread;
+    void playbackLoop();
+    bool playSlice(const char *data, int size);
+    void notifyConsumer();
+    void notifyProducer();
+    void waitForProducer(int produced);
+    void waitForConsumer(int progress);
+
+private:
+    PcmDevice & device_;
+    PcmRingBuffer ring_;
+    scoped_ptr<PlaybackThread> thread_;
+
+    QMutex mutex_;              ///< Only to sleep and wake up.
+    QWaitCondition has_data_;   ///< Playback thread waits for produced_.
+    QWaitCondition has_room_;   ///< Producer waits for progress_.
+    QAtomicInt consumer_waiting_;
+    QAtomicInt producer_waiting_;
+    QAtomicInt produced_;       ///< Bumped by every write(), stop() and quit.
+    QAtomicInt progress_;       ///< Bumped by the playback thread.
+    QAtomicInt quit_;
+    QAtomicInt stops_;          ///< Calls to stop().
+    QAtomicInt stops_done_;     ///< Calls to stop() the playback thread has handled.
+
+    mutable QMutex stats_mutex_;
+    qint64 written_;
+    qint64 played_;
+    int underruns_;
+    int device_errors_;
+    qint64 total_written_;      ///< Not reset by resetStats().
+    qint64 total_consumed_;     ///< Played or dropped by stop().
+    qint64 drained_at_;         ///< total_written_ at the last drain().
+    bool starved_;              ///< Ran empty before drain(), an underrun if more data comes.
+    qint64 starved_at_;
+
+    NO_COPY_AND_ASSIGN(PcmStream);
+};
+
+#endif // ONYX_PCM_STREAM_H_
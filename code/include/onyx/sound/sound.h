@@ -2,10 +2,11 @@
 #define ONYX_SOUND_H_
 
 #include <QByteArray>
+#include "onyx/sound/pcm_stream.h"
 
 /// Manipulate sound card for linux based system.
 /// Helpful link: http://www.oreilly.de/catalog/multilinux/excerpt/ch14-05.htm
-class Sound
+class Sound : public PcmDevice
 {
 public:
     Sound(bool open = true, const char *dev = "/dev/dsp");
@@ -30,6 +31,14 @@ public:
     /// all parameters of sound chip are correctly configured.
     bool play(const char *data, int size);
 
+    /// Streaming sink with its own playback thread, created on first use.
+    /// Configure the device before, the format is read by every slice.
+    PcmStream & stream();
+
+    /// Post-processing of play() and the stream. The formats follow the
+    /// device settings, the gain and cross-feed can be set there.
+    PcmProcessor & processor() { return processor_; }
+
     /// Check if the device is enabled or not.
     inline bool isEnabled() { return enable_; }
     inline void enable(bool enable = true) { enable_ = enable; }
@@ -37,14 +46,23 @@ public:
     bool open(const char *device_name);
     void close();
 
+public:
+    // PcmDevice, also used by play().
+    PcmProcessor & streamProcessor() { return processor_; }
+    bool writeDevice(const char *data, int size);
+
 private:
-    QByteArray toStereo(const char *src, int size, const int bps);
+    void updateProcessor();
 
 private:
     int device_;
     bool enable_;   ///< Soft flag to enable or disable the device.
     int bps_;
     int channels_;
+    int rate_;
+    int device_rate_;   ///< What the driver accepted, may differ from rate_.
+    PcmProcessor processor_;
+    scoped_ptr<PcmStream> stream_;
 };
 
 
@@ -71,6 +71,7 @@ private:
     static bool makeSureTableExist(QSqlDatabase& database);
 
     static void loadAllServices(QSqlDatabase &, Services &);
+    static bool serviceForFile(QSqlDatabase &, const QString & path, Service &);
     static bool calibrationService(QSqlDatabase &, Service &);
     static bool metService(QSqlDatabase &, Service &);
     static bool musicService(QSqlDatabase &, Service & service);
@@ -100,6 +101,8 @@ private:
     static bool unRegisterService(QSqlDatabase &, const Service &);
 
     static void loadDefaultServices();
+    static void readAllServices(QSqlDatabase &, Services &);
+    static void updateIndex(QSqlDatabase &);
 };
 
 };
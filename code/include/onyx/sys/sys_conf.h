@@ -18,6 +18,8 @@ using namespace base;
 namespace sys
 {
 
+/// Values read often are served from the process wide SystemConfigCache,
+/// so a SystemConfig can be constructed just to read one of them.
 class SystemConfig
 {
 public:
@@ -30,6 +32,7 @@ public:
 
     // Services session.
     void loadAllServices(Services &);
+    bool serviceForFile(const QString & path, Service & service);
     bool calibrationService(Service &);
     bool metService(Service &);
     bool musicService(Service &);
@@ -159,6 +162,9 @@ public:
 
     static QString defaultAccessPoint();
 
+private:
+    void initializeTables();
+
 private:
     scoped_ptr<QSqlDatabase> database_;
 };
@@ -0,0 +1,60 @@
+/// Process wide cache of the values read from the system configuration
+/// database.
+
+#ifndef SYS_CONF_CACHE_H__
+#define SYS_CONF_CACHE_H__
+
+#include <QtGui/QtGui>
+#include "onyx/base/base.h"
+
+namespace sys
+{
+
+/// Process wide snapshot of the values read through SystemConfig, so
+/// that a throwaway SystemConfig does not query the database again.
+///
+/// The snapshot is dropped as soon as the database is written, by this
+/// process or by another one. SQLite increments the change counter in
+/// the database header at every write transaction; it's read before a
+/// value is served from memory, which costs one read of 4 bytes instead
+/// of a query. changed() is emitted when the event loop runs after
+/// another process wrote the database.
+class SystemConfigCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static SystemConfigCache & instance();
+
+    void attach(const QString & db_path);
+    bool find(const QString & key, QVariant & value);
+    void insert(const QString & key, const QVariant & value);
+    void invalidate();
+
+Q_SIGNALS:
+    void changed();
+
+private Q_SLOTS:
+    void onFileChanged(const QString & path);
+
+private:
+    SystemConfigCache();
+    ~SystemConfigCache();
+
+    quint32 changeCounter();
+    bool validate();
+
+private:
+    QMutex mutex_;
+    QString path_;
+    QFile file_;                    ///< Database file, for the header.
+    quint32 counter_;               ///< Change counter of the snapshot.
+    QHash<QString, QVariant> values_;
+    QFileSystemWatcher watcher_;
+
+    NO_COPY_AND_ASSIGN(SystemConfigCache);
+};
+
+}
+
+#endif  // SYS_CONF_CACHE_H__
@@ -34,6 +34,14 @@ enum MusicPlayerState
 /// Caller uses SysStatus to get system status. Caller can also
 /// change some system options through the methods provided by
 /// SysStatus.
+///
+/// The values returned by the getters are cached. Properties broadcast
+/// by system manager when they change (battery, volume, mute and sdio)
+/// are kept until the next broadcast or setter. The other ones can be
+/// changed by other processes without notice, they are kept for one
+/// second only, long enough for a repaint. The cache is dropped on
+/// wakeup. The asynchronous setters return at once and restore the
+/// previous value if system manager refuses the new one.
 class SysStatus : public QObject
 {
     Q_OBJECT;
@@ -158,6 +166,14 @@ class SysStatus : public QObject
     bool requestMultiTouch();
     bool queryLedSignal();
 
+    void setVolumeAsync(int volume);
+    void muteAsync(bool m);
+    void setGrayScaleAsync(int colors);
+    void setBrightnessAsync(const unsigned char brightness);
+    void setSuspendIntervalAsync(int ms);
+    void setShutdownIntervalAsync(int ms);
+    void invalidateProperties();
+
     // The following signals must be the same with system manager.
     // Need a better way to sync them.
   signals:
@@ -269,12 +285,31 @@ class SysStatus : public QObject
 
     void onUserBehaviorSignal(const QByteArray &data);
 
+    void onAsyncCallFinished(QDBusPendingCallWatcher *watcher);
+
   private:
     SysStatus();
     SysStatus(SysStatus & ref);
     void installSlots();
 
+    bool cachedCall(const QString & method, QList<QVariant> & args) const;
+    void cacheProperty(const QString & method, const QVariant & value) const;
+    void cacheProperty(const QString & method, const QList<QVariant> & args) const;
+    void asyncCall(const QString & method, const QVariant & value, const QString & property);
+
     QDBusConnection connection_;    ///< Connection to system manager.
+
+    /// Reply of a getter of system manager and when it was received.
+    struct Property
+    {
+        QList<QVariant> args;
+        QTime time;
+    };
+
+    /// Replies of the getters of system manager by method name.
+    typedef QHash<QString, Property> Properties;
+    mutable Properties properties_;
+
     bool usb_mounted_;
     bool sd_mounted_;
     bool flash_mounted_;
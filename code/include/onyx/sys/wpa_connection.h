@@ -7,12 +7,19 @@
 #include "onyx/base/dbus.h"
 #include "onyx/wpa/wpa_ctrl.h"
 #include "onyx/sys/wifi_conf.h"
+#include "onyx/sys/wpa_tokenizer.h"
 
 using namespace sys;
 
 /// Maintains connection to wpa_supplicant daemon.
 /// It sends command to wap_supplicant and broadcasts
 /// messages to all listeners.
+///
+/// Nothing is polled. The monitor connection is attached to
+/// wpa_supplicant and read when the socket notifier says there is an
+/// event; scan results are only fetched on CTRL-EVENT-SCAN-RESULTS,
+/// once for a burst of them. Replies and events are parsed in place
+/// by WpaTokenizer.
 class WpaConnection : public QObject
 {
     Q_OBJECT
@@ -45,6 +52,8 @@ public:
 
 public Q_SLOTS:
     int  openCtrlConnection(const QString & name = QString());
+    void setCtrlInterfaceDir(const QString & dir) { ctrl_dir_ = dir; }
+    const QString & ctrlInterfaceDir() const { return ctrl_dir_; }
     bool isWpaSupplicantConnected() { return wpa_supplicant_connected_; }
 
     bool update();
@@ -95,10 +104,11 @@ private:
 
     bool setWepKey(int network_id, const QString &key, int id);
 
-    void parseScanResult(WifiProfiles & result, QByteArray & data);
-    void parseMessage(QByteArray & data);
-    bool parseItem(QString & tag, QVariant & value, const QByteArray & data);
-    bool parseEntry(const QStringList & title, const QByteArray & data, QVariantMap & result);
+    void parseScanResult(WifiProfiles & result, const WpaToken & data);
+    void parseMessage(const WpaToken & data);
+    void fetchScanResults();
+    bool parseItem(const WpaToken & data, QVariantMap & result);
+    bool parseEntry(const QStringList & title, const WpaToken & data, QVariantMap & result);
     bool encryptionAttributes(WifiProfile & profile);
     bool detailInfo(WifiProfile & profile);
 
@@ -111,9 +121,11 @@ private:
 private:
     QDBusConnection connection_;    ///< Connection to system manager.
     bool wpa_supplicant_connected_;
+    QString ctrl_dir_;                    ///< Directory of the control sockets.
     QString ctrl_iface_;                  ///< Control interface.
     struct wpa_ctrl *ctrl_conn_;         ///< Control connection to send command.
     struct wpa_ctrl *monitor_conn_;      ///< monitor connection to receive notification.
+    QByteArray message_;                 ///< Buffer of the monitor connection.
 
     WifiProfiles cached_network_;   ///< All networks scanned.
     WifiProfile connecting_ap_;     ///< Access point currently used.
@@ -61,6 +61,7 @@ private Q_SLOTS:
     void triggerScan();
     void scan();
     void onScanTimeout();
+    void onCtrlInterfaceChanged();
     void onScanReturned(WifiProfiles & list);
 
     void onNeedPassword(WifiProfile profile);
@@ -99,6 +100,8 @@ private:
     bool isConnecting();
     void setConnecting(bool c);
     void stopAllTimers();
+    void waitForWpaSupplicant();
+    void stopWaitingForWpaSupplicant();
     void setState(WifiProfile profile, WpaConnection::ConnectionState s);
 
     bool isWifiEnabled() { return wifi_enabled_; }
@@ -110,7 +113,8 @@ private:
     QDBusConnection connection_;    ///< Connection to system manager.
     scoped_ptr<WpaConnection> proxy_;
 
-    QTimer scan_timer_;
+    QTimer scan_timer_;                 ///< Deadline to start wpa_supplicant.
+    QFileSystemWatcher ctrl_watcher_;   ///< Waits for the control socket.
     int scan_count_;     ///< Scan retry.
     int connect_retry_;
 
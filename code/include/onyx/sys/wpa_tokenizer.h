@@ -0,0 +1,140 @@
+#ifndef WPA_TOKENIZER_H_
+#define WPA_TOKENIZER_H_
+
+#include <ctype.h>
+#include <string.h>
+#include <QtCore/QtCore>
+
+/// Piece of a reply or a message of wpa_supplicant. It points into the
+/// received buffer and does not own the data, so it's only valid as
+/// long as the buffer is.
+class WpaToken
+{
+public:
+    WpaToken() : data_(0), size_(0) {}
+    WpaToken(const char *data, int size) : data_(data), size_(size) {}
+    explicit WpaToken(const QByteArray & data) : data_(data.constData()), size_(data.size()) {}
+
+    const char *data() const { return data_; }
+    int size() const { return size_; }
+    bool isEmpty() const { return size_ <= 0; }
+
+    bool startsWith(const char *prefix) const
+    {
+        int length = static_cast<int>(strlen(prefix));
+        return length <= size_ && memcmp(data_, prefix, length) == 0;
+    }
+
+    bool contains(const char *text) const
+    {
+        int length = static_cast<int>(strlen(text));
+        for(int i = 0; i + length <= size_; ++i)
+        {
+            if (memcmp(data_ + i, text, length) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int indexOf(char c) const
+    {
+        if (size_ <= 0)
+        {
+            return -1;
+        }
+        const void *p = memchr(data_, c, size_);
+        return p ? static_cast<int>(static_cast<const char *>(p) - data_) : -1;
+    }
+
+    WpaToken left(int n) const { return WpaToken(data_, qBound(0, n, size_)); }
+    WpaToken mid(int pos) const
+    {
+        pos = qBound(0, pos, size_);
+        return WpaToken(data_ + pos, size_ - pos);
+    }
+
+    /// Without leading and trailing white spaces.
+    WpaToken trimmed() const
+    {
+        int begin = 0, end = size_;
+        while (begin < end && isspace(static_cast<unsigned char>(data_[begin])))
+        {
+            ++begin;
+        }
+        while (end > begin && isspace(static_cast<unsigned char>(data_[end - 1])))
+        {
+            --end;
+        }
+        return WpaToken(data_ + begin, end - begin);
+    }
+
+    /// Event messages start with their priority, like "<3>".
+    WpaToken withoutPriority() const
+    {
+        if (size_ > 0 && data_[0] == '<')
+        {
+            int pos = indexOf('>');
+            if (pos > 0)
+            {
+                return mid(pos + 1);
+            }
+        }
+        return *this;
+    }
+
+    QByteArray toByteArray() const { return QByteArray(data_, size_); }
+    QString toString() const { return QString::fromUtf8(data_, size_); }
+
+private:
+    const char *data_;
+    int size_;
+};
+
+/// Split a reply of wpa_supplicant in lines or a line in fields without
+/// copying anything. Gives the same tokens as QByteArray::split, empty
+/// ones included.
+class WpaTokenizer
+{
+public:
+    WpaTokenizer(const WpaToken & data, char separator)
+        : data_(data), separator_(separator), pos_(0) {}
+
+    bool next(WpaToken & token)
+    {
+        if (pos_ > data_.size())
+        {
+            return false;
+        }
+        WpaToken rest = data_.mid(pos_);
+        int end = rest.indexOf(separator_);
+        if (end < 0)
+        {
+            end = rest.size();
+        }
+        token = rest.left(end);
+        pos_ += end + 1;
+        return true;
+    }
+
+    /// Number of the tokens left.
+    int count() const
+    {
+        WpaTokenizer copy(*this);
+        WpaToken token;
+        int n = 0;
+        while (copy.next(token))
+        {
+            ++n;
+        }
+        return n;
+    }
+
+private:
+    WpaToken data_;
+    char separator_;
+    int pos_;
+};
+
+#endif  // WPA_TOKENIZER_H_
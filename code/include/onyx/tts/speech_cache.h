@@ -0,0 +1,84 @@
+#ifndef ONYX_LIB_TTS_SPEECH_CACHE_H_
+#define ONYX_LIB_TTS_SPEECH_CACHE_H_
+
+#include "onyx/base/base.h"
+#include <QtCore/QtCore>
+
+namespace tts
+{
+
+/// Disk cache of synthesized PCM, one compressed file per chunk of text,
+/// so that passages read again are played without running the engine.
+/// Files are named after a hash of the engine, its settings and the
+/// text, and evicted least recently used first when the cache is over
+/// capacity. The order survives restarts through the file times.
+///
+/// The cache is thread-safe: the pipeline uses it from its synthesis
+/// thread while the statistics are read from the UI.
+class SpeechCache
+{
+public:
+    /// About 3 minutes of 16 bits stereo at 44.1KHz, before compression.
+    static const qint64 DEFAULT_CAPACITY = 32 * 1024 * 1024;
+
+    explicit SpeechCache(const QString & path = defaultPath(), qint64 capacity = DEFAULT_CAPACITY);
+    ~SpeechCache();
+
+    static QString defaultPath();
+
+    /// Identify the PCM of text spoken with the given settings. White
+    /// space in the text does not matter.
+    static QByteArray key(const QString & engine, const QString & speaker,
+                          int speed, int style, const QString & text);
+
+public:
+    const QString & path() const { return path_; }
+    void setCapacity(qint64 bytes);
+    qint64 capacity() const;
+    qint64 usedBytes() const;
+    int count() const;
+
+    bool insert(const QByteArray & key, const QByteArray & pcm);
+    bool contains(const QByteArray & key) const;
+    bool find(const QByteArray & key, QByteArray & pcm);
+    void remove(const QByteArray & key);
+    void clear();
+
+    int hits() const;
+    int misses() const;
+    int evictions() const;
+    double hitRate() const;
+    void resetStatistics();
+
+private:
+    struct Item
+    {
+        qint64 bytes;
+        unsigned int last_access;
+    };
+    typedef QHash<QByteArray, Item> Items;
+
+private:
+    void load();
+    void evictUntil(qint64 target);
+    void removeItem(const QByteArray & key);
+    static bool readFile(const QString & path, QByteArray & pcm);
+    QString filePath(const QByteArray & key) const;
+
+private:
+    mutable QMutex mutex_;
+    QString path_;
+    Items items_;
+    qint64 capacity_;
+    qint64 used_;
+    unsigned int clock_;
+    int hits_;
+    int misses_;
+    int evictions_;
+
+    NO_COPY_AND_ASSIGN(SpeechCache);
+};
+
+}   // namespace tts
+
+#endif  // ONYX_LIB_TTS_SPEECH_CACHE_H_
@@ -4,8 +4,8 @@
 #include "onyx/base/base.h"
 #include "onyx/ui/ui.h"
 #include "onyx/sound/sound.h"
-#include "onyx/sound/async_player.h"
 #include "tts_interface.h"
+#include "tts_pipeline.h"
 
 namespace tts
 {
@@ -57,6 +57,8 @@ public:
     bool setStyle(int style);
 
     Sound & sound();
+    SpeechPipeline * pipeline() { return pipeline_.get(); }
+    SpeechCache * cache() { return cache_.get(); }
 
 public Q_SLOTS:
     bool speak(const QString & text);
@@ -71,21 +73,22 @@ Q_SIGNALS:
     void TTSInitError();
 
 private Q_SLOTS:
-    void onSynthDone(bool ok, QByteArray &data);
-    void onTimeout();
-    void onPlayFinished(int);
+    void onSpeechFinished();
+
 private:
     bool loadPlugin();
     bool loadPreferPlugin(const QString & filePath);
     void init(const QLocale & locale);
+    bool initEngine(const QLocale & locale);
+    QMutex * engineMutex();
 
 private:
     scoped_ptr<Sound> sound_;
     TTS_State state_;
     TTS_Valid valid_;
-    QByteArray data_;   ///< Cached data.
     scoped_ptr<TTSInterface> tts_impl_; ///< Backend instance.
-    QTimer timer_;
+    scoped_ptr<SpeechCache> cache_;     ///< Used by pipeline_, outlives it.
+    scoped_ptr<SpeechPipeline> pipeline_;   ///< Streams tts_impl_ output.
     int span_;      ///< Serves as interval.
     int idle_count_;
 };
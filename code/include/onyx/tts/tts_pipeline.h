@@ -0,0 +1,131 @@
+#ifndef ONYX_LIB_TTS_PIPELINE_H_
+#define ONYX_LIB_TTS_PIPELINE_H_
+
+#include "onyx/base/base.h"
+#include "onyx/sound/sound.h"
+#include "tts_interface.h"
+#include "speech_cache.h"
+
+namespace tts
+{
+
+QStringList splitClauses(const QString & text, int min_length, int max_length);
+
+class PipelineThread;
+
+/// Streaming speech pipeline. The text is split at clause boundaries.
+/// A synthesis thread runs the engine on chunk N+1 while a playback
+/// thread feeds chunk N to the sound device in small slices, so the
+/// first clause is heard as soon as it's synthesized instead of after
+/// the whole page. Pause and stop take effect within one slice.
+///
+/// The engine must emit synthDone() before synthText() returns. It is
+/// only called from the synthesis thread; lock engineMutex() before
+/// using the engine from other threads, or change the settings through
+/// the pipeline.
+class SpeechPipeline : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SpeechPipeline(TTSInterface & engine, QObject *parent = 0);
+    ~SpeechPipeline();
+
+    void setStreaming(bool streaming);
+    bool isStreaming() const;
+    void setQueueLimit(int chunks);
+
+    /// Chunks found in the cache are played without the engine, the
+    /// others are stored once synthesized. Not owned, it must outlive
+    /// the pipeline. 0 to disable.
+    void setCache(SpeechCache *cache);
+    SpeechCache * cache() const;
+
+    bool start(const QString & text, Sound & sound);
+    void pause();
+    void resume(Sound & sound);
+    void stop();
+
+    bool isActive() const;
+    bool isPaused() const;
+    bool waitForDone(int timeout = -1);
+    QMutex & engineMutex() { return engine_mutex_; }
+
+    bool currentSpeaker(QString & speaker);
+    bool setSpeaker(const QString & speaker);
+    bool currentSpeed(int & speed);
+    bool setSpeed(int speed);
+    bool currentStyle(int & style);
+    bool setStyle(int style);
+
+    int firstAudioLatency() const;
+    int chunkCount() const;
+    int playedChunks() const;
+
+Q_SIGNALS:
+    /// The first PCM of the text is handed to the sound device.
+    void firstAudio(int latency_ms);
+
+    /// All chunks of the text have been played.
+    void finished();
+
+private Q_SLOTS:
+    void onSynthDone(bool ok, QByteArray & data);
+
+private:
+    friend class PipelineThread;
+    void synthLoop();
+    void playLoop();
+    bool isDone() const;
+    QByteArray cacheKey(const QString & text);
+    void applySettings();
+
+private:
+    enum Setting
+    {
+        SPEAKER = 1,
+        SPEED = 2,
+        STYLE = 4
+    };
+
+    TTSInterface & engine_;
+    mutable QMutex mutex_;
+    QMutex engine_mutex_;
+    QWaitCondition has_text_;   ///< Synthesis thread waits for text or room.
+    QWaitCondition has_audio_;  ///< Playback thread waits for PCM.
+    QWaitCondition idle_;       ///< Device released or text finished.
+
+    QQueue<QString> texts_;
+    QQueue<QByteArray> pcm_;
+    QByteArray synth_data_;     ///< Filled by onSynthDone, synthesis thread only.
+    int play_offset_;           ///< Bytes of pcm_.head() already played.
+    Sound *sound_;
+    SpeechCache *cache_;
+    unsigned int generation_;   ///< Bumped by stop() and start().
+    bool streaming_;
+    int queue_limit_;
+    bool active_;
+    bool paused_;
+    bool synthesizing_;
+    bool playing_;
+    bool quit_;
+
+    int pending_;               ///< Settings changed during a chunk.
+    QString pending_speaker_;
+    int pending_speed_;
+    int pending_style_;
+
+    QTime clock_;
+    int first_audio_;
+    int chunks_;
+    int played_;
+
+    scoped_ptr<PipelineThread> synth_thread_;
+    scoped_ptr<PipelineThread> play_thread_;
+
+    NO_COPY_AND_ASSIGN(SpeechPipeline);
+};
+
+}   // namespace tts
+
+#endif  // ONYX_LIB_TTS_PIPELINE_H_
@@ -106,6 +106,15 @@ public:
     /// restore the viewport by given reading history
     virtual void restoreByReadingHistory(const QVariant & item);
 
+    /// view port in content coordination
+    const QRect & viewPort() const { return display_area_.view; }
+
+    /// the space between each page
+    int spacing() const { return space_; }
+
+    /// pages are laid out horizontally or not
+    bool isHorizontal() { return isLandscape(); }
+
 private:
     // update the crop area
     void resetVisibleArea();
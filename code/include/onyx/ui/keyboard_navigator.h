@@ -11,6 +11,65 @@ QWidget * moveFocus(QWidget *parent, int key);
 
 QWidget * moveFocusCircularly(QWidget *parent, int key);
 
+/// Geometry of a focusable widget in the coordinates of the parent
+/// given to moveFocus.
+struct FocusEntry
+{
+    QWidget *widget;
+    int x;          ///< x position in the parent.
+    int y;          ///< y position in the parent.
+    int center;     ///< y center in the parent.
+    int order;      ///< Position in the widget tree.
+};
+
+/// Geometry of the visible focusable widgets under the parent widget
+/// given to moveFocus, which does not need to be a top level widget.
+///
+/// The geometry is relative to the parent, so it stays valid when the
+/// parent or its window moves. It is collected once and kept until a
+/// widget under the parent is moved, resized, shown, hidden, added or
+/// removed. The entries are sorted by x and by y center, so that the
+/// nearest widget in a direction is found by a binary search and a walk
+/// on both sides of it, instead of mapping every widget at each key
+/// press. Changing the focus policy of a widget does not send any event,
+/// call invalidate() after it.
+class FocusIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    static FocusIndex & instance(QWidget *parent);
+
+    QWidget * search(QWidget *current, int key);
+    void invalidate();
+
+    bool isValid() const { return valid_; }
+    int size();
+    int rebuilds() const { return rebuilds_; }
+
+protected:
+    bool eventFilter(QObject *obj, QEvent *event);
+
+private:
+    explicit FocusIndex(QWidget *parent);
+    ~FocusIndex();
+
+    void update();
+    void collect(QWidget *parent);
+    QWidget * nearest(const FocusEntry & from, bool vertical, int sign, bool wrap);
+
+private:
+    QWidget *parent_;
+    bool valid_;
+    int rebuilds_;
+    QVector<FocusEntry> by_x_;          ///< Sorted by x.
+    QVector<FocusEntry> by_center_;     ///< Sorted by y center.
+    int min_x_, max_x_;
+    int min_y_, max_y_;
+
+    NO_COPY_AND_ASSIGN(FocusIndex);
+};
+
 }
 
 #endif //  ONYX_KEYBOARD_NAVIGATOR_H_
@@ -0,0 +1,114 @@
+#ifndef PAGE_CACHE_H_
+#define PAGE_CACHE_H_
+
+#include "onyx/base/base.h"
+#include "onyx/ui/ui_global.h"
+#include "onyx/ui/render_policy.h"
+
+using namespace ui;
+
+namespace vbf
+{
+
+/// Identify a rendered page image. Zoom is kept in thousandths so that
+/// keys compare exactly. Settings is defined by the viewer, for example
+/// a combination of ImageRenderSetting values and contrast.
+struct PageCacheKey
+{
+    PageCacheKey()
+        : page(-1), zoom(0), rotation(ROTATE_0_DEGREE), settings(0) {}
+
+    PageCacheKey(int p, ZoomFactor z, RotateDegree r = ROTATE_0_DEGREE, int s = 0)
+        : page(p)
+        , zoom(static_cast<int>(z * 1000.0f + 0.5f))
+        , rotation(r)
+        , settings(s) {}
+
+    bool operator==(const PageCacheKey & right) const
+    {
+        return page == right.page &&
+               zoom == right.zoom &&
+               rotation == right.rotation &&
+               settings == right.settings;
+    }
+
+    int page;
+    int zoom;
+    RotateDegree rotation;
+    int settings;
+};
+
+uint qHash(const PageCacheKey & key);
+
+/// Cache of rendered page images with a byte budget.
+/// When the budget is exceeded, the image least useful for the reader is
+/// evicted: pages the render policy does not request go first, then pages
+/// of lower priority, then pages far from the current page, then the
+/// least recently used. The cache is thread-safe so that render tasks can
+/// insert images from worker threads.
+class PageCache
+{
+public:
+    static const size_t DEFAULT_BUDGET = 8 * 1024 * 1024;
+
+    explicit PageCache(size_t budget = DEFAULT_BUDGET);
+    ~PageCache();
+
+    void setBudget(size_t bytes);
+    size_t budget() const { return budget_; }
+    size_t usedBytes() const;
+    int count() const;
+
+    void setRenderPolicy(RenderPolicy *policy);
+    void setCurrentPage(int page);
+    int currentPage() const;
+
+    bool insert(const PageCacheKey & key, const QImage & image);
+    bool contains(const PageCacheKey & key) const;
+    QImage find(const PageCacheKey & key);
+    void remove(const PageCacheKey & key);
+    void removePage(int page);
+    void clear();
+
+    size_t shrink(size_t target);
+    size_t checkMemory();
+    size_t checkMemory(unsigned long free_memory);
+
+    int hits() const;
+    int misses() const;
+    int evictions() const;
+    double hitRate() const;
+    void resetStatistics();
+
+private:
+    struct Item
+    {
+        QImage image;
+        size_t bytes;
+        unsigned int last_access;
+    };
+    typedef QHash<PageCacheKey, Item> Items;
+
+private:
+    void evictUntil(size_t target);
+    bool isBetterVictim(const PageCacheKey & a, const Item & ia,
+                        const PageCacheKey & b, const Item & ib);
+    static size_t imageBytes(const QImage & image);
+
+private:
+    mutable QMutex mutex_;
+    Items items_;
+    size_t budget_;
+    size_t used_;
+    RenderPolicy *policy_;
+    int current_page_;
+    unsigned int clock_;
+    int hits_;
+    int misses_;
+    int evictions_;
+
+    NO_COPY_AND_ASSIGN(PageCache);
+};
+
+};
+#endif
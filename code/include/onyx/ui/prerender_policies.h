@@ -0,0 +1,108 @@
+#ifndef PRERENDER_POLICIES_H_
+#define PRERENDER_POLICIES_H_
+
+#include "onyx/ui/render_policy.h"
+
+namespace vbf
+{
+
+class ContinuousPageLayout;
+
+/// Prerender pages in the direction the user is reading.
+/// The direction is decided by the last turns, so a single step back
+/// to check a figure does not flip the prerender window.
+class DirectionalRenderPolicy : public RenderPolicy
+{
+public:
+    DirectionalRenderPolicy(int ahead = 2, int behind = 1, int history = 5);
+    virtual ~DirectionalRenderPolicy();
+
+    virtual void getRenderRequests(const int current_page,
+                                   const int previous_page,
+                                   const int total,
+                                   QVector<int> & result);
+
+    void setAhead(int ahead) { ahead_ = qMax(ahead, 0); }
+    int ahead() const { return ahead_; }
+    void setBehind(int behind) { behind_ = qMax(behind, 0); }
+    int behind() const { return behind_; }
+
+    int direction() const;
+    void reset();
+
+protected:
+    void recordTurn(const int current_page, const int previous_page);
+    void buildRequests(const int current_page,
+                       const int total,
+                       const int ahead,
+                       QVector<int> & result);
+
+private:
+    int ahead_;
+    int behind_;
+    int history_size_;
+    QList<int> history_;    ///< Recent turn directions, +1 or -1.
+};
+
+/// Directional policy whose prerender window widens when pages are
+/// turned quickly, e.g. when skimming, and shrinks back when the user
+/// reads slowly.
+class AdaptiveRenderPolicy : public DirectionalRenderPolicy
+{
+public:
+    AdaptiveRenderPolicy(int min_ahead = 2,
+                         int max_ahead = 8,
+                         int window_ms = 10000);
+    virtual ~AdaptiveRenderPolicy();
+
+    virtual void getRenderRequests(const int current_page,
+                                   const int previous_page,
+                                   const int total,
+                                   QVector<int> & result);
+
+    int currentAhead() const { return current_ahead_; }
+    int turnsInWindow() const { return turns_.size(); }
+
+protected:
+    /// Current time in ms. Trace replay overrides it.
+    virtual qint64 now();
+
+private:
+    int min_ahead_;
+    int max_ahead_;
+    int window_ms_;
+    int current_ahead_;
+    QQueue<qint64> turns_;  ///< Time of recent page turns.
+    QTime clock_;
+};
+
+/// Policy for ContinuousPageLayout. Visible pages come first, then the
+/// pages within a few view port lengths, nearest first. Pages in scroll
+/// direction win on equal distance.
+class ContinuousRenderPolicy : public RenderPolicy
+{
+public:
+    ContinuousRenderPolicy(ContinuousPageLayout *layout,
+                           qreal screens = 2.0,
+                           int max_pages = 8);
+    virtual ~ContinuousRenderPolicy();
+
+    virtual void getRenderRequests(const int current_page,
+                                   const int previous_page,
+                                   const int total,
+                                   QVector<int> & result);
+
+    void setScreens(qreal screens) { screens_ = screens; }
+    void setMaxPages(int pages) { max_pages_ = qMax(pages, 1); }
+
+private:
+    int pageLength(int page_number, int fallback);
+
+private:
+    ContinuousPageLayout *layout_;
+    qreal screens_;
+    int max_pages_;
+};
+
+};
+#endif
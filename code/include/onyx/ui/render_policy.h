@@ -34,6 +34,7 @@ protected:
 private:
     bool need_prerender_;
     RenderRequests requests_;
+    QVector<int> sources_;
 
     // Image render requests list should be thread-safe
     QMutex mutex_;
@@ -0,0 +1,378 @@
+#include <limits.h>
+
+#include "onyx/base/task_scheduler.h"
+
+namespace vbf
+{
+
+static const int MAX_WORKERS = 4;
+
+/// Posted to the scheduler when a task leaves the workers, so that the
+/// completion is reported and the task deleted in the scheduler's thread.
+class TaskDoneEvent : public QEvent
+{
+public:
+    static const QEvent::Type TYPE = static_cast<QEvent::Type>(QEvent::User + 0x7a5);
+
+    TaskDoneEvent(BaseTask *t, bool c)
+        : QEvent(TYPE)
+        , task(t)
+        , cancelled(c)
+    {
+    }
+
+    BaseTask *task;
+    bool cancelled;
+};
+
+class TaskWorker : public QThread
+{
+public:
+    explicit TaskWorker(TaskScheduler *scheduler) : scheduler_(scheduler) {}
+
+protected:
+    void run() { scheduler_->run(); }
+
+private:
+    TaskScheduler *scheduler_;
+};
+
+/// Construct the scheduler.
+/// \param workers Number of worker threads. If it's not positive, the
+/// number of cores is used.
+TaskScheduler::TaskScheduler(int workers, QObject *parent)
+    : QObject(parent)
+    , generation_(0)
+    , queued_(0)
+    , unfinished_(0)
+    , stopping_(false)
+{
+    if (workers <= 0)
+    {
+        workers = qBound(1, QThread::idealThreadCount(), MAX_WORKERS);
+    }
+    for (int i = 0; i < workers; ++i)
+    {
+        workers_.push_back(new TaskWorker(this));
+    }
+    // Workers read workers_, so start them after the list is complete.
+    foreach(TaskWorker *worker, workers_)
+    {
+        worker->start();
+    }
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    cancelAll();
+    {
+        QMutexLocker locker(&mutex_);
+        stopping_ = true;
+        has_work_.wakeAll();
+    }
+    foreach(TaskWorker *worker, workers_)
+    {
+        worker->wait();
+        delete worker;
+    }
+    workers_.clear();
+
+    // Tasks still in queue have been cancelled.
+    for (int i = 0; i < TASK_PRIORITY_COUNT; ++i)
+    {
+        for (Queue::iterator it = queues_[i].begin(); it != queues_[i].end(); ++it)
+        {
+            finish(*it, true);
+        }
+        queues_[i].clear();
+    }
+    queued_ = 0;
+
+    // Deliver what the workers reported before they stopped.
+    QCoreApplication::sendPostedEvents(this, TaskDoneEvent::TYPE);
+}
+
+/// Set the priority used by addTask(task) for tasks of the type.
+void TaskScheduler::setTypePriority(int type, TaskPriority priority)
+{
+    QMutexLocker locker(&mutex_);
+    type_priorities_[type] = priority;
+}
+
+/// Types without explicit priority are treated as prerender tasks.
+TaskPriority TaskScheduler::typePriority(int type) const
+{
+    QMutexLocker locker(&mutex_);
+    return type_priorities_.value(type, TASK_PRIORITY_PRERENDER);
+}
+
+void TaskScheduler::addTask(BaseTask *task)
+{
+    addTask(task, typePriority(task->type()));
+}
+
+/// Add the task to its priority class.
+/// \param front Put the task before other tasks of the same priority.
+void TaskScheduler::addTask(BaseTask *task, TaskPriority priority, bool front)
+{
+    if (task == 0)
+    {
+        return;
+    }
+
+    Entry entry;
+    entry.task = task;
+    entry.priority = qBound(0, static_cast<int>(priority), TASK_PRIORITY_COUNT - 1);
+
+    QMutexLocker locker(&mutex_);
+    entry.type_generation = type_generations_.value(task->type(), 0);
+    entry.generation = generation_;
+    if (front)
+    {
+        queues_[entry.priority].push_front(entry);
+    }
+    else
+    {
+        queues_[entry.priority].push_back(entry);
+    }
+    ++queued_;
+    ++unfinished_;
+    has_work_.wakeOne();
+}
+
+/// Cancel all queued and running tasks of the type. Running tasks are
+/// aborted, queued tasks are dropped when workers reach them.
+void TaskScheduler::cancelTasks(int type)
+{
+    QMutexLocker locker(&mutex_);
+    ++type_generations_[type];
+    foreach(const Entry & entry, running_)
+    {
+        if (entry.task->type() == type)
+        {
+            entry.task->abort();
+        }
+    }
+    // Let idle workers clean up the queue.
+    has_work_.wakeAll();
+}
+
+void TaskScheduler::cancelAll()
+{
+    QMutexLocker locker(&mutex_);
+    ++generation_;
+    foreach(const Entry & entry, running_)
+    {
+        entry.task->abort();
+    }
+    has_work_.wakeAll();
+}
+
+/// Abort running tasks without touching the queue.
+void TaskScheduler::abortRunning()
+{
+    QMutexLocker locker(&mutex_);
+    foreach(const Entry & entry, running_)
+    {
+        entry.task->abort();
+    }
+}
+
+/// Pause all running tasks. They are put back to the end of their
+/// priority class and restarted later.
+void TaskScheduler::pauseRunning()
+{
+    QMutexLocker locker(&mutex_);
+    foreach(const Entry & entry, running_)
+    {
+        entry.task->pause();
+    }
+}
+
+/// Number of queued tasks, including cancelled ones not dropped yet.
+int TaskScheduler::pendingCount() const
+{
+    QMutexLocker locker(&mutex_);
+    return queued_;
+}
+
+int TaskScheduler::runningCount() const
+{
+    QMutexLocker locker(&mutex_);
+    return running_.size();
+}
+
+/// Number of tasks whose taskFinished() has not been emitted yet.
+int TaskScheduler::unfinishedCount() const
+{
+    QMutexLocker locker(&mutex_);
+    return unfinished_;
+}
+
+bool TaskScheduler::isIdle() const
+{
+    QMutexLocker locker(&mutex_);
+    return queued_ == 0 && running_.isEmpty();
+}
+
+/// Block until the workers have nothing to do. Completion events still
+/// need the event loop to be delivered.
+bool TaskScheduler::waitForIdle(int timeout)
+{
+    QMutexLocker locker(&mutex_);
+    QTime t;
+    t.start();
+    while (queued_ > 0 || !running_.isEmpty())
+    {
+        unsigned long remain = ULONG_MAX;
+        if (timeout >= 0)
+        {
+            if (t.elapsed() >= timeout)
+            {
+                return false;
+            }
+            remain = timeout - t.elapsed();
+        }
+        idle_.wait(&mutex_, remain);
+    }
+    return true;
+}
+
+bool TaskScheduler::isStale(const Entry & entry) const
+{
+    return entry.generation != generation_ ||
+           entry.type_generation != type_generations_.value(entry.task->type(), 0);
+}
+
+/// Pick the next task of highest priority. Cancelled entries met on
+/// the way are reported and dropped. Called with mutex_ locked.
+bool TaskScheduler::takeNext(Entry & entry)
+{
+    for (int i = 0; i < TASK_PRIORITY_COUNT; ++i)
+    {
+        Queue & queue = queues_[i];
+        while (!queue.empty())
+        {
+            Entry front = queue.front();
+            queue.pop_front();
+            --queued_;
+            if (isStale(front))
+            {
+                finish(front, true);
+                continue;
+            }
+            entry = front;
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Check if a waiting task of higher priority should take this worker.
+/// Called with mutex_ locked.
+bool TaskScheduler::shouldYield(int priority) const
+{
+    if (running_.size() < workers_.size())
+    {
+        return false;
+    }
+    for (int i = 0; i < priority; ++i)
+    {
+        if (!queues_[i].empty())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Report the task to the scheduler's thread. Called with mutex_ locked.
+void TaskScheduler::finish(const Entry & entry, bool cancelled)
+{
+    QCoreApplication::postEvent(this, new TaskDoneEvent(entry.task, cancelled));
+}
+
+/// Worker thread loop.
+void TaskScheduler::run()
+{
+    QMutexLocker locker(&mutex_);
+    while (!stopping_)
+    {
+        Entry entry;
+        if (!takeNext(entry))
+        {
+            if (running_.isEmpty())
+            {
+                idle_.wakeAll();
+            }
+            has_work_.wait(&mutex_);
+            continue;
+        }
+
+        running_.push_back(entry);
+        BaseTask *task = entry.task;
+        bool yielded = false;
+        locker.unlock();
+
+        while (task->status() == TASK_RUN)
+        {
+            task->exec();
+
+            locker.relock();
+            yielded = (task->status() == TASK_RUN && shouldYield(entry.priority));
+            locker.unlock();
+            if (yielded)
+            {
+                break;
+            }
+        }
+
+        locker.relock();
+        for (int i = 0; i < running_.size(); ++i)
+        {
+            if (running_[i].task == task)
+            {
+                running_.removeAt(i);
+                break;
+            }
+        }
+
+        bool cancelled = isStale(entry);
+        if (!cancelled && (yielded || task->status() == TASK_PAUSE))
+        {
+            // Yielded tasks continue first, paused ones wait for others
+            // of the same priority, the same as TasksHandler.
+            task->start();
+            if (yielded)
+            {
+                queues_[entry.priority].push_front(entry);
+            }
+            else
+            {
+                queues_[entry.priority].push_back(entry);
+            }
+            ++queued_;
+            continue;
+        }
+        finish(entry, cancelled);
+    }
+}
+
+bool TaskScheduler::event(QEvent *e)
+{
+    if (e->type() != TaskDoneEvent::TYPE)
+    {
+        return QObject::event(e);
+    }
+
+    TaskDoneEvent *done = static_cast<TaskDoneEvent *>(e);
+    {
+        QMutexLocker locker(&mutex_);
+        --unfinished_;
+    }
+    emit taskFinished(done->task, done->cancelled);
+    delete done->task;
+    return true;
+}
+
+}  // namespace vbf
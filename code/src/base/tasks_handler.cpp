@@ -9,6 +9,7 @@ TasksHandler::TasksHandler()
     : task_timer_()
     , tasks_()
     , cur_task_(0)
+    , scheduler_(0)
 {
     connect(&task_timer_, SIGNAL(timeout()), this, SLOT(execute()));
 }
@@ -28,6 +29,23 @@ TasksHandler::~TasksHandler()
 /// if the timer stops when adding, start it
 void TasksHandler::addTask(BaseTask *t, bool append)
 {
+    if (scheduler_)
+    {
+        if (append)
+        {
+            scheduler_->addTask(t);
+        }
+        else
+        {
+            // As on the GUI thread, the running tasks are aborted
+            // whatever their type.
+            scheduler_->cancelTasks(t->type());
+            scheduler_->abortRunning();
+            scheduler_->addTask(t, scheduler_->typePriority(t->type()), true);
+        }
+        return;
+    }
+
     if (append)
     {
         tasks_.append(t);
@@ -51,6 +69,11 @@ void TasksHandler::addTask(BaseTask *t, bool append)
 /// otherwise execute the next task
 void TasksHandler::abortCurTask()
 {
+    if (scheduler_)
+    {
+        scheduler_->abortRunning();
+    }
+
     if (cur_task_)
     {
         cur_task_->abort();
@@ -62,6 +85,11 @@ void TasksHandler::abortCurTask()
 /// otherwise execute the next task
 void TasksHandler::pauseCurTask()
 {
+    if (scheduler_)
+    {
+        scheduler_->pauseRunning();
+    }
+
     if (cur_task_)
     {
         cur_task_->pause();
@@ -139,6 +167,11 @@ void TasksHandler::removeCurrentTask()
 /// Clear the tasks queue and current task
 void TasksHandler::clearTasks()
 {
+    if (scheduler_)
+    {
+        scheduler_->cancelAll();
+    }
+
     removeCurrentTask();
     tasks_.clear();
 }
@@ -146,6 +179,11 @@ void TasksHandler::clearTasks()
 /// Clear the tasks with given type
 void TasksHandler::clearTasks(int t)
 {
+    if (scheduler_)
+    {
+        scheduler_->cancelTasks(t);
+    }
+
     tasks_.clear<int>(t);
 }
 
@@ -178,7 +216,18 @@ BaseTask* TasksHandler::currentTask()
 /// Check whether the task queue is empty or not
 bool TasksHandler::isEmpty()
 {
+    if (scheduler_ && !scheduler_->isIdle())
+    {
+        return false;
+    }
     return (tasks_.size() == 0);
 }
 
+/// Forward all following tasks to the worker pool. Tasks already added
+/// keep running on the GUI thread.
+void TasksHandler::setScheduler(TaskScheduler *scheduler)
+{
+    scheduler_ = scheduler;
+}
+
 }  // namespace vbf
@@ -0,0 +1,244 @@
+#include "onyx/cms/annotation_index.h"
+
+namespace cms
+{
+
+/// Chinese, Japanese and Korean characters, written without spaces.
+static bool isIdeographic(const QChar & c)
+{
+    ushort u = c.unicode();
+    return (u >= 0x2e80 && u <= 0x9fff) ||
+           (u >= 0xac00 && u <= 0xd7af) ||
+           (u >= 0xf900 && u <= 0xfaff);
+}
+
+/// The smallest string greater than every string starting with prefix.
+static QString prefixEnd(const QString & prefix)
+{
+    QString end(prefix);
+    int last = end.size() - 1;
+    end[last] = QChar(end.at(last).unicode() + 1);
+    return end;
+}
+
+AnnotationIndex::AnnotationIndex(void)
+{
+}
+
+AnnotationIndex::~AnnotationIndex(void)
+{
+}
+
+QStringList AnnotationIndex::tokenize(const QString & text)
+{
+    QStringList words;
+    QString word;
+    for(int i = 0; i < text.size(); ++i)
+    {
+        const QChar & c = text.at(i);
+        if (isIdeographic(c) || !c.isLetterOrNumber())
+        {
+            if (!word.isEmpty())
+            {
+                words.push_back(word);
+                word.clear();
+            }
+            if (isIdeographic(c))
+            {
+                words.push_back(QString(c));
+            }
+        }
+        else
+        {
+            word.append(c.toLower());
+        }
+    }
+    if (!word.isEmpty())
+    {
+        words.push_back(word);
+    }
+    return words;
+}
+
+bool AnnotationIndex::makeSureTableExist(QSqlDatabase &database)
+{
+    QSqlQuery query(database);
+    return query.exec( "create table if not exists annotation_index ("
+                       "id integer primary key, "
+                       "document text, "
+                       "page integer, "
+                       "annotation integer, "
+                       "title text)") &&
+           query.exec( "create index if not exists annotation_index_document "
+                       "on annotation_index (document, page)") &&
+           query.exec( "create table if not exists annotation_word ("
+                       "word text, "
+                       "annotation_id integer)") &&
+           query.exec( "create index if not exists annotation_word_index "
+                       "on annotation_word (word, annotation_id)");
+}
+
+bool AnnotationIndex::removeTable(QSqlDatabase &database)
+{
+    QSqlQuery query(database);
+    query.exec( "drop table annotation_word" );
+    return query.exec( "drop table annotation_index" );
+}
+
+/// Remove the rows of a page, or of all pages when page is -1.
+bool AnnotationIndex::removeRows(QSqlQuery & query,
+                                 const QString & document,
+                                 int page)
+{
+    QString condition("document = ?");
+    if (page >= 0)
+    {
+        condition += " and page = ?";
+    }
+
+    query.prepare( "delete from annotation_word where annotation_id in "
+                   "(select id from annotation_index where " + condition + ")" );
+    query.addBindValue(document);
+    if (page >= 0)
+    {
+        query.addBindValue(page);
+    }
+    if (!query.exec())
+    {
+        return false;
+    }
+
+    query.prepare( "delete from annotation_index where " + condition );
+    query.addBindValue(document);
+    if (page >= 0)
+    {
+        query.addBindValue(page);
+    }
+    return query.exec();
+}
+
+/// Replace the indexed annotations of the page by the titles. An empty
+/// list removes the page.
+bool AnnotationIndex::updatePage(QSqlDatabase &database,
+                                 const QString & document,
+                                 int page,
+                                 const QStringList & titles)
+{
+    database.transaction();
+    QSqlQuery query(database);
+    bool ok = removeRows(query, document, page);
+    for(int i = 0; ok && i < titles.size(); ++i)
+    {
+        QStringList words = tokenize(titles.at(i));
+        if (words.isEmpty())
+        {
+            continue;
+        }
+
+        query.prepare( "insert into annotation_index (document, page, annotation, title) "
+                       "values (?, ?, ?, ?)" );
+        query.addBindValue(document);
+        query.addBindValue(page);
+        query.addBindValue(i);
+        query.addBindValue(titles.at(i));
+        ok = query.exec();
+        if (!ok)
+        {
+            break;
+        }
+
+        QVariant id = query.lastInsertId();
+        words.removeDuplicates();
+        query.prepare( "insert into annotation_word (word, annotation_id) values (?, ?)" );
+        foreach(const QString & word, words)
+        {
+            query.bindValue(0, word);
+            query.bindValue(1, id);
+            ok = ok && query.exec();
+        }
+    }
+
+    if (!ok)
+    {
+        qDebug() << query.lastError();
+        database.rollback();
+        return false;
+    }
+    return database.commit();
+}
+
+bool AnnotationIndex::removeDocument(QSqlDatabase &database,
+                                     const QString & document)
+{
+    database.transaction();
+    QSqlQuery query(database);
+    if (!removeRows(query, document, -1))
+    {
+        database.rollback();
+        return false;
+    }
+    return database.commit();
+}
+
+/// Annotations matching every word of the text, by document and page.
+/// Each word is a range scan of the word index.
+bool AnnotationIndex::search(QSqlDatabase &database,
+                             const QString & text,
+                             AnnotationHits & hits,
+                             int limit)
+{
+    hits.clear();
+    QStringList words = tokenize(text);
+    words.removeDuplicates();
+    if (words.isEmpty())
+    {
+        return true;
+    }
+
+    QStringList ranges;
+    for(int i = 0; i < words.size(); ++i)
+    {
+        ranges.push_back("select annotation_id from annotation_word "
+                         "where word >= ? and word < ?");
+    }
+
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+    query.prepare( "select document, page, annotation, title from annotation_index "
+                   "where id in (" + ranges.join(" intersect ") + ") "
+                   "order by document, page, annotation limit ?" );
+    foreach(const QString & word, words)
+    {
+        query.addBindValue(word);
+        query.addBindValue(prefixEnd(word));
+    }
+    query.addBindValue(limit);
+    if (!query.exec())
+    {
+        qDebug() << query.lastError();
+        return false;
+    }
+
+    while (query.next())
+    {
+        AnnotationHit hit;
+        hit.document = query.value(0).toString();
+        hit.page = query.value(1).toInt();
+        hit.annotation = query.value(2).toInt();
+        hit.title = query.value(3).toString();
+        hits.push_back(hit);
+    }
+    return true;
+}
+
+int AnnotationIndex::count(QSqlDatabase &database)
+{
+    QSqlQuery query(database);
+    if (query.exec("select count(*) from annotation_index") && query.next())
+    {
+        return query.value(0).toInt();
+    }
+    return 0;
+}
+
+}
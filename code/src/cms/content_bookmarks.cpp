@@ -3,6 +3,31 @@
 namespace cms
 {
 
+static QByteArray toBlob(const QVariant & data)
+{
+    QByteArray blob;
+    QDataStream stream(&blob, QIODevice::WriteOnly);
+    stream << data;
+    return blob;
+}
+
+static QVariant fromBlob(const QByteArray & blob)
+{
+    QVariant data;
+    QDataStream stream(blob);
+    stream >> data;
+    return data;
+}
+
+static void readEntries(QSqlQuery & query, BookmarkEntries & entries)
+{
+    while (query.next())
+    {
+        entries.push_back(BookmarkEntry(query.value(0).toString(),
+                                        fromBlob(query.value(1).toByteArray())));
+    }
+}
+
 ContentBookmarks::ContentBookmarks(void)
 {
 }
@@ -14,11 +39,310 @@ ContentBookmarks::~ContentBookmarks(void)
 bool ContentBookmarks::makeSureTableExist(QSqlDatabase &database)
 {
     QSqlQuery query(database);
-    return query.exec( "create table if not exists content_bookmarks ("
-                       "id integer primary key, "
-                       "bookmarks blob)");
+    bool ok = query.exec( "create table if not exists content_bookmarks ("
+                          "id integer primary key, "
+                          "bookmarks blob)") &&
+              query.exec( "create table if not exists bookmark ("
+                          "id integer primary key, "
+                          "content_id integer, "
+                          "sequence integer, "
+                          "position real, "
+                          "title text, "
+                          "data blob)") &&
+              checkColumns(database) &&
+              query.exec( "create index if not exists bookmark_position_index "
+                          "on bookmark (content_id, position)") &&
+              query.exec( "create index if not exists bookmark_sequence_index "
+                          "on bookmark (content_id, sequence)");
+    return ok && migrate(database);
+}
+
+/// Tables created before the sequence column keep the order of the ids.
+bool ContentBookmarks::checkColumns(QSqlDatabase &database)
+{
+    QSqlQuery query(database);
+    query.prepare("select sql from sqlite_master where name = ?");
+    query.addBindValue("bookmark");
+    if (!query.exec() || !query.next() ||
+        query.value(0).toString().contains("sequence"))
+    {
+        return true;
+    }
+
+    database.transaction();
+    if (!query.exec("alter table bookmark add sequence integer") ||
+        !query.exec("update bookmark set sequence = id"))
+    {
+        qDebug() << query.lastError();
+        database.rollback();
+        return false;
+    }
+    return database.commit();
+}
 
-    // May also need to create a index.
+/// Move the blobs to the rows. A blob that can not be read is left
+/// in place.
+///
+/// content.db is shared by the processes, which all run this when they
+/// open it. The blobs are read, moved and removed in one immediate
+/// transaction, so that a second process waits for the first one and
+/// then finds no blob left.
+bool ContentBookmarks::migrate(QSqlDatabase &database)
+{
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+    if (!query.exec("select id from content_bookmarks limit 1"))
+    {
+        return false;
+    }
+    if (!query.next())
+    {
+        return true;
+    }
+    query.finish();
+
+    if (!query.exec("begin immediate"))
+    {
+        qDebug() << query.lastError();
+        return false;
+    }
+
+    QList<QPair<cms_long, BookmarkEntries> > found;
+    bool ok = query.exec("select id, bookmarks from content_bookmarks");
+    while (ok && query.next())
+    {
+        // Same layout as QVector<vbf::Bookmark>.
+        QByteArray blob = query.value(1).toByteArray();
+        QDataStream stream(blob);
+        quint32 count = 0;
+        stream >> count;
+        BookmarkEntries entries;
+        for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+        {
+            BookmarkEntry entry;
+            stream >> entry.first >> entry.second;
+            entries.push_back(entry);
+        }
+        if (stream.status() != QDataStream::Ok || !stream.atEnd())
+        {
+            qWarning("Could not read bookmarks of %lld", query.value(0).toLongLong());
+            continue;
+        }
+        found.push_back(qMakePair(query.value(0).toLongLong(), entries));
+    }
+    query.finish();
+
+    // The blob is written by older versions only, it replaces the rows.
+    for (int i = 0; ok && i < found.size(); ++i)
+    {
+        const cms_long id = found[i].first;
+        const BookmarkEntries & entries = found[i].second;
+        ok = removeEntries(database, id);
+        for (int j = 0; ok && j < entries.size(); ++j)
+        {
+            ok = insertEntry(query, id, entries[j], j);
+        }
+        ok = ok && removeBookmarks(database, id);
+    }
+
+    if (!ok)
+    {
+        qDebug() << query.lastError();
+        query.exec("rollback");
+        return false;
+    }
+    return query.exec("commit");
+}
+
+/// The position key of a bookmark: its data when it's a number, null
+/// otherwise.
+QVariant ContentBookmarks::position(const QVariant & data)
+{
+    switch (data.type())
+    {
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+    case QVariant::Double:
+        return data.toDouble();
+    default:
+        if (data.userType() == QMetaType::Float)
+        {
+            return data.toDouble();
+        }
+        return QVariant(QVariant::Double);
+    }
+}
+
+bool ContentBookmarks::insertEntry(QSqlQuery & query,
+                                   const cms_long id,
+                                   const BookmarkEntry & entry,
+                                   int sequence)
+{
+    query.prepare( "insert into bookmark (content_id, sequence, position, title, data) "
+                   "values (?, ?, ?, ?, ?)" );
+    query.addBindValue(id);
+    query.addBindValue(sequence);
+    query.addBindValue(position(entry.second));
+    query.addBindValue(entry.first);
+    query.addBindValue(toBlob(entry.second));
+    return query.exec();
+}
+
+/// All the bookmarks of the content, in the order they were saved.
+/// Bookmarks added one by one are in position order among them.
+bool ContentBookmarks::getEntries(QSqlDatabase &database,
+                                  const cms_long id,
+                                  BookmarkEntries & entries)
+{
+    entries.clear();
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+    query.prepare( "select title, data from bookmark where content_id = ? "
+                   "order by sequence, id" );
+    query.addBindValue(id);
+    if (!query.exec())
+    {
+        return false;
+    }
+    readEntries(query, entries);
+    return true;
+}
+
+/// The bookmarks whose position is in [first, last], for example the
+/// pages on the screen, in position order.
+bool ContentBookmarks::getEntries(QSqlDatabase &database,
+                                  const cms_long id,
+                                  double first,
+                                  double last,
+                                  BookmarkEntries & entries)
+{
+    entries.clear();
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+    query.prepare( "select title, data from bookmark where content_id = ? "
+                   "and position >= ? and position <= ? "
+                   "order by position, id" );
+    query.addBindValue(id);
+    query.addBindValue(first);
+    query.addBindValue(last);
+    if (!query.exec())
+    {
+        return false;
+    }
+    readEntries(query, entries);
+    return true;
+}
+
+/// Replace all the bookmarks of the content. Bookmarks without position
+/// keep the order of the list.
+bool ContentBookmarks::replaceEntries(QSqlDatabase &database,
+                                      const cms_long id,
+                                      const BookmarkEntries & entries)
+{
+    database.transaction();
+    bool ok = removeEntries(database, id);
+    QSqlQuery query(database);
+    for (int i = 0; ok && i < entries.size(); ++i)
+    {
+        ok = insertEntry(query, id, entries[i], i);
+    }
+    if (!ok)
+    {
+        database.rollback();
+        return false;
+    }
+    return database.commit();
+}
+
+/// Add the bookmark, unless the same title and data are already there.
+/// A bookmark with a numeric position goes after the last one whose
+/// position is not greater, so that bookmarks saved in position order
+/// stay in position order. The others go at the end.
+bool ContentBookmarks::addEntry(QSqlDatabase &database,
+                                const cms_long id,
+                                const BookmarkEntry & entry)
+{
+    QSqlQuery query(database);
+    query.prepare( "select id from bookmark where content_id = ? "
+                   "and title = ? and data = ?" );
+    query.addBindValue(id);
+    query.addBindValue(entry.first);
+    query.addBindValue(toBlob(entry.second));
+    if (!query.exec() || query.next())
+    {
+        return false;
+    }
+
+    database.transaction();
+    QVariant key = position(entry.second);
+    if (key.isNull())
+    {
+        query.prepare( "select max(sequence) + 1 from bookmark where content_id = ?" );
+        query.addBindValue(id);
+    }
+    else
+    {
+        query.prepare( "select coalesce((select max(sequence) + 1 from bookmark "
+                       "where content_id = ? and position <= ?), "
+                       "(select min(sequence) from bookmark where content_id = ?))" );
+        query.addBindValue(id);
+        query.addBindValue(key);
+        query.addBindValue(id);
+    }
+    bool ok = query.exec();
+    int sequence = (ok && query.next()) ? query.value(0).toInt() : 0;
+    query.finish();
+
+    // Make room for it.
+    query.prepare( "update bookmark set sequence = sequence + 1 "
+                   "where content_id = ? and sequence >= ?" );
+    query.addBindValue(id);
+    query.addBindValue(sequence);
+    ok = ok && query.exec() && insertEntry(query, id, entry, sequence);
+    if (!ok)
+    {
+        qDebug() << query.lastError();
+        database.rollback();
+        return false;
+    }
+    return database.commit();
+}
+
+bool ContentBookmarks::removeEntry(QSqlDatabase &database,
+                                   const cms_long id,
+                                   const BookmarkEntry & entry)
+{
+    QSqlQuery query(database);
+    query.prepare( "delete from bookmark where content_id = ? "
+                   "and title = ? and data = ?" );
+    query.addBindValue(id);
+    query.addBindValue(entry.first);
+    query.addBindValue(toBlob(entry.second));
+    return query.exec() && query.numRowsAffected() > 0;
+}
+
+bool ContentBookmarks::removeEntries(QSqlDatabase &database,
+                                     const cms_long id)
+{
+    QSqlQuery query(database);
+    query.prepare( "delete from bookmark where content_id = ?" );
+    query.addBindValue(id);
+    return query.exec();
+}
+
+int ContentBookmarks::entryCount(QSqlDatabase &database,
+                                 const cms_long id)
+{
+    QSqlQuery query(database);
+    query.prepare( "select count(*) from bookmark where content_id = ?" );
+    query.addBindValue(id);
+    if (query.exec() && query.next())
+    {
+        return query.value(0).toInt();
+    }
+    return 0;
 }
 
 bool ContentBookmarks::getBookmarks(QSqlDatabase &database,
@@ -80,6 +404,7 @@ bool ContentBookmarks::updateBookmarks(QSqlDatabase &database,
 bool ContentBookmarks::removeTable(QSqlDatabase &database)
 {
     QSqlQuery query(database);
+    query.exec( "drop table bookmark" );
     return query.exec( "drop table content_bookmarks" );
 }
 }
@@ -106,6 +106,8 @@ bool ContentCategory::makeSureTableExist(QSqlDatabase & database)
                 "content_id integer , "
                 "category_id integer  "
                 ")");
+    query.exec( "create index if not exists content_category_index "
+                "on content_category (category_id)" );
 
     // category_category relationship table.
     query.exec( "create table if not exists category_category ("
@@ -7,6 +7,7 @@
 #include "onyx/cms/content_bookmarks.h"
 #include "onyx/cms/content_shortcut.h"
 #include "onyx/cms/notes_manager.h"
+#include "onyx/cms/annotation_index.h"
 
 
 namespace cms
@@ -18,8 +19,20 @@ const cms_long ContentManager::SERVER_ROOT_CATEGORY_ID  = 2;
 const cms_long ContentManager::RECENT_DOCUMENTS_ID      = 3;
 const cms_long ContentManager::READING_LISTS_ID         = 4;
 
-ContentManager::ContentManager()
+/// Serializes the table creation, the migrations and the creation of the
+/// categories, which check and insert rows, when several threads open the
+/// same database at the same time.
+static QMutex & initializeMutex()
+{
+    static QMutex mutex;
+    return mutex;
+}
+
+/// A connection can only be used by the thread creating it. Threads
+/// other than the main one need their own connection name.
+ContentManager::ContentManager(const QString & connection)
 : database_()
+, connection_(connection)
 , root_category_()
 , local_root_category_()
 , server_root_category_()
@@ -38,13 +51,13 @@ bool ContentManager::open(const QString & database_name)
 {
     if (!database_)
     {
-        if (QSqlDatabase::contains("cms"))
+        if (QSqlDatabase::contains(connection_))
         {
-            database_.reset(new QSqlDatabase(QSqlDatabase::database("cms")));
+            database_.reset(new QSqlDatabase(QSqlDatabase::database(connection_)));
         }
         else
         {
-            database_.reset(new QSqlDatabase(QSqlDatabase::addDatabase("QSQLITE", "cms")));
+            database_.reset(new QSqlDatabase(QSqlDatabase::addDatabase("QSQLITE", connection_)));
         }
     }
 
@@ -61,6 +74,7 @@ bool ContentManager::open(const QString & database_name)
             qDebug() << database_->lastError().text();
             return false;
         }
+        QMutexLocker locker(&initializeMutex());
         initializeTables();
         initializeCategories();
     }
@@ -82,7 +96,7 @@ void ContentManager::close()
     {
         database_->close();
         database_.reset(0);
-        QSqlDatabase::removeDatabase("cms");
+        QSqlDatabase::removeDatabase(connection_);
     }
 }
 
@@ -111,6 +125,9 @@ void ContentManager::initializeTables()
 
     // Notes manager
     NotesManager::makeSureTableExist(*database_);
+
+    // Annotation search.
+    AnnotationIndex::makeSureTableExist(*database_);
 }
 
 void ContentManager::initializeCategories()
@@ -244,6 +261,7 @@ bool ContentManager::removeContentNode(ContentNode& info)
 {
     // Remove the options.
     ContentOptions::removeOptions(*database_, info.id());
+    ContentBookmarks::removeEntries(*database_, info.id());
 
     // Remove from content category table, which also removes
     // from recent document list.
@@ -414,9 +432,11 @@ bool ContentManager::getBookmarks(const cms_long id, cms_blob &bookmarks)
     return ContentBookmarks::getBookmarks(*database_, id, bookmarks);
 }
 
+/// Remove the bookmark blob and the bookmark rows.
 bool ContentManager::removeBookmarks(const cms_long id)
 {
-    return ContentBookmarks::removeBookmarks(*database_, id);
+    return ContentBookmarks::removeEntries(*database_, id) &&
+           ContentBookmarks::removeBookmarks(*database_, id);
 }
 
 bool ContentManager::updateBookmarks(const cms_long id, const cms_blob & bookmarks)
@@ -424,6 +444,46 @@ bool ContentManager::updateBookmarks(const cms_long id, const cms_blob & bookmar
     return ContentBookmarks::updateBookmarks(*database_, id, bookmarks);
 }
 
+/// All bookmarks of the content, ordered by position.
+bool ContentManager::getBookmarkEntries(const cms_long id,
+                                        BookmarkEntries & entries)
+{
+    return ContentBookmarks::getEntries(*database_, id, entries);
+}
+
+/// Bookmarks of the content whose position is in [first, last].
+bool ContentManager::getBookmarkEntries(const cms_long id,
+                                        double first,
+                                        double last,
+                                        BookmarkEntries & entries)
+{
+    return ContentBookmarks::getEntries(*database_, id, first, last, entries);
+}
+
+bool ContentManager::replaceBookmarkEntries(const cms_long id,
+                                            const BookmarkEntries & entries)
+{
+    return ContentBookmarks::replaceEntries(*database_, id, entries);
+}
+
+/// Add one bookmark. Returns false if it's already there.
+bool ContentManager::addBookmarkEntry(const cms_long id,
+                                      const BookmarkEntry & entry)
+{
+    return ContentBookmarks::addEntry(*database_, id, entry);
+}
+
+bool ContentManager::removeBookmarkEntry(const cms_long id,
+                                         const BookmarkEntry & entry)
+{
+    return ContentBookmarks::removeEntry(*database_, id, entry);
+}
+
+int ContentManager::bookmarkCount(const cms_long id)
+{
+    return ContentBookmarks::entryCount(*database_, id);
+}
+
 bool ContentManager::addToRecentDocuments(const QString &doc_path)
 {
     ContentNode node;
@@ -468,38 +528,39 @@ bool ContentManager::addToRecentDocuments(const cms_long id)
 QString ContentManager::latestReading()
 {
     QString path;
-    cms_ids all;
-    if (!getRecentDocuments(all))
-    {
-        return path;
-    }
-
-    if (all.size() <= 0)
+    ContentNodes nodes;
+    if (!getRecentDocuments(nodes, 0, 1) || nodes.empty())
     {
         return path;
     }
-
-    ContentNode node;
-    if (!getContentNode(all.front(), node))
-    {
-        return path;
-    }
-
-    return node.nativeAbsolutePath();
+    return nodes.front().nativeAbsolutePath();
 }
 
-/// Get the recent opened docuemnts.
+/// Get the recent opened docuemnts, most recently accessed first.
 bool ContentManager::getRecentDocuments(cms_ids & documents)
 {
-    // Have to sort them by last access time.
-    if (!getChildrenContent(recent_read_category_, documents))
-    {
-        return false;
-    }
+    return ContentNode::getCategoryIds(*database_,
+                                       recent_read_category_.id(),
+                                       documents);
+}
 
-    sortRecentDocuments(documents);
+/// Get a page of the recent documents, most recently accessed first.
+/// The nodes are read in one query, a negative limit reads all of them.
+bool ContentManager::getRecentDocuments(ContentNodes & nodes,
+                                        int offset,
+                                        int limit)
+{
+    return ContentNode::getCategoryNodes(*database_,
+                                         recent_read_category_.id(),
+                                         offset,
+                                         limit,
+                                         nodes);
+}
 
-    return true;
+int ContentManager::recentDocumentCount()
+{
+    return ContentNode::categoryNodeCount(*database_,
+                                          recent_read_category_.id());
 }
 
 bool ContentManager::clearRecentDocuments()
@@ -576,6 +637,27 @@ int  ContentManager::allNotes(Notes &notes)
     return NotesManager::all(*database_, notes);
 }
 
+/// Names of the notes, without the thumbnails.
+bool ContentManager::listNotes(Notes &notes, int offset, int count)
+{
+    return NotesManager::list(*database_, notes, offset, count);
+}
+
+int ContentManager::noteCount()
+{
+    return NotesManager::count(*database_);
+}
+
+bool ContentManager::noteThumbnail(const QString & name, QImage & image)
+{
+    return NotesManager::thumbnail(*database_, name, image);
+}
+
+bool ContentManager::loadNoteThumbnails(Notes &notes)
+{
+    return NotesManager::loadThumbnails(*database_, notes);
+}
+
 bool ContentManager::addNoteIndex(const NoteInfo & note)
 {
     QString path = getSketchDB(note.name());
@@ -584,6 +666,8 @@ bool ContentManager::addNoteIndex(const NoteInfo & note)
     ContentNode info;
     getContentNode(info, path, true);
 
+    // Note names can be searched as annotations.
+    AnnotationIndex::updatePage(*database_, note.name(), -1, QStringList(note.name()));
     return NotesManager::addIndex(*database_, note);
 }
 
@@ -598,6 +682,7 @@ bool ContentManager::removeNote(const QString & name)
     }
 
     // Remove index.
+    AnnotationIndex::removeDocument(*database_, name);
     if (!NotesManager::removeIndex(*database_, name))
     {
         qDebug() << "Failed to remove index";
@@ -618,7 +703,7 @@ bool ContentManager::removeNote(const QString & name)
 bool ContentManager::removeAllNotes()
 {
     cms::Notes notes;
-    allNotes(notes);
+    listNotes(notes);
     foreach(NoteInfo n, notes)
     {
         removeNote(n.name());
@@ -630,7 +715,43 @@ bool ContentManager::removeAllNotes()
 /// notes database.
 bool ContentManager::removeAllNotesIndex()
 {
-   return NotesManager::removeAll(*database_);
+    cms::Notes notes;
+    listNotes(notes);
+    foreach(NoteInfo n, notes)
+    {
+        AnnotationIndex::removeDocument(*database_, n.name());
+    }
+    return NotesManager::removeAll(*database_);
+}
+
+/// Replace the indexed annotations of a page by their titles. An
+/// empty list removes the page from the index.
+bool ContentManager::updateAnnotationIndex(const QString & doc_path,
+                                           int page,
+                                           const QStringList & titles)
+{
+    return AnnotationIndex::updatePage(*database_, doc_path, page, titles);
+}
+
+bool ContentManager::removeAnnotationIndex(const QString & doc_path)
+{
+    return AnnotationIndex::removeDocument(*database_, doc_path);
+}
+
+/// Search the annotations of all documents and the note names. Every
+/// word of the text has to be found, as a word or a word prefix. A
+/// negative limit returns all the hits.
+bool ContentManager::searchAnnotations(const QString & text,
+                                       AnnotationHits & hits,
+                                       int limit)
+{
+    return AnnotationIndex::search(*database_, text, hits, limit);
+}
+
+/// Number of indexed annotations and notes.
+int ContentManager::annotationIndexSize()
+{
+    return AnnotationIndex::count(*database_);
 }
 
 void ContentManager::dropAllTables()
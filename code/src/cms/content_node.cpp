@@ -7,6 +7,26 @@ namespace cms
 {
 // TODO: Move to global header file.
 
+/// Columns read by readNode().
+static const QString NODE_COLUMNS =
+    "content.id, name, location, title, authors, description, "
+    "last_access, publisher, md5, size, "
+    "rating, read_time, read_count, progress, attributes ";
+
+/// Seconds of the last access time, null when the time is not valid.
+/// The text is taken as UTC, like strftime('%s') does in the
+/// migration, only the order matters.
+static QVariant accessTime(const QString & last_access)
+{
+    QDateTime time = QDateTime::fromString(last_access, dateFormat());
+    if (!time.isValid())
+    {
+        return QVariant(QVariant::LongLong);
+    }
+    time.setTimeSpec(Qt::UTC);
+    return static_cast<qlonglong>(time.toTime_t());
+}
+
 
 ContentNode::ContentNode(void)
 : id_(CMS_INVALID_ID)
@@ -179,13 +199,32 @@ bool ContentNode::makeSureTableExist(QSqlDatabase &database)
                         "read_time integer, "
                         "read_count integer, "
                         "progress text, "
-                        "attributes blob "
+                        "attributes blob, "
+                        "access_time integer "
                         ")");
-    if (ok)
+    if (!ok)
     {
-        return query.exec("create index if not exists name_index on content (name) ");
+        return false;
     }
-    return false;
+
+    // Databases of older versions only have the text time.
+    if (!database.record("content").contains("access_time"))
+    {
+        database.transaction();
+        ok = query.exec("alter table content add column access_time integer") &&
+             query.exec("update content set access_time = "
+                        "cast(strftime('%s', last_access) as integer)");
+        if (!ok)
+        {
+            qDebug() << query.lastError();
+            database.rollback();
+            return false;
+        }
+        database.commit();
+    }
+
+    return query.exec("create index if not exists name_index on content (name) ") &&
+           query.exec("create index if not exists access_time_index on content (access_time) ");
 }
 
 
@@ -431,8 +470,8 @@ bool ContentNode::updateContentNodeByUrl(QSqlDatabase& database,
             " (name, location, title, authors, "
             " description, last_access, publisher, md5, "
             " size, rating, read_time, read_count, "
-            " progress, attributes) values "
-            " (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?) ");
+            " progress, attributes, access_time) values "
+            " (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?) ");
 
         query.addBindValue(node.name());
         query.addBindValue(node.location());
@@ -448,6 +487,7 @@ bool ContentNode::updateContentNodeByUrl(QSqlDatabase& database,
         query.addBindValue(node.read_count());
         query.addBindValue(node.progress());
         query.addBindValue(node.attributes());
+        query.addBindValue(accessTime(node.last_access()));
 
         if (!query.exec())
         {
@@ -462,7 +502,7 @@ bool ContentNode::updateContentNodeByUrl(QSqlDatabase& database,
                         " name = ?, location = ?, title = ?, authors = ?, "
                         " description = ?, last_access = ?, publisher = ?,  "
                         " size = ?, rating = ?, read_time = ?, read_count = ?, "
-                        " progress = ?, attributes = ? "
+                        " progress = ?, attributes = ?, access_time = ? "
                         " where md5 = ?");
 
         query.addBindValue(node.name());
@@ -480,6 +520,7 @@ bool ContentNode::updateContentNodeByUrl(QSqlDatabase& database,
 
         query.addBindValue(node.progress());
         query.addBindValue(node.attributes());
+        query.addBindValue(accessTime(node.last_access()));
 
         query.addBindValue(url);
 
@@ -507,6 +548,105 @@ bool ContentNode::allNodes(QSqlDatabase& database, cms_ids & list)
     return (list.size() > 0);
 }
 
+/// Retrieve the nodes of the category in one query, most recently
+/// accessed first. Nodes never accessed come last, in the order they
+/// were added. A negative limit returns all the nodes after offset.
+bool ContentNode::getCategoryNodes(QSqlDatabase& database,
+                                   const cms_long category,
+                                   int offset,
+                                   int limit,
+                                   ContentNodes & nodes)
+{
+    nodes.clear();
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+    query.prepare( "select " + NODE_COLUMNS +
+                   "from content_category join content "
+                   "on content.id = content_category.content_id "
+                   "where content_category.category_id = ? "
+                   "order by content.access_time desc, content_category.id "
+                   "limit ? offset ?" );
+    query.addBindValue(category);
+    query.addBindValue(limit);
+    query.addBindValue(offset);
+    if (!query.exec())
+    {
+        qDebug() << query.lastError();
+        return false;
+    }
+
+    while (query.next())
+    {
+        nodes.push_back(ContentNode());
+        readNode(query, nodes.back());
+    }
+    return true;
+}
+
+/// Same order as getCategoryNodes(), only the ids.
+bool ContentNode::getCategoryIds(QSqlDatabase& database,
+                                 const cms_long category,
+                                 cms_ids & list)
+{
+    list.clear();
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+    query.prepare( "select content.id "
+                   "from content_category join content "
+                   "on content.id = content_category.content_id "
+                   "where content_category.category_id = ? "
+                   "order by content.access_time desc, content_category.id" );
+    query.addBindValue(category);
+    if (!query.exec())
+    {
+        qDebug() << query.lastError();
+        return false;
+    }
+
+    while (query.next())
+    {
+        list.push_back(query.value(0).toLongLong());
+    }
+    return true;
+}
+
+int ContentNode::categoryNodeCount(QSqlDatabase& database,
+                                   const cms_long category)
+{
+    QSqlQuery query(database);
+    query.prepare( "select count(*) "
+                   "from content_category join content "
+                   "on content.id = content_category.content_id "
+                   "where content_category.category_id = ? " );
+    query.addBindValue(category);
+    if (query.exec() && query.next())
+    {
+        return query.value(0).toInt();
+    }
+    return 0;
+}
+
+/// Fill the node from a row selected with NODE_COLUMNS.
+void ContentNode::readNode(const QSqlQuery & query, ContentNode & node)
+{
+    int index = 0;
+    node.id_ = query.value(index++).toLongLong();
+    node.name_ = query.value(index++).toString();
+    node.location_ = query.value(index++).toString();
+    node.title_ = query.value(index++).toString();
+    node.mutable_authors() = query.value(index++).toString();
+    node.mutable_description() = query.value(index++).toString();
+    node.mutable_last_access() = query.value(index++).toString();
+    node.mutable_publisher() = query.value(index++).toString();
+    node.mutable_md5() = query.value(index++).toString();
+    node.mutable_size() = query.value(index++).toLongLong();
+    node.mutable_rating() = query.value(index++).toInt();
+    node.mutable_read_time() = query.value(index++).toInt();
+    node.mutable_read_count() = query.value(index++).toInt();
+    node.mutable_progress() = query.value(index++).toString();
+    node.mutable_attributes() = query.value(index++).toByteArray();
+}
+
 bool ContentNode::createContentNode(QSqlDatabase& database,
                                     ContentNode & node)
 {
@@ -514,9 +654,10 @@ bool ContentNode::createContentNode(QSqlDatabase& database,
     query.prepare ("insert into content "
                    "(name, location, title, authors, description, "
                    "last_access, publisher, md5, "
-                   "size, rating, read_time, read_count, progress, attributes ) "
+                   "size, rating, read_time, read_count, progress, attributes, "
+                   "access_time) "
                    " values "
-                   "(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+                   "(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
 
     query.addBindValue(node.name());
     query.addBindValue(node.location());
@@ -533,6 +674,7 @@ bool ContentNode::createContentNode(QSqlDatabase& database,
     query.addBindValue(node.read_count());
     query.addBindValue(node.progress());
     query.addBindValue(node.attributes());
+    query.addBindValue(accessTime(node.last_access()));
 
     if (query.exec())
     {
@@ -550,7 +692,7 @@ bool ContentNode::updateContentNode(QSqlDatabase& database,
                    " name = ?, location = ?, title = ?, authors = ?, "
                    " description = ?, last_access = ?, publisher = ?, md5 = ?, "
                    " size = ?, rating = ?, read_time = ?, read_count = ?, "
-                   " progress = ?, attributes = ? "
+                   " progress = ?, attributes = ?, access_time = ? "
                    " where id = ?");
 
     query.addBindValue(node.name());
@@ -569,6 +711,7 @@ bool ContentNode::updateContentNode(QSqlDatabase& database,
 
     query.addBindValue(node.progress());
     query.addBindValue(node.attributes());
+    query.addBindValue(accessTime(node.last_access()));
 
     query.addBindValue(node.id());
 
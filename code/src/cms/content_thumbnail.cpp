@@ -16,9 +16,13 @@ namespace cms
 
 const QString ContentThumbnail::DB_NAME = ".onyx.thumbs.db";
 
-ContentThumbnail::ContentThumbnail(const QString &folder, bool open_db)
+/// The connection is named after the folder by default. Threads other
+/// than the main one need their own connection name.
+ContentThumbnail::ContentThumbnail(const QString &folder, bool open_db,
+                                   const QString & connection)
 : database_()
 , dir_(folder)
+, connection_(connection.isEmpty() ? dir_.absolutePath() : connection)
 {
     if (open_db)
     {
@@ -35,7 +39,7 @@ bool ContentThumbnail::open()
 {
     if (!database_)
     {
-        database_.reset(new QSqlDatabase(QSqlDatabase::addDatabase("QSQLITE",dir_.absolutePath())));
+        database_.reset(new QSqlDatabase(QSqlDatabase::addDatabase("QSQLITE", connection_)));
         database_->setDatabaseName(getThumbDB(dir_.absolutePath()));
     }
 
@@ -59,7 +63,7 @@ bool ContentThumbnail::close()
     {
         database_->close();
         database_.reset(0);
-        QSqlDatabase::removeDatabase(dir_.absolutePath());
+        QSqlDatabase::removeDatabase(connection_);
         return true;
     }
     return false;
@@ -43,27 +43,34 @@ NotesManager::~NotesManager(void)
 {
 }
 
+static const QString NOTE_NAME = "scribble_";
+static const QString TIME_FORMAT = "yyyy-MM-dd_hh:mm";
+
+/// Number of a note named by suggestedName, 0 for other names.
+int NotesManager::sequence(const QString & name)
+{
+    if (!name.startsWith(NOTE_NAME))
+    {
+        return 0;
+    }
+
+    // The name ends with the creation time.
+    QString str = name.mid(NOTE_NAME.length());
+    str.chop(TIME_FORMAT.length() + 1);
+    return str.toInt();
+}
+
+/// The number of the new note follows the largest one, read from the
+/// sequence index.
 QString NotesManager::suggestedName(QSqlDatabase & database)
 {
-    const QString NOTE_NAME = "scribble_";
-    const QString curr_time = QDateTime::currentDateTime().toString("yyyy-MM-dd_hh:mm");
-    int curr_time_len = curr_time.length();
+    const QString curr_time = QDateTime::currentDateTime().toString(TIME_FORMAT);
     int max = 1;
-    Notes notes;
-    all(database, notes);
-    foreach(NoteInfo n, notes)
+    QSqlQuery query(database);
+    if (query.exec("select max(sequence) from notes") && query.next() &&
+        !query.value(0).isNull())
     {
-        if (n.name().startsWith(NOTE_NAME))
-        {
-            QString str = n.name();
-            str = str.remove(0, NOTE_NAME.length());
-            str = str.remove(str.length() - curr_time_len - 1, curr_time_len + 1);
-            int value = str.toInt();
-            if (max <= value)
-            {
-                max = value + 1;
-            }
-        }
+        max = qMax(max, query.value(0).toInt() + 1);
     }
 
     QString name("%1%2%3%4");
@@ -74,12 +81,73 @@ QString NotesManager::suggestedName(QSqlDatabase & database)
 bool NotesManager::makeSureTableExist(QSqlDatabase &database)
 {
     QSqlQuery query(database);
-    return query.exec( "create table if not exists notes ("
-                       "id integer primary key, "
-                       "name text, "
-                       "thumbnail blob)");
+    if (!query.exec( "create table if not exists notes ("
+                     "id integer primary key, "
+                     "name text, "
+                     "thumbnail blob, "
+                     "sequence integer)"))
+    {
+        return false;
+    }
+
+    if (!checkColumns(database))
+    {
+        qDebug("Could not add the sequence column to the notes table");
+        return false;
+    }
+    return query.exec( "create unique index if not exists notes_name "
+                       "on notes (name)" ) &&
+           query.exec( "create index if not exists notes_sequence "
+                       "on notes (sequence)" );
+}
+
+/// Tables created by previous versions have no sequence column, and may
+/// have several rows for one name. Add the column, fill it and keep the
+/// last row of each name.
+bool NotesManager::checkColumns(QSqlDatabase &database)
+{
+    QSqlQuery query(database);
+    query.prepare("select sql from sqlite_master where name = ?");
+    query.addBindValue("notes");
+    if (!query.exec() || !query.next() ||
+        query.value(0).toString().contains("sequence"))
+    {
+        return true;
+    }
+
+    database.transaction();
+    bool ok = query.exec("alter table notes add sequence integer") &&
+              query.exec("delete from notes where id not in "
+                         "(select max(id) from notes group by name)");
+
+    QList<QPair<int, int> > sequences;
+    if (ok && (ok = query.exec("select id, name from notes")))
+    {
+        while (query.next())
+        {
+            int value = sequence(query.value(1).toString());
+            if (value != 0)
+            {
+                sequences.push_back(qMakePair(query.value(0).toInt(), value));
+            }
+        }
+    }
+
+    query.prepare("update notes set sequence = ? where id = ?");
+    for(int i = 0; ok && i < sequences.size(); ++i)
+    {
+        query.bindValue(0, sequences.at(i).second);
+        query.bindValue(1, sequences.at(i).first);
+        ok = query.exec();
+    }
 
-    // May also need to create a index.
+    if (!ok)
+    {
+        qDebug() << query.lastError();
+        database.rollback();
+        return false;
+    }
+    return database.commit();
 }
 
 bool NotesManager::removeTable(QSqlDatabase &database)
@@ -88,6 +156,8 @@ bool NotesManager::removeTable(QSqlDatabase &database)
     return query.exec( "drop table notes" );
 }
 
+/// Load all notes with their thumbnails. Prefer list() when the
+/// thumbnails are not all displayed.
 int  NotesManager::all(QSqlDatabase &database, Notes &notes)
 {
     QSqlQuery query(database);
@@ -108,20 +178,91 @@ int  NotesManager::all(QSqlDatabase &database, Notes &notes)
     return true;
 }
 
+/// Names of count notes from offset, in the order they were added,
+/// without thumbnails. A negative count lists all the notes after offset.
+bool NotesManager::list(QSqlDatabase &database,
+                        Notes &notes,
+                        int offset,
+                        int count)
+{
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+    query.prepare( "select name from notes order by id limit ? offset ?");
+    query.addBindValue(count);
+    query.addBindValue(offset);
+    if (!query.exec())
+    {
+        qDebug() << query.lastError();
+        return false;
+    }
+
+    NoteInfo note;
+    while (query.next())
+    {
+        note.mutable_name() = query.value(0).toString();
+        notes.push_back(note);
+    }
+    return true;
+}
+
+int NotesManager::count(QSqlDatabase &database)
+{
+    QSqlQuery query(database);
+    if (query.exec("select count(*) from notes") && query.next())
+    {
+        return query.value(0).toInt();
+    }
+    return 0;
+}
+
+bool NotesManager::thumbnail(QSqlDatabase &database,
+                             const QString & name,
+                             QImage & image)
+{
+    QSqlQuery query(database);
+    query.prepare( "select thumbnail from notes where name = ?");
+    query.addBindValue(name);
+    if (!query.exec() || !query.next())
+    {
+        return false;
+    }
+    return image.loadFromData(query.value(0).toByteArray());
+}
+
+/// Load the thumbnails of the notes, for example a page returned by
+/// list().
+bool NotesManager::loadThumbnails(QSqlDatabase &database, Notes &notes)
+{
+    QSqlQuery query(database);
+    query.prepare( "select thumbnail from notes where name = ?");
+    bool ok = true;
+    for(int i = 0; i < notes.size(); ++i)
+    {
+        query.bindValue(0, notes[i].name());
+        if (!query.exec() || !query.next())
+        {
+            ok = false;
+            continue;
+        }
+        notes[i].mutable_thumbnail().loadFromData(query.value(0).toByteArray());
+    }
+    return ok;
+}
+
 /// Add a new note index or replace existing note index.
 bool NotesManager::addIndex(QSqlDatabase &database,
                             const NoteInfo & note)
 {
-    // Remove the existing note if any.
-    removeIndex(database, note.name());
-
     QSqlQuery query(database);
-    query.prepare( "INSERT OR REPLACE into notes (name, thumbnail) values(?, ?)");
+    query.prepare( "INSERT OR REPLACE into notes (name, thumbnail, sequence) values(?, ?, ?)");
     query.addBindValue(note.name());
 
     QByteArray ba;
     note.thumbnail(ba);
     query.addBindValue(ba);
+
+    int value = sequence(note.name());
+    query.addBindValue(value != 0 ? QVariant(value) : QVariant(QVariant::Int));
     return query.exec();
 }
 
@@ -4,6 +4,20 @@
 namespace anno
 {
 
+/// Connection to the content database used to update the search index,
+/// one for each document.
+static const QString INDEX_CONNECTION = "annotation_index_%1";
+
+static QStringList titles( AnnotationPagePtr page )
+{
+    QStringList list;
+    foreach(const Annotation & annotation, page->annotations())
+    {
+        list.push_back(annotation.title());
+    }
+    return list;
+}
+
 AnnotationIO::IOMap AnnotationIO::io_map_;
 
 AnnotationIO::AnnotationIO()
@@ -20,6 +34,7 @@ bool AnnotationIO::open(const QString doc_name, bool create)
     bool exist = DataBase::isDBExist( doc_name );
     if (exist || create)
     {
+        doc_name_ = doc_name;
         db_ = DataBase::getDB( doc_name );
         if (db_ != 0 && db_->database() != 0)
         {
@@ -41,6 +56,7 @@ void AnnotationIO::close()
     {
         db_->close();
     }
+    index_db_.reset(0);
 }
 
 bool AnnotationIO::initialTable()
@@ -82,6 +98,67 @@ bool AnnotationIO::savePage( AnnotationPagePtr page )
             removePage(page);
         }
     }
+    indexPage(page);
+    return true;
+}
+
+/// Keep the annotation search index of the content database up to
+/// date. Only this page is changed in the index.
+void AnnotationIO::indexPage( AnnotationPagePtr page )
+{
+    cms::ContentManager *db = indexDatabase();
+    if (db == 0 ||
+        !db->updateAnnotationIndex(doc_name_, page->position(), titles(page)))
+    {
+        qWarning("Could not index annotations of page %d", page->position());
+    }
+}
+
+/// Open the content database once and keep it until close(), so that
+/// saving many pages does not check its tables for every page.
+cms::ContentManager * AnnotationIO::indexDatabase()
+{
+    if (index_db_ && index_db_->isOpen())
+    {
+        return index_db_.get();
+    }
+
+    QString db_path;
+    cms::getDatabasePath(doc_name_, db_path);
+    index_db_.reset(new cms::ContentManager(INDEX_CONNECTION.arg(doc_name_)));
+    if (!index_db_->open(db_path))
+    {
+        index_db_.reset(0);
+        return 0;
+    }
+    return index_db_.get();
+}
+
+/// Index all the annotations of the document again, for databases
+/// written before the index or out of sync with it.
+bool AnnotationIO::rebuildIndex( cms::ContentManager & db, const QString & doc_name )
+{
+    db.removeAnnotationIndex(doc_name);
+
+    AnnotationIO io;
+    if (!io.open(doc_name, false))
+    {
+        return false;
+    }
+
+    IDMap map;
+    io.loadPagesID(map);
+    for (IDMapIter it = map.begin(); it != map.end(); ++it)
+    {
+        AnnotationPagePtr page(new AnnotationPage);
+        page->setGlobalID(it.key());
+        page->setPosition(it.value());
+        if (!io.loadPage(page) ||
+            !db.updateAnnotationIndex(doc_name, page->position(), titles(page)))
+        {
+            return false;
+        }
+    }
     return true;
 }
 
@@ -51,63 +51,126 @@ bool removeBookmark(Bookmarks & bookmarks, const Bookmark & bookmark)
 }
 
 
-/// Store bookmark for the document.
-bool loadBookmarks(cms::ContentManager & db,
-                   const QString &doc_path,
-                   Bookmarks & bookmarks)
+static void toEntries(const Bookmarks & bookmarks, BookmarkEntries & entries)
+{
+    foreach(const Bookmark & bookmark, bookmarks)
+    {
+        entries.push_back(BookmarkEntry(bookmark.title(), bookmark.data()));
+    }
+}
+
+static void fromEntries(const BookmarkEntries & entries, Bookmarks & bookmarks)
+{
+    bookmarks.clear();
+    bookmarks.reserve(entries.size());
+    foreach(const BookmarkEntry & entry, entries)
+    {
+        bookmarks.push_back(Bookmark(entry.first, entry.second));
+    }
+}
+
+/// Find the content node of the document, create it when asked.
+static bool getNode(cms::ContentManager & db,
+                    const QString & doc_path,
+                    ContentNode & node,
+                    bool create)
 {
-    // Retrieve document information.
     QFileInfo info(doc_path);
-    ContentNode node;
     node.mutable_name() = info.fileName();
     node.mutable_location() = info.path();
     node.mutable_size() = info.size();
-    if (!db.getContentNode(node))
+    if (db.getContentNode(node))
     {
-        db.createContentNode(node);
         return true;
     }
+    return create && db.createContentNode(node);
+}
 
-    // Read blob from the database.
-    cms_blob data;
-    db.getBookmarks(node.id(), data);
-    if (data.size() <= 0)
+/// Store bookmark for the document.
+/// The content node is created if it does not exist, unless create
+/// is false. The bookmarks are in the order they were saved, so a list
+/// kept sorted by insertBookmark stays sorted. Bookmarks stored by
+/// addBookmark are placed by their numeric data.
+bool loadBookmarks(cms::ContentManager & db,
+                   const QString &doc_path,
+                   Bookmarks & bookmarks,
+                   bool create)
+{
+    ContentNode node;
+    if (!getNode(db, doc_path, node, create))
     {
         return true;
     }
 
-    QBuffer buffer(&data);
-    buffer.open(QIODevice::ReadOnly);
-    QDataStream stream(&buffer);
-    stream >> bookmarks;
+    BookmarkEntries entries;
+    db.getBookmarkEntries(node.id(), entries);
+    fromEntries(entries, bookmarks);
     return true;
 }
 
-/// Load bookmarks for the document.
+/// Load the bookmarks whose data is a number in [first, last], usually
+/// the pages or positions on the screen. Only the index range is read.
+bool loadBookmarks(cms::ContentManager & db,
+                   const QString &doc_path,
+                   double first,
+                   double last,
+                   Bookmarks & bookmarks)
+{
+    bookmarks.clear();
+    ContentNode node;
+    if (!getNode(db, doc_path, node, false))
+    {
+        return true;
+    }
+
+    BookmarkEntries entries;
+    db.getBookmarkEntries(node.id(), first, last, entries);
+    fromEntries(entries, bookmarks);
+    return true;
+}
+
+/// Load bookmarks for the document. All bookmarks of the document are
+/// replaced, use addBookmark and removeBookmark for a single one.
 bool saveBookmarks(cms::ContentManager & db,
                    const QString &doc_path,
                    const Bookmarks & bookmarks)
 {
+    ContentNode node;
+    if (!getNode(db, doc_path, node, true))
+    {
+        return false;
+    }
 
-    // Retrieve document information.
-    QFileInfo info(doc_path);
+    BookmarkEntries entries;
+    toEntries(bookmarks, entries);
+    return db.replaceBookmarkEntries(node.id(), entries);
+}
+
+/// Store one more bookmark of the document without rewriting the others.
+/// \return false when the same bookmark is already stored.
+bool addBookmark(cms::ContentManager & db,
+                 const QString &doc_path,
+                 const Bookmark & bookmark)
+{
     ContentNode node;
-    node.mutable_name() = info.fileName();
-    node.mutable_location() = info.path();
-    node.mutable_size() = info.size();
-    if (!db.getContentNode(node))
+    if (!getNode(db, doc_path, node, true))
     {
-        db.createContentNode(node);
+        return false;
     }
+    return db.addBookmarkEntry(node.id(), BookmarkEntry(bookmark.title(), bookmark.data()));
+}
 
-    // Store the bookmarks.
-    cms_blob data;
-    QBuffer buffer(&data);
-    buffer.open(QIODevice::WriteOnly);
-    QDataStream stream(&buffer);
-    stream << bookmarks;
-    db.updateBookmarks(node.id(), data);
-    return true;
+/// Remove one stored bookmark of the document.
+bool removeBookmark(cms::ContentManager & db,
+                    const QString &doc_path,
+                    const Bookmark & bookmark)
+{
+    ContentNode node;
+    if (!getNode(db, doc_path, node, false))
+    {
+        return false;
+    }
+    return db.removeBookmarkEntry(node.id(), BookmarkEntry(bookmark.title(), bookmark.data()));
 }
 
 }
@@ -0,0 +1,273 @@
+#include <limits.h>
+
+#include "onyx/data/document_session.h"
+#include "onyx/data/annotation_agent.h"
+#include "onyx/data/sketch_proxy.h"
+
+namespace vbf
+{
+
+static const char *PIECE_NAMES[PIECE_COUNT] =
+{
+    "options", "bookmarks", "thumbnail", "notes"
+};
+
+/// Bytes read at a time when the notes database is read ahead.
+static const int READ_AHEAD_BLOCK = 64 * 1024;
+
+class SessionThread : public QThread
+{
+public:
+    SessionThread(DocumentSession *session, DocumentPiece piece)
+        : session_(session)
+        , piece_(piece)
+    {
+    }
+
+protected:
+    void run() { session_->load(piece_); }
+
+private:
+    DocumentSession *session_;
+    DocumentPiece piece_;
+};
+
+/// Start loading every piece of the document.
+DocumentSession::DocumentSession(const QString & doc_path,
+                                 ThumbnailType thumbnail_type,
+                                 QObject *parent)
+    : QObject(parent)
+    , path_(doc_path)
+    , thumbnail_type_(thumbnail_type)
+    , annotation_agent_(0)
+    , sketch_proxy_(0)
+    , notes_opened_(false)
+    , first_page_(-1)
+{
+    clock_.start();
+    for (int i = 0; i < PIECE_COUNT; ++i)
+    {
+        elapsed_[i] = -1;
+    }
+    for (int i = 0; i < PIECE_COUNT; ++i)
+    {
+        SessionThread *thread = new SessionThread(this, static_cast<DocumentPiece>(i));
+        threads_.push_back(thread);
+        thread->start();
+    }
+}
+
+/// Waits for the workers, a query can not be interrupted.
+DocumentSession::~DocumentSession()
+{
+    foreach(SessionThread *thread, threads_)
+    {
+        thread->wait();
+        delete thread;
+    }
+    threads_.clear();
+}
+
+bool DocumentSession::isReady(DocumentPiece piece) const
+{
+    QMutexLocker locker(&mutex_);
+    return elapsed_[piece] >= 0;
+}
+
+/// Wait until the piece is loaded. Returns false on timeout.
+bool DocumentSession::waitFor(DocumentPiece piece, int timeout)
+{
+    QMutexLocker locker(&mutex_);
+    QTime t;
+    t.start();
+    while (elapsed_[piece] < 0)
+    {
+        unsigned long remain = ULONG_MAX;
+        if (timeout >= 0)
+        {
+            if (t.elapsed() >= timeout)
+            {
+                return false;
+            }
+            remain = timeout - t.elapsed();
+        }
+        ready_.wait(&mutex_, remain);
+    }
+    return true;
+}
+
+bool DocumentSession::waitForAll(int timeout)
+{
+    QTime t;
+    t.start();
+    for (int i = 0; i < PIECE_COUNT; ++i)
+    {
+        int remain = timeout;
+        if (timeout >= 0)
+        {
+            remain = qMax(timeout - t.elapsed(), 0);
+        }
+        if (!waitFor(static_cast<DocumentPiece>(i), remain))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Annotations and sketches to open after the first page. Both may be
+/// 0. They are used in the session's thread only.
+void DocumentSession::setNotes(anno::AnnotationAgent *agent,
+                               sketch::SketchProxy *proxy)
+{
+    annotation_agent_ = agent;
+    sketch_proxy_ = proxy;
+}
+
+bool DocumentSession::areNotesOpened() const
+{
+    return notes_opened_;
+}
+
+/// Called by the viewer when the first page is on the screen. The
+/// annotations and sketches are opened when the control goes back to
+/// the event loop.
+void DocumentSession::firstPageShown()
+{
+    if (first_page_ >= 0)
+    {
+        return;
+    }
+    first_page_ = clock_.elapsed();
+
+    QMutexLocker locker(&mutex_);
+    qDebug("%s: first page after %d ms (options %d, bookmarks %d, thumbnail %d, notes %d)",
+           qPrintable(path_), first_page_,
+           elapsed_[PIECE_OPTIONS], elapsed_[PIECE_BOOKMARKS],
+           elapsed_[PIECE_THUMBNAIL], elapsed_[PIECE_NOTES]);
+    QMetaObject::invokeMethod(this, "openNotes", Qt::QueuedConnection);
+}
+
+/// Open the annotations and sketches of the document. Usually invoked
+/// by firstPageShown(), may be called before to open them at once.
+void DocumentSession::openNotes()
+{
+    if (notes_opened_)
+    {
+        return;
+    }
+    waitFor(PIECE_NOTES);
+
+    QTime t;
+    t.start();
+    if (annotation_agent_)
+    {
+        annotation_agent_->open(path_);
+    }
+    if (sketch_proxy_)
+    {
+        sketch_proxy_->open(path_);
+    }
+    notes_opened_ = true;
+    qDebug("%s: notes opened in %d ms", qPrintable(path_), t.elapsed());
+    emit notesOpened();
+}
+
+/// Milliseconds between the construction and the end of the piece, or
+/// -1 if it's not loaded yet.
+int DocumentSession::elapsed(DocumentPiece piece) const
+{
+    QMutexLocker locker(&mutex_);
+    return elapsed_[piece];
+}
+
+/// Milliseconds between the construction and firstPageShown(), or -1.
+int DocumentSession::timeToFirstPage() const
+{
+    return first_page_;
+}
+
+/// Called in the worker of the piece.
+void DocumentSession::load(DocumentPiece piece)
+{
+    switch (piece)
+    {
+    case PIECE_OPTIONS:
+        readOptions();
+        break;
+    case PIECE_BOOKMARKS:
+        readBookmarks();
+        break;
+    case PIECE_THUMBNAIL:
+        readThumbnail();
+        break;
+    case PIECE_NOTES:
+        readNotesAhead();
+        break;
+    default:
+        break;
+    }
+
+    {
+        QMutexLocker locker(&mutex_);
+        elapsed_[piece] = clock_.elapsed();
+        ready_.wakeAll();
+    }
+    qDebug("%s: %s loaded after %d ms", qPrintable(path_), PIECE_NAMES[piece], elapsed(piece));
+
+    // Queued to the receivers in the session's thread.
+    emit pieceReady(piece);
+}
+
+void DocumentSession::readOptions()
+{
+    ContentManager db(connectionName(PIECE_OPTIONS));
+    if (openDatabase(path_, db))
+    {
+        loadDocumentOptions(db, path_, configuration_);
+    }
+}
+
+/// The options worker creates the content node if needed, not this one.
+void DocumentSession::readBookmarks()
+{
+    ContentManager db(connectionName(PIECE_BOOKMARKS));
+    if (openDatabase(path_, db))
+    {
+        vbf::loadBookmarks(db, path_, bookmarks_, false);
+    }
+}
+
+void DocumentSession::readThumbnail()
+{
+    QFileInfo info(path_);
+    ContentThumbnail thumbs(info.path(), true, connectionName(PIECE_THUMBNAIL));
+    thumbs.loadThumbnail(info.fileName(), thumbnail_type_, thumbnail_);
+}
+
+/// Bring the notes database into the page cache, so that opening the
+/// annotations and sketches in the viewer thread does not wait for the
+/// disk. AnnotationIO and SketchIO both open it through DataBase::getDB,
+/// the annotation table is in the same file as the sketches.
+void DocumentSession::readNotesAhead()
+{
+    QFile file(cms::getSketchDB(path_));
+    if (!file.exists() || !file.open(QIODevice::ReadOnly))
+    {
+        return;
+    }
+
+    QByteArray block(READ_AHEAD_BLOCK, 0);
+    while (file.read(block.data(), block.size()) > 0)
+    {
+    }
+}
+
+QString DocumentSession::connectionName(DocumentPiece piece) const
+{
+    return QString("document_session_%1_%2")
+        .arg(static_cast<qulonglong>(reinterpret_cast<quintptr>(this)))
+        .arg(PIECE_NAMES[piece]);
+}
+
+}   // namespace vbf
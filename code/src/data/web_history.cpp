@@ -8,11 +8,26 @@ namespace webhistory
 {
 
 
+/// Format of the access time of ThumbnailItem.
+static const char * ACCESS_FORMAT = "yyyy-MM-dd hh:mm";
+
+static QVariant deserialize(const QByteArray & value)
+{
+    QVariant var;
+    QByteArray data(value);
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    QDataStream stream(&buffer);
+    stream >> var;
+    return var;
+}
+
 WebHistory::WebHistory()
 : max_count_(20)
 {
     open("web_history");
     makeSureTableExist(*database_);
+    migrate(*database_);
 }
 
 WebHistory::~WebHistory()
@@ -48,17 +63,179 @@ bool WebHistory::close()
 void WebHistory::makeSureTableExist(QSqlDatabase& database)
 {
     QSqlQuery query(database);
-    query.exec("create table if not exists conf ("
-                      "key integer primary key, "
-                      "value blob "
+    query.exec("create table if not exists pages ("
+                      "id integer primary key, "
+                      "url text unique, "
+                      "title text, "
+                      "access integer "
+                      ")");
+    // The pages are ordered by id.
+    query.exec("drop index if exists pages_access");
+    query.exec("create table if not exists thumbnails ("
+                      "url text primary key, "
+                      "data blob "
                       ")");
 }
 
-/// Load configuration from database.
-bool WebHistory::loadConf(QVariantList & conf)
+/// Move the pages of the conf table written by previous versions.
+bool WebHistory::migrate(QSqlDatabase& database)
+{
+    QSqlQuery query(database);
+    query.prepare("select name from sqlite_master where type = 'table' and name = ?");
+    query.addBindValue("conf");
+    if (!query.exec() || !query.next())
+    {
+        return true;
+    }
+
+    QVariantList conf;
+    if (query.exec("select value from conf order by key"))
+    {
+        while (query.next())
+        {
+            conf.append(deserialize(query.value(0).toByteArray()));
+        }
+    }
+
+    database.transaction();
+    if (!insertItems(query, conf) || !trim(query) || !query.exec("drop table conf"))
+    {
+        qDebug() << query.lastError().text();
+        database.rollback();
+        return false;
+    }
+    return database.commit();
+}
+
+/// Keep the first maxCount() pages and their thumbnails.
+bool WebHistory::trim(QSqlQuery & query)
+{
+    query.prepare("delete from pages where id not in "
+                  "(select id from pages order by id desc limit ?)");
+    query.addBindValue(maxCount());
+    return query.exec() &&
+           query.exec("delete from thumbnails where url not in (select url from pages)");
+}
+
+/// Record a visit of url, the page becomes the first one. It's one row
+/// written, the thumbnail of the page is kept.
+bool WebHistory::visit(const QUrl & url, const QString & title)
+{
+    // To the minute, as the access times written by saveConf().
+    QDateTime access = QDateTime::fromString(
+        QDateTime::currentDateTime().toString(ACCESS_FORMAT), ACCESS_FORMAT);
+
+    database_->transaction();
+    QSqlQuery query(*database_);
+    query.prepare("insert or replace into pages (url, title, access) values (?, ?, ?)");
+    query.addBindValue(url.toString());
+    query.addBindValue(title);
+    query.addBindValue(access.toTime_t());
+    if (!query.exec() || !trim(query))
+    {
+        qDebug() << query.lastError().text();
+        database_->rollback();
+        return false;
+    }
+    return database_->commit();
+}
+
+/// Store the thumbnail of a visited page.
+bool WebHistory::setThumbnail(const QUrl & url, const QImage & image)
+{
+    ThumbnailItem item;
+    item.setThumbnail(image);
+
+    QSqlQuery query(*database_);
+    query.prepare("select count(*) from pages where url = ?");
+    query.addBindValue(url.toString());
+    if (!query.exec() || !query.next() || query.value(0).toInt() <= 0)
+    {
+        return false;
+    }
+    return saveThumbnail(query, url.toString(), item.value("thumbnail").toByteArray());
+}
+
+/// Write the thumbnail unless the same one is already stored.
+bool WebHistory::saveThumbnail(QSqlQuery & query,
+                               const QString & url,
+                               const QByteArray & data)
+{
+    query.prepare("select data from thumbnails where url = ?");
+    query.addBindValue(url);
+    if (query.exec() && query.next() && query.value(0).toByteArray() == data)
+    {
+        return true;
+    }
+
+    query.prepare("insert or replace into thumbnails (url, data) values (?, ?)");
+    query.addBindValue(url);
+    query.addBindValue(data);
+    if (!query.exec())
+    {
+        qDebug() << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+QImage WebHistory::thumbnail(const QUrl & url)
+{
+    QImage image;
+    QSqlQuery query(*database_);
+    query.prepare("select data from thumbnails where url = ?");
+    query.addBindValue(url.toString());
+    if (query.exec() && query.next())
+    {
+        image.loadFromData(query.value(0).toByteArray());
+    }
+    return image;
+}
+
+bool WebHistory::remove(const QUrl & url)
+{
+    database_->transaction();
+    QSqlQuery query(*database_);
+    query.prepare("delete from pages where url = ?");
+    query.addBindValue(url.toString());
+    bool ok = query.exec();
+    query.prepare("delete from thumbnails where url = ?");
+    query.addBindValue(url.toString());
+    if (!ok || !query.exec())
+    {
+        qDebug() << query.lastError().text();
+        database_->rollback();
+        return false;
+    }
+    return database_->commit();
+}
+
+int WebHistory::count()
+{
+    QSqlQuery query(*database_);
+    if (query.exec("select count(*) from pages") && query.next())
+    {
+        return query.value(0).toInt();
+    }
+    return 0;
+}
+
+/// Load the pages as ThumbnailItem, in the order saved by saveConf(),
+/// the pages visited since then first.
+bool WebHistory::load(QVariantList & pages, bool with_thumbnails)
 {
     QSqlQuery query(*database_);
-    query.prepare( "select value from conf");
+    query.setForwardOnly(true);
+    if (with_thumbnails)
+    {
+        query.prepare( "select pages.url, pages.title, pages.access, thumbnails.data "
+                       "from pages left join thumbnails on thumbnails.url = pages.url "
+                       "order by pages.id desc");
+    }
+    else
+    {
+        query.prepare( "select url, title, access from pages order by id desc");
+    }
 
     if (!query.exec())
     {
@@ -67,22 +244,36 @@ bool WebHistory::loadConf(QVariantList & conf)
 
     while (query.next())
     {
-        QVariant var;
-        QByteArray data = query.value(0).toByteArray();
-        QBuffer buffer(&data);
-        buffer.open(QIODevice::ReadOnly);
-        QDataStream stream(&buffer);
-        stream >> var;
-        conf.append(var);
+        ThumbnailItem item;
+        item.setUrl(QUrl(query.value(0).toString()));
+        item.setTitle(query.value(1).toString());
+        QDateTime access = QDateTime::fromTime_t(query.value(2).toUInt());
+        item.setAccessTime(access.toString(ACCESS_FORMAT));
+        if (with_thumbnails && !query.value(3).isNull())
+        {
+            item.insert("thumbnail", query.value(3).toByteArray());
+        }
+        pages.append(item);
     }
     return true;
 }
 
+/// Titles, urls and access times of the pages, without the thumbnails.
+bool WebHistory::loadPages(QVariantList & pages)
+{
+    return load(pages, false);
+}
+
+/// Load the pages with their thumbnails.
+bool WebHistory::loadConf(QVariantList & conf)
+{
+    return load(conf, true);
+}
+
 bool WebHistory::clear(QSqlDatabase& database)
 {
     QSqlQuery query(database);
-    query.prepare( "delete from conf");
-    if (!query.exec())
+    if (!query.exec("delete from pages") || !query.exec("delete from thumbnails"))
     {
         qDebug() << query.lastError().text();
         return false;
@@ -90,35 +281,49 @@ bool WebHistory::clear(QSqlDatabase& database)
     return true;
 }
 
-bool WebHistory::saveConf(const QVariantList & conf)
+/// Insert the items, first one first. The last ones are inserted first,
+/// the pages are listed by descending id.
+bool WebHistory::insertItems(QSqlQuery & query, const QVariantList & items)
 {
-    clear(*database_);
-
-    QSqlQuery query(*database_);
-
-    query.prepare( "insert into conf (value) values(?)");
-
-    // We only store the first maxCount pages.
-    int index = 0;
-    foreach(QVariant v, conf)
+    for(int i = qMin(items.size(), maxCount()) - 1; i >= 0; --i)
     {
-        QByteArray data;
-        QBuffer buffer(&data);
-        buffer.open(QIODevice::WriteOnly);
-        QDataStream stream(&buffer);
-        stream << v;
-        query.addBindValue(data);
-        query.exec();
+        ThumbnailItem item(items.at(i).toMap());
+        QString url = item.url().toString();
+        QDateTime access = QDateTime::fromString(item.accessTime(), ACCESS_FORMAT);
+
+        query.prepare("insert or replace into pages (url, title, access) values (?, ?, ?)");
+        query.addBindValue(url);
+        query.addBindValue(item.title());
+        query.addBindValue(access.isValid() ? access.toTime_t() : 0);
+        if (!query.exec())
+        {
+            return false;
+        }
 
-        // Check
-        if (++index >= maxCount())
+        if (item.contains("thumbnail") && !saveThumbnail(query, url, item.value("thumbnail").toByteArray()))
         {
-            break;
+            return false;
         }
     }
     return true;
 }
 
+/// Replace the pages by the first maxCount() items of conf. Prefer visit()
+/// and setThumbnail(): only the thumbnails that changed are written, but
+/// every page row is.
+bool WebHistory::saveConf(const QVariantList & conf)
+{
+    database_->transaction();
+    QSqlQuery query(*database_);
+    if (!query.exec("delete from pages") || !insertItems(query, conf) || !trim(query))
+    {
+        qDebug() << query.lastError().text();
+        database_->rollback();
+        return false;
+    }
+    return database_->commit();
+}
+
 void WebHistory::clear()
 {
     clear(*database_);
@@ -197,7 +402,7 @@ void ThumbnailItem::setThumbnail(const QImage & image)
 
 void ThumbnailItem::updateAccessTime()
 {
-    setAccessTime(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm"));
+    setAccessTime(QDateTime::currentDateTime().toString(ACCESS_FORMAT));
 }
 
 QString ThumbnailItem::accessTime()
@@ -0,0 +1,354 @@
+// -*- mode: c++; c-basic-offset: 4; -*-
+
+#include "onyx/screen/async_screen_proxy.h"
+
+#include <QtGui/QtGui>
+
+namespace onyx
+{
+namespace screen
+{
+
+static const int WAIT_SLICE = 20;
+
+/// Construct the proxy and connect to the screen server.
+/// \param server The local socket name of the screen server. If it's empty,
+/// the same environment variables as ScreenProxy are used.
+/// \param window Maximum number of commands in flight.
+AsyncScreenProxy::AsyncScreenProxy(const QString & server,
+                                   int window,
+                                   QObject *parent)
+: QObject(parent)
+, socket_(0)
+, window_(qMax(window, 1))
+, timeout_(DEFAULT_TIMEOUT)
+, waveform_(ScreenProxy::GC)
+, next_sequence_(0)
+{
+    if (!server.isEmpty() || qgetenv("USE_UNIX_SOCKET").toInt() > 0)
+    {
+        QLocalSocket * local = new QLocalSocket(this);
+        if (server.isEmpty())
+        {
+            local->connectToServer(qgetenv("SCREEN_SERVER_ADDRESS").data());
+        }
+        else
+        {
+            local->connectToServer(server);
+        }
+        socket_ = local;
+    }
+    else
+    {
+        QUdpSocket * udp = new QUdpSocket(this);
+        udp->connectToHost(QHostAddress(QHostAddress::LocalHost), PORT);
+        socket_ = udp;
+    }
+    connect(socket_, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+
+    timer_.setSingleShot(true);
+    connect(&timer_, SIGNAL(timeout()), this, SLOT(onTimeout()));
+}
+
+AsyncScreenProxy::~AsyncScreenProxy()
+{
+}
+
+bool AsyncScreenProxy::isConnected() const
+{
+    QLocalSocket * local = qobject_cast<QLocalSocket *>(socket_);
+    if (local)
+    {
+        return local->state() == QLocalSocket::ConnectedState;
+    }
+    QUdpSocket * udp = qobject_cast<QUdpSocket *>(socket_);
+    return udp && udp->state() == QAbstractSocket::ConnectedState;
+}
+
+/// Change the number of commands that can be in flight. Commands already
+/// sent are not affected.
+void AsyncScreenProxy::setWindow(int window)
+{
+    window_ = qMax(window, 1);
+    dispatch();
+}
+
+void AsyncScreenProxy::setDefaultWaveform(ScreenProxy::Waveform w)
+{
+    if (w == ScreenProxy::INVALID)
+    {
+        waveform_ = ScreenProxy::GC;
+    }
+    else
+    {
+        waveform_ = w;
+    }
+}
+
+/// Check if the command has been processed, either successfully or not.
+bool AsyncScreenProxy::isFinished(unsigned int sequence) const
+{
+    if (sequence > next_sequence_)
+    {
+        return false;
+    }
+    foreach(const Request & request, in_flight_)
+    {
+        if (request.sequence == sequence)
+        {
+            return false;
+        }
+    }
+    foreach(const Request & request, pending_)
+    {
+        if (request.sequence == sequence)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Ask the server to copy data of the widget from framebuffer to
+/// display controller.
+unsigned int AsyncScreenProxy::sync(const QWidget *widget, const QRect * region)
+{
+    return regionCommand(ScreenCommand::SYNC,
+                         mapToScreen(widget, region),
+                         waveform_,
+                         true,
+                         ScreenCommand::WAIT_NONE);
+}
+
+unsigned int AsyncScreenProxy::updateWidget(const QWidget *widget,
+                                            ScreenProxy::Waveform w,
+                                            bool whole,
+                                            ScreenCommand::WaitMode wait)
+{
+    return regionCommand(ScreenCommand::SYNC_AND_UPDATE,
+                         mapToScreen(widget, 0),
+                         w,
+                         whole,
+                         wait);
+}
+
+unsigned int AsyncScreenProxy::updateWidgetRegion(const QWidget *widget,
+                                                  const QRect & rect,
+                                                  ScreenProxy::Waveform w,
+                                                  bool whole,
+                                                  ScreenCommand::WaitMode wait)
+{
+    return regionCommand(ScreenCommand::SYNC_AND_UPDATE,
+                         mapToScreen(widget, &rect),
+                         w,
+                         whole,
+                         wait);
+}
+
+/// Update the region that is already in screen coordinates.
+unsigned int AsyncScreenProxy::updateScreenRegion(const QRect & rect,
+                                                  ScreenProxy::Waveform w,
+                                                  bool whole,
+                                                  ScreenCommand::WaitMode wait)
+{
+    return regionCommand(ScreenCommand::SYNC_AND_UPDATE, rect, w, whole, wait);
+}
+
+unsigned int AsyncScreenProxy::updateScreen(ScreenProxy::Waveform w,
+                                            ScreenCommand::WaitMode wait)
+{
+    ScreenCommand command;
+    memset(&command, 0, sizeof(command));
+    command.type = ScreenCommand::UPDATE;
+    command.waveform = (w == ScreenProxy::INVALID ? waveform_ : w);
+    command.update_flags = ScreenCommand::FULL_UPDATE;
+    command.wait_flags = wait;
+    return send(command);
+}
+
+unsigned int AsyncScreenProxy::ensureUpdateFinished()
+{
+    ScreenCommand command;
+    memset(&command, 0, sizeof(command));
+    command.type = ScreenCommand::WAIT_FOR_FINISHED;
+    command.wait_flags = ScreenCommand::WAIT_BEFORE_UPDATE;
+    return send(command);
+}
+
+unsigned int AsyncScreenProxy::regionCommand(ScreenCommand::Type type,
+                                             const QRect & rc,
+                                             ScreenProxy::Waveform w,
+                                             bool whole,
+                                             ScreenCommand::WaitMode wait)
+{
+    ScreenCommand command;
+    memset(&command, 0, sizeof(command));
+    command.type = type;
+    command.top = rc.top();
+    command.left = rc.left();
+    command.width = rc.width();
+    command.height = rc.height();
+    command.waveform = (w == ScreenProxy::INVALID ? waveform_ : w);
+    if (whole)
+    {
+        command.update_flags = ScreenCommand::FULL_UPDATE;
+    }
+    else
+    {
+        command.update_flags = ScreenCommand::PARTIAL_UPDATE;
+    }
+    command.wait_flags = wait;
+    return send(command);
+}
+
+/// Queue the command and return its sequence number. The command is
+/// written to the server immediately when the window allows it.
+/// WAIT_COMMAND_FINISH is always added so that the server replies.
+unsigned int AsyncScreenProxy::send(const ScreenCommand & command)
+{
+    Request request;
+    request.sequence = ++next_sequence_;
+    request.command = command;
+    request.command.wait_flags = static_cast<ScreenCommand::WaitMode>(
+        command.wait_flags | ScreenCommand::WAIT_COMMAND_FINISH);
+
+    // The last point carries the sequence number.
+    if (command.type == ScreenCommand::DRAW_LINES &&
+        command.point_count > ScreenCommand::SEQUENCE_POINT)
+    {
+        qWarning("AsyncScreenProxy: too many points in command %u", request.sequence);
+        finish(request.sequence, false);
+        return request.sequence;
+    }
+    request.command.points[ScreenCommand::SEQUENCE_POINT] =
+        QPoint(static_cast<int>(request.sequence), 0);
+    pending_.enqueue(request);
+    dispatch();
+    return request.sequence;
+}
+
+/// Write pending commands until the window is full.
+void AsyncScreenProxy::dispatch()
+{
+    while (!pending_.isEmpty() && in_flight_.size() < window_)
+    {
+        Request request = pending_.dequeue();
+        qint64 written = socket_->write(reinterpret_cast<const char *>(&request.command),
+                                        sizeof(request.command));
+        if (written != static_cast<qint64>(sizeof(request.command)))
+        {
+            qWarning("AsyncScreenProxy: failed to send command %u", request.sequence);
+            finish(request.sequence, false);
+            continue;
+        }
+        request.sent.start();
+        in_flight_.enqueue(request);
+    }
+    restartTimer();
+}
+
+void AsyncScreenProxy::onReadyRead()
+{
+    read_buffer_.append(socket_->readAll());
+    const int size = sizeof(ScreenCommand);
+    int replies = read_buffer_.size() / size;
+    QByteArray data = read_buffer_.left(replies * size);
+    read_buffer_.remove(0, replies * size);
+
+    for (int i = 0; i < replies; ++i)
+    {
+        ScreenCommand reply;
+        memcpy(&reply, data.constData() + i * size, size);
+        unsigned int sequence = static_cast<unsigned int>(
+            reply.points[ScreenCommand::SEQUENCE_POINT].x());
+
+        // Late reply of a command we already gave up on, or a duplicate.
+        int index = 0;
+        while (index < in_flight_.size() && in_flight_.at(index).sequence != sequence)
+        {
+            ++index;
+        }
+        if (index >= in_flight_.size())
+        {
+            continue;
+        }
+
+        // The server processes the commands in order, the ones sent before
+        // have been processed even if their reply was lost.
+        QList<unsigned int> finished;
+        for (int j = 0; j <= index; ++j)
+        {
+            finished.push_back(in_flight_.dequeue().sequence);
+        }
+        foreach(unsigned int done, finished)
+        {
+            finish(done, true);
+        }
+    }
+    dispatch();
+}
+
+/// The oldest command did not finish in time. Report it as failed so
+/// that the window does not stay blocked. Its reply may still come, it
+/// is dropped as it matches no command in flight.
+void AsyncScreenProxy::onTimeout()
+{
+    while (!in_flight_.isEmpty() && in_flight_.head().sent.elapsed() >= timeout_)
+    {
+        finish(in_flight_.dequeue().sequence, false);
+    }
+    dispatch();
+}
+
+void AsyncScreenProxy::finish(unsigned int sequence, bool ok)
+{
+    emit commandFinished(sequence, ok);
+}
+
+void AsyncScreenProxy::restartTimer()
+{
+    if (in_flight_.isEmpty())
+    {
+        timer_.stop();
+        return;
+    }
+    timer_.start(qMax(timeout_ - in_flight_.head().sent.elapsed(), 0));
+}
+
+/// Process events until the command finished or timeout. Only use it
+/// when the caller really needs the result, e.g. before taking a
+/// screenshot.
+bool AsyncScreenProxy::waitForFinished(unsigned int sequence, int timeout)
+{
+    QTime t;
+    t.start();
+    while (!isFinished(sequence) && t.elapsed() <= timeout)
+    {
+        if (socket_->bytesAvailable() <= 0)
+        {
+            // Short slices so that the timeout timer still gets a chance.
+            socket_->waitForReadyRead(qBound(0, timeout - t.elapsed(), WAIT_SLICE));
+        }
+        QCoreApplication::processEvents();
+    }
+    return isFinished(sequence);
+}
+
+bool AsyncScreenProxy::waitForAll(int timeout)
+{
+    QTime t;
+    t.start();
+    while (!isIdle() && t.elapsed() <= timeout)
+    {
+        if (socket_->bytesAvailable() <= 0)
+        {
+            // Short slices so that the timeout timer still gets a chance.
+            socket_->waitForReadyRead(qBound(0, timeout - t.elapsed(), WAIT_SLICE));
+        }
+        QCoreApplication::processEvents();
+    }
+    return isIdle();
+}
+
+}  // namespace screen
+}  // namespace onyx
@@ -1,7 +1,10 @@
 // -*- mode: c++; c-basic-offset: 4; -*-
 
 #include "onyx/screen/screen_proxy.h"
+#include "onyx/screen/shared_framebuffer.h"
+#include "onyx/screen/waveform_scheduler.h"
 
+#include <unistd.h>
 #include <QtGui/QtGui>
 #ifdef BUILD_FOR_ARM
 #include <QtGui/qscreen_qws.h>
@@ -40,6 +43,19 @@ inline static QIODevice & socket()
     return *udp_socket_;
 }
 
+/// Push buffered data to the server without waiting for the event loop.
+inline static void flushSocket()
+{
+    if (g_unix_socket_)
+    {
+        unix_socket_->flush();
+    }
+    else
+    {
+        udp_socket_->flush();
+    }
+}
+
 // TODO: sendCommand should only take one argument. The second is redundant.
 inline static void sendCommand(
         ScreenCommand & command,
@@ -63,8 +79,7 @@ ScreenProxy::ScreenProxy()
 , waveform_(ScreenProxy::GC)
 , previous_waveform_(ScreenProxy::GC)
 , user_data_(0)
-, gc_interval_(1)
-, gu_count_(0)
+, scheduler_(new WaveformScheduler)
 {
     g_unix_socket_ = (qgetenv("USE_UNIX_SOCKET").toInt() > 0);
     if (g_unix_socket_)
@@ -79,6 +94,8 @@ ScreenProxy::ScreenProxy()
 
 ScreenProxy::~ScreenProxy()
 {
+    closeSharedFrameBuffer();
+
     if (unix_socket_)
     {
         delete unix_socket_;
@@ -94,7 +111,7 @@ ScreenProxy::~ScreenProxy()
 
 void ScreenProxy::setGCInterval(const int interval)
 {
-    this->gc_interval_ = interval;
+    scheduler_->setBudget(interval);
 }
 
 /// Make sure the previous update request has been processed.
@@ -118,67 +135,101 @@ void ScreenProxy::setDefaultWaveform(Waveform w)
     }
 }
 
+/// The region of the widget in logical screen coordinates.
+static QRect logicalRect(const QWidget *widget, const QRect *region, const QRect & desk)
+{
+    QRect rect = desk;
+    if (widget)
+    {
+        rect.moveTopLeft(widget->mapToGlobal(widget->rect().topLeft()));
+        rect.setSize(widget->size());
+    }
+
+    // combine the region
+    if (region)
+    {
+        rect.moveTo(region->topLeft());
+        rect.setSize(region->size());
+    }
+    return rect;
+}
+
 /// Calculate the region from widget coordinates to screen coordinates.
 /// \param widget The Qt widget.
 /// \param region The result in screen coordinates system.
-QRect & ScreenProxy::screenRegion(const QWidget *widget,
-                                  const QRect *region)
+QRect mapToScreen(const QWidget *widget, const QRect *region)
 {
+    QRect rect;
 #ifndef BUILD_FOR_ARM
-    rect_.setCoords(0, 0, 0, 0);
-    return rect_;
+    rect.setCoords(0, 0, 0, 0);
+    return rect;
 #endif
     int degree = 0;
 
     // Get widget screen rectangle.
     QRect desk = qApp->desktop()->screenGeometry();
-    rect_ = desk;
-
-    if (widget)
-    {
-        rect_.moveTopLeft(widget->mapToGlobal(widget->rect().topLeft()));
-        rect_.setSize(widget->size());
-    }
-
-    // combine the region
-    if (region)
-    {
-        rect_.moveTo(region->topLeft());
-        rect_.setSize(region->size());
-    }
+    rect = logicalRect(widget, region, desk);
 
 #ifdef BUILD_FOR_ARM
     degree = QScreen::instance()->transformOrientation() * 90;
 #endif
 
+    rect = mapToScreen(rect, desk, degree);
+    return rect.intersected(mapToScreen(desk, desk, degree));
+}
+
+/// Rotate a rectangle of the logical screen to the physical screen. The
+/// result is not clipped to the screen.
+/// \param rect The rectangle in logical screen coordinates.
+/// \param desk The logical screen geometry.
+/// \param degree The screen rotation, 0, 90, 180 or 270.
+QRect mapToScreen(const QRect & rect, const QRect & desk, int degree)
+{
     if (degree == 90)
     {
-        rect_.setRect(rect_.y(),
-                      desk.width() - rect_.x() - rect_.width(),
-                      rect_.height(),
-                      rect_.width());
-        desk.setSize(QSize(desk.height(), desk.width()));
+        return QRect(rect.y(),
+                     desk.width() - rect.x() - rect.width(),
+                     rect.height(),
+                     rect.width());
     }
     else if (degree == 180)
     {
-        qDebug("destk %d %d rect %d %d %d %d", desk.width(), desk.height(), rect_.left(), rect_.top(), rect_.width(), rect_.height());
-
-        rect_.setRect(desk.width() - rect_.x() - rect_.width(),
-                      desk.height() - rect_.y() - rect_.height(),
-                      rect_.width(),
-                      rect_.height());
-        desk.setSize(QSize(desk.width(), desk.height()));
+        return QRect(desk.width() - rect.x() - rect.width(),
+                     desk.height() - rect.y() - rect.height(),
+                     rect.width(),
+                     rect.height());
     }
     else if (degree == 270)
     {
-        rect_.setRect(desk.height() - rect_.y() - rect_.height(),
-                      rect_.x(),
-                      rect_.height(),
-                      rect_.width());
-        desk.setSize(QSize(desk.height(), desk.width()));
+        return QRect(desk.height() - rect.y() - rect.height(),
+                     rect.x(),
+                     rect.height(),
+                     rect.width());
     }
+    return rect;
+}
 
-    rect_ = rect_.intersected(desk);
+/// Rotate pixels rendered in logical screen coordinates the same way as
+/// mapToScreen rotates their rectangle.
+/// \param image The rendered pixels.
+/// \param degree The screen rotation, 0, 90, 180 or 270.
+QImage mapToScreen(const QImage & image, int degree)
+{
+    if (degree % 360 == 0)
+    {
+        return image;
+    }
+    QTransform transform;
+    transform.rotate(360 - degree);
+    return image.transformed(transform);
+}
+
+/// Calculate the region from widget coordinates to screen coordinates
+/// and keep it in rect_.
+QRect & ScreenProxy::screenRegion(const QWidget *widget,
+                                  const QRect *region)
+{
+    rect_ = mapToScreen(widget, region);
     return rect_;
 }
 
@@ -228,6 +279,158 @@ QRect & ScreenProxy::sync(const QWidget *widget,
     return rc;
 }
 
+/// Hand over pixels already rendered by the caller instead of letting the
+/// daemon read them from Qt framebuffer. Falls back to the normal sync when
+/// the shared frame buffer is not available.
+/// \param widget The widget the pixels belong to.
+/// \param rendered The rendered pixels. Its top left is the top left of region.
+/// \param region The region inside the widget. If it's NULL, the whole widget.
+QRect & ScreenProxy::sync(const QWidget *widget,
+                          const QImage & rendered,
+                          const QRect * region)
+{
+#ifdef BUILD_FOR_ARM
+    QRect & rc = screenRegion(widget, region);
+    if (shared_fb_ && !rc.isEmpty())
+    {
+        // The frame buffer is in physical screen coordinates, rotate the
+        // pixels as their rectangle. The image is placed by its whole
+        // rectangle, part of it may be out of the screen.
+        QRect desk = qApp->desktop()->screenGeometry();
+        int degree = QScreen::instance()->transformOrientation() * 90;
+        QRect rotated = mapToScreen(logicalRect(widget, region, desk), desk, degree);
+        QVector<QRect> damage;
+        damage.push_back(rc);
+        publish(mapToScreen(rendered, degree), rotated.topLeft(), damage);
+        return rc;
+    }
+#endif
+
+    // Outside of the device the screen region is not known, let the
+    // daemon read Qt framebuffer.
+    return sync(widget, region);
+}
+
+/// Create the shared frame buffer and ask the daemon to use it. This is
+/// done once, all following frames only send the damage list.
+/// \param width The frame width. If it's not positive, the screen width is used.
+/// \param height The frame height. If it's not positive, the screen height is used.
+/// \return true if the daemon accepted the shared frame buffer.
+bool ScreenProxy::openSharedFrameBuffer(int width, int height)
+{
+    if (shared_fb_)
+    {
+        return true;
+    }
+
+    if (width <= 0 || height <= 0)
+    {
+        QRect desk = qApp->desktop()->screenGeometry();
+        width = desk.width();
+        height = desk.height();
+#ifdef BUILD_FOR_ARM
+        if (QScreen::instance()->transformOrientation() % 2)
+        {
+            qSwap(width, height);
+        }
+#endif
+    }
+
+    scoped_ptr<SharedFrameBuffer> fb(new SharedFrameBuffer);
+    if (!fb->create(SharedFrameBuffer::segmentName(getpid()), width, height))
+    {
+        return false;
+    }
+
+    command_.type = ScreenCommand::SHM_ATTACH;
+    command_.color = getpid();
+    command_.size = static_cast<int>(fb->size());
+    command_.left = 0;
+    command_.top = 0;
+    command_.width = width;
+    command_.height = height;
+    command_.point_count = 0;
+    sendCommand(command_, ScreenCommand::WAIT_ALL);
+    if (command_.type != ScreenCommand::SHM_ATTACH ||
+        command_.point_count != ScreenCommand::SHM_ACCEPTED)
+    {
+        qWarning("Screen server does not support shared frame buffer.");
+        return false;
+    }
+
+    shared_fb_.reset(fb.release());
+    return true;
+}
+
+void ScreenProxy::closeSharedFrameBuffer()
+{
+    if (!shared_fb_)
+    {
+        return;
+    }
+
+    shared_fb_->waitForConsumed();
+    command_.type = ScreenCommand::SHM_DETACH;
+    command_.color = getpid();
+    sendCommand(command_, ScreenCommand::WAIT_ALL);
+    shared_fb_.reset(0);
+}
+
+/// Copy image into the shared frame buffer and ask the daemon to consume
+/// the damaged regions from it.
+/// \param image The rendered pixels.
+/// \param pos Where the top left of image is in screen coordinates.
+/// \param damage The changed regions in screen coordinates.
+/// \param update Update screen after sync or not.
+/// \param waveform The waveform used when update is true.
+/// \param wait The synchronous way between ScreenProxy and server.
+bool ScreenProxy::publish(const QImage & image,
+                          const QPoint & pos,
+                          const QVector<QRect> & damage,
+                          bool update,
+                          Waveform waveform,
+                          ScreenCommand::WaitMode wait)
+{
+    if (!shared_fb_ || damage.isEmpty())
+    {
+        return false;
+    }
+
+    // The daemon may still be reading the previous frame.
+    if (!shared_fb_->waitForConsumed())
+    {
+        qWarning("Previous shared frame is not consumed in time.");
+        return false;
+    }
+    if (!image.isNull())
+    {
+        shared_fb_->copyFrom(image, pos);
+    }
+
+    QRect bounds;
+    foreach(const QRect & rc, damage)
+    {
+        bounds = bounds.united(rc);
+    }
+    unsigned int frame = shared_fb_->publish(damage);
+
+    if (waveform == INVALID)
+    {
+        waveform = waveform_;
+    }
+    command_.type = update ? ScreenCommand::SHM_SYNC_AND_UPDATE : ScreenCommand::SHM_SYNC;
+    command_.top = bounds.top();
+    command_.left = bounds.left();
+    command_.width = bounds.width();
+    command_.height = bounds.height();
+    command_.size = static_cast<int>(frame);
+    command_.waveform = waveform;
+    command_.update_flags = ScreenCommand::PARTIAL_UPDATE;
+    sendCommand(command_, wait);
+    flushSocket();
+    return true;
+}
+
 /// This function copies data for the specified widget from Qt framebuffer
 /// to display controller and updates the screen by using the waveform.
 /// \param widget The Qt widget to udpate.
@@ -251,6 +454,11 @@ void ScreenProxy::updateWidget(const QWidget *widget,
         waveform = waveform_;
     }
 
+    if (WaveformScheduler::isClearing(waveform))
+    {
+        scheduler_->clean(rc);
+    }
+
     // Construct command.
     command_.type = ScreenCommand::SYNC_AND_UPDATE;
     command_.top = rc.top();
@@ -294,6 +502,11 @@ void ScreenProxy::updateWidgetRegion(const QWidget *widget,
         waveform = waveform_;
     }
 
+    if (WaveformScheduler::isClearing(waveform))
+    {
+        scheduler_->clean(rc);
+    }
+
     // Construct command.
     command_.type = ScreenCommand::SYNC_AND_UPDATE;
     command_.top = rc.top();
@@ -327,6 +540,11 @@ void ScreenProxy::updateScreen(Waveform waveform,
     command_.waveform = waveform;
     command_.update_flags = ScreenCommand::FULL_UPDATE;
     sendCommand(command_, wait);
+
+    if (WaveformScheduler::isClearing(waveform))
+    {
+        scheduler_->reset();
+    }
 }
 
 /// Draw line on screen directly.
@@ -381,6 +599,7 @@ void ScreenProxy::fillScreen(unsigned char color)
     command_.waveform = ScreenProxy::GC;
     command_.update_flags = ScreenCommand::FULL_UPDATE;
     sendCommand(command_);
+    scheduler_->reset();
 }
 
 void ScreenProxy::setWaveformPolicy(WaveformPolicy policy)
@@ -393,47 +612,85 @@ ScreenProxy::WaveformPolicy ScreenProxy::waveformPolicy()
     return policy_;
 }
 
+/// Update the widget, or the region of it, with the waveform, except
+/// the tiles of the screen that have reached the GC interval, which
+/// are updated with GC. See WaveformScheduler.
 void ScreenProxy::updateWidgetWithGCInterval(const QWidget *widget,
         const QRect *rect,
         Waveform waveform,
         bool update_whole,
         ScreenCommand::WaitMode wait)
 {
+    if (!isUpdateEnabled() && waveform != onyx::screen::ScreenProxy::DW)
+    {
+        return;
+    }
+
     if (waveform == INVALID)
     {
         waveform = waveform_;
     }
 
-    if (GU == waveform || GC4 == waveform || A2 == waveform)
+    QRect region = screenRegion(widget, rect);
+    WaveformUpdates updates;
+    scheduler_->setScreenRect(mapToScreen(0));
+    scheduler_->schedule(region, waveform, updates);
+    if (updates.size() == 1 && updates.front().rect == region)
     {
-        increaseGUCount();
-        if (0 != gc_interval_ && gu_count_ >= gc_interval_)
+        waveform = updates.front().waveform;
+        if (NULL == rect)
         {
-            waveform = GC;
+            updateWidget(widget, waveform, update_whole, wait);
         }
+        else
+        {
+            updateWidgetRegion(widget, *rect, waveform, update_whole, wait);
+        }
+        return;
     }
-    if (GC == waveform)
+
+    // The server processes the updates in order, only the last one
+    // needs to wait for the server when the caller asks for it.
+    ScreenCommand::WaitMode no_reply = static_cast<ScreenCommand::WaitMode>(
+        wait & ~ScreenCommand::WAIT_COMMAND_FINISH);
+    for(int i = 0; i < updates.size(); ++i)
     {
-        resetGUCount();
+        const WaveformUpdate & update = updates.at(i);
+        updateScreenRegion(update.rect,
+                           update.waveform,
+                           update_whole,
+                           i + 1 < updates.size() ? no_reply : wait);
     }
-    if (NULL == rect)
+}
+
+/// Update a region in screen coordinates.
+void ScreenProxy::updateScreenRegion(const QRect & rect,
+                                     Waveform waveform,
+                                     bool update_whole,
+                                     ScreenCommand::WaitMode wait)
+{
+#ifndef BUILD_FOR_FB
+    command_.type = ScreenCommand::SYNC_AND_UPDATE;
+    command_.top = rect.top();
+    command_.left = rect.left();
+    command_.width = rect.width();
+    command_.height = rect.height();
+    command_.waveform = waveform;
+    if (update_whole)
     {
-        updateWidget(widget, waveform, update_whole, wait);
+        command_.update_flags = ScreenCommand::FULL_UPDATE;
     }
     else
     {
-        updateWidgetRegion(widget, *rect, waveform, update_whole, wait);
+        command_.update_flags = ScreenCommand::PARTIAL_UPDATE;
     }
-}
-
-void ScreenProxy::increaseGUCount()
-{
-    ++gu_count_;
+    sendCommand(command_, wait);
+#endif
 }
 
 void ScreenProxy::resetGUCount()
 {
-    gu_count_ = 0;
+    scheduler_->reset();
 }
 
 }  //namespace screen
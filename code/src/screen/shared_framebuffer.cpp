@@ -0,0 +1,310 @@
+// -*- mode: c++; c-basic-offset: 4; -*-
+
+#include "onyx/screen/shared_framebuffer.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace onyx
+{
+namespace screen
+{
+
+SharedFrameBuffer::SharedFrameBuffer()
+: owner_(false)
+, size_(0)
+, data_(0)
+, header_(0)
+, pixels_(0)
+{
+}
+
+SharedFrameBuffer::~SharedFrameBuffer()
+{
+    close();
+}
+
+/// Segment name used by the client with the given process id.
+QString SharedFrameBuffer::segmentName(int pid)
+{
+    return QString("/onyx_screen_fb_%1").arg(pid);
+}
+
+/// Create a new segment for frames of width x height pixels.
+bool SharedFrameBuffer::create(const QString & name, int width, int height)
+{
+    close();
+    if (width <= 0 || height <= 0)
+    {
+        return false;
+    }
+
+    QByteArray path = name.toLocal8Bit();
+    shm_unlink(path.constData());
+    int fd = shm_open(path.constData(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0)
+    {
+        qWarning("Could not create shared frame buffer %s", path.constData());
+        return false;
+    }
+
+    // Keep lines 4 bytes aligned, the same as QImage.
+    const int stride = (width + 3) & ~3;
+    const int header_size = (sizeof(SharedFrameHeader) + 63) & ~63;
+    const size_t size = header_size + static_cast<size_t>(stride) * height;
+    if (ftruncate(fd, size) != 0 || !map(fd, size))
+    {
+        ::close(fd);
+        shm_unlink(path.constData());
+        return false;
+    }
+    ::close(fd);
+
+    name_ = name;
+    owner_ = true;
+    memset(header_, 0, sizeof(SharedFrameHeader));
+    header_->width = width;
+    header_->height = height;
+    header_->stride = stride;
+    header_->header_size = header_size;
+    header_->version = SharedFrameHeader::VERSION;
+    pixels_ = data_ + header_size;
+    __sync_synchronize();
+    header_->magic = SharedFrameHeader::MAGIC;
+    return true;
+}
+
+/// Attach to a segment created by another process.
+bool SharedFrameBuffer::attach(const QString & name)
+{
+    close();
+    QByteArray path = name.toLocal8Bit();
+    int fd = shm_open(path.constData(), O_RDWR, 0600);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 ||
+        info.st_size < static_cast<off_t>(sizeof(SharedFrameHeader)) ||
+        !map(fd, info.st_size))
+    {
+        ::close(fd);
+        return false;
+    }
+    ::close(fd);
+
+    if (header_->magic != SharedFrameHeader::MAGIC ||
+        header_->version != SharedFrameHeader::VERSION ||
+        static_cast<size_t>(header_->header_size) +
+        static_cast<size_t>(header_->stride) * header_->height > size_)
+    {
+        qWarning("Invalid shared frame buffer %s", path.constData());
+        close();
+        return false;
+    }
+    name_ = name;
+    owner_ = false;
+    pixels_ = data_ + header_->header_size;
+    return true;
+}
+
+void SharedFrameBuffer::close()
+{
+    if (data_)
+    {
+        munmap(data_, size_);
+    }
+    if (owner_ && !name_.isEmpty())
+    {
+        shm_unlink(name_.toLocal8Bit().constData());
+    }
+    name_.clear();
+    owner_ = false;
+    size_ = 0;
+    data_ = 0;
+    header_ = 0;
+    pixels_ = 0;
+}
+
+bool SharedFrameBuffer::map(int fd, size_t size)
+{
+    void * addr = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED)
+    {
+        return false;
+    }
+    data_ = static_cast<uchar *>(addr);
+    size_ = size;
+    header_ = reinterpret_cast<SharedFrameHeader *>(data_);
+    return true;
+}
+
+/// Wait until the server has consumed the last published frame, so that
+/// it's safe to write new pixels.
+bool SharedFrameBuffer::waitForConsumed(int timeout)
+{
+    if (!isValid())
+    {
+        return false;
+    }
+
+    QTime t;
+    t.start();
+    while (consumed() != published())
+    {
+        if (t.elapsed() > timeout)
+        {
+            return false;
+        }
+        usleep(500);
+    }
+    return true;
+}
+
+/// Copy the image into the frame at pos, converting to 8-bit gray.
+/// Indexed8 images with a gray color table are copied line by line.
+void SharedFrameBuffer::copyFrom(const QImage & image, const QPoint & pos)
+{
+    if (!isValid())
+    {
+        return;
+    }
+
+    QRect target = QRect(pos, image.size()).intersected(QRect(0, 0, width(), height()));
+    if (target.isEmpty())
+    {
+        return;
+    }
+    const int sx = target.left() - pos.x();
+    const int sy = target.top() - pos.y();
+
+    if (image.format() == QImage::Format_Indexed8)
+    {
+        QVector<QRgb> colors = image.colorTable();
+        bool identity = (colors.size() == 256);
+        for (int i = 0; i < 256; ++i)
+        {
+            gray_table_[i] = (i < colors.size() ? qGray(colors[i]) : 0);
+            identity = identity && gray_table_[i] == i;
+        }
+
+        for (int y = 0; y < target.height(); ++y)
+        {
+            const uchar * src = image.scanLine(sy + y) + sx;
+            uchar * dst = scanLine(target.top() + y) + target.left();
+            if (identity)
+            {
+                memcpy(dst, src, target.width());
+            }
+            else
+            {
+                for (int x = 0; x < target.width(); ++x)
+                {
+                    dst[x] = gray_table_[src[x]];
+                }
+            }
+        }
+        return;
+    }
+
+    QImage converted;
+    const QImage * source = &image;
+    if (image.format() != QImage::Format_RGB32 &&
+        image.format() != QImage::Format_ARGB32 &&
+        image.format() != QImage::Format_ARGB32_Premultiplied)
+    {
+        converted = image.convertToFormat(QImage::Format_RGB32);
+        source = &converted;
+    }
+    for (int y = 0; y < target.height(); ++y)
+    {
+        const QRgb * src = reinterpret_cast<const QRgb *>(source->scanLine(sy + y)) + sx;
+        uchar * dst = scanLine(target.top() + y) + target.left();
+        for (int x = 0; x < target.width(); ++x)
+        {
+            dst[x] = qGray(src[x]);
+        }
+    }
+}
+
+/// Publish the damage list of the current frame and return its sequence.
+/// When there are more rectangles than the header can hold, the remaining
+/// ones are merged into the last slot.
+unsigned int SharedFrameBuffer::publish(const QVector<QRect> & damage)
+{
+    if (!isValid())
+    {
+        return 0;
+    }
+
+    QRect bounds(0, 0, width(), height());
+    int count = 0;
+    for (int i = 0; i < damage.size(); ++i)
+    {
+        QRect rc = damage[i].intersected(bounds);
+        if (rc.isEmpty())
+        {
+            continue;
+        }
+        if (count >= SharedFrameHeader::MAX_DAMAGE)
+        {
+            SharedFrameHeader::Rect & last = header_->damage[count - 1];
+            rc = rc.united(QRect(last.left, last.top, last.width, last.height));
+            --count;
+        }
+        SharedFrameHeader::Rect & r = header_->damage[count++];
+        r.left = rc.left();
+        r.top = rc.top();
+        r.width = rc.width();
+        r.height = rc.height();
+    }
+    header_->damage_count = count;
+
+    // Pixels and damage list must be visible before the sequence.
+    __sync_synchronize();
+    return ++header_->published;
+}
+
+unsigned int SharedFrameBuffer::published() const
+{
+    return header_ ? header_->published : 0;
+}
+
+unsigned int SharedFrameBuffer::consumed() const
+{
+    return header_ ? header_->consumed : 0;
+}
+
+QVector<QRect> SharedFrameBuffer::damage() const
+{
+    QVector<QRect> result;
+    if (!isValid())
+    {
+        return result;
+    }
+    const int count = qBound(0, header_->damage_count,
+                             static_cast<int>(SharedFrameHeader::MAX_DAMAGE));
+    for (int i = 0; i < count; ++i)
+    {
+        const SharedFrameHeader::Rect & r = header_->damage[i];
+        result.push_back(QRect(r.left, r.top, r.width, r.height));
+    }
+    return result;
+}
+
+/// Called by the server when it has finished reading the frame.
+void SharedFrameBuffer::markConsumed(unsigned int frame)
+{
+    if (header_)
+    {
+        __sync_synchronize();
+        header_->consumed = frame;
+    }
+}
+
+}  // namespace screen
+}  // namespace onyx
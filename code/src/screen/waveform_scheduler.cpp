@@ -0,0 +1,171 @@
+// -*- mode: c++; c-basic-offset: 4; -*-
+
+#include "onyx/screen/waveform_scheduler.h"
+
+namespace onyx
+{
+namespace screen
+{
+
+static qint64 area(const QRect & rect)
+{
+    return static_cast<qint64>(rect.width()) * rect.height();
+}
+
+WaveformScheduler::WaveformScheduler(int tile_size, int budget)
+: tile_size_(qMax(tile_size, 1))
+, budget_(budget)
+, partial_area_(0)
+, promoted_area_(0)
+{
+}
+
+WaveformScheduler::~WaveformScheduler()
+{
+}
+
+/// Change the tile size. The counts are dropped.
+void WaveformScheduler::setTileSize(int size)
+{
+    tile_size_ = qMax(size, 1);
+    reset();
+}
+
+/// Forget the ghosting of the tiles updated with a clearing waveform.
+/// Only the tiles completely covered by rect are clean.
+void WaveformScheduler::clean(const QRect & rect)
+{
+    if (rect.isEmpty() || counts_.isEmpty())
+    {
+        return;
+    }
+
+    int last_row = tileIndex(rect.bottom());
+    int last_column = tileIndex(rect.right());
+    for(int row = tileIndex(rect.top()); row <= last_row; ++row)
+    {
+        for(int column = tileIndex(rect.left()); column <= last_column; ++column)
+        {
+            Tile tile(row, column);
+            if (rect.contains(tileRect(tile)))
+            {
+                counts_.remove(tile);
+            }
+        }
+    }
+}
+
+/// Forget the ghosting of all tiles, after a full screen GC update.
+void WaveformScheduler::reset()
+{
+    counts_.clear();
+}
+
+void WaveformScheduler::resetStatistics()
+{
+    partial_area_ = 0;
+    promoted_area_ = 0;
+}
+
+bool WaveformScheduler::isClearing(ScreenProxy::Waveform waveform)
+{
+    return waveform == ScreenProxy::GC ||
+           waveform == ScreenProxy::GC8 ||
+           waveform == ScreenProxy::GC16;
+}
+
+bool WaveformScheduler::isCounted(ScreenProxy::Waveform waveform)
+{
+    return waveform == ScreenProxy::GU ||
+           waveform == ScreenProxy::GC4 ||
+           waveform == ScreenProxy::A2;
+}
+
+/// Number of partial updates of the tile containing pos since its last
+/// GC update.
+int WaveformScheduler::partialUpdates(const QPoint & pos) const
+{
+    return counts_.value(Tile(tileIndex(pos.y()), tileIndex(pos.x())), 0);
+}
+
+int WaveformScheduler::tileIndex(int coordinate) const
+{
+    // Round towards minus infinity.
+    return coordinate >= 0 ? coordinate / tile_size_ : (coordinate + 1) / tile_size_ - 1;
+}
+
+QRect WaveformScheduler::tileRect(const Tile & tile) const
+{
+    QRect rect(tile.second * tile_size_, tile.first * tile_size_, tile_size_, tile_size_);
+    if (screen_.isValid())
+    {
+        rect &= screen_;
+    }
+    return rect;
+}
+
+/// Split the update of rect with waveform into the updates to send.
+/// Tiles reaching the budget are updated with GC, the rest of the
+/// region with waveform.
+void WaveformScheduler::schedule(const QRect & rect,
+                                 ScreenProxy::Waveform waveform,
+                                 WaveformUpdates & updates)
+{
+    updates.clear();
+    if (rect.isEmpty() || !(isClearing(waveform) || isCounted(waveform)))
+    {
+        updates.push_back(WaveformUpdate(rect, waveform));
+        return;
+    }
+
+    if (isClearing(waveform))
+    {
+        clean(rect);
+        updates.push_back(WaveformUpdate(rect, waveform));
+        return;
+    }
+
+    int first_row = tileIndex(rect.top());
+    int last_row = tileIndex(rect.bottom());
+    int first_column = tileIndex(rect.left());
+    int last_column = tileIndex(rect.right());
+    QRegion promoted;
+    for(int row = first_row; row <= last_row; ++row)
+    {
+        for(int column = first_column; column <= last_column; ++column)
+        {
+            Tile tile(row, column);
+            int & count = counts_[tile];
+            ++count;
+            if (budget_ > 0 && count >= budget_)
+            {
+                promoted += tileRect(tile);
+                counts_.remove(tile);
+            }
+        }
+    }
+
+    if (promoted.isEmpty())
+    {
+        partial_area_ += area(rect);
+        updates.push_back(WaveformUpdate(rect, waveform));
+        return;
+    }
+
+    QVector<QRect> rects = (QRegion(rect) - promoted).rects();
+    foreach(const QRect & r, rects)
+    {
+        partial_area_ += area(r);
+        updates.push_back(WaveformUpdate(r, waveform));
+    }
+
+    rects = promoted.rects();
+    foreach(const QRect & r, rects)
+    {
+        promoted_area_ += area(r);
+        updates.push_back(WaveformUpdate(r, ScreenProxy::GC));
+    }
+}
+
+}  // namespace screen
+}  // namespace onyx
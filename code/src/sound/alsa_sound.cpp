@@ -21,8 +21,6 @@ AlsaSound::AlsaSound()
     , byte_per_frames_(0)
     , audio_data_per_ms_(1)
     , conv2stereo_(false)
-    , stereo_buff_len_(0)
-    , stereo_buff_(0)
 {
 #ifdef BUILD_WITH_TFT
     openPCMHandler();
@@ -35,6 +33,8 @@ AlsaSound::AlsaSound()
 
 AlsaSound::~AlsaSound()
 {
+    // The playback thread writes to the handler.
+    stream_.reset(0);
     closePCMHandler();
     closeMixer();
 }
@@ -171,6 +171,8 @@ bool AlsaSound::setParams(unsigned int bitspersample, unsigned int channels, uns
         }
     }
     fprintf(stderr, "set parameters %d %d %d.\n", bitspersample, channels, samplerate);
+    processor_.setInput(samplerate, channels, bitspersample);
+    processor_.setOutput(samplerate, conv2stereo_ ? 2 : channels);
     audio_data_per_ms_ = (samplerate * channels * bitspersample / 8) / 1000;
     byte_per_frames_ = channels * bitspersample / 8;
 #endif
@@ -179,36 +181,28 @@ bool AlsaSound::setParams(unsigned int bitspersample, unsigned int channels, uns
 
 bool AlsaSound::play(unsigned char *data, int size)
 {
-#ifdef BUILD_WITH_TFT
-    static const unsigned int MAX_VOLUME_FOR_AK98 = 0xa186;
-    bool ret;
-    unsigned long frames = size / byte_per_frames_;
+    return writeStream(reinterpret_cast<const char *>(data), size);
+}
 
-    if (conv2stereo_)
+PcmStream & AlsaSound::stream()
+{
+    if (!stream_)
     {
-        if (stereo_buff_len_ < size * 2)
-        {
-            /* enalarge stereo_buff */
-            if (stereo_buff_)
-            {
-                free (stereo_buff_);
-                stereo_buff_len_ = 0;
-            }
-
-            stereo_buff_ = (unsigned char *)malloc (size * 2);
-            if (stereo_buff_ == NULL)
-            {
-                return false;
-            }
-            stereo_buff_len_ = size * 2;
-        }
+        stream_.reset(new PcmStream(*this));
+    }
+    return *stream_;
+}
 
-        if (mono2Stereo (data, frames, stereo_buff_) < 0)
-        {
-            return false;
-        }
+bool AlsaSound::writeDevice(const char *data, int size)
+{
+#ifdef BUILD_WITH_TFT
+    const int frame_bytes = conv2stereo_ ? byte_per_frames_ * 2 : byte_per_frames_;
+    if (frame_bytes <= 0)
+    {
+        return false;
     }
 
+    unsigned long frames = size / frame_bytes;
     while (frames > 0)
     {
         int rc = snd_pcm_writei (pcm_handle_, data, frames);
@@ -224,10 +218,7 @@ bool AlsaSound::play(unsigned char *data, int size)
             break;
         }
 
-        if (conv2stereo_)
-            data += rc * byte_per_frames_ * 2;
-        else
-            data += rc * byte_per_frames_;
+        data += rc * frame_bytes;
         frames -= rc;
     }
 #endif
@@ -256,11 +247,6 @@ void AlsaSound::closePCMHandler()
     snd_pcm_drain(pcm_handle_);
     snd_pcm_close(pcm_handle_);
     pcm_handle_  = 0;
-    if (stereo_buff_)
-    {
-        free (stereo_buff_);
-        stereo_buff_len_ = 0;
-    }
 }
 
 bool AlsaSound::openMixer()
@@ -319,62 +305,3 @@ void AlsaSound::closeMixer()
     snd_mixer_close(mixer_);
 #endif
 }
-
-int AlsaSound::mono2Stereo(const unsigned char* mono_buf,
-                           long unsigned int frames,
-                           unsigned char* stereo_buf)
-{
-    int i = 0, j =0;
-
-    switch (byte_per_frames_)
-    {
-    case 1:
-        for (; frames > 0; frames--)
-        {
-            stereo_buf[i++] = mono_buf[j];
-            stereo_buf[i++] = mono_buf[j];
-            j++;
-        }
-        break;
-    case 2:
-        for (; frames > 0; frames--)
-        {
-            stereo_buf[i++] = mono_buf[j];
-            stereo_buf[i++] = mono_buf[j+1];
-            stereo_buf[i++] = mono_buf[j];
-            stereo_buf[i++] = mono_buf[j+1];
-            j += 2;
-        }
-        break;
-    case 3:
-        for (; frames > 0; frames--)
-        {
-            stereo_buf[i++] = mono_buf[j];
-            stereo_buf[i++] = mono_buf[j+1];
-            stereo_buf[i++] = mono_buf[j+2];
-            stereo_buf[i++] = mono_buf[j];
-            stereo_buf[i++] = mono_buf[j+1];
-            stereo_buf[i++] = mono_buf[j+2];
-            j += 3;
-        }
-        break;
-    case 4:
-        for (; frames > 0; frames--)
-        {
-            stereo_buf[i++] = mono_buf[j];
-            stereo_buf[i++] = mono_buf[j+1];
-            stereo_buf[i++] = mono_buf[j+2];
-            stereo_buf[i++] = mono_buf[j+3];
-            stereo_buf[i++] = mono_buf[j];
-            stereo_buf[i++] = mono_buf[j+1];
-            stereo_buf[i++] = mono_buf[j+2];
-            stereo_buf[i++] = mono_buf[j+3];
-            j += 4;
-        }
-        break;
-    default:
-        return -1;
-        break;
-    }
-    return frames;
-}
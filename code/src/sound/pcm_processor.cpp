@@ -0,0 +1,669 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#define PCM_X86
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON__) || defined(__aarch64__)
+#define PCM_NEON
+#include <arm_neon.h>
+#if defined(__linux__) && !defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+#include "onyx/sound/pcm_processor.h"
+
+/// Soft clipping leaves samples below the knee alone, and bends the rest
+/// towards full scale with the same slope at the knee.
+static const float SOFT_KNEE = 24576.0f;
+static const float SOFT_RANGE = 32767.0f - 24576.0f;
+
+static const float SAMPLE_MIN = -32768.0f;
+static const float SAMPLE_MAX = 32767.0f;
+
+/// Input frames converted per kernel call, so the resampled block stays
+/// in the cache.
+static const int BLOCK_FRAMES = 1024;
+
+int monoToStereo(const char *mono, int size, int bytes_per_sample, char *stereo)
+{
+    const int samples = size / bytes_per_sample;
+    switch (bytes_per_sample)
+    {
+    case 1:
+        for (int i = 0; i < samples; ++i)
+        {
+            stereo[2 * i] = stereo[2 * i + 1] = mono[i];
+        }
+        break;
+    case 2:
+        {
+            const quint16 *src = reinterpret_cast<const quint16 *>(mono);
+            quint16 *dst = reinterpret_cast<quint16 *>(stereo);
+            for (int i = 0; i < samples; ++i)
+            {
+                dst[2 * i] = dst[2 * i + 1] = src[i];
+            }
+        }
+        break;
+    default:
+        for (int i = 0; i < samples; ++i)
+        {
+            memcpy(stereo, mono, bytes_per_sample);
+            memcpy(stereo + bytes_per_sample, mono, bytes_per_sample);
+            stereo += 2 * bytes_per_sample;
+            mono += bytes_per_sample;
+        }
+        break;
+    }
+    return samples * bytes_per_sample * 2;
+}
+
+
+// Scalar reference. The SIMD kernels evaluate the same expressions in the
+// same order, lane by lane.
+
+static inline float softClip(float x)
+{
+    const float a = fabsf(x);
+    if (a <= SOFT_KNEE)
+    {
+        return x;
+    }
+    const float over = a - SOFT_KNEE;
+    const float y = SOFT_KNEE + SOFT_RANGE * over / (over + SOFT_RANGE);
+    return (x < 0.0f) ? -y : y;
+}
+
+static inline qint16 toSample(float x, bool soft_clip)
+{
+    if (soft_clip)
+    {
+        x = softClip(x);
+    }
+    x = qMin(qMax(x, SAMPLE_MIN), SAMPLE_MAX);
+    return static_cast<qint16>(lrintf(x));
+}
+
+/// Cross-feeds one frame, leaves the left and right output in l and r.
+static inline void crossFeed(PcmCrossFeed *cf, float & l, float & r)
+{
+    const float x[4] = { l, r, l, r };
+    const float last[4] = { cf->last[0], cf->last[1], cf->last[0], cf->last[1] };
+    for (int i = 0; i < 4; ++i)
+    {
+        cf->state[i] = cf->a0[i] * x[i] + cf->a1[i] * last[i] + cf->b1[i] * cf->state[i];
+    }
+    cf->last[0] = l;
+    cf->last[1] = r;
+    l = cf->state[2] + cf->state[1];
+    r = cf->state[3] + cf->state[0];
+}
+
+static void runScalar(const PcmKernelParams & p, const qint16 *in, int frames, qint16 *out)
+{
+    if (p.cross_feed)
+    {
+        const float gain = p.cross_feed->gain * p.gain;
+        for (int i = 0; i < frames; ++i)
+        {
+            float l = in[0];
+            float r = (p.in_channels == 2) ? in[1] : l;
+            in += p.in_channels;
+            crossFeed(p.cross_feed, l, r);
+            out[0] = toSample(l * gain, p.soft_clip);
+            out[1] = toSample(r * gain, p.soft_clip);
+            out += 2;
+        }
+        return;
+    }
+
+    for (int i = 0; i < frames; ++i)
+    {
+        if (p.in_channels == p.out_channels)
+        {
+            for (int c = 0; c < p.out_channels; ++c)
+            {
+                out[c] = toSample(in[c] * p.gain, p.soft_clip);
+            }
+        }
+        else if (p.out_channels == 2)
+        {
+            out[0] = out[1] = toSample(in[0] * p.gain, p.soft_clip);
+        }
+        else
+        {
+            out[0] = toSample((in[0] + in[1]) * 0.5f * p.gain, p.soft_clip);
+        }
+        in += p.in_channels;
+        out += p.out_channels;
+    }
+}
+
+
+#ifdef PCM_X86
+
+__attribute__((target("sse2")))
+static inline __m128i toSamplesSse2(__m128 x, bool soft_clip)
+{
+    if (soft_clip)
+    {
+        const __m128 sign = _mm_set1_ps(-0.0f);
+        const __m128 knee = _mm_set1_ps(SOFT_KNEE);
+        const __m128 range = _mm_set1_ps(SOFT_RANGE);
+        const __m128 a = _mm_andnot_ps(sign, x);
+        // Lanes below the knee keep x, clamp them so they can't divide by 0.
+        const __m128 over = _mm_max_ps(_mm_sub_ps(a, knee), _mm_setzero_ps());
+        __m128 y = _mm_add_ps(knee, _mm_div_ps(_mm_mul_ps(range, over), _mm_add_ps(over, range)));
+        y = _mm_or_ps(y, _mm_and_ps(sign, x));
+        const __m128 bent = _mm_cmpgt_ps(a, knee);
+        x = _mm_or_ps(_mm_and_ps(bent, y), _mm_andnot_ps(bent, x));
+    }
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(SAMPLE_MIN)), _mm_set1_ps(SAMPLE_MAX));
+    return _mm_cvtps_epi32(x);
+}
+
+/// Sign extends the low or high four samples of v.
+__attribute__((target("sse2")))
+static inline __m128 lowToFloatSse2(__m128i v)
+{
+    return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+}
+
+__attribute__((target("sse2")))
+static inline __m128 highToFloatSse2(__m128i v)
+{
+    return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+}
+
+/// One frame per register: lowpass left and right, highboost left and
+/// right. Two frames are clipped and stored together.
+__attribute__((target("sse2")))
+static void crossFeedSse2(const PcmKernelParams & p, const qint16 *in, int frames, qint16 *out)
+{
+    PcmCrossFeed *cf = p.cross_feed;
+    const __m128 a0 = _mm_loadu_ps(cf->a0);
+    const __m128 a1 = _mm_loadu_ps(cf->a1);
+    const __m128 b1 = _mm_loadu_ps(cf->b1);
+    const __m128 gain = _mm_set1_ps(cf->gain * p.gain);
+    __m128 state = _mm_loadu_ps(cf->state);
+    __m128 last = _mm_set_ps(cf->last[1], cf->last[0], cf->last[1], cf->last[0]);
+
+    __m128 pending = _mm_setzero_ps();
+    for (int i = 0; i < frames; ++i)
+    {
+        const float l = in[0];
+        const float r = (p.in_channels == 2) ? in[1] : l;
+        in += p.in_channels;
+
+        const __m128 x = _mm_set_ps(r, l, r, l);
+        state = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, x), _mm_mul_ps(a1, last)), _mm_mul_ps(b1, state));
+        last = x;
+
+        // hi left + lo right, hi right + lo left.
+        const __m128 mixed = _mm_add_ps(_mm_movehl_ps(state, state),
+                                        _mm_shuffle_ps(state, state, _MM_SHUFFLE(0, 1, 0, 1)));
+        const __m128 frame = _mm_mul_ps(mixed, gain);
+        if ((i & 1) == 0)
+        {
+            pending = frame;
+            continue;
+        }
+        const __m128i s = toSamplesSse2(_mm_movelh_ps(pending, frame), p.soft_clip);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(out), _mm_packs_epi32(s, s));
+        out += 4;
+    }
+    if (frames & 1)
+    {
+        const __m128i s = toSamplesSse2(pending, p.soft_clip);
+        const int pair = _mm_cvtsi128_si32(_mm_packs_epi32(s, s));
+        memcpy(out, &pair, sizeof(pair));
+    }
+
+    _mm_storeu_ps(cf->state, state);
+    float x[4];
+    _mm_storeu_ps(x, last);
+    cf->last[0] = x[0];
+    cf->last[1] = x[1];
+}
+
+__attribute__((target("sse2")))
+static void runSse2(const PcmKernelParams & p, const qint16 *in, int frames, qint16 *out)
+{
+    if (p.cross_feed)
+    {
+        crossFeedSse2(p, in, frames, out);
+        return;
+    }
+    if (p.in_channels == 2 && p.out_channels == 1)
+    {
+        runScalar(p, in, frames, out);
+        return;
+    }
+
+    // Eight input samples per iteration.
+    const __m128 gain = _mm_set1_ps(p.gain);
+    const int samples = frames * p.in_channels;
+    int i = 0;
+    for (; i + 8 <= samples; i += 8)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        const __m128i lo = toSamplesSse2(_mm_mul_ps(lowToFloatSse2(v), gain), p.soft_clip);
+        const __m128i hi = toSamplesSse2(_mm_mul_ps(highToFloatSse2(v), gain), p.soft_clip);
+        const __m128i s = _mm_packs_epi32(lo, hi);
+        if (p.in_channels == p.out_channels)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), s);
+        }
+        else
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * i), _mm_unpacklo_epi16(s, s));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * i + 8), _mm_unpackhi_epi16(s, s));
+        }
+    }
+
+    const int done = i / p.in_channels;
+    runScalar(p, in + i, frames - done, out + done * p.out_channels);
+}
+
+#endif  // PCM_X86
+
+
+#ifdef PCM_NEON
+
+/// ARMv7 has no vector division nor rounding conversion, so its results
+/// can be one LSB away from the scalar ones. AArch64 matches exactly.
+static inline int32x4_t toSamplesNeon(float32x4_t x, bool soft_clip)
+{
+    if (soft_clip)
+    {
+        const float32x4_t knee = vdupq_n_f32(SOFT_KNEE);
+        const float32x4_t range = vdupq_n_f32(SOFT_RANGE);
+        const float32x4_t a = vabsq_f32(x);
+        const float32x4_t over = vmaxq_f32(vsubq_f32(a, knee), vdupq_n_f32(0.0f));
+        const float32x4_t num = vmulq_f32(range, over);
+        const float32x4_t den = vaddq_f32(over, range);
+#if defined(__aarch64__)
+        float32x4_t y = vaddq_f32(knee, vdivq_f32(num, den));
+#else
+        float32x4_t inv = vrecpeq_f32(den);
+        inv = vmulq_f32(vrecpsq_f32(den, inv), inv);
+        inv = vmulq_f32(vrecpsq_f32(den, inv), inv);
+        float32x4_t y = vaddq_f32(knee, vmulq_f32(num, inv));
+#endif
+        const uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(x), vdupq_n_u32(0x80000000));
+        y = vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(y), sign));
+        x = vbslq_f32(vcgtq_f32(a, knee), y, x);
+    }
+    x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(SAMPLE_MIN)), vdupq_n_f32(SAMPLE_MAX));
+#if defined(__aarch64__)
+    return vcvtnq_s32_f32(x);
+#else
+    // Round half away from zero.
+    const uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(x), vdupq_n_u32(0x80000000));
+    const float32x4_t half = vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(vdupq_n_f32(0.5f)), sign));
+    return vcvtq_s32_f32(vaddq_f32(x, half));
+#endif
+}
+
+static void runNeon(const PcmKernelParams & p, const qint16 *in, int frames, qint16 *out)
+{
+    // The recursion of the cross-feed leaves nothing to do in parallel
+    // on two lanes.
+    if (p.cross_feed || (p.in_channels == 2 && p.out_channels == 1))
+    {
+        runScalar(p, in, frames, out);
+        return;
+    }
+
+    const int samples = frames * p.in_channels;
+    int i = 0;
+    for (; i + 8 <= samples; i += 8)
+    {
+        const int16x8_t v = vld1q_s16(in + i);
+        const float32x4_t lo = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), p.gain);
+        const float32x4_t hi = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), p.gain);
+        const int16x8_t s = vcombine_s16(vqmovn_s32(toSamplesNeon(lo, p.soft_clip)),
+                                         vqmovn_s32(toSamplesNeon(hi, p.soft_clip)));
+        if (p.in_channels == p.out_channels)
+        {
+            vst1q_s16(out + i, s);
+        }
+        else
+        {
+            int16x8x2_t stereo;
+            stereo.val[0] = s;
+            stereo.val[1] = s;
+            vst2q_s16(out + 2 * i, stereo);
+        }
+    }
+
+    const int done = i / p.in_channels;
+    runScalar(p, in + i, frames - done, out + done * p.out_channels);
+}
+
+#endif  // PCM_NEON
+
+
+static const PcmKernels kernels_scalar = { "scalar", runScalar };
+#ifdef PCM_X86
+static const PcmKernels kernels_sse2 = { "sse2", runSse2 };
+#endif
+#ifdef PCM_NEON
+static const PcmKernels kernels_neon = { "neon", runNeon };
+#endif
+
+#ifdef PCM_NEON
+static bool cpuHasNeon()
+{
+#if defined(__aarch64__)
+    return true;
+#elif defined(__linux__) && defined(HWCAP_NEON)
+    return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#else
+    return true;    // Built with -mfpu=neon, so it is required anyway.
+#endif
+}
+#endif
+
+const PcmKernels *PcmProcessor::kernels(Kernel kernel)
+{
+    switch (kernel)
+    {
+    case KERNEL_SCALAR:
+        return &kernels_scalar;
+
+#ifdef PCM_X86
+    case KERNEL_SSE2:
+        return __builtin_cpu_supports("sse2") ? &kernels_sse2 : 0;
+#endif
+
+#ifdef PCM_NEON
+    case KERNEL_NEON:
+        return cpuHasNeon() ? &kernels_neon : 0;
+#endif
+
+    case KERNEL_AUTO:
+        {
+            const char *name = getenv("ONYX_PCM_KERNEL");
+            for (int i = KERNEL_SCALAR; name != 0 && i < KERNEL_COUNT; ++i)
+            {
+                const PcmKernels *k = kernels(static_cast<Kernel>(i));
+                if (k != 0 && strcmp(k->name, name) == 0)
+                {
+                    return k;
+                }
+            }
+            for (int i = KERNEL_COUNT - 1; i > KERNEL_SCALAR; --i)
+            {
+                const PcmKernels *k = kernels(static_cast<Kernel>(i));
+                if (k != 0)
+                {
+                    return k;
+                }
+            }
+            return &kernels_scalar;
+        }
+
+    default:
+        break;
+    }
+    return 0;
+}
+
+
+PcmProcessor::PcmProcessor()
+    : kernels_(kernels(KERNEL_AUTO))
+    , in_rate_(0)
+    , in_channels_(2)
+    , in_bits_(16)
+    , out_rate_(0)
+    , out_channels_(2)
+    , gain_(1.0f)
+    , cross_feed_enabled_(false)
+    , cross_feed_cut_(700)
+    , cross_feed_level_(45)
+    , step_(1 << 16)
+{
+    updateCrossFeed();
+    reset();
+}
+
+PcmProcessor::~PcmProcessor()
+{
+}
+
+void PcmProcessor::setInput(int rate, int channels, int bits)
+{
+    in_rate_ = rate;
+    in_channels_ = (channels == 1) ? 1 : 2;
+    in_bits_ = bits;
+    updateCrossFeed();
+    reset();
+}
+
+void PcmProcessor::setOutput(int rate, int channels)
+{
+    out_rate_ = rate;
+    out_channels_ = (channels == 1) ? 1 : 2;
+    updateCrossFeed();
+    reset();
+}
+
+void PcmProcessor::setGain(float gain)
+{
+    gain_ = qMax(gain, 0.0f);
+}
+
+void PcmProcessor::setCrossFeed(bool enable, int cut_hz, int feed_db10)
+{
+    cross_feed_enabled_ = enable;
+    cross_feed_cut_ = qBound(300, cut_hz, 2000);
+    cross_feed_level_ = qBound(10, feed_db10, 150);
+    updateCrossFeed();
+    reset();
+}
+
+bool PcmProcessor::setKernel(Kernel kernel)
+{
+    const PcmKernels *k = kernels(kernel);
+    if (k == 0)
+    {
+        return false;
+    }
+    kernels_ = k;
+    return true;
+}
+
+bool PcmProcessor::isResampling() const
+{
+    return in_bits_ == 16 && in_rate_ > 0 && out_rate_ > 0 && in_rate_ != out_rate_;
+}
+
+bool PcmProcessor::isCrossFeeding() const
+{
+    return cross_feed_enabled_ && in_bits_ == 16 && out_channels_ == 2;
+}
+
+bool PcmProcessor::isIdentity() const
+{
+    if (in_channels_ != out_channels_)
+    {
+        return false;
+    }
+    return in_bits_ != 16 || (gain_ == 1.0f && !isResampling() && !isCrossFeeding());
+}
+
+int PcmProcessor::inputFrameBytes() const
+{
+    return qMax(in_bits_ / 8, 1) * in_channels_;
+}
+
+int PcmProcessor::maxOutputBytes(int input_bytes) const
+{
+    qint64 frames = input_bytes / inputFrameBytes();
+    if (isResampling())
+    {
+        frames = (frames << 16) / step_ + 1;
+    }
+    return static_cast<int>(frames * qMax(in_bits_ / 8, 1) * out_channels_);
+}
+
+int PcmProcessor::process(const char *in, int size, char *out)
+{
+    const int frame_bytes = inputFrameBytes();
+    size = size / frame_bytes * frame_bytes;
+    if (isIdentity())
+    {
+        memcpy(out, in, size);
+        return size;
+    }
+
+    // Other formats only need the channels.
+    const int sample_bytes = qMax(in_bits_ / 8, 1);
+    if (in_bits_ != 16 || (gain_ == 1.0f && !isResampling() && !isCrossFeeding() && out_channels_ == 2))
+    {
+        if (in_channels_ == 1)
+        {
+            return monoToStereo(in, size, sample_bytes, out);
+        }
+        const int frames = size / frame_bytes;
+        for (int i = 0; i < frames; ++i)
+        {
+            memcpy(out + i * sample_bytes, in + i * frame_bytes, sample_bytes);
+        }
+        return frames * sample_bytes;
+    }
+
+    PcmKernelParams params;
+    params.in_channels = in_channels_;
+    params.out_channels = out_channels_;
+    params.gain = gain_;
+    params.soft_clip = gain_ > 1.0f;
+    params.cross_feed = isCrossFeeding() ? &cross_feed_ : 0;
+
+    const qint16 *src = reinterpret_cast<const qint16 *>(in);
+    qint16 *dst = reinterpret_cast<qint16 *>(out);
+    int frames = size / frame_bytes;
+    while (frames > 0)
+    {
+        const int count = qMin(frames, BLOCK_FRAMES);
+        if (isResampling())
+        {
+            const int resampled = resample(src, count, resampled_.data());
+            kernels_->run(params, resampled_.constData(), resampled, dst);
+            dst += resampled * out_channels_;
+        }
+        else
+        {
+            kernels_->run(params, src, count, dst);
+            dst += count * out_channels_;
+        }
+        src += count * in_channels_;
+        frames -= count;
+    }
+    return static_cast<int>(reinterpret_cast<char *>(dst) - out);
+}
+
+void PcmProcessor::process(const char *in, int size, QByteArray & out)
+{
+    const int offset = out.size();
+    out.resize(offset + maxOutputBytes(size));
+    out.resize(offset + process(in, size, out.data() + offset));
+}
+
+void PcmProcessor::reset()
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        cross_feed_.state[i] = 0.0f;
+    }
+    cross_feed_.last[0] = cross_feed_.last[1] = 0.0f;
+
+    if (in_rate_ > 0 && out_rate_ > 0)
+    {
+        step_ = static_cast<quint32>((static_cast<quint64>(in_rate_) << 16) / out_rate_);
+    }
+    step_ = qMax(step_, 1u);
+    phase_ = 0;
+    last_[0] = last_[1] = 0;
+    has_last_ = false;
+    if (isResampling())
+    {
+        const qint64 frames = (static_cast<qint64>(BLOCK_FRAMES) << 16) / step_ + 1;
+        resampled_.resize(static_cast<int>(frames * in_channels_));
+    }
+    else
+    {
+        resampled_.clear();
+    }
+}
+
+/// Linear interpolation in 16.16 fixed point, on the input channels.
+/// Position 0 is the last frame of the previous call, 1 the first of in.
+int PcmProcessor::resample(const qint16 *in, int frames, qint16 *out)
+{
+    const int channels = in_channels_;
+    if (!has_last_)
+    {
+        // Start exactly on the first frame.
+        last_[0] = in[0];
+        last_[1] = in[channels - 1];
+        phase_ = 1 << 16;
+        has_last_ = true;
+    }
+
+    int count = 0;
+    quint32 pos = phase_;
+    while (static_cast<int>(pos >> 16) < frames)
+    {
+        const int index = pos >> 16;
+        const int fraction = (pos & 0xffff) >> 1;
+        for (int c = 0; c < channels; ++c)
+        {
+            const int a = (index == 0) ? last_[c] : in[(index - 1) * channels + c];
+            const int b = in[index * channels + c];
+            *out++ = static_cast<qint16>(a + (((b - a) * fraction) >> 15));
+        }
+        ++count;
+        pos += step_;
+    }
+
+    phase_ = pos - (static_cast<quint32>(frames) << 16);
+    for (int c = 0; c < channels; ++c)
+    {
+        last_[c] = in[(frames - 1) * channels + c];
+    }
+    return count;
+}
+
+/// Filter coefficients of bs2b for the output rate.
+void PcmProcessor::updateCrossFeed()
+{
+    const double rate = (out_rate_ > 0) ? out_rate_ : 44100;
+    const double level = cross_feed_level_ / 10.0;
+    const double gb_lo = level * -5.0 / 6.0 - 3.0;
+    const double gb_hi = level / 6.0 - 3.0;
+    const double g_lo = pow(10.0, gb_lo / 20.0);
+    const double g_hi = 1.0 - pow(10.0, gb_hi / 20.0);
+    const double fc_lo = cross_feed_cut_;
+    const double fc_hi = fc_lo * pow(2.0, (gb_lo - 20.0 * log10(g_hi)) / 12.0);
+
+    const double x_lo = exp(-2.0 * M_PI * fc_lo / rate);
+    const double x_hi = exp(-2.0 * M_PI * fc_hi / rate);
+    for (int i = 0; i < 2; ++i)
+    {
+        cross_feed_.a0[i] = static_cast<float>(g_lo * (1.0 - x_lo));
+        cross_feed_.a1[i] = 0.0f;
+        cross_feed_.b1[i] = static_cast<float>(x_lo);
+        cross_feed_.a0[i + 2] = static_cast<float>(1.0 - g_hi * (1.0 - x_hi));
+        cross_feed_.a1[i + 2] = static_cast<float>(-x_hi);
+        cross_feed_.b1[i + 2] = static_cast<float>(x_hi);
+    }
+    cross_feed_.gain = static_cast<float>(1.0 / (1.0 - g_hi + g_lo));
+}
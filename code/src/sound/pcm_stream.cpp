@@ -0,0 +1,396 @@
+#include <string.h>
+
+#include "onyx/sound/pcm_stream.h"
+
+/// Bytes taken from the ring per device write. About 93ms of 16 bits mono
+/// at 22.05KHz, which bounds the stop latency.
+static const int SLICE_BYTES = 4 * 1024;
+
+/// Room for a converted slice in PcmDevice::writeStream().
+static const int CONVERTED_BYTES = 16 * 1024;
+
+/// The waiting side also wakes up on its own after this long, in case a
+/// device write never returns.
+static const int WAIT_SLICE_MS = 100;
+
+static int roundUpToPowerOfTwo(int value)
+{
+    int result = 1;
+    while (result < value)
+    {
+        result <<= 1;
+    }
+    return result;
+}
+
+bool PcmDevice::writeStream(const char *data, int size)
+{
+    PcmProcessor & processor = streamProcessor();
+    if (processor.isIdentity())
+    {
+        return writeDevice(data, size);
+    }
+
+    char converted[CONVERTED_BYTES];
+    const int frame = processor.inputFrameBytes();
+    int step = SLICE_BYTES / frame * frame;
+    while (step > frame && processor.maxOutputBytes(step) > CONVERTED_BYTES)
+    {
+        step = step / 2 / frame * frame;
+    }
+    for (int offset = 0; offset + frame <= size; offset += step)
+    {
+        const int count = processor.process(data + offset, qMin(step, size - offset), converted);
+        if (!writeDevice(converted, count))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+PcmRingBuffer::PcmRingBuffer(int capacity)
+    : data_(0)
+    , mask_(roundUpToPowerOfTwo(qMax(capacity, 2)) - 1)
+    , read_(0)
+    , write_(0)
+{
+    data_ = new char[mask_ + 1];
+}
+
+PcmRingBuffer::~PcmRingBuffer()
+{
+    delete [] data_;
+}
+
+int PcmRingBuffer::available() const
+{
+    const unsigned int w = write_.fetchAndAddAcquire(0);
+    const unsigned int r = read_.fetchAndAddAcquire(0);
+    return static_cast<int>(w - r);
+}
+
+int PcmRingBuffer::space() const
+{
+    return capacity() - available();
+}
+
+int PcmRingBuffer::write(const char *data, int size)
+{
+    // The consumer only moves read_ forward, so the space can only grow
+    // after it's read.
+    const unsigned int r = read_.fetchAndAddAcquire(0);
+    const unsigned int w = write_.fetchAndAddRelaxed(0);
+    const int count = qMin(size, capacity() - static_cast<int>(w - r));
+    if (count <= 0)
+    {
+        return 0;
+    }
+
+    const int offset = static_cast<int>(w & mask_);
+    const int first = qMin(count, capacity() - offset);
+    memcpy(data_ + offset, data, first);
+    memcpy(data_, data + first, count - first);
+    write_.fetchAndStoreRelease(static_cast<int>(w + count));
+    return count;
+}
+
+int PcmRingBuffer::peek(const char *& data) const
+{
+    const unsigned int w = write_.fetchAndAddAcquire(0);
+    const unsigned int r = read_.fetchAndAddRelaxed(0);
+    const int offset = static_cast<int>(r & mask_);
+    data = data_ + offset;
+    return qMin(static_cast<int>(w - r), capacity() - offset);
+}
+
+void PcmRingBuffer::consume(int size)
+{
+    const unsigned int r = read_.fetchAndAddRelaxed(0);
+    read_.fetchAndStoreRelease(static_cast<int>(r + size));
+}
+
+int PcmRingBuffer::discard()
+{
+    const unsigned int w = write_.fetchAndAddAcquire(0);
+    const unsigned int r = read_.fetchAndAddRelaxed(0);
+    read_.fetchAndStoreRelease(static_cast<int>(w));
+    return static_cast<int>(w - r);
+}
+
+
+class PcmStream::PlaybackThread : public QThread
+{
+public:
+    explicit PlaybackThread(PcmStream *stream)
+        : stream_(stream)
+    {
+    }
+
+protected:
+    void run() { stream_->playbackLoop(); }
+
+private:
+    PcmStream *stream_;
+};
+
+PcmStream::PcmStream(PcmDevice & device, int capacity)
+    : device_(device)
+    , ring_(capacity)
+    , consumer_waiting_(0)
+    , producer_waiting_(0)
+    , produced_(0)
+    , progress_(0)
+    , quit_(0)
+    , stops_(0)
+    , stops_done_(0)
+    , written_(0)
+    , played_(0)
+    , underruns_(0)
+    , device_errors_(0)
+    , total_written_(0)
+    , total_consumed_(0)
+    , drained_at_(0)
+    , starved_(false)
+    , starved_at_(0)
+{
+    thread_.reset(new PlaybackThread(this));
+    thread_->start();
+}
+
+PcmStream::~PcmStream()
+{
+    quit_.fetchAndStoreOrdered(1);
+    notifyConsumer();
+    thread_->wait();
+}
+
+int PcmStream::write(const char *data, int size, int timeout_ms)
+{
+    const int stops = stops_.fetchAndAddOrdered(0);
+    QTime t;
+    t.start();
+
+    int done = 0;
+    while (done < size && stops_.fetchAndAddOrdered(0) == stops)
+    {
+        const int progress = progress_.fetchAndAddOrdered(0);
+        const int count = ring_.write(data + done, size - done);
+        if (count > 0)
+        {
+            done += count;
+            notifyConsumer();
+            continue;
+        }
+
+        if (timeout_ms >= 0 && t.elapsed() >= timeout_ms)
+        {
+            break;
+        }
+        waitForConsumer(progress);
+    }
+
+    QMutexLocker locker(&stats_mutex_);
+    written_ += done;
+    total_written_ += done;
+    return done;
+}
+
+bool PcmStream::drain(int timeout_ms)
+{
+    {
+        // The ring may already have run empty at the end of the data.
+        QMutexLocker locker(&stats_mutex_);
+        drained_at_ = total_written_;
+        if (starved_ && starved_at_ == total_written_)
+        {
+            starved_ = false;
+        }
+    }
+    QTime t;
+    t.start();
+
+    bool drained = true;
+    forever
+    {
+        const int progress = progress_.fetchAndAddOrdered(0);
+        // Bytes stay in the ring until the device has taken them. A
+        // partial frame is never played.
+        if (ring_.available() < qMax(device_.streamFrameBytes(), 1))
+        {
+            break;
+        }
+        if (timeout_ms >= 0 && t.elapsed() >= timeout_ms)
+        {
+            drained = false;
+            break;
+        }
+        waitForConsumer(progress);
+    }
+    return drained;
+}
+
+void PcmStream::stop()
+{
+    const int stops = stops_.fetchAndAddOrdered(1) + 1;
+    notifyConsumer();
+
+    // Once the playback thread has dropped the ring, new data is kept.
+    forever
+    {
+        const int progress = progress_.fetchAndAddOrdered(0);
+        if (stops_done_.fetchAndAddOrdered(0) == stops)
+        {
+            break;
+        }
+        waitForConsumer(progress);
+    }
+}
+
+PcmStream::Stats PcmStream::stats() const
+{
+    Stats result;
+    result.capacity = ring_.capacity();
+    result.buffered = ring_.available();
+
+    QMutexLocker locker(&stats_mutex_);
+    result.written = written_;
+    result.played = played_;
+    result.underruns = underruns_;
+    result.device_errors = device_errors_;
+    return result;
+}
+
+void PcmStream::resetStats()
+{
+    QMutexLocker locker(&stats_mutex_);
+    written_ = 0;
+    played_ = 0;
+    underruns_ = 0;
+    device_errors_ = 0;
+}
+
+/// Playback thread loop.
+void PcmStream::playbackLoop()
+{
+    bool playing = false;
+    while (!quit_.fetchAndAddOrdered(0))
+    {
+        const int produced = produced_.fetchAndAddOrdered(0);
+        const int stops = stops_.fetchAndAddOrdered(0);
+        if (stops != stops_done_.fetchAndAddOrdered(0))
+        {
+            const int dropped = ring_.discard();
+            playing = false;
+            {
+                QMutexLocker locker(&stats_mutex_);
+                total_consumed_ += dropped;
+                starved_ = false;
+            }
+            stops_done_.fetchAndStoreOrdered(stops);
+            notifyProducer();
+            continue;
+        }
+
+        const char *data = 0;
+        const int frame = qMax(device_.streamFrameBytes(), 1);
+        int size = ring_.peek(data);
+        size = qMin(size, SLICE_BYTES) / frame * frame;
+        if (size <= 0)
+        {
+            // Running empty after the data given to drain() is fine.
+            if (playing)
+            {
+                QMutexLocker locker(&stats_mutex_);
+                if (drained_at_ != total_consumed_)
+                {
+                    starved_ = true;
+                    starved_at_ = total_consumed_;
+                }
+            }
+            playing = false;
+            notifyProducer();
+            waitForProducer(produced);
+            continue;
+        }
+
+        if (!playing)
+        {
+            QMutexLocker locker(&stats_mutex_);
+            if (starved_)
+            {
+                ++underruns_;
+                starved_ = false;
+            }
+        }
+
+        const bool ok = playSlice(data, size);
+        ring_.consume(size);
+        playing = true;
+        {
+            QMutexLocker locker(&stats_mutex_);
+            played_ += size;
+            total_consumed_ += size;
+            if (!ok)
+            {
+                ++device_errors_;
+            }
+        }
+        notifyProducer();
+    }
+}
+
+bool PcmStream::playSlice(const char *data, int size)
+{
+    return device_.writeStream(data, size);
+}
+
+/// Called by the producer after it changed something the playback thread
+/// may be waiting for.
+void PcmStream::notifyConsumer()
+{
+    produced_.fetchAndAddOrdered(1);
+    if (consumer_waiting_.fetchAndAddOrdered(0))
+    {
+        QMutexLocker locker(&mutex_);
+        has_data_.wakeAll();
+    }
+}
+
+/// Called by the playback thread after it made progress.
+void PcmStream::notifyProducer()
+{
+    progress_.fetchAndAddOrdered(1);
+    if (producer_waiting_.fetchAndAddOrdered(0))
+    {
+        QMutexLocker locker(&mutex_);
+        has_room_.wakeAll();
+    }
+}
+
+/// Sleeps until produced_ changes. The flag is raised before produced_ is
+/// checked again, and notifyConsumer() changes produced_ before it checks
+/// the flag, so one of them always sees the other.
+void PcmStream::waitForProducer(int produced)
+{
+    QMutexLocker locker(&mutex_);
+    consumer_waiting_.fetchAndStoreOrdered(1);
+    if (produced_.fetchAndAddOrdered(0) == produced)
+    {
+        has_data_.wait(&mutex_, WAIT_SLICE_MS);
+    }
+    consumer_waiting_.fetchAndStoreOrdered(0);
+}
+
+void PcmStream::waitForConsumer(int progress)
+{
+    // A counter, write() and stop() may wait in two threads.
+    QMutexLocker locker(&mutex_);
+    producer_waiting_.fetchAndAddOrdered(1);
+    if (progress_.fetchAndAddOrdered(0) == progress)
+    {
+        has_room_.wait(&mutex_, WAIT_SLICE_MS);
+    }
+    producer_waiting_.fetchAndAddOrdered(-1);
+}
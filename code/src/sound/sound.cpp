@@ -36,7 +36,10 @@ Sound::Sound(bool o, const char *dev)
 , enable_(true)
 , bps_(8)
 , channels_(0)
+, rate_(0)
+, device_rate_(0)
 {
+    updateProcessor();
     if (o)
     {
         open(dev);
@@ -45,6 +48,8 @@ Sound::Sound(bool o, const char *dev)
 
 Sound::~Sound()
 {
+    // The playback thread writes to the device.
+    stream_.reset(0);
     close();
 }
 
@@ -89,23 +94,6 @@ void Sound::close()
     device_ = -1;
 }
 
-/// Convert mono to stereo according to the bps.
-QByteArray Sound::toStereo(const char *src, int size, const int bps)
-{
-    QByteArray data;
-    const char * p = src;
-    int len = bps / 8;
-    data.reserve(size * len);
-    size = size / len;
-    for(int i = 0; i < size; ++i)
-    {
-        data.append(p, len);
-        data.append(p, len);
-        p += len;
-    }
-    return data;
-}
-
 int Sound::volume()
 {
     int volume = 0;
@@ -168,8 +156,9 @@ bool Sound::setVolume(int volume)
 
 bool Sound::setBitsPerSample(int bps)
 {
-#ifndef _WINDOWS
     bps_ = bps;
+    updateProcessor();
+#ifndef _WINDOWS
     int ret = -1;
     int arg = bps;
     if (ret = ioctl(device_, SOUND_PCM_WRITE_BITS, &arg) ==  - 1)
@@ -190,6 +179,7 @@ bool Sound::setBitsPerSample(int bps)
 bool Sound::setChannels(int channels)
 {
     channels_ = channels;
+    updateProcessor();
     if (channels != 2)
     {
         channels = 2;
@@ -215,16 +205,26 @@ bool Sound::setChannels(int channels)
 
 bool Sound::setSamplingRate(const int rate)
 {
+    rate_ = device_rate_ = rate;
 #ifndef _WINDOWS
     int ret = -1;
     int arg = rate;
     if (ret = ioctl(device_, SOUND_PCM_WRITE_RATE, &arg) ==  - 1)
     {
         printf("SOUND_PCM_WRITE_RATE ioctl failed.\n");
+        updateProcessor();
         return false;
     }
+
+    // The driver picks the nearest rate it supports, resample to it.
+    if (arg > 0 && arg != rate)
+    {
+        printf("Sampling rate %d not supported, resample to %d.\n", rate, arg);
+        device_rate_ = arg;
+    }
 #endif
 
+    updateProcessor();
     return true;
 }
 
@@ -254,15 +254,34 @@ bool Sound::play(const char *data, int size)
         return false;
     }
 
-    const char *buffer = data;
-    // have to convert
-    QByteArray d;
-    if (channels_ != 0 && channels_ != 2)
+    return writeStream(data, size);
+}
+
+PcmStream & Sound::stream()
+{
+    if (!stream_)
     {
-        d = toStereo(data, size, bps_);
-        buffer = d.constData();
-        size = d.size();
+        stream_.reset(new PcmStream(*this));
     }
+    return *stream_;
+}
+
+/// The device is always set to stereo once channels are set, see
+/// setChannels(), and plays at the rate the driver accepted.
+void Sound::updateProcessor()
+{
+    const int channels = (channels_ == 2) ? 2 : 1;
+    processor_.setInput(rate_, channels, bps_);
+    processor_.setOutput(device_rate_, (channels_ == 0) ? channels : 2);
+}
+
+bool Sound::writeDevice(const char *buffer, int size)
+{
+    if (!isEnabled())
+    {
+        return false;
+    }
+
 #ifndef _WINDOWS
     int written = 0;
     const int buffer_size = 16 * 1024;      /// Not sure yet.
@@ -288,6 +307,3 @@ bool Sound::play(const char *data, int size)
 
     return true;
 }
-
-
-
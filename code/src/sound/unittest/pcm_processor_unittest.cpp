@@ -0,0 +1,318 @@
+#include <stdlib.h>
+
+#include "onyx/base/base.h"
+#include "gtest/gtest.h"
+#include "onyx/sound/pcm_processor.h"
+
+namespace
+{
+
+/// Speech like noise with some full scale samples.
+static QByteArray noise(int samples, int seed)
+{
+    QByteArray result(samples * 2, 0);
+    qint16 *data = reinterpret_cast<qint16 *>(result.data());
+    unsigned int x = seed * 2654435761u + 1;
+    for (int i = 0; i < samples; ++i)
+    {
+        x = x * 1103515245u + 12345u;
+        int value = static_cast<int>((x >> 8) & 0xffff) - 32768;
+        if (i % 5)
+        {
+            value /= 8;
+        }
+        data[i] = static_cast<qint16>(value);
+    }
+    data[0] = 32767;
+    data[samples - 1] = -32768;
+    return result;
+}
+
+/// Largest difference between two buffers of samples.
+static int maxDifference(const QByteArray & a, const QByteArray & b)
+{
+    if (a.size() != b.size())
+    {
+        return 65536;
+    }
+    const qint16 *x = reinterpret_cast<const qint16 *>(a.constData());
+    const qint16 *y = reinterpret_cast<const qint16 *>(b.constData());
+    int result = 0;
+    for (int i = 0; i < a.size() / 2; ++i)
+    {
+        result = qMax(result, abs(x[i] - y[i]));
+    }
+    return result;
+}
+
+/// Feeds data in chunks of odd sizes, so the kernels see every tail.
+static QByteArray run(PcmProcessor & processor, const QByteArray & data)
+{
+    QByteArray result;
+    const int frame = processor.inputFrameBytes();
+    int offset = 0;
+    for (int i = 0; offset < data.size(); ++i)
+    {
+        const int size = qMin(frame * (1 + (i * 37) % 1500), data.size() - offset);
+        processor.process(data.constData() + offset, size, result);
+        offset += size;
+    }
+    return result;
+}
+
+static const qint16 *samples(const QByteArray & data)
+{
+    return reinterpret_cast<const qint16 *>(data.constData());
+}
+
+TEST(PcmProcessorTest, MonoToStereo)
+{
+    const short mono[] = { 1, -2, 300, -32768 };
+    short stereo[8];
+    EXPECT_EQ(16, monoToStereo(reinterpret_cast<const char *>(mono), sizeof(mono), 2,
+                               reinterpret_cast<char *>(stereo)));
+    const short expected[] = { 1, 1, -2, -2, 300, 300, -32768, -32768 };
+    EXPECT_EQ(0, memcmp(expected, stereo, sizeof(expected)));
+
+    const char mono3[] = { 1, 2, 3, 4, 5, 6 };
+    char stereo3[12];
+    EXPECT_EQ(12, monoToStereo(mono3, sizeof(mono3), 3, stereo3));
+    const char expected3[] = { 1, 2, 3, 1, 2, 3, 4, 5, 6, 4, 5, 6 };
+    EXPECT_EQ(0, memcmp(expected3, stereo3, sizeof(expected3)));
+}
+
+/// Only the channels change at unity gain, whatever the kernel.
+TEST(PcmProcessorTest, Unity)
+{
+    const QByteArray mono = noise(10001, 1);
+    PcmProcessor processor;
+    processor.setInput(44100, 1);
+    processor.setOutput(44100, 2);
+    EXPECT_FALSE(processor.isIdentity());
+
+    QByteArray expected(mono.size() * 2, 0);
+    monoToStereo(mono.constData(), mono.size(), 2, expected.data());
+    EXPECT_TRUE(run(processor, mono) == expected);
+
+    processor.setOutput(44100, 1);
+    EXPECT_TRUE(processor.isIdentity());
+    EXPECT_TRUE(run(processor, mono) == mono);
+
+    // Half a frame is left out.
+    QByteArray out;
+    processor.setInput(44100, 2);
+    processor.setOutput(44100, 2);
+    processor.process(mono.constData(), 6, out);
+    EXPECT_EQ(4, out.size());
+
+    // 8 bits samples only get their channels.
+    processor.setInput(8000, 1, 8);
+    processor.setOutput(44100, 2);
+    processor.setGain(2.0f);
+    out.clear();
+    processor.process("\x01\x02\x03", 3, out);
+    EXPECT_TRUE(out == QByteArray("\x01\x01\x02\x02\x03\x03"));
+}
+
+/// Every SIMD kernel gives the output of the scalar one, within one LSB
+/// where the instruction set has no exact division or rounding.
+TEST(PcmProcessorTest, KernelsMatchScalar)
+{
+    const int channels[][2] = { { 1, 2 }, { 2, 2 }, { 1, 1 }, { 2, 1 } };
+    const float gains[] = { 0.5f, 1.5f, 4.0f };
+    const int rates[] = { 44100, 22050, 48000 };
+
+    for (int k = PcmProcessor::KERNEL_SCALAR + 1; k < PcmProcessor::KERNEL_COUNT; ++k)
+    {
+        const PcmKernels *kernels = PcmProcessor::kernels(static_cast<PcmProcessor::Kernel>(k));
+        if (kernels == 0)
+        {
+            continue;
+        }
+        for (size_t c = 0; c < sizeof(channels) / sizeof(channels[0]); ++c)
+        {
+            const QByteArray data = noise(20000 * channels[c][0] + channels[c][0], c);
+            for (size_t g = 0; g < sizeof(gains) / sizeof(gains[0]); ++g)
+            {
+                for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); ++r)
+                {
+                    for (int cross_feed = 0; cross_feed < 2; ++cross_feed)
+                    {
+                        PcmProcessor scalar, simd;
+                        ASSERT_TRUE(scalar.setKernel(PcmProcessor::KERNEL_SCALAR));
+                        ASSERT_TRUE(simd.setKernel(static_cast<PcmProcessor::Kernel>(k)));
+                        PcmProcessor *both[] = { &scalar, &simd };
+                        for (int i = 0; i < 2; ++i)
+                        {
+                            both[i]->setInput(rates[r], channels[c][0]);
+                            both[i]->setOutput(44100, channels[c][1]);
+                            both[i]->setGain(gains[g]);
+                            both[i]->setCrossFeed(cross_feed != 0);
+                        }
+
+                        const QByteArray expected = run(scalar, data);
+                        EXPECT_FALSE(expected.isEmpty());
+                        EXPECT_LE(maxDifference(expected, run(simd, data)), 1)
+                            << kernels->name << " channels " << channels[c][0] << "->" << channels[c][1]
+                            << " gain " << gains[g] << " rate " << rates[r] << " cross-feed " << cross_feed;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/// Below the knee the gain is linear, above it the peaks get closer to
+/// full scale without reaching it.
+TEST(PcmProcessorTest, SoftClip)
+{
+    const qint16 input[] = { 1000, -1000, 6000, 8000, 16000, 32767, -32768 };
+    const QByteArray data(reinterpret_cast<const char *>(input), sizeof(input));
+
+    PcmProcessor processor;
+    processor.setInput(44100, 1);
+    processor.setOutput(44100, 1);
+    processor.setGain(4.0f);
+    QByteArray out;
+    processor.process(data.constData(), data.size(), out);
+    ASSERT_EQ(data.size(), out.size());
+
+    const qint16 *result = samples(out);
+    EXPECT_EQ(4000, result[0]);
+    EXPECT_EQ(-4000, result[1]);
+    EXPECT_EQ(24000, result[2]);
+    EXPECT_GT(result[3], 24576);
+    EXPECT_GT(result[4], result[3]);
+    EXPECT_GT(result[5], result[4]);
+    EXPECT_LT(result[5], 32767);
+    EXPECT_LT(result[6], -result[4]);
+    EXPECT_GT(result[6], -32767);
+}
+
+/// A ramp stays a ramp at twice the rate, however the input is cut.
+TEST(PcmProcessorTest, Resample)
+{
+    QByteArray ramp(2000 * 2, 0);
+    qint16 *data = reinterpret_cast<qint16 *>(ramp.data());
+    for (int i = 0; i < 2000; ++i)
+    {
+        data[i] = static_cast<qint16>(i * 10 - 10000);
+    }
+
+    PcmProcessor processor;
+    processor.setInput(22050, 1);
+    processor.setOutput(44100, 1);
+    EXPECT_TRUE(processor.isResampling());
+    QByteArray whole;
+    processor.process(ramp.constData(), ramp.size(), whole);
+    EXPECT_LE(whole.size(), processor.maxOutputBytes(ramp.size()));
+    EXPECT_EQ(2 * (2 * 2000 - 2), whole.size());
+
+    const qint16 *result = samples(whole);
+    for (int i = 0; i < whole.size() / 2; ++i)
+    {
+        ASSERT_EQ(i * 5 - 10000, result[i]) << i;
+    }
+
+    processor.reset();
+    EXPECT_TRUE(run(processor, ramp) == whole);
+
+    // Down to 16KHz.
+    processor.setInput(48000, 2);
+    processor.setOutput(16000, 2);
+    QByteArray stereo(2000 * 4, 0);
+    monoToStereo(ramp.constData(), ramp.size(), 2, stereo.data());
+    const QByteArray down = run(processor, stereo);
+    EXPECT_NEAR(2000 / 3 * 4, down.size(), 8);
+    for (int i = 0; i < down.size() / 4; ++i)
+    {
+        ASSERT_EQ(i * 30 - 10000, samples(down)[2 * i]) << i;
+        ASSERT_EQ(samples(down)[2 * i], samples(down)[2 * i + 1]);
+    }
+}
+
+/// The left channel alone leaks its low frequencies into the right one.
+TEST(PcmProcessorTest, CrossFeed)
+{
+    QByteArray left(4410 * 4, 0);
+    qint16 *data = reinterpret_cast<qint16 *>(left.data());
+    for (int i = 0; i < 4410; ++i)
+    {
+        data[2 * i] = 10000;
+    }
+
+    PcmProcessor processor;
+    processor.setInput(44100, 2);
+    processor.setOutput(44100, 2);
+    processor.setCrossFeed(true);
+    EXPECT_TRUE(processor.isCrossFeeding());
+    const QByteArray out = run(processor, left);
+    ASSERT_EQ(left.size(), out.size());
+
+    const qint16 *last = samples(out) + out.size() / 2 - 2;
+    EXPECT_GT(last[1], 1000);
+    EXPECT_LT(last[1], last[0]);
+
+    // Identical channels stay identical.
+    QByteArray mono(4410 * 2, 0);
+    memcpy(mono.data(), samples(noise(4410, 3)), mono.size());
+    processor.setInput(44100, 1);
+    const QByteArray stereo = run(processor, mono);
+    for (int i = 0; i < stereo.size() / 4; ++i)
+    {
+        ASSERT_EQ(samples(stereo)[2 * i], samples(stereo)[2 * i + 1]);
+    }
+}
+
+/// Prints the throughput of each kernel, in million input samples per
+/// second.
+TEST(PcmProcessorTest, Benchmark)
+{
+    const int SAMPLES = 441000;
+    const QByteArray data = noise(SAMPLES, 7);
+    QByteArray out(SAMPLES * 16, 0);
+
+    struct Case
+    {
+        const char *name;
+        int in_rate;
+        int in_channels;
+        float gain;
+        bool cross_feed;
+    };
+    const Case cases[] = {
+        { "mono to stereo, gain", 44100, 1, 2.0f, false },
+        { "stereo, gain", 44100, 2, 0.7f, false },
+        { "stereo, cross-feed", 44100, 2, 1.0f, true },
+        { "22.05KHz mono, gain", 22050, 1, 2.0f, false },
+    };
+
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c)
+    {
+        for (int k = PcmProcessor::KERNEL_SCALAR; k < PcmProcessor::KERNEL_COUNT; ++k)
+        {
+            PcmProcessor processor;
+            if (!processor.setKernel(static_cast<PcmProcessor::Kernel>(k)))
+            {
+                continue;
+            }
+            processor.setInput(cases[c].in_rate, cases[c].in_channels);
+            processor.setOutput(44100, 2);
+            processor.setGain(cases[c].gain);
+            processor.setCrossFeed(cases[c].cross_feed);
+
+            const int ROUNDS = 10;
+            QTime t;
+            t.start();
+            for (int round = 0; round < ROUNDS; ++round)
+            {
+                processor.process(data.constData(), data.size(), out.data());
+            }
+            const int elapsed = qMax(t.elapsed(), 1);
+            printf("%-24s %-8s %8.1f Msamples/s\n", cases[c].name, processor.kernelName(),
+                   static_cast<double>(SAMPLES) * ROUNDS / elapsed / 1000.0);
+        }
+    }
+}
+
+}
@@ -0,0 +1,222 @@
+#include <unistd.h>
+
+#include "onyx/base/base.h"
+#include "gtest/gtest.h"
+#include "onyx/sound/pcm_stream.h"
+
+namespace
+{
+
+/// Records what the playback thread writes.
+class FakeDevice : public PcmDevice
+{
+public:
+    /// 16 bits mono, played in stereo or not.
+    FakeDevice(bool stereo = false, int delay_us = 0)
+        : delay_us_(delay_us)
+        , writes_(0)
+    {
+        processor_.setInput(22050, 1);
+        processor_.setOutput(22050, stereo ? 2 : 1);
+    }
+
+    PcmProcessor & streamProcessor() { return processor_; }
+
+    bool writeDevice(const char *data, int size)
+    {
+        if (delay_us_ > 0)
+        {
+            usleep(delay_us_);
+        }
+        QMutexLocker locker(&mutex_);
+        data_.append(data, size);
+        ++writes_;
+        return true;
+    }
+
+    QByteArray data()
+    {
+        QMutexLocker locker(&mutex_);
+        return data_;
+    }
+
+    int writes()
+    {
+        QMutexLocker locker(&mutex_);
+        return writes_;
+    }
+
+private:
+    PcmProcessor processor_;
+    int delay_us_;
+    QMutex mutex_;
+    QByteArray data_;
+    int writes_;
+};
+
+static QByteArray pattern(int size, int seed)
+{
+    QByteArray result(size, 0);
+    for (int i = 0; i < size; ++i)
+    {
+        result[i] = static_cast<char>((i * 7 + seed) & 0xff);
+    }
+    return result;
+}
+
+TEST(PcmRingBufferTest, WrapAround)
+{
+    PcmRingBuffer ring(100);
+    EXPECT_EQ(128, ring.capacity());
+    EXPECT_EQ(0, ring.available());
+    EXPECT_EQ(128, ring.space());
+
+    QByteArray expected, actual;
+    for (int round = 0; round < 50; ++round)
+    {
+        const QByteArray chunk = pattern(37 + round % 11, round);
+        ASSERT_EQ(chunk.size(), ring.write(chunk.constData(), chunk.size()));
+        expected.append(chunk);
+
+        // Read less than written, so the indexes wrap at every offset.
+        int left = ring.available() - 20;
+        while (left > 0)
+        {
+            const char *data = 0;
+            const int count = qMin(ring.peek(data), left);
+            ASSERT_GT(count, 0);
+            actual.append(data, count);
+            ring.consume(count);
+            left -= count;
+        }
+    }
+    EXPECT_TRUE(expected.startsWith(actual));
+    EXPECT_EQ(expected.size() - actual.size(), ring.available());
+}
+
+TEST(PcmRingBufferTest, Full)
+{
+    PcmRingBuffer ring(64);
+    const QByteArray data = pattern(100, 1);
+    EXPECT_EQ(64, ring.write(data.constData(), data.size()));
+    EXPECT_EQ(0, ring.space());
+    EXPECT_EQ(0, ring.write(data.constData(), data.size()));
+
+    EXPECT_EQ(64, ring.discard());
+    EXPECT_EQ(0, ring.available());
+    EXPECT_EQ(64, ring.space());
+}
+
+/// Everything written comes out in order, with a ring much smaller than
+/// the data and writes of odd sizes.
+TEST(PcmStreamTest, Order)
+{
+    FakeDevice device;
+    const QByteArray data = pattern(1024 * 1024, 3);
+    {
+        PcmStream stream(device, 4096);
+        int offset = 0;
+        for (int i = 0; offset < data.size(); ++i)
+        {
+            const int size = qMin(2 * (1 + i % 997), data.size() - offset);
+            ASSERT_EQ(size, stream.write(data.constData() + offset, size));
+            offset += size;
+        }
+        EXPECT_TRUE(stream.drain(5000));
+
+        PcmStream::Stats stats = stream.stats();
+        EXPECT_EQ(4096, stats.capacity);
+        EXPECT_EQ(0, stats.buffered);
+        EXPECT_EQ(data.size(), stats.written);
+        EXPECT_EQ(data.size(), stats.played);
+        EXPECT_EQ(0, stats.device_errors);
+    }
+    EXPECT_TRUE(device.data() == data);
+}
+
+TEST(PcmStreamTest, Stereo)
+{
+    FakeDevice device(true);
+    PcmStream stream(device);
+    const QByteArray mono = pattern(10000, 5);
+    ASSERT_EQ(mono.size(), stream.write(mono.constData(), mono.size()));
+    EXPECT_TRUE(stream.drain(5000));
+
+    QByteArray expected(mono.size() * 2, 0);
+    monoToStereo(mono.constData(), mono.size(), 2, expected.data());
+    EXPECT_TRUE(device.data() == expected);
+}
+
+/// A gap in the middle of the data is an underrun, the end of the data
+/// followed by drain() is not.
+TEST(PcmStreamTest, Underruns)
+{
+    FakeDevice device;
+    PcmStream stream(device);
+    const QByteArray data = pattern(2000, 7);
+
+    stream.write(data.constData(), data.size());
+    usleep(50 * 1000);
+    stream.write(data.constData(), data.size());
+    EXPECT_TRUE(stream.drain(5000));
+    EXPECT_EQ(1, stream.stats().underruns);
+
+    stream.write(data.constData(), data.size());
+    EXPECT_TRUE(stream.drain(5000));
+    usleep(50 * 1000);
+    EXPECT_EQ(1, stream.stats().underruns);
+
+    stream.resetStats();
+    EXPECT_EQ(0, stream.stats().underruns);
+    EXPECT_EQ(0, stream.stats().written);
+}
+
+/// stop() drops the data not played yet and unblocks a writer.
+TEST(PcmStreamTest, Stop)
+{
+    // About 2ms per slice.
+    FakeDevice device(false, 2000);
+    PcmStream stream(device, 8192);
+    const QByteArray data = pattern(1024 * 1024, 9);
+
+    class Writer : public QThread
+    {
+    public:
+        Writer(PcmStream & stream, const QByteArray & data)
+            : stream_(stream), data_(data), written_(0) {}
+        void run() { written_ = stream_.write(data_.constData(), data_.size()); }
+        PcmStream & stream_;
+        QByteArray data_;
+        int written_;
+    };
+
+    Writer writer(stream, data);
+    writer.start();
+    usleep(30 * 1000);
+    stream.stop();
+    ASSERT_TRUE(writer.wait(5000));
+    EXPECT_LT(writer.written_, data.size());
+
+    // Data written after stop() is played.
+    const int before = device.data().size();
+    const QByteArray more = pattern(1000, 11);
+    EXPECT_EQ(more.size(), stream.write(more.constData(), more.size()));
+    EXPECT_TRUE(stream.drain(5000));
+    EXPECT_TRUE(device.data().endsWith(more));
+    EXPECT_LE(device.data().size(), before + 8192 + more.size());
+}
+
+TEST(PcmStreamTest, WriteTimeout)
+{
+    FakeDevice device(false, 100 * 1000);
+    PcmStream stream(device, 4096);
+    const QByteArray data = pattern(64 * 1024, 13);
+    QTime t;
+    t.start();
+    const int written = stream.write(data.constData(), data.size(), 50);
+    EXPECT_LT(written, data.size());
+    EXPECT_LT(t.elapsed(), 1000);
+    stream.stop();
+}
+
+}
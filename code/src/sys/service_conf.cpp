@@ -1,5 +1,6 @@
 
 #include "onyx/sys/service_conf.h"
+#include "onyx/sys/sys_conf_cache.h"
 
 namespace sys
 {
@@ -167,6 +168,17 @@ bool Service::operator== (const Service & right)
 /// Need a default service map.
 static Services DEFAULT_SERVICES;
 
+/// All services and the service of each extension, in lower case. Built
+/// once and kept until the services table is written. Guarded by
+/// services_mutex.
+static Services all_services;
+static QHash<QString, Service> extension_services;
+static QMutex services_mutex;
+
+/// Key of the index in SystemConfigCache, which tells when the database
+/// has been written.
+static const QString SERVICES_KEY = "services";
+
 /// Maintain all services state. Service is used by explorer to
 /// view content for end user.
 /// The service files usually is under /usr/share/dbus-1/services/
@@ -347,8 +359,63 @@ void ServiceConfig::loadDefaultServices()
     }
 }
 
-/// Always read all services from database.
+/// All services, with the ones registered in the database.
 void ServiceConfig::loadAllServices(QSqlDatabase &database, Services &services)
+{
+    QMutexLocker locker(&services_mutex);
+    updateIndex(database);
+    services = all_services;
+}
+
+/// The service opening the file, found by its extension without case.
+/// When several services handle the extension, the first one of
+/// loadAllServices is used.
+bool ServiceConfig::serviceForFile(QSqlDatabase &database,
+                                   const QString & path,
+                                   Service & service)
+{
+    QString ext = QFileInfo(path).suffix().toLower();
+    QMutexLocker locker(&services_mutex);
+    updateIndex(database);
+    QHash<QString, Service>::const_iterator it = extension_services.find(ext);
+    if (it == extension_services.end())
+    {
+        return false;
+    }
+    service = it.value();
+    return true;
+}
+
+/// Build the services and the extension index again if the database
+/// has been written since they were built.
+void ServiceConfig::updateIndex(QSqlDatabase &database)
+{
+    QVariant built;
+    if (SystemConfigCache::instance().find(SERVICES_KEY, built))
+    {
+        return;
+    }
+
+    readAllServices(database, all_services);
+    extension_services.clear();
+    for(ConstServicesIter iter = all_services.begin(); iter != all_services.end(); ++iter)
+    {
+        foreach(const QString & ext, iter->extensions())
+        {
+            QString key = ext.toLower();
+            if (!extension_services.contains(key))
+            {
+                extension_services.insert(key, *iter);
+            }
+        }
+    }
+    SystemConfigCache::instance().insert(SERVICES_KEY, true);
+}
+
+/// Always read all services from database. A registered extension is
+/// taken from the default services and given to the registered service,
+/// which is merged with the service of the same name.
+void ServiceConfig::readAllServices(QSqlDatabase &database, Services &services)
 {
     QString ext, svr, obj, ifname, method, app;
     services.clear();
@@ -356,6 +423,11 @@ void ServiceConfig::loadAllServices(QSqlDatabase &database, Services &services)
     loadDefaultServices();
     services = DEFAULT_SERVICES;
 
+    // Registered extensions, in the order of the rows.
+    QStringList exts;
+    QList<Service> registered;
+    QSet<QString> overridden;
+
     QSqlQuery query(database);
     query.prepare("SELECT extension, service, object, interface, method, app FROM services");
     query.exec();
@@ -369,32 +441,42 @@ void ServiceConfig::loadAllServices(QSqlDatabase &database, Services &services)
         method = query.value(index++).toString();
         app = query.value(index).toString();
 
-        // Add to the service list.
-        Service service(svr, obj, ifname, method, app);
-        service.mutable_extensions().push_back(ext);
+        exts.push_back(ext);
+        registered.push_back(Service(svr, obj, ifname, method, app));
+        overridden.insert(ext);
+    }
 
-        ServicesIter iter;
-        // first kill default service for ext
-        for(iter = services.begin(); iter != services.end(); ++iter)
+    // First kill default service for the registered extensions.
+    QHash<QString, Service *> by_name;
+    for(ServicesIter iter = services.begin(); iter != services.end(); ++iter)
+    {
+        QStringList & list = iter->mutable_extensions();
+        for(int i = list.size() - 1; i >= 0; --i)
         {
-            if (iter->extensions().contains(ext))
+            if (overridden.contains(list.at(i)))
             {
-                iter->mutable_extensions().removeAll(ext);
+                list.removeAt(i);
             }
         }
-
-        for(iter = services.begin(); iter != services.end(); ++iter)
+        if (!by_name.contains(iter->service_name()))
         {
-            if (*iter == service)
-            {
-                iter->mutable_extensions().push_back(ext);
-                break;
-            }
+            by_name.insert(iter->service_name(), &(*iter));
         }
+    }
 
-        if (iter == services.end())
+    // Add to the service list.
+    for(int i = 0; i < registered.size(); ++i)
+    {
+        QHash<QString, Service *>::iterator pos = by_name.find(registered[i].service_name());
+        if (pos != by_name.end())
+        {
+            pos.value()->mutable_extensions().push_back(exts[i]);
+        }
+        else
         {
-            services.push_back(service);
+            registered[i].mutable_extensions().push_back(exts[i]);
+            services.push_back(registered[i]);
+            by_name.insert(registered[i].service_name(), &services.back());
         }
     }
 }
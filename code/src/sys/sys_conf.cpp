@@ -14,14 +14,40 @@
 #include "onyx/sys/font_conf.h"
 #include "onyx/sys/misc_conf.h"
 #include "onyx/sys/platform.h"
+#include "onyx/sys/sys_conf_cache.h"
 #include "device_conf.h"
 
 namespace sys
 {
 
+/// Databases whose tables have been created by this process.
+static QSet<QString> initialized_databases;
+static QMutex initialized_mutex;
+
+static inline SystemConfigCache & cache()
+{
+    return SystemConfigCache::instance();
+}
+
 SystemConfig::SystemConfig()
 {
     open();
+}
+
+SystemConfig::~SystemConfig()
+{
+    close();
+}
+
+/// Create the tables, once per process and database.
+void SystemConfig::initializeTables()
+{
+    QMutexLocker locker(&initialized_mutex);
+    if (initialized_databases.contains(database_->databaseName()))
+    {
+        return;
+    }
+    initialized_databases.insert(database_->databaseName());
 
     DictConfig::makeSureTableExist(*database_);
     PMConfig::makeSureTableExist(*database_);
@@ -36,14 +62,16 @@ SystemConfig::SystemConfig()
     MiscConfig::makeSureTableExist(*database_);
 }
 
-SystemConfig::~SystemConfig()
+void SystemConfig::loadAllServices(Services &services)
 {
-    close();
+    ServiceConfig::loadAllServices(*database_, services);
 }
 
-void SystemConfig::loadAllServices(Services &services)
+/// The service to open the file with, by its extension. Returns false
+/// if no service handles it.
+bool SystemConfig::serviceForFile(const QString & path, Service & service)
 {
-    ServiceConfig::loadAllServices(*database_, services);
+    return ServiceConfig::serviceForFile(*database_, path, service);
 }
 
 /// Retrieve the calibration service.
@@ -155,30 +183,47 @@ bool SystemConfig::onyxPdfReaderService(Service &service)
 bool SystemConfig::registerService(const Service &service,
                                    const QString &path)
 {
-    return ServiceConfig::registerService(*database_, service, path);
+    bool ok = ServiceConfig::registerService(*database_, service, path);
+    cache().invalidate();
+    return ok;
 }
 
 bool SystemConfig::unRegisterService(const Service &service)
 {
-    return ServiceConfig::unRegisterService(*database_, service);
+    bool ok = ServiceConfig::unRegisterService(*database_, service);
+    cache().invalidate();
+    return ok;
 }
 
-/// The database is in home directory.
+/// The database is in home directory. The connection is shared by all
+/// instances and kept open, opening it again would close it first.
 bool SystemConfig::open()
 {
+    QString path = QDir::home().filePath("system_config.db");
     if (!database_)
     {
         if (QSqlDatabase::contains("system_config"))
         {
-            database_.reset(new QSqlDatabase(QSqlDatabase::database("system_config")));
+            database_.reset(new QSqlDatabase(QSqlDatabase::database("system_config", false)));
         }
         else
         {
             database_.reset(new QSqlDatabase(QSqlDatabase::addDatabase("QSQLITE", "system_config")));
         }
-        database_->setDatabaseName(QDir::home().filePath("system_config.db"));
     }
-    return database_->open();
+
+    if (!database_->isOpen() || database_->databaseName() != path)
+    {
+        database_->close();
+        database_->setDatabaseName(path);
+        if (!database_->open())
+        {
+            return false;
+        }
+    }
+    initializeTables();
+    cache().attach(path);
+    return true;
 }
 
 bool SystemConfig::close()
@@ -206,12 +251,19 @@ bool SystemConfig::setLocale(const QLocale & locale)
 
 void SystemConfig::setDefaultFontFamily(const QString & name)
 {
-    return FontConfig::setDefaultFontFamily(*database_, name);
+    FontConfig::setDefaultFontFamily(*database_, name);
+    cache().invalidate();
 }
 
 QString SystemConfig::defaultFontFamily()
 {
-    return FontConfig::defaultFontFamily(*database_);
+    QVariant value;
+    if (!cache().find("font_family", value))
+    {
+        value = FontConfig::defaultFontFamily(*database_);
+        cache().insert("font_family", value);
+    }
+    return value.toString();
 }
 
 bool SystemConfig::dictionaryRoots(QStringList & dirs)
@@ -222,13 +274,21 @@ bool SystemConfig::dictionaryRoots(QStringList & dirs)
 /// Read the dictionary name that user selected.
 QString SystemConfig::selectedDictionary()
 {
-    return DictConfig::selectedDictionary(*database_);
+    QVariant value;
+    if (!cache().find("selected_dictionary", value))
+    {
+        value = DictConfig::selectedDictionary(*database_);
+        cache().insert("selected_dictionary", value);
+    }
+    return value.toString();
 }
 
 /// Save the dictionary name as the selected.
 bool SystemConfig::selectDictionary(const QString & name)
 {
-    return DictConfig::selectDictionary(*database_, name);
+    bool ok = DictConfig::selectDictionary(*database_, name);
+    cache().invalidate();
+    return ok;
 }
 
 static const QString ZONE_PREFIX = "/usr/share/zoneinfo/";
@@ -489,17 +549,27 @@ bool SystemConfig::isMounted(const std::string & point)
 /// At that time, the volume from hardware is undefined.
 int SystemConfig::volume()
 {
-    return VolumeConfig::volume(*database_);
+    QVariant value;
+    if (!cache().find("volume", value))
+    {
+        value = VolumeConfig::volume(*database_);
+        cache().insert("volume", value);
+    }
+    return value.toInt();
 }
 
 bool SystemConfig::setVolume(const int v)
 {
-    return VolumeConfig::setVolume(*database_, v);
+    bool ok = VolumeConfig::setVolume(*database_, v);
+    cache().invalidate();
+    return ok;
 }
 
 bool SystemConfig::mute(bool m)
 {
-    return VolumeConfig::mute(*database_, m);
+    bool ok = VolumeConfig::mute(*database_, m);
+    cache().invalidate();
+    return ok;
 }
 
 QVector<int> SystemConfig::volumes()
@@ -519,27 +589,49 @@ int SystemConfig::maxVolume()
 
 bool SystemConfig::isMute()
 {
-    return VolumeConfig::isMute(*database_);
+    QVariant value;
+    if (!cache().find("mute", value))
+    {
+        value = VolumeConfig::isMute(*database_);
+        cache().insert("mute", value);
+    }
+    return value.toBool();
 }
 
 int SystemConfig::suspendInterval()
 {
-    return PMConfig::suspendInterval(*database_);
+    QVariant value;
+    if (!cache().find("suspend_interval", value))
+    {
+        value = PMConfig::suspendInterval(*database_);
+        cache().insert("suspend_interval", value);
+    }
+    return value.toInt();
 }
 
 bool SystemConfig::setSuspendInterval(int ms)
 {
-    return PMConfig::setSuspendInterval(*database_, ms);
+    bool ok = PMConfig::setSuspendInterval(*database_, ms);
+    cache().invalidate();
+    return ok;
 }
 
 int SystemConfig::shutdownInterval()
 {
-    return PMConfig::shutdownInterval(*database_);
+    QVariant value;
+    if (!cache().find("shutdown_interval", value))
+    {
+        value = PMConfig::shutdownInterval(*database_);
+        cache().insert("shutdown_interval", value);
+    }
+    return value.toInt();
 }
 
 bool SystemConfig::setShutdownInterval(int ms)
 {
-    return PMConfig::setShutdownInterval(*database_, ms);
+    bool ok = PMConfig::setShutdownInterval(*database_, ms);
+    cache().invalidate();
+    return ok;
 }
 
 bool SystemConfig::clearWifiProfiles()
@@ -663,12 +755,24 @@ QString SystemConfig::downloadFolder()
 
 QString SystemConfig::serialNumber()
 {
-    return DeviceConfig::serialNumber(*database_);
+    QVariant value;
+    if (!cache().find("serial_number", value))
+    {
+        value = DeviceConfig::serialNumber(*database_);
+        cache().insert("serial_number", value);
+    }
+    return value.toString();
 }
 
 QString SystemConfig::deviceId()
 {
-    return DeviceConfig::deviceId(*database_);
+    QVariant value;
+    if (!cache().find("device_id", value))
+    {
+        value = DeviceConfig::deviceId(*database_);
+        cache().insert("device_id", value);
+    }
+    return value.toString();
 }
 
 QString SystemConfig::version()
@@ -743,12 +847,20 @@ QString SystemConfig::defaultAccessPoint()
 
 bool SystemConfig::setMiscValue(const QString &key, const QString &value)
 {
-    return MiscConfig::setValue(*database_, key, value);
+    bool ok = MiscConfig::setValue(*database_, key, value);
+    cache().invalidate();
+    return ok;
 }
 
 QString SystemConfig::miscValue(const QString &key)
 {
-    return MiscConfig::getValue(*database_, key);
+    QVariant value;
+    if (!cache().find("misc/" + key, value))
+    {
+        value = MiscConfig::getValue(*database_, key);
+        cache().insert("misc/" + key, value);
+    }
+    return value.toString();
 }
 
 int SystemConfig::screenUpdateGCInterval()
@@ -758,7 +870,7 @@ int SystemConfig::screenUpdateGCInterval()
     {
         DEFAULT_GC_INTERVAL = 1;
     }
-    QString value = MiscConfig::getValue(*database_, "screen_update_setting");
+    QString value = miscValue("screen_update_setting");
     bool ok;
     int interval = value.toInt(&ok, 10);
     if (!ok)
@@ -771,7 +883,7 @@ int SystemConfig::screenUpdateGCInterval()
 int SystemConfig::screenUpdateGrayScaleSetting()
 {
     const int DEFAULT_GRAY_SCALE_SETTING = 8;
-    QString value = MiscConfig::getValue(*database_, "gray_scale_setting");
+    QString value = miscValue("gray_scale_setting");
     bool ok;
     int gray_scale_setting = value.toInt(&ok, 10);
     if (!ok)
@@ -0,0 +1,133 @@
+#include "onyx/sys/sys_conf_cache.h"
+
+namespace sys
+{
+
+/// Offset of the file change counter in the SQLite database header.
+static const int CHANGE_COUNTER_OFFSET = 24;
+
+SystemConfigCache & SystemConfigCache::instance()
+{
+    static SystemConfigCache instance_;
+    return instance_;
+}
+
+SystemConfigCache::SystemConfigCache()
+    : counter_(0)
+{
+    connect(&watcher_, SIGNAL(fileChanged(const QString &)),
+            this, SLOT(onFileChanged(const QString &)));
+}
+
+SystemConfigCache::~SystemConfigCache()
+{
+}
+
+/// Use the database of path. The snapshot is dropped when the path
+/// changes.
+void SystemConfigCache::attach(const QString & db_path)
+{
+    QMutexLocker locker(&mutex_);
+    if (path_ == db_path)
+    {
+        return;
+    }
+
+    if (!path_.isEmpty())
+    {
+        watcher_.removePath(path_);
+    }
+    file_.close();
+    values_.clear();
+
+    path_ = db_path;
+    file_.setFileName(path_);
+    watcher_.addPath(path_);
+    counter_ = changeCounter();
+}
+
+/// Return the cached value of key. False if it's not cached or the
+/// database has been written since it was.
+bool SystemConfigCache::find(const QString & key, QVariant & value)
+{
+    QMutexLocker locker(&mutex_);
+    validate();
+    QHash<QString, QVariant>::const_iterator it = values_.find(key);
+    if (it == values_.end())
+    {
+        return false;
+    }
+    value = it.value();
+    return true;
+}
+
+/// Cache a value read from the database.
+void SystemConfigCache::insert(const QString & key, const QVariant & value)
+{
+    QMutexLocker locker(&mutex_);
+    values_.insert(key, value);
+}
+
+/// Drop the snapshot. Called after writing the database.
+void SystemConfigCache::invalidate()
+{
+    QMutexLocker locker(&mutex_);
+    values_.clear();
+    counter_ = changeCounter();
+}
+
+/// Drop the snapshot if the database changed. Returns false then.
+bool SystemConfigCache::validate()
+{
+    quint32 counter = changeCounter();
+    if (counter == counter_)
+    {
+        return true;
+    }
+    values_.clear();
+    counter_ = counter;
+    return false;
+}
+
+quint32 SystemConfigCache::changeCounter()
+{
+    if (!file_.isOpen() && !file_.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+    {
+        return 0;
+    }
+
+    uchar data[4];
+    if (!file_.seek(CHANGE_COUNTER_OFFSET) ||
+        file_.read(reinterpret_cast<char *>(data), sizeof(data)) != sizeof(data))
+    {
+        return 0;
+    }
+    return qFromBigEndian<quint32>(data);
+}
+
+void SystemConfigCache::onFileChanged(const QString & path)
+{
+    bool valid = true;
+    {
+        QMutexLocker locker(&mutex_);
+        if (path != path_)
+        {
+            return;
+        }
+
+        // Watch the new file if it has been replaced.
+        if (!watcher_.files().contains(path))
+        {
+            file_.close();
+            watcher_.addPath(path);
+        }
+        valid = validate();
+    }
+
+    if (!valid)
+    {
+        emit changed();
+    }
+}
+
+}   // namespace sys
@@ -163,6 +163,168 @@ SysStatus::~SysStatus()
 {
 }
 
+/// Milliseconds the properties without a change signal are kept.
+static const int PROPERTY_TIMEOUT = 1000;
+
+/// Properties system manager broadcasts when they change.
+static bool isBroadcast(const QString & method)
+{
+    return (method == "batteryStatus" ||
+            method == "volume" ||
+            method == "isMute" ||
+            method == "sdioState");
+}
+
+/// Return the reply of a getter of system manager. The reply is kept
+/// until a broadcast signal or a setter changes the property, or for
+/// PROPERTY_TIMEOUT ms when system manager does not broadcast it, so
+/// that repainting the status bar does not block on the bus.
+bool SysStatus::cachedCall(const QString & method, QList<QVariant> & args) const
+{
+    Properties::const_iterator it = properties_.find(method);
+    if (it != properties_.end() &&
+        (isBroadcast(method) || it.value().time.elapsed() < PROPERTY_TIMEOUT))
+    {
+        args = it.value().args;
+        return true;
+    }
+
+    QDBusMessage message = QDBusMessage::createMethodCall(
+        service,            // destination
+        object,             // path
+        iface,              // interface
+        method              // method.
+    );
+
+    QDBusMessage reply = connection_.call(message);
+    if (reply.type() == QDBusMessage::ReplyMessage)
+    {
+        args = reply.arguments();
+        cacheProperty(method, args);
+        return true;
+    }
+    else if (reply.type() == QDBusMessage::ErrorMessage)
+    {
+        qWarning("%s", qPrintable(reply.errorMessage()));
+    }
+    return false;
+}
+
+/// Store the reply of a getter.
+void SysStatus::cacheProperty(const QString & method, const QList<QVariant> & args) const
+{
+    Property & property = properties_[method];
+    property.args = args;
+    property.time.start();
+}
+
+/// Store the value of a property of one argument, named by its getter.
+void SysStatus::cacheProperty(const QString & method, const QVariant & value) const
+{
+    QList<QVariant> args;
+    args << value;
+    cacheProperty(method, args);
+}
+
+/// Drop the cached properties. The next getter asks system manager again.
+void SysStatus::invalidateProperties()
+{
+    properties_.clear();
+}
+
+/// Send a setter without waiting for the reply. The property is cached
+/// with the new value at once. If system manager refuses it, the
+/// previous value is restored, or dropped when there was none.
+void SysStatus::asyncCall(const QString & method,
+                          const QVariant & value,
+                          const QString & property)
+{
+    QDBusMessage message = QDBusMessage::createMethodCall(
+        service,            // destination
+        object,             // path
+        iface,              // interface
+        method              // method.
+    );
+    message << value;
+
+    QDBusPendingCallWatcher *watcher =
+        new QDBusPendingCallWatcher(connection_.asyncCall(message), this);
+    watcher->setProperty("property", property);
+    watcher->setProperty("value", value);
+    Properties::const_iterator it = properties_.find(property);
+    if (it != properties_.end() && it.value().args.size() > 0)
+    {
+        watcher->setProperty("previous", it.value().args.front());
+    }
+    cacheProperty(property, value);
+    connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher *)),
+            this, SLOT(onAsyncCallFinished(QDBusPendingCallWatcher *)));
+}
+
+void SysStatus::onAsyncCallFinished(QDBusPendingCallWatcher *watcher)
+{
+    QDBusMessage reply = watcher->reply();
+    bool refused = false;
+    if (reply.type() == QDBusMessage::ErrorMessage)
+    {
+        qWarning("%s", qPrintable(reply.errorMessage()));
+        refused = true;
+    }
+    else if (reply.arguments().size() > 0 &&
+             reply.arguments().at(0).type() == QVariant::Bool)
+    {
+        refused = !reply.arguments().at(0).toBool();
+    }
+
+    // Leave the property alone if a broadcast or a later setter changed it.
+    QString property = watcher->property("property").toString();
+    Properties::const_iterator it = properties_.find(property);
+    if (refused && it != properties_.end() &&
+        it.value().args == (QList<QVariant>() << watcher->property("value")))
+    {
+        QVariant previous = watcher->property("previous");
+        if (previous.isValid())
+        {
+            cacheProperty(property, previous);
+        }
+        else
+        {
+            properties_.remove(property);
+        }
+    }
+    watcher->deleteLater();
+}
+
+void SysStatus::setVolumeAsync(int volume)
+{
+    asyncCall("setVolume", volume, "volume");
+}
+
+void SysStatus::muteAsync(bool m)
+{
+    asyncCall("mute", m, "isMute");
+}
+
+void SysStatus::setGrayScaleAsync(int colors)
+{
+    asyncCall("setGrayScale", colors, "grayScale");
+}
+
+void SysStatus::setBrightnessAsync(const unsigned char brightness)
+{
+    asyncCall("setBacklightBrightness", brightness, "backlightBrightness");
+}
+
+void SysStatus::setSuspendIntervalAsync(int ms)
+{
+    asyncCall("setSuspendInterval", ms, "suspendInterval");
+}
+
+void SysStatus::setShutdownIntervalAsync(int ms)
+{
+    asyncCall("setShutdownInterval", ms, "shutdownInterval");
+}
+
 /// Register slots to system manager to enable application to receive signals from
 /// system manager.
 void SysStatus::installSlots()
@@ -476,28 +638,14 @@ void SysStatus::installSlots()
 bool SysStatus::batteryStatus(int& current,
                               int& status)
 {
-    QDBusMessage message = QDBusMessage::createMethodCall(
-        service,            // destination
-        object,             // path
-        iface,              // interface
-        "batteryStatus"      // method.
-    );
-
-    // Call.
-    QDBusMessage reply = connection_.call(message);
-
-    if (reply.type() == QDBusMessage::ReplyMessage)
-    {
-        QList<QVariant> args = reply.arguments();
-        current = args[1].toInt();
-        status = args[2].toInt();
-        return true;
-    }
-    else if (reply.type() == QDBusMessage::ErrorMessage)
+    QList<QVariant> args;
+    if (!cachedCall("batteryStatus", args) || args.size() < 3)
     {
-        qWarning("%s", qPrintable(reply.errorMessage()));
+        return false;
     }
-    return false;
+    current = args[1].toInt();
+    status = args[2].toInt();
+    return true;
 }
 
 /// Ask system manager to broadcast battery signals to all listeners.
@@ -694,24 +842,8 @@ bool SysStatus::sdioState() const
     return true;
 #endif
 
-    QDBusMessage message = QDBusMessage::createMethodCall(
-        service,            // destination
-        object,             // path
-        iface,              // interface
-        "sdioState"      // method.
-    );
-
-    QDBusMessage reply = connection_.call(message);
-
-    if (reply.type() == QDBusMessage::ReplyMessage)
-    {
-        return checkAndReturnBool(reply.arguments());
-    }
-    else if (reply.type() == QDBusMessage::ErrorMessage)
-    {
-        qWarning("%s", qPrintable(reply.errorMessage()));
-    }
-    return false;
+    QList<QVariant> args;
+    return cachedCall("sdioState", args) && checkAndReturnBool(args);
 }
 
 bool SysStatus::enableSdio(bool enable)
@@ -731,7 +863,12 @@ bool SysStatus::enableSdio(bool enable)
 
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
-        return checkAndReturnBool(reply.arguments());
+        if (checkAndReturnBool(reply.arguments()))
+        {
+            cacheProperty("sdioState", enable);
+            return true;
+        }
+        return false;
     }
     else if (reply.type() == QDBusMessage::ErrorMessage)
     {
@@ -906,7 +1043,12 @@ bool SysStatus::setSuspendInterval(int ms)
 
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
-        return checkAndReturnBool(reply.arguments());
+        if (checkAndReturnBool(reply.arguments()))
+        {
+            cacheProperty("suspendInterval", ms);
+            return true;
+        }
+        return false;
     }
     else if (reply.type() == QDBusMessage::ErrorMessage)
     {
@@ -917,24 +1059,11 @@ bool SysStatus::setSuspendInterval(int ms)
 
 int  SysStatus::suspendInterval()
 {
-    QDBusMessage message = QDBusMessage::createMethodCall(
-        service,            // destination
-        object,             // path
-        iface,              // interface
-        "suspendInterval"      // method.
-    );
-
-    QDBusMessage reply = connection_.call(message);
-
-    if (reply.type() == QDBusMessage::ReplyMessage)
+    QList<QVariant> args;
+    if (cachedCall("suspendInterval", args) && args.size() > 0)
     {
-        QList<QVariant> args = reply.arguments();
         return args[0].toInt();
     }
-    else if (reply.type() == QDBusMessage::ErrorMessage)
-    {
-        qWarning("%s", qPrintable(reply.errorMessage()));
-    }
     return 0;
 }
 
@@ -974,7 +1103,12 @@ bool SysStatus::setShutdownInterval(int ms)
 
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
-        return checkAndReturnBool(reply.arguments());
+        if (checkAndReturnBool(reply.arguments()))
+        {
+            cacheProperty("shutdownInterval", ms);
+            return true;
+        }
+        return false;
     }
     else if (reply.type() == QDBusMessage::ErrorMessage)
     {
@@ -985,24 +1119,11 @@ bool SysStatus::setShutdownInterval(int ms)
 
 int  SysStatus::shutdownInterval()
 {
-    QDBusMessage message = QDBusMessage::createMethodCall(
-        service,            // destination
-        object,             // path
-        iface,              // interface
-        "shutdownInterval"      // method.
-    );
-
-    QDBusMessage reply = connection_.call(message);
-
-    if (reply.type() == QDBusMessage::ReplyMessage)
+    QList<QVariant> args;
+    if (cachedCall("shutdownInterval", args) && args.size() > 0)
     {
-        QList<QVariant> args = reply.arguments();
         return args[0].toInt();
     }
-    else if (reply.type() == QDBusMessage::ErrorMessage)
-    {
-        qWarning("%s", qPrintable(reply.errorMessage()));
-    }
     return 0;
 }
 
@@ -1097,24 +1218,11 @@ void SysStatus::reportMusicPlayerState(int state)
 
 int SysStatus::volume()
 {
-    QDBusMessage message = QDBusMessage::createMethodCall(
-        service,            // destination
-        object,             // path
-        iface,              // interface
-        "volume"      // method.
-    );
-
-    QDBusMessage reply = connection_.call(message);
-
-    if (reply.type() == QDBusMessage::ReplyMessage)
+    QList<QVariant> args;
+    if (cachedCall("volume", args) && args.size() > 0)
     {
-        QList<QVariant> args = reply.arguments();
         return args[0].toInt();
     }
-    else if (reply.type() == QDBusMessage::ErrorMessage)
-    {
-        qWarning("%s", qPrintable(reply.errorMessage()));
-    }
     return -1;
 }
 
@@ -1132,7 +1240,12 @@ bool SysStatus::setVolume(int volume)
 
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
-        return checkAndReturnBool(reply.arguments());
+        if (checkAndReturnBool(reply.arguments()))
+        {
+            cacheProperty("volume", volume);
+            return true;
+        }
+        return false;
     }
     else if (reply.type() == QDBusMessage::ErrorMessage)
     {
@@ -1155,7 +1268,12 @@ bool SysStatus::mute(bool m)
 
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
-        return checkAndReturnBool(reply.arguments());
+        if (checkAndReturnBool(reply.arguments()))
+        {
+            cacheProperty("isMute", m);
+            return true;
+        }
+        return false;
     }
     else if (reply.type() == QDBusMessage::ErrorMessage)
     {
@@ -1166,24 +1284,8 @@ bool SysStatus::mute(bool m)
 
 bool SysStatus::isMute()
 {
-    QDBusMessage message = QDBusMessage::createMethodCall(
-        service,            // destination
-        object,             // path
-        iface,              // interface
-        "isMute"      // method.
-    );
-
-    QDBusMessage reply = connection_.call(message);
-
-    if (reply.type() == QDBusMessage::ReplyMessage)
-    {
-        return checkAndReturnBool(reply.arguments());
-    }
-    else if (reply.type() == QDBusMessage::ErrorMessage)
-    {
-        qWarning("%s", qPrintable(reply.errorMessage()));
-    }
-    return false;
+    QList<QVariant> args;
+    return cachedCall("isMute", args) && checkAndReturnBool(args);
 }
 
 bool SysStatus::isWpaSupplicantRunning()
@@ -1441,29 +1543,16 @@ bool SysStatus::setGrayScale(int colors)
         qWarning("%s", qPrintable(reply.errorMessage()));
         return false;
     }
+    cacheProperty("grayScale", colors);
     return true;
 }
 
 int SysStatus::grayScale()
 {
-    QDBusMessage message = QDBusMessage::createMethodCall(
-        service,            // destination
-        object,             // path
-        iface,              // interface
-        "grayScale"      // method.
-    );
-
-    QDBusMessage reply = connection_.call(message);
-    if (reply.type() == QDBusMessage::ReplyMessage)
-    {
-        if (reply.arguments().size() > 0)
-        {
-            return reply.arguments().front().toInt();
-        }
-    }
-    else if (reply.type() == QDBusMessage::ErrorMessage)
+    QList<QVariant> args;
+    if (cachedCall("grayScale", args) && args.size() > 0)
     {
-        qWarning("%s", qPrintable(reply.errorMessage()));
+        return args.front().toInt();
     }
     return 8;
 }
@@ -1817,6 +1906,7 @@ bool SysStatus::setBrightness(const unsigned char brightness)
     QDBusMessage reply = connection_.call(message);
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
+        cacheProperty("backlightBrightness", brightness);
         return true;
     }
     else if (reply.type() == QDBusMessage::ErrorMessage)
@@ -1828,23 +1918,10 @@ bool SysStatus::setBrightness(const unsigned char brightness)
 
 unsigned char SysStatus::brightness()
 {
-    QDBusMessage message = QDBusMessage::createMethodCall(
-        service,            // destination
-        object,             // path
-        iface,              // interface
-        "backlightBrightness"      // method.
-    );
-    QDBusMessage reply = connection_.call(message);
-    if (reply.type() == QDBusMessage::ReplyMessage)
+    QList<QVariant> args;
+    if (cachedCall("backlightBrightness", args) && args.size() > 0)
     {
-        if (reply.arguments().size() > 0)
-        {
-            return reply.arguments().at(0).toInt();
-        }
-    }
-    else if (reply.type() == QDBusMessage::ErrorMessage)
-    {
-        qWarning("%s", qPrintable(reply.errorMessage()));
+        return args.at(0).toInt();
     }
     return 0;
 }
@@ -1864,28 +1941,17 @@ void SysStatus::turnGlowLightOn(bool on, bool save)
     if (reply.type() == QDBusMessage::ErrorMessage)
     {
         qWarning("%s", qPrintable(reply.errorMessage()));
+        return;
     }
+    cacheProperty("glowLightOn", on ? 1 : 0);
 }
 
 bool SysStatus::glowLightOn()
 {
-    QDBusMessage message = QDBusMessage::createMethodCall(
-        service,            // destination
-        object,             // path
-        iface,              // interface
-        "glowLightOn"       // method.
-    );
-    QDBusMessage reply = connection_.call(message);
-    if (reply.type() == QDBusMessage::ReplyMessage)
+    QList<QVariant> args;
+    if (cachedCall("glowLightOn", args) && args.size() > 0)
     {
-        if (reply.arguments().size() > 0)
-        {
-            return reply.arguments().at(0).toInt() > 0;
-        }
-    }
-    else if (reply.type() == QDBusMessage::ErrorMessage)
-    {
-        qWarning("%s", qPrintable(reply.errorMessage()));
+        return args.at(0).toInt() > 0;
     }
     return false;
 }
@@ -2037,12 +2103,16 @@ void SysStatus::onSdCardChanged(bool insert)
 
 void SysStatus::onSdioChanged(bool on)
 {
+    cacheProperty("sdioState", on);
     emit sdioChangedSignal(on);
 }
 
 void SysStatus::onBatteryChanged(int current,
                                  int status)
 {
+    QList<QVariant> args;
+    args << true << current << status;
+    cacheProperty("batteryStatus", args);
     emit batterySignal(current, status);
 }
 
@@ -2073,6 +2143,8 @@ void SysStatus::onAboutToSuspend()
 
 void SysStatus::onWakeup()
 {
+    // Anything may have changed while the device was sleeping.
+    invalidateProperties();
     emit wakeup();
 }
 
@@ -2115,6 +2187,8 @@ void SysStatus::onDownloadStateChanged(const QString &url,
 
 void SysStatus::onVolumeChanged(int new_volume, bool is_mute)
 {
+    cacheProperty("volume", new_volume);
+    cacheProperty("isMute", is_mute);
     emit volumeChanged(new_volume, is_mute);
 }
 
@@ -60,6 +60,18 @@ enum
 
 
 
+/// Tags of the first line of a table, like
+/// "bssid / frequency / signal level / flags / ssid".
+static void parseTitle(const WpaToken & line, QStringList & tags)
+{
+    WpaTokenizer items(line, '/');
+    WpaToken item;
+    while (items.next(item))
+    {
+        tags.push_back(item.trimmed().toString());
+    }
+}
+
 /// WpaConnection constructor.
 /// \name The interface name. If the name is empty, WpaConnection
 /// would check the interface automatically.
@@ -70,9 +82,11 @@ WpaConnection::WpaConnection(const QString &name)
 : connection_(QDBusConnection::sessionBus())
 #endif
 , wpa_supplicant_connected_(false)
+, ctrl_dir_(CTRL_IFACE_DIR)
 , ctrl_iface_(name)
 , ctrl_conn_(0)
 , monitor_conn_(0)
+, message_(LENGTH, 0)
 #ifndef _WIN32
 , notifier_(0)
 #else
@@ -109,7 +123,7 @@ QString WpaConnection::defaultInterface()
 
 #ifdef CONFIG_CTRL_IFACE_UNIX
     struct dirent *dent;
-    DIR *dir = opendir(CTRL_IFACE_DIR.toAscii().constData());
+    DIR *dir = opendir(ctrl_dir_.toAscii().constData());
     if (dir)
     {
         while ((dent = readdir(dir)))
@@ -176,7 +190,7 @@ int WpaConnection::openCtrlConnection(const QString & name)
 
     QString cfile;
 #ifdef CONFIG_CTRL_IFACE_UNIX
-    cfile = CTRL_IFACE_DIR + "/" + ctrl_iface_;
+    cfile = ctrl_dir_ + "/" + ctrl_iface_;
 #else
     cfile = ctrl_iface_;
 #endif
@@ -263,16 +277,11 @@ bool WpaConnection::status(QVariantMap & info, bool broadcast)
         return false;
     }
 
-    QString tag;
-    QVariant value;
-    QList<QByteArray> items = reply.split(SEPARATOR);
-    foreach(QByteArray item, items)
+    WpaTokenizer lines(WpaToken(reply), SEPARATOR);
+    WpaToken line;
+    while (lines.next(line))
     {
-        if (parseItem(tag, value, item))
-        {
-            // qDebug() << tag << value;
-            info[tag] = value;
-        }
+        parseItem(line, info);
     }
 
     // Check wpa_state.
@@ -318,18 +327,17 @@ bool WpaConnection::listNetworks(WifiProfiles &networks)
     }
 
     QStringList tags;
-    int index = 0;
-    QList<QByteArray> lines = reply.split(SEPARATOR);
-    QList<QByteArray> items = lines.at(index).split('/');
-    foreach(QByteArray item, items)
+    WpaTokenizer lines(WpaToken(reply), SEPARATOR);
+    WpaToken line;
+    if (lines.next(line))
     {
-        tags.push_back(item.trimmed());
+        parseTitle(line, tags);
     }
 
-    for(int i = 1; i < lines.size(); ++i)
+    while (lines.next(line))
     {
         WifiProfile network;
-        if (parseEntry(tags, lines.at(i), network))
+        if (parseEntry(tags, line, network))
         {
             networks.push_back(network);
         }
@@ -689,34 +697,27 @@ void WpaConnection::debugDump(WifiProfiles & all)
     }
 }
 
-/// Update cached networks.
+/// Update cached networks. It stops at the first failure, as every
+/// following request would fail or time out as well.
 void WpaConnection::updateCachedNetworks()
 {
     clearCachedNetworks();
+    QByteArray reply;
     for(int i = 0; i < 200; ++i)
     {
         QString command("BSS %1");
         command = command.arg(i);
-        QByteArray reply;
-        if (ctrlRequest(command, reply) < 0)
-        {
-            continue;
-        }
-        if (!reply.contains(SEPARATOR))
+        if (ctrlRequest(command, reply) < 0 || !reply.contains(SEPARATOR))
         {
             break;
         }
 
         WifiProfile ap;
-        QString tag;
-        QVariant value;
-        QList<QByteArray> lines = reply.split(SEPARATOR);
-        foreach(QByteArray line, lines)
+        WpaTokenizer lines(WpaToken(reply), SEPARATOR);
+        WpaToken line;
+        while (lines.next(line))
         {
-            if (parseItem(tag, value, line))
-            {
-                ap.insert(tag, value);
-            }
+            parseItem(line, ap);
         }
         cached_network_.push_back(ap);
     }
@@ -748,38 +749,52 @@ void WpaConnection::onAddressAcquired(bool ok)
 /// Receive messages from wpa supplicant.
 void WpaConnection::receiveMessages()
 {
-    size_t length = LENGTH;
-    QByteArray result;
-    result.resize(length);
-
+    bool scan_results = false;
     while (monitor_conn_ && wpa_ctrl_pending(monitor_conn_) > 0)
     {
-        if (wpa_ctrl_recv(monitor_conn_, result.data(), &length) == 0)
+        size_t length = message_.size() - 1;
+        if (wpa_ctrl_recv(monitor_conn_, message_.data(), &length) != 0)
         {
-            result[static_cast<uint>(length)] = 0;
-            parseMessage(result);
+            break;
+        }
+
+        WpaToken message = WpaToken(message_.constData(), static_cast<int>(length)).withoutPriority();
+        if (message.startsWith(WPA_EVENT_SCAN_RESULTS))
+        {
+            // wpa_supplicant may report several scans at once.
+            scan_results = true;
+        }
+        else
+        {
+            parseMessage(message);
         }
     }
+
+    if (scan_results)
+    {
+        fetchScanResults();
+    }
 }
 
-void WpaConnection::parseMessage(QByteArray & data)
+void WpaConnection::fetchScanResults()
 {
-    qDebug() << "message received: " << data;
+    WifiProfiles aps;
+    scanResults(aps);
+    emit scanResultsReady(aps);
+    broadcastState(STATE_SCANNED);
+}
 
-    if (data.contains(WPA_EVENT_SCAN_RESULTS))
-    {
-        WifiProfiles aps;
-        scanResults(aps);
-        emit scanResultsReady(aps);
-        broadcastState(STATE_SCANNED);
-    }
-    else if (data.contains("Associated with"))
+void WpaConnection::parseMessage(const WpaToken & data)
+{
+    qDebug("message received: %.*s", data.size(), data.data());
+
+    if (data.contains("Associated with"))
     {
         // Means connecting..., but does not need to broadcast any message here.
         // broadcastState(STATE_CONNECTING);
         update();
     }
-    else if (data.contains(WPA_EVENT_DISCONNECTED))
+    else if (data.startsWith(WPA_EVENT_DISCONNECTED))
     {
         // Incorrect password.
         // "WPA: 4-Way Handshake failed - pre-shared key may be incorrect"))
@@ -798,7 +813,7 @@ void WpaConnection::parseMessage(QByteArray & data)
             }
         }
     }
-    else if (data.contains(WPA_EVENT_CONNECTED) ||
+    else if (data.startsWith(WPA_EVENT_CONNECTED) ||
              data.contains("Key negotiation completed"))
     {
         // Connected.
@@ -825,66 +840,59 @@ bool WpaConnection::scanResults(WifiProfiles & aps)
     }
 
     clearCachedNetworks();
-    parseScanResult(aps, reply);
+    parseScanResult(aps, WpaToken(reply));
     return true;
 }
 
 void WpaConnection::parseScanResult(WifiProfiles & result,
-                                    QByteArray & data)
+                                    const WpaToken & data)
 {
-    QString tag;
-    QVariant value;
-    QList<QByteArray> lines = data.split(SEPARATOR);
-
     // first line
     // data = 0x02ec8350 "bssid / frequency / signal level / flags / ssid"
     QStringList tags;
-    int index = 0;
-    QList<QByteArray> items = lines.at(index).split('/');
-    foreach(QByteArray item, items)
+    WpaTokenizer lines(data, SEPARATOR);
+    WpaToken line;
+    if (lines.next(line))
     {
-        tags.push_back(item.trimmed());
+        parseTitle(line, tags);
     }
 
     // other lines.
     // data = 0x02fc27a8 "00:24:01:1e:55:e0	2412	-49	[WPA-PSK-TKIP+CCMP][WPA2-PSK-TKIP+CCMP][WPS]	tiger"
-    for(index = 1; index < lines.size(); ++index)
+    while (lines.next(line))
     {
         WifiProfile profile;
-        if (parseEntry(tags, lines.at(index), profile))
+        if (parseEntry(tags, line, profile))
         {
             // Update attributes according to flag.
             encryptionAttributes(profile);
             detailInfo(profile);
 
             // Always add the scan result to result list no matter the bssid is valid or not.
-            // if (!profile.bssid().contains(INVALID_BSSID))
-            {
-                result.push_back(profile);
-            }
+            result.push_back(profile);
         }
     }
 
     //debugDump(result);
 }
 
-bool WpaConnection::parseItem(QString & tag, QVariant & value, const QByteArray & data)
+/// Parse a "tag=value" line.
+bool WpaConnection::parseItem(const WpaToken & data, QVariantMap & result)
 {
     int pos = data.indexOf('=');
     if (pos < 0)
     {
         return false;
     }
-    tag = data.left(pos);
-    value = data.mid(pos + 1);
+    result.insert(data.left(pos).toString(), data.mid(pos + 1).toByteArray());
     return true;
 }
 
 bool WpaConnection::parseEntry(const QStringList & tags,
-                               const QByteArray & data,
+                               const WpaToken & data,
                                QVariantMap & result)
 {
-    if (!data.contains('\t'))
+    if (data.indexOf('\t') < 0)
     {
         // qDebug("ParseEntry error: No tab found %s.", data.constData());
         return false;
@@ -892,17 +900,17 @@ bool WpaConnection::parseEntry(const QStringList & tags,
 
     // Parse the entry
     // data = 0x02fc27a8 "00:24:01:1e:55:e0	2412	-49	[WPA-PSK-TKIP+CCMP][WPA2-PSK-TKIP+CCMP][WPS]	tiger"
-    QList<QByteArray> items = data.split('\t');
-    if (items.size() != tags.size())
+    WpaTokenizer items(data, '\t');
+    if (items.count() != tags.size())
     {
         // qDebug("ParseEntry error: unmatched size. %s", data.constData());
         return false;
     }
 
-    for(int i = 0; i < items.size(); ++i)
+    WpaToken item;
+    for(int i = 0; items.next(item); ++i)
     {
-        result[tags[i]] = items.at(i);
-        // qDebug("tag %s value %s", qPrintable(tags[i]), items.at(i).constData());
+        result[tags[i]] = item.toByteArray();
     }
     return true;
 }
@@ -1039,8 +1047,8 @@ int WpaConnection::sendCtrlRequest(wpa_ctrl * ctrl,
         return ERROR_INVALID_PARAMETER;
     }
 
-    size_t length = LENGTH;
-    result.resize(length);
+    size_t length = LENGTH - 1;
+    result.resize(LENGTH);
     int ret = wpa_ctrl_request(ctrl, command.toAscii().constData(), command.length(),
                                result.data(), &length, 0);
 
@@ -1052,7 +1060,8 @@ int WpaConnection::sendCtrlRequest(wpa_ctrl * ctrl,
     {
         qWarning("Command %s failed.", qPrintable(command));
     }
-    result[static_cast<uint>(length)] = 0;
+    // Only keep what has been received, not the rest of the buffer.
+    result.resize(ret < 0 ? 0 : static_cast<int>(length));
     return ret;
 }
 
@@ -1070,7 +1079,7 @@ int WpaConnection::addNetwork()
         return -1;
     }
 
-    return reply.toInt();
+    return reply.trimmed().toInt();
 }
 
 /// Remove the network specified by the id.
@@ -7,6 +7,9 @@
 
 static WifiProfile dummy;
 
+/// Time given to wpa_supplicant to create its control socket.
+static const int START_TIMEOUT = 7500;
+
 WpaConnectionManager::WpaConnectionManager()
 #ifndef _WINDOWS
 : connection_(QDBusConnection::systemBus())
@@ -22,7 +25,8 @@ WpaConnectionManager::WpaConnectionManager()
 , disable_idle_(false)
 {
     setupConnections();
-    scan_timer_.setInterval(1500);
+    scan_timer_.setSingleShot(true);
+    scan_timer_.setInterval(START_TIMEOUT);
 }
 
 WpaConnectionManager::~WpaConnectionManager()
@@ -66,11 +70,44 @@ void WpaConnectionManager::onSdioChanged(bool on)
     }
 }
 
+/// wpa_supplicant did not create its control socket in time.
 void WpaConnectionManager::onScanTimeout()
 {
-    // If we can not connect to wpa supplicant before, we need to
-    // scan now.
-    scan();
+    stopWaitingForWpaSupplicant();
+
+    // Wifi device is detected, but wpa_supplicant can not be launched
+    // Hardware issue, but user can try to turn off and turn on the
+    // wifi switcher again.
+    setState(dummy, WpaConnection::STATE_HARDWARE_ERROR);
+    SysStatus::instance().enableSdio(false);
+    SysStatus::instance().enableSdio(true);
+}
+
+/// Something changed in the directory of the control sockets, maybe
+/// wpa_supplicant is ready now.
+void WpaConnectionManager::onCtrlInterfaceChanged()
+{
+    if (!scan_timer_.isActive())
+    {
+        return;
+    }
+
+    // Watch the socket directory once it has been created.
+    QString dir = proxy().ctrlInterfaceDir();
+    if (!ctrl_watcher_.directories().contains(dir) && QFile::exists(dir))
+    {
+        ctrl_watcher_.addPath(dir);
+    }
+
+    if (proxy().openCtrlConnection() < 0)
+    {
+        return;
+    }
+
+    stopWaitingForWpaSupplicant();
+    emit wpaStateChanged(true);
+    setState(dummy, WpaConnection::STATE_SCANNING);
+    proxy().scan();
 }
 
 /// Called when wpa supplicant get some scan results.
@@ -235,6 +272,8 @@ bool WpaConnectionManager::checkWpaSupplicant()
 void WpaConnectionManager::setupConnections()
 {
     QObject::connect(&scan_timer_, SIGNAL(timeout()), this, SLOT(onScanTimeout()));
+    QObject::connect(&ctrl_watcher_, SIGNAL(directoryChanged(const QString &)),
+                     this, SLOT(onCtrlInterfaceChanged()));
 
     if (!connection_.connect(service, object, iface,
                              "sdioChangedSignal",
@@ -270,34 +309,46 @@ void WpaConnectionManager::scan()
     }
 
     increaseScanRetry();
-    bool wpa_ok = checkWpaSupplicant();
-    if (wpa_ok)
+    if (checkWpaSupplicant())
     {
+        stopWaitingForWpaSupplicant();
         if (canScanRetry())
         {
-            // Stop timer.
-            scan_timer_.stop();
             setState(dummy, WpaConnection::STATE_SCANNING);
             proxy().scan();
         }
     }
     else
     {
-        // Wait a little bit to rescan.
-        scan_timer_.stop();
-        if (canScanRetry())
-        {
-            scan_timer_.start();
-        }
-        else if (!wpa_ok)
-        {
-            // Wifi device is detected, but wpa_supplicant can not be launched
-            // Hardware issue, but user can try to turn off and turn on the
-            // wifi switcher again.
-            setState(dummy, WpaConnection::STATE_HARDWARE_ERROR);
-            SysStatus::instance().enableSdio(false);
-            SysStatus::instance().enableSdio(true);
-        }
+        waitForWpaSupplicant();
+    }
+}
+
+/// Wait until wpa_supplicant creates its control socket instead of
+/// trying to open it again and again.
+void WpaConnectionManager::waitForWpaSupplicant()
+{
+    if (scan_timer_.isActive())
+    {
+        return;
+    }
+
+    // The directory may not exist before wpa_supplicant starts.
+    QString dir = proxy().ctrlInterfaceDir();
+    if (!QFile::exists(dir))
+    {
+        dir = QFileInfo(dir).absolutePath();
+    }
+    ctrl_watcher_.addPath(dir);
+    scan_timer_.start();
+}
+
+void WpaConnectionManager::stopWaitingForWpaSupplicant()
+{
+    scan_timer_.stop();
+    if (!ctrl_watcher_.directories().isEmpty())
+    {
+        ctrl_watcher_.removePaths(ctrl_watcher_.directories());
     }
 }
 
@@ -468,7 +519,7 @@ void WpaConnectionManager::setConnecting(bool c)
 
 void WpaConnectionManager::stopAllTimers()
 {
-    scan_timer_.stop();
+    stopWaitingForWpaSupplicant();
 }
 
 void WpaConnectionManager::setState(WifiProfile profile, WpaConnection::ConnectionState s)
@@ -0,0 +1,250 @@
+#include "espeak_context.h"
+#include "src/wavegen_kernels.h"
+
+namespace tts
+{
+
+/// espeak_Initialize() changes the process locale.
+static QMutex init_mutex;
+
+ESpeakContext::ESpeakContext(const QString & data_path)
+    : data_path_(QFile::encodeName(data_path))
+    , request_(0)
+    , phonemes_(0)
+    , ready_(false)
+    , sample_rate_(-1)
+    , stop_(false)
+{
+    start();
+}
+
+ESpeakContext::~ESpeakContext()
+{
+    Request request;
+    request.type = QUIT;
+    execute(request);
+    wait();
+}
+
+/// Wait for the synthesizer to be initialized.
+bool ESpeakContext::isValid()
+{
+    return sampleRate() > 0;
+}
+
+int ESpeakContext::sampleRate()
+{
+    QMutexLocker locker(&mutex_);
+    while (!ready_)
+    {
+        done_.wait(&mutex_);
+    }
+    return sample_rate_;
+}
+
+bool ESpeakContext::setVoiceByName(const QString & name)
+{
+    Request request;
+    request.type = SET_VOICE;
+    request.text = name.toUtf8();
+    return execute(request);
+}
+
+bool ESpeakContext::setParameter(espeak_PARAMETER parameter, int value)
+{
+    Request request;
+    request.type = SET_PARAMETER;
+    request.parameter = parameter;
+    request.value = value;
+    return execute(request);
+}
+
+/// Use one of the WAVEGEN_KERNEL_* implementations of the wave generator
+/// loops. By default the fastest one the CPU supports is used. Returns
+/// false if the kernel is not available.
+bool ESpeakContext::setWavegenKernel(int kernel)
+{
+    Request request;
+    request.type = SET_KERNEL;
+    request.value = kernel;
+    return execute(request);
+}
+
+/// Synthesize the text to mono 16 bits PCM at sampleRate(), appended
+/// to pcm. Blocks until the text is done or stop() is called.
+bool ESpeakContext::synthesize(const QString & text, QByteArray & pcm, int flags)
+{
+    Request request;
+    request.type = SYNTHESIZE;
+    request.text = text.toUtf8();
+    request.value = flags;
+    request.pcm = &pcm;
+    return execute(request);
+}
+
+/// Translate the text to eSpeak phoneme mnemonics, one line per clause,
+/// appended to phonemes. No sound is generated.
+bool ESpeakContext::translate(const QString & text, QByteArray & phonemes, int flags)
+{
+    Request request;
+    request.type = TRANSLATE;
+    request.text = text.toUtf8();
+    request.value = flags;
+    request.pcm = &phonemes;
+    return execute(request);
+}
+
+/// Number of words kept by the word translation cache, 0 disables it.
+/// The cache is emptied.
+bool ESpeakContext::setWordCacheSize(int entries)
+{
+    Request request;
+    request.type = SET_WORD_CACHE;
+    request.value = entries;
+    return execute(request);
+}
+
+/// Hit and miss counts of the word translation cache, since it was created
+/// or since the last reset.
+bool ESpeakContext::wordCacheStats(WORD_CACHE_STATS & stats, bool reset)
+{
+    Request request;
+    request.type = GET_WORD_CACHE_STATS;
+    request.value = reset;
+    request.stats = &stats;
+    return execute(request);
+}
+
+/// Hand the request to the context thread and wait for the result.
+bool ESpeakContext::execute(Request & request)
+{
+    if (request.type != QUIT && !isValid())
+    {
+        return false;
+    }
+
+    QMutexLocker caller(&call_mutex_);
+    if (request.type == SYNTHESIZE)
+    {
+        stop_ = false;
+    }
+
+    QMutexLocker locker(&mutex_);
+    request.result = false;
+    request_ = &request;
+    has_request_.wakeOne();
+    while (request_ != 0)
+    {
+        done_.wait(&mutex_);
+    }
+    return request.result;
+}
+
+void ESpeakContext::run()
+{
+    int rate = -1;
+    {
+        QMutexLocker init(&init_mutex);
+        rate = espeak_Initialize(AUDIO_OUTPUT_SYNCHRONOUS, 0, data_path_.constData(), 0);
+        espeak_SetSynthCallback(synthCallback);
+    }
+
+    QMutexLocker locker(&mutex_);
+    sample_rate_ = rate;
+    ready_ = true;
+    done_.wakeAll();
+
+    bool quit = false;
+    while (!quit)
+    {
+        while (request_ == 0)
+        {
+            has_request_.wait(&mutex_);
+        }
+
+        Request *request = request_;
+        quit = (request->type == QUIT);
+        locker.unlock();
+        process(*request);
+        locker.relock();
+
+        request_ = 0;
+        done_.wakeAll();
+    }
+}
+
+/// Called in the context thread.
+void ESpeakContext::process(Request & request)
+{
+    switch (request.type)
+    {
+    case SET_VOICE:
+        request.result = (espeak_SetVoiceByName(request.text.constData()) == EE_OK);
+        break;
+    case SET_PARAMETER:
+        request.result = (espeak_SetParameter(static_cast<espeak_PARAMETER>(request.parameter),
+                                              request.value, 0) == EE_OK);
+        break;
+    case SET_KERNEL:
+        request.result = (SelectWavegenKernels(request.value) != 0);
+        break;
+    case SYNTHESIZE:
+        request.result = (espeak_Synth(request.text.constData(), request.text.size() + 1,
+                                       0, POS_CHARACTER, 0, request.value, 0, request.pcm) == EE_OK);
+        break;
+    case TRANSLATE:
+        phonemes_ = request.pcm;
+        espeak_SetPhonemeCallback(phonemeCallback);
+        request.result = (espeak_TextToPhonemes(request.text.constData(), request.text.size() + 1,
+                                                request.value) == EE_OK);
+        espeak_SetPhonemeCallback(0);
+        phonemes_ = 0;
+        break;
+    case SET_WORD_CACHE:
+        SetWordCacheSize(request.value);
+        request.result = true;
+        break;
+    case GET_WORD_CACHE_STATS:
+        GetWordCacheStats(request.stats);
+        if (request.value)
+        {
+            ResetWordCacheStats();
+        }
+        request.result = true;
+        break;
+    case QUIT:
+        if (sample_rate_ > 0)
+        {
+            espeak_Terminate();
+        }
+        request.result = true;
+        break;
+    }
+}
+
+int ESpeakContext::synthCallback(short *wav, int numsamples, espeak_EVENT *events)
+{
+    QByteArray *pcm = static_cast<QByteArray *>(events->user_data);
+    if (pcm != 0 && wav != 0 && numsamples > 0)
+    {
+        pcm->append(reinterpret_cast<const char *>(wav), numsamples * sizeof(short));
+    }
+
+    // Returning 1 aborts the synthesis, so stop takes effect within the
+    // current clause.
+    ESpeakContext *context = static_cast<ESpeakContext *>(QThread::currentThread());
+    return context->stop_ ? 1 : 0;
+}
+
+int ESpeakContext::phonemeCallback(const char *phonemes)
+{
+    ESpeakContext *context = static_cast<ESpeakContext *>(QThread::currentThread());
+    if (context->phonemes_ != 0)
+    {
+        context->phonemes_->append(phonemes);
+        context->phonemes_->append('\n');
+    }
+    return 0;
+}
+
+}   // namespace tts
@@ -0,0 +1,85 @@
+#ifndef ONYX_LIB_TTS_ESPEAK_CONTEXT_H_
+#define ONYX_LIB_TTS_ESPEAK_CONTEXT_H_
+
+#include <QtCore/QtCore>
+#include "src/speak_lib.h"
+#include "src/wordcache.h"
+
+namespace tts
+{
+
+/// One independent eSpeak synthesizer.
+/// eSpeak keeps its state in thread local variables (see ESPEAK_TLS in
+/// speech.h), so every context owns a thread and runs all eSpeak calls
+/// on it. Different contexts can synthesize at the same time; calls to
+/// the same context are serialized.
+class ESpeakContext : public QThread
+{
+public:
+    static const int DEFAULT_FLAGS = espeakPHONEMES | espeakENDPAUSE | espeakCHARS_UTF8;
+
+    explicit ESpeakContext(const QString & data_path);
+    ~ESpeakContext();
+
+    bool isValid();
+    int sampleRate();
+
+    bool setVoiceByName(const QString & name);
+    bool setParameter(espeak_PARAMETER parameter, int value);
+    bool setWavegenKernel(int kernel);
+    bool synthesize(const QString & text, QByteArray & pcm, int flags = DEFAULT_FLAGS);
+    bool translate(const QString & text, QByteArray & phonemes, int flags = DEFAULT_FLAGS);
+
+    bool setWordCacheSize(int entries);
+    bool wordCacheStats(WORD_CACHE_STATS & stats, bool reset = false);
+    void stop() { stop_ = true; }
+
+protected:
+    void run();
+
+private:
+    enum RequestType
+    {
+        SET_VOICE,
+        SET_PARAMETER,
+        SET_KERNEL,
+        SYNTHESIZE,
+        TRANSLATE,
+        SET_WORD_CACHE,
+        GET_WORD_CACHE_STATS,
+        QUIT
+    };
+
+    struct Request
+    {
+        RequestType type;
+        QByteArray text;
+        int parameter;
+        int value;
+        QByteArray *pcm;        ///< Or the phonemes.
+        WORD_CACHE_STATS *stats;
+        bool result;
+    };
+
+private:
+    bool execute(Request & request);
+    void process(Request & request);
+    static int synthCallback(short *wav, int numsamples, espeak_EVENT *events);
+    static int phonemeCallback(const char *phonemes);
+
+private:
+    QByteArray data_path_;
+    QMutex call_mutex_;     ///< One caller at a time.
+    QMutex mutex_;
+    QWaitCondition has_request_;
+    QWaitCondition done_;
+    Request *request_;
+    QByteArray *phonemes_;  ///< Used by the context thread.
+    bool ready_;
+    int sample_rate_;       ///< Negative if eSpeak could not be initialized.
+    volatile bool stop_;
+};
+
+}   // namespace tts
+
+#endif  // ONYX_LIB_TTS_ESPEAK_CONTEXT_H_
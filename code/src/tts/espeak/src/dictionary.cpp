@@ -34,10 +34,12 @@
 #include "phoneme.h"
 #include "synthesize.h"
 #include "translate.h"
+#include "wordcache.h"
 
 
-int dictionary_skipwords;
-char dictionary_name[40];
+ESPEAK_TLS int dictionary_skipwords;
+ESPEAK_TLS WORD_CONTEXT word_context;
+ESPEAK_TLS char dictionary_name[40];
 
 extern char *print_dictionary_flags(unsigned int *flags);
 
@@ -235,7 +237,6 @@ int LoadDictionary(Translator *tr, const char *name, int no_error)
 	char *p;
 	int *pw;
 	int length;
-	FILE *f;
 	unsigned int size;
 	char fname[sizeof(path_home)+20];
 
@@ -247,11 +248,10 @@ int LoadDictionary(Translator *tr, const char *name, int no_error)
 	// Load a pronunciation data file into memory
 	// bytes 0-3:  offset to rules data
 	// bytes 4-7:  number of hash table entries
+	// The file is mapped rather than read, see MapFile(). Setting up the
+	// hash table below reads all of it.
 	sprintf(fname,"%s%c%s_dict",path_home,PATHSEP,name);
-	size = GetFileLength(fname);
-
-	f = fopen(fname,"rb");
-	if((f == NULL) || (size <= 0))
+	if(MapFile(&tr->dict_file,fname,MAP_FILE_SEQUENTIAL) != 0)
 	{
 		if(no_error == 0)
 		{
@@ -260,13 +260,9 @@ int LoadDictionary(Translator *tr, const char *name, int no_error)
 		return(1);
 	}
 
-	if(tr->data_dictlist != NULL)
-		Free(tr->data_dictlist);
-
-	tr->data_dictlist = Alloc(size);
-	fread(tr->data_dictlist,size,1,f);
-	fclose(f);
-
+	WordCacheClear();
+	tr->data_dictlist = tr->dict_file.data;
+	size = tr->dict_file.size;
 
 	pw = (int *)(tr->data_dictlist);
 	length = reverse_word_bytes(pw[1]);
@@ -1616,7 +1612,7 @@ static char *DecodeRule(const char *group, char *rule)
    char buf[60];
    char buf_pre[60];
 	char suffix[20];
-	static char output[60];
+	static ESPEAK_TLS char output[60];
 
 	static char symbols[] = {' ',' ',' ',' ',' ',' ',' ',' ',' ',
 			'@','&','%','+','#','S','D','Z','A','L',' ',' ',' ',' ',' ','N','K','V',' ','T','X','?','W'};
@@ -1796,6 +1792,63 @@ void AppendPhonemes(Translator *tr, char *string, int size, const char *ph)
 
 
 
+static void ContextRead(const char *p)
+{//====================================
+// The translation has looked at the character at p. Note if it is outside
+// the word which is being translated for the word cache.
+	int n;
+
+	if(word_context.start == NULL)
+		return;
+
+	// other buffers, such as a word with its prefix removed, are not the text
+	if((p > word_context.end) && (p <= word_context.end + N_WORD_BYTES))
+	{
+		if((n = p - word_context.end) > word_context.after)
+			word_context.after = n;
+	}
+	else
+	if((p < word_context.start - 1) && (p >= word_context.start - N_WORD_BYTES))
+	{
+		if((n = word_context.start - 1 - p) > word_context.before)
+			word_context.before = n;
+	}
+}
+
+
+static void ContextRule(unsigned char rb, const char *p, int xbytes)
+{//=================================================================
+// A pre or post rule item is matched against the character at p
+	switch(rb)
+	{
+	case RULE_ALT1:
+	case RULE_INC_SCORE:
+	case RULE_DEL_FWD:
+	case RULE_ENDING:
+	case RULE_NO_SUFFIX:
+	case RULE_STRESSED:
+	case RULE_IFVERB:
+	case RULE_CAPITAL:
+		// these don't look at the character
+		break;
+
+	case RULE_LETTERGP2:
+	case RULE_SYLLABLE:
+	case RULE_NOVOWELS:
+	case '.':
+		// these look at several characters, up to a space
+		if((p < word_context.start - 1) || (p > word_context.end))
+			word_context.unbounded = 1;
+		break;
+
+	default:
+		ContextRead(p);
+		ContextRead(p + xbytes);
+		break;
+	}
+}
+
+
 static void MatchRule(Translator *tr, char *word[], const char *group, char *rule, MatchRecord *match_out, int word_flags, int dict_flags)
 {//=======================================================================================================================================
 /* Checks a specified word against dictionary rules.
@@ -1839,7 +1892,7 @@ static void MatchRule(Translator *tr, char *word[], const char *group, char *rul
 	int add_points;
 
 	MatchRecord match;
-	static MatchRecord best;
+	static ESPEAK_TLS MatchRecord best;
 
 	int  total_consumed;  /* letters consumed for best match */
 	int  group_length;
@@ -1980,6 +2033,8 @@ static void MatchRule(Translator *tr, char *word[], const char *group, char *rul
 					distance_right = 19;
 				last_letter = letter;
 				letter_xbytes = utf8_in(&letter_w,post_ptr)-1;
+				if(word_context.start != NULL)
+					ContextRule(rb, post_ptr, letter_xbytes);
 				letter = *post_ptr++;
 
 				switch(rb)
@@ -2169,6 +2224,8 @@ static void MatchRule(Translator *tr, char *word[], const char *group, char *rul
 				pre_ptr--;
 				letter_xbytes = utf8_in2(&letter_w,pre_ptr,1)-1;
 				letter = *pre_ptr;
+				if(word_context.start != NULL)
+					ContextRule(rb, pre_ptr, -letter_xbytes);
 
 				switch(rb)
 				{
@@ -2973,6 +3030,13 @@ static const char *LookupDict2(Translator *tr, const char *word, const char *wor
 				if(memcmp(word2,p,n_chars) != 0)
 					condition_failed = 1;
 
+				if(word_context.start != NULL)
+				{
+					// the text up to the first difference was looked at
+					for(ix=0; (ix < n_chars-1) && (word2[ix] == p[ix]); ix++);
+					ContextRead(&word2[ix]);
+				}
+
 				if(condition_failed)
 				{
 					p = next;
@@ -3157,11 +3221,13 @@ int LookupDictList(Translator *tr, char **wordptr, char *ph_out, unsigned int *f
 	int  nbytes;
 	int  len;
 	char word[N_WORD_BYTES];
-	static char word_replacement[N_WORD_BYTES];
+	static ESPEAK_TLS char word_replacement[N_WORD_BYTES];
 
 	length = 0;
 	word2 = word1 = *wordptr;
 
+	if((word_context.start != NULL) && (word2[utf8_nbytes(word2)] == ' '))
+		ContextRead(&word2[utf8_nbytes(word2)+1]);
 	while((word2[nbytes = utf8_nbytes(word2)]==' ') && (word2[nbytes+1]=='.'))
 	{
 		// look for an abbreviation of the form a.b.c
@@ -3323,7 +3389,7 @@ int RemoveEnding(Translator *tr, char *word, int end_type, char *word_copy)
 	int end_flags;
 	const char *p;
 	int  len;
-	static char ending[12];
+	static ESPEAK_TLS char ending[12];
 	
 	// these lists are language specific, but are only relevent if the 'e' suffix flag is used
 	static const char *add_e_exceptions[] = {
@@ -49,10 +49,10 @@ typedef struct {
 	short pitch2;
 } SYLLABLE;
 
-static SYLLABLE *syllable_tab;
+static ESPEAK_TLS SYLLABLE *syllable_tab;
 
 
-static int tone_pitch_env;    /* used to return pitch envelope */
+static ESPEAK_TLS int tone_pitch_env;    /* used to return pitch envelope */
 
 
 
@@ -319,13 +319,13 @@ static int min_drop[] =  {0x300,0x300,0x400,0x400,0x900,0x900,0x900,0xb00};
 #define PRIMARY_LAST 7
 
 
-static int  number_pre;
-static int  number_body;
-static int  number_tail;
-static int  last_primary;
-static int  tone_posn;
-static int  tone_posn2;
-static int  no_tonic;
+static ESPEAK_TLS int  number_pre;
+static ESPEAK_TLS int  number_body;
+static ESPEAK_TLS int  number_tail;
+static ESPEAK_TLS int  last_primary;
+static ESPEAK_TLS int  tone_posn;
+static ESPEAK_TLS int  tone_posn2;
+static ESPEAK_TLS int  no_tonic;
 
 
 static void count_pitch_vowels(int start, int end, int clause_end)
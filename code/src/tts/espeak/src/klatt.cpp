@@ -40,10 +40,10 @@
 
 #ifdef INCLUDE_KLATT    // conditional compilation for the whole file
 
-extern unsigned char *out_ptr;   // **JSD
-extern unsigned char *out_start;
-extern unsigned char *out_end;
-extern WGEN_DATA wdata;
+extern ESPEAK_TLS unsigned char *out_ptr;   // **JSD
+extern ESPEAK_TLS unsigned char *out_start;
+extern ESPEAK_TLS unsigned char *out_end;
+extern ESPEAK_TLS WGEN_DATA wdata;
 static int nsamples;
 static int sample_count;
 
@@ -966,7 +966,7 @@ static double DBtoLIN(long dB)
 
 
 
-extern voice_t *wvoice;
+extern ESPEAK_TLS voice_t *wvoice;
 static wavegen_peaks_t peaks[N_PEAKS];
 static int end_wave;
 static int klattp[N_KLATTP];
@@ -0,0 +1,119 @@
+#include "StdAfx.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef PLATFORM_POSIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "speak_lib.h"
+#include "speech.h"
+
+
+static int ReadWholeFile(MAPPED_FILE *mf, const char *fname)
+{//=========================================================
+	FILE *f;
+	int size;
+	char *p;
+
+	size = GetFileLength(fname);
+	if(size <= 0)
+		return(-1);
+
+	if((f = fopen(fname,"rb")) == NULL)
+		return(-1);
+
+	if((p = Alloc(size)) == NULL)
+	{
+		fclose(f);
+		return(-1);
+	}
+	if(fread(p,1,size,f) != (size_t)size)
+	{
+		Free(p);
+		fclose(f);
+		return(-1);
+	}
+	fclose(f);
+
+	mf->data = p;
+	mf->size = size;
+	mf->mapped = 0;
+	return(0);
+}
+
+
+#ifdef PLATFORM_POSIX
+static int MapWholeFile(MAPPED_FILE *mf, const char *fname, int access)
+{//====================================================================
+	int fd;
+	struct stat statbuf;
+	void *p;
+
+	if((fd = open(fname,O_RDONLY)) < 0)
+		return(-1);
+
+	if((fstat(fd,&statbuf) != 0) || !S_ISREG(statbuf.st_mode) || (statbuf.st_size <= 0))
+	{
+		close(fd);
+		return(-1);
+	}
+
+	p = mmap(NULL,statbuf.st_size,PROT_READ | PROT_WRITE,MAP_PRIVATE,fd,0);
+	close(fd);   // the mapping keeps the file
+	if(p == MAP_FAILED)
+		return(-1);
+
+	if(access == MAP_FILE_RANDOM)
+		madvise(p,statbuf.st_size,MADV_RANDOM);
+
+	mf->data = (char *)p;
+	mf->size = statbuf.st_size;
+	mf->mapped = 1;
+	return(0);
+}
+#endif
+
+
+int MapFile(MAPPED_FILE *mf, const char *fname, int access)
+{//========================================================
+// Loads fname into mf, which is all zero or has been loaded before.
+// The previous contents are released only if the new file is loaded.
+// Returns 0 on success.
+	MAPPED_FILE new_file;
+	int result = -1;
+
+	memset(&new_file,0,sizeof(new_file));
+#ifdef PLATFORM_POSIX
+	result = MapWholeFile(&new_file,fname,access);
+#endif
+	if(result != 0)
+		result = ReadWholeFile(&new_file,fname);
+	if(result != 0)
+		return(result);
+
+	UnmapFile(mf);
+	memcpy(mf,&new_file,sizeof(MAPPED_FILE));
+	return(0);
+}
+
+
+void UnmapFile(MAPPED_FILE *mf)
+{//============================
+	if(mf->data != NULL)
+	{
+#ifdef PLATFORM_POSIX
+		if(mf->mapped)
+			munmap(mf->data,mf->size);
+		else
+#endif
+			Free(mf->data);
+	}
+	mf->data = NULL;
+	mf->size = 0;
+	mf->mapped = 0;
+}
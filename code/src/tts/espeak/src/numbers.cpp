@@ -496,7 +496,7 @@ void LookupLetter(Translator *tr, unsigned int letter, int next_byte, char *ph_b
 {//=================================================================================
 	int len;
 	unsigned char *p;
-	static char single_letter[10] = {0,0};
+	static ESPEAK_TLS char single_letter[10] = {0,0};
 	char ph_stress[2];
 	unsigned int dict_flags[2];
 	char ph_buf3[40];
@@ -1167,7 +1167,7 @@ static int TranslateNumber_1(Translator *tr, char *word, char *ph_out, unsigned
 	int thousands_inc = 0;
 	int prev_thousands = 0;
 	int this_value;
-	static int prev_value;
+	static ESPEAK_TLS int prev_value;
 	int decimal_count;
 	int max_decimal_count;
 	char string[12];  // for looking up entries in de_list
@@ -127,10 +127,10 @@ typedef struct {
 
 // Several phoneme tables may be loaded into memory. phoneme_tab points to
 // one for the current voice
-extern int n_phoneme_tab;
-extern int current_phoneme_table;
-extern PHONEME_TAB *phoneme_tab[N_PHONEME_TAB];
-extern unsigned char phoneme_tab_flags[N_PHONEME_TAB];  // bit 0: not inherited
+extern ESPEAK_TLS int n_phoneme_tab;
+extern ESPEAK_TLS int current_phoneme_table;
+extern ESPEAK_TLS PHONEME_TAB *phoneme_tab[N_PHONEME_TAB];
+extern ESPEAK_TLS unsigned char phoneme_tab_flags[N_PHONEME_TAB];  // bit 0: not inherited
 
 typedef struct {
 	char name[N_PHONEME_TAB_NAME];
@@ -149,8 +149,8 @@ typedef struct {
 	char type;   // 0=always replace, 1=only at end of word
 } REPLACE_PHONEMES;
 
-extern int n_replace_phonemes;
-extern REPLACE_PHONEMES replace_phonemes[N_REPLACE_PHONEMES];
+extern ESPEAK_TLS int n_replace_phonemes;
+extern ESPEAK_TLS REPLACE_PHONEMES replace_phonemes[N_REPLACE_PHONEMES];
 
 
 #define PH(c1,c2)  (c2<<8)+c1          // combine two characters into an integer for phoneme name 
@@ -164,5 +164,5 @@ void DecodePhonemes(const char *inptr, char *outptr);
 
 extern const char *WordToString(unsigned int word);
 
-extern PHONEME_TAB_LIST phoneme_tab_list[N_PHONEME_TABS];
-extern int phoneme_tab_number;
+extern ESPEAK_TLS PHONEME_TAB_LIST phoneme_tab_list[N_PHONEME_TABS];
+extern ESPEAK_TLS int phoneme_tab_number;
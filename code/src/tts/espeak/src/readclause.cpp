@@ -42,26 +42,26 @@
 #define N_XML_BUF   256
 
 
-static const char *xmlbase = "";    // base URL from <speak>
+static ESPEAK_TLS const char *xmlbase = "";    // base URL from <speak>
 
-static int namedata_ix=0;
-static int n_namedata = 0;
-char *namedata = NULL;
+static ESPEAK_TLS int namedata_ix=0;
+static ESPEAK_TLS int n_namedata = 0;
+ESPEAK_TLS char *namedata = NULL;
 
 
-static FILE *f_input = NULL;
-static int ungot_char2 = 0;
-char *p_textinput;
-wchar_t *p_wchar_input;
-static int ungot_char;
-static const char *ungot_word = NULL;
-static int end_of_input;
+static ESPEAK_TLS FILE *f_input = NULL;
+static ESPEAK_TLS int ungot_char2 = 0;
+ESPEAK_TLS char *p_textinput;
+ESPEAK_TLS wchar_t *p_wchar_input;
+static ESPEAK_TLS int ungot_char;
+static ESPEAK_TLS const char *ungot_word = NULL;
+static ESPEAK_TLS int end_of_input;
 
-static int ignore_text=0;   // set during <sub> ... </sub>  to ignore text which has been replaced by an alias
-static int clear_skipping_text = 0;  // next clause should clear the skipping_text flag
-int count_characters = 0;
-static int sayas_mode;
-static int ssml_ignore_l_angle = 0;
+static ESPEAK_TLS int ignore_text=0;   // set during <sub> ... </sub>  to ignore text which has been replaced by an alias
+static ESPEAK_TLS int clear_skipping_text = 0;  // next clause should clear the skipping_text flag
+ESPEAK_TLS int count_characters = 0;
+static ESPEAK_TLS int sayas_mode;
+static ESPEAK_TLS int ssml_ignore_l_angle = 0;
 
 static const char *punct_stop = ".:!?";    // pitch fall if followed by space
 static const char *punct_close = ")]}>;'\"";  // always pitch fall unless followed by alnum
@@ -159,17 +159,17 @@ typedef struct {
 } SSML_STACK;
 
 #define N_SSML_STACK  20
-static int n_ssml_stack;
-static SSML_STACK ssml_stack[N_SSML_STACK];
+static ESPEAK_TLS int n_ssml_stack;
+static ESPEAK_TLS SSML_STACK ssml_stack[N_SSML_STACK];
 
-static char current_voice_id[40] = {0};
+static ESPEAK_TLS char current_voice_id[40] = {0};
 
 
 #define N_PARAM_STACK  20
-static int n_param_stack;
-PARAM_STACK param_stack[N_PARAM_STACK];
+static ESPEAK_TLS int n_param_stack;
+ESPEAK_TLS PARAM_STACK param_stack[N_PARAM_STACK];
 
-static int speech_parameters[N_SPEECH_PARAM];     // current values, from param_stack
+static ESPEAK_TLS int speech_parameters[N_SPEECH_PARAM];     // current values, from param_stack
 
 const int param_defaults[N_SPEECH_PARAM] = {
    0,     // silence (internal use)
@@ -420,7 +420,7 @@ static int GetC(void)
 	int ix;
 	int n_bytes;
 	unsigned char m;
-	static int ungot2 = 0;
+	static ESPEAK_TLS int ungot2 = 0;
 	static const unsigned char mask[4] = {0xff,0x1f,0x0f,0x07};
 	static const unsigned char mask2[4] = {0,0x80,0x20,0x30};
 
@@ -515,7 +515,7 @@ static const char *WordToString2(unsigned int word)
 {//================================================
 // Convert a language mnemonic word into a string
 	int  ix;
-	static char buf[5];
+	static ESPEAK_TLS char buf[5];
 	char *p;
 
 	p = buf;
@@ -560,7 +560,7 @@ static const char *LookupCharName(Translator *tr, int c)
 	char phonemes2[60];
 	const char *lang_name = NULL;
 	char *string;
-	static char buf[60];
+	static ESPEAK_TLS char buf[60];
 
 	buf[0] = 0;
 	flags[0] = 0;
@@ -766,7 +766,7 @@ static int LoadSoundFile2(const char *fname)
 // (if it'snot already loaded)
 
 	int ix;
-	static int slot = -1;
+	static ESPEAK_TLS int slot = -1;
 
 	for(ix=0; ix<n_soundicon_tab; ix++)
 	{
@@ -1085,7 +1085,7 @@ static wchar_t *GetSsmlAttribute(wchar_t *pw, const char *name)
 // Gets the value string for an attribute.
 // Returns NULL if the attribute is not present
 	int ix;
-	static wchar_t empty[1] = {0};
+	static ESPEAK_TLS wchar_t empty[1] = {0};
 
 	while(*pw != 0)
 	{
@@ -1895,8 +1895,8 @@ int ReadClause(Translator *tr, FILE *f_in, char *buf, short *charix, int n_buf,
 
 #define N_XML_BUF2   20
 	char xml_buf2[N_XML_BUF2+2];           // for &<name> and &<number> sequences
-	static char ungot_string[N_XML_BUF2+4];
-	static int ungot_string_ix = -1;
+	static ESPEAK_TLS char ungot_string[N_XML_BUF2+4];
+	static ESPEAK_TLS int ungot_string_ix = -1;
 
 	if(clear_skipping_text)
 	{
@@ -100,9 +100,9 @@ static unsigned char faster[] = {
 114,112,110,109,107,105,104,102,100,98, // 370-379
 96,94,92,90,88,85,83,80,78,75,72 }; //380-390
 
-static int speed1 = 130;
-static int speed2 = 121;
-static int speed3 = 118;
+static ESPEAK_TLS int speed1 = 130;
+static ESPEAK_TLS int speed2 = 121;
+static ESPEAK_TLS int speed3 = 118;
 
 
 
@@ -279,7 +279,7 @@ void CalcLengths(Translator *tr)
 
 	int  stress;
 	int  type;
-	static int  more_syllables=0;
+	static ESPEAK_TLS int  more_syllables=0;
 	int  pre_sonorant=0;
 	int  pre_voiced=0;
 	int  last_pitch = 0;
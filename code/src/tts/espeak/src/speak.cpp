@@ -51,12 +51,12 @@
 
 
 extern void Write4Bytes(FILE *f, int value);
-char path_home[N_PATH_HOME];    // this is the espeak-data directory
+ESPEAK_TLS char path_home[N_PATH_HOME];    // this is the espeak-data directory
 
 char filetype[5];
 char wavefile[200];
-int (* uri_callback)(int, const char *, const char *) = NULL;
-int (* phoneme_callback)(const char *) = NULL;
+ESPEAK_TLS int (* uri_callback)(int, const char *, const char *) = NULL;
+ESPEAK_TLS int (* phoneme_callback)(const char *) = NULL;
 
 FILE *f_wave = NULL;
 int quiet = 0;
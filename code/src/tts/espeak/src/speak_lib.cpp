@@ -40,30 +40,31 @@
 #include "synthesize.h"
 #include "voice.h"
 #include "translate.h"
+#include "wordcache.h"
 #include "debug.h"
 
 #include "fifo.h"
 #include "event.h"
 #include "wave.h"
 
-unsigned char *outbuf=NULL;
-extern espeak_VOICE voice_selected;
+ESPEAK_TLS unsigned char *outbuf=NULL;
+extern ESPEAK_TLS espeak_VOICE voice_selected;
 
-espeak_EVENT *event_list=NULL;
-int event_list_ix=0;
-int n_event_list;
-long count_samples;
-void* my_audio=NULL;
+ESPEAK_TLS espeak_EVENT *event_list=NULL;
+ESPEAK_TLS int event_list_ix=0;
+ESPEAK_TLS int n_event_list;
+ESPEAK_TLS long count_samples;
+ESPEAK_TLS void* my_audio=NULL;
 
-static unsigned int my_unique_identifier=0;
-static void* my_user_data=NULL;
-static espeak_AUDIO_OUTPUT my_mode=AUDIO_OUTPUT_SYNCHRONOUS;
-static int synchronous_mode = 1;
-t_espeak_callback* synth_callback = NULL;
-int (* uri_callback)(int, const char *, const char *) = NULL;
-int (* phoneme_callback)(const char *) = NULL;
+static ESPEAK_TLS unsigned int my_unique_identifier=0;
+static ESPEAK_TLS void* my_user_data=NULL;
+static ESPEAK_TLS espeak_AUDIO_OUTPUT my_mode=AUDIO_OUTPUT_SYNCHRONOUS;
+static ESPEAK_TLS int synchronous_mode = 1;
+ESPEAK_TLS t_espeak_callback* synth_callback = NULL;
+ESPEAK_TLS int (* uri_callback)(int, const char *, const char *) = NULL;
+ESPEAK_TLS int (* phoneme_callback)(const char *) = NULL;
 
-char path_home[N_PATH_HOME];   // this is the espeak-data directory
+ESPEAK_TLS char path_home[N_PATH_HOME];   // this is the espeak-data directory
 
 
 #ifdef USE_ASYNC
@@ -342,6 +343,7 @@ static int initialise(void)
 	int param;
 	int result;
 
+	InitVoiceData();
 	LoadConfig();
 
     // By Onyx, change the default sample rate to 44100
@@ -767,7 +769,7 @@ ESPEAK_API espeak_ERROR espeak_Synth(const void *text, size_t size,
 #endif
 
 	espeak_ERROR a_error=EE_INTERNAL_ERROR;
-	static unsigned int temp_identifier;
+	static ESPEAK_TLS unsigned int temp_identifier;
 
 	if (unique_identifier == NULL)
 	{
@@ -826,7 +828,7 @@ ESPEAK_API espeak_ERROR espeak_Synth_Mark(const void *text, size_t size,
 #endif
 
 	espeak_ERROR a_error=EE_OK;
-	static unsigned int temp_identifier;
+	static ESPEAK_TLS unsigned int temp_identifier;
 
 	if (unique_identifier == NULL)
 	{
@@ -1068,6 +1070,23 @@ ESPEAK_API void espeak_SetPhonemeTrace(int value, FILE *stream)
 }   //  end of espeak_SetPhonemes
 
 
+ESPEAK_API espeak_ERROR espeak_TextToPhonemes(const void *text, size_t size, unsigned int flags)
+{//==============================================================================================
+	ENTER("espeak_TextToPhonemes");
+	espeak_ERROR result;
+	int quiet = option_quiet;
+
+	if(!synchronous_mode)
+		return(EE_INTERNAL_ERROR);
+
+	// the clauses are translated, but Generate() makes no sound
+	option_quiet = 1;
+	result = sync_espeak_Synth(0,text,size,0,POS_CHARACTER,0,flags,NULL);
+	option_quiet = quiet;
+	return(result);
+}   //  end of espeak_TextToPhonemes
+
+
 ESPEAK_API void espeak_CompileDictionary(const char *path, FILE *log, int flags)
 {//=============================================================================
 	ENTER("espeak_CompileDictionary");
@@ -1143,6 +1162,7 @@ ESPEAK_API espeak_ERROR espeak_Terminate(void)
 	Free(outbuf);
 	outbuf = NULL;
 	FreePhData();
+	FreeWordCache();
 
 	return EE_OK;
 }   //  end of espeak_Terminate
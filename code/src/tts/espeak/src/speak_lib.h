@@ -443,6 +443,26 @@ void espeak_SetPhonemeTrace(int value, FILE *stream);
    stream   output stream for the phoneme symbols (and trace).  If stream=NULL then it uses stdout.
 */
 
+#ifdef __cplusplus
+extern "C"
+#endif
+void espeak_SetPhonemeCallback(int (* PhonemeCallback)(const char *));
+/* The callback is called with the phoneme mnemonics of each clause, before
+   it is spoken.
+*/
+
+#ifdef __cplusplus
+extern "C"
+#endif
+espeak_ERROR espeak_TextToPhonemes(const void *text, size_t size, unsigned int flags);
+/* Translate the text like espeak_Synth(), without generating any sound.
+   The result is passed to the callback of espeak_SetPhonemeCallback().
+   Only in AUDIO_OUTPUT_SYNCHRONOUS mode.
+
+   Return: EE_OK: operation achieved
+           EE_INTERNAL_ERROR.
+*/
+
 #ifdef __cplusplus
 extern "C"
 #endif
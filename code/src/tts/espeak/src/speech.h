@@ -36,6 +36,12 @@
 #define __cdecl 
 #define ESPEAK_API  extern "C"
 
+// Synthesizer state is kept per thread, so that every thread which calls
+// espeak_Initialize() owns an independent synthesizer. See ESpeakContext.
+#ifndef ESPEAK_TLS
+#define ESPEAK_TLS  __thread
+#endif
+
 #ifdef LIBRARY
 #define USE_ASYNC
 //#define USE_MBROLA_LIB
@@ -72,10 +78,28 @@ int LookupMnem(MNEM_TAB *table, char *string);
 #define N_PATH_HOME  150
 #endif
 
-extern char path_home[N_PATH_HOME];    // this is the espeak-data directory
+extern ESPEAK_TLS char path_home[N_PATH_HOME];    // this is the espeak-data directory
 
 extern void strncpy0(char *to,const char *from, int size);
 int  GetFileLength(const char *filename);
 char *Alloc(int size);
 void Free(void *ptr);
 
+// Read-only data files (the *_dict files, phontab, phonindex and phondata).
+// On POSIX they are mapped with mmap(), so the pages are only loaded when
+// they are first used, and they are shared by the ESpeakContext threads and
+// by all the processes which use the same espeak-data. Otherwise, or if the
+// mapping fails, the file is read into memory from Alloc().
+// The mapping is private and writable, a write would only copy the page.
+typedef struct {
+	char *data;
+	int size;
+	int mapped;    // 0 if data came from Alloc()
+} MAPPED_FILE;
+
+#define MAP_FILE_SEQUENTIAL  0
+#define MAP_FILE_RANDOM      1   // no read ahead
+
+int MapFile(MAPPED_FILE *mf, const char *fname, int access);
+void UnmapFile(MAPPED_FILE *mf);
+
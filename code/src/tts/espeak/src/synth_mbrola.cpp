@@ -38,7 +38,7 @@ extern void SetPitch2(voice_t *voice, int pitch1, int pitch2, int *pitch_base, i
 
 #ifdef USE_MBROLA_LIB
 
-extern unsigned char *outbuf;
+extern ESPEAK_TLS unsigned char *outbuf;
 
 #ifndef PLATFORM_WINDOWS
 
@@ -106,7 +106,7 @@ void unload_MBR()
 #endif   // USE_MBROLA_LIB
 
 
-static MBROLA_TAB *mbrola_tab = NULL;
+static ESPEAK_TLS MBROLA_TAB *mbrola_tab = NULL;
 static int mbrola_control = 0;
 
 
@@ -284,7 +284,7 @@ static char *WritePitch(int env, int pitch1, int pitch2, int split, int final)
 	int y[4];
 	int env_split;
 	char buf[50];
-	static char output[50];
+	static ESPEAK_TLS char output[50];
 
 	output[0] = 0;
 	pitch_env = envelope_data[env];
@@ -38,69 +38,52 @@
 const char *version_string = "1.40  22.Dec.08";
 const int version_phdata  = 0x014000;
 
-int option_device_number = -1;
+ESPEAK_TLS int option_device_number = -1;
 
 // copy the current phoneme table into here
-int n_phoneme_tab;
-int current_phoneme_table;
-PHONEME_TAB *phoneme_tab[N_PHONEME_TAB];
-unsigned char phoneme_tab_flags[N_PHONEME_TAB];   // bit 0: not inherited
-
-unsigned int *phoneme_index=NULL;
-char *spects_data=NULL;
-unsigned char *wavefile_data=NULL;
-static unsigned char *phoneme_tab_data = NULL;
-
-int n_phoneme_tables;
-PHONEME_TAB_LIST phoneme_tab_list[N_PHONEME_TABS];
-int phoneme_tab_number = 0;
-
-int wavefile_ix;              // a wavefile to play along with the synthesis
-int wavefile_amp;
-int wavefile_ix2;
-int wavefile_amp2;
-
-int seq_len_adjust;
-int vowel_transition[4];
-int vowel_transition0;
-int vowel_transition1;
+ESPEAK_TLS int n_phoneme_tab;
+ESPEAK_TLS int current_phoneme_table;
+ESPEAK_TLS PHONEME_TAB *phoneme_tab[N_PHONEME_TAB];
+ESPEAK_TLS unsigned char phoneme_tab_flags[N_PHONEME_TAB];   // bit 0: not inherited
+
+ESPEAK_TLS unsigned int *phoneme_index=NULL;
+ESPEAK_TLS char *spects_data=NULL;
+ESPEAK_TLS unsigned char *wavefile_data=NULL;
+static ESPEAK_TLS unsigned char *phoneme_tab_data = NULL;
+
+static ESPEAK_TLS MAPPED_FILE phontab_file;
+static ESPEAK_TLS MAPPED_FILE phonindex_file;
+static ESPEAK_TLS MAPPED_FILE phondata_file;
+
+ESPEAK_TLS int n_phoneme_tables;
+ESPEAK_TLS PHONEME_TAB_LIST phoneme_tab_list[N_PHONEME_TABS];
+ESPEAK_TLS int phoneme_tab_number = 0;
+
+ESPEAK_TLS int wavefile_ix;              // a wavefile to play along with the synthesis
+ESPEAK_TLS int wavefile_amp;
+ESPEAK_TLS int wavefile_ix2;
+ESPEAK_TLS int wavefile_amp2;
+
+ESPEAK_TLS int seq_len_adjust;
+ESPEAK_TLS int vowel_transition[4];
+ESPEAK_TLS int vowel_transition0;
+ESPEAK_TLS int vowel_transition1;
 
 int FormantTransition2(frameref_t *seq, int &n_frames, unsigned int data1, unsigned int data2, PHONEME_TAB *other_ph, int which);
 
 
 
-static char *ReadPhFile(void *ptr, const char *fname)
-{//==================================================
-	FILE *f_in;
-	char *p;
-	unsigned int  length;
+static char *ReadPhFile(MAPPED_FILE *mf, const char *fname, int access)
+{//=====================================================================
 	char buf[sizeof(path_home)+40];
 
 	sprintf(buf,"%s%c%s",path_home,PATHSEP,fname);
-	length = GetFileLength(buf);
-	
-	if((f_in = fopen(buf,"rb")) == NULL)
+	if(MapFile(mf,buf,access) != 0)
 	{
 		fprintf(stderr,"Can't read data file: '%s'\n",buf);
 		return(NULL);
 	}
-
-	if(ptr != NULL)
-		Free(ptr);
-		
-	if((p = Alloc(length)) == NULL)
-	{
-		fclose(f_in);
-		return(NULL);
-	}
-	if(fread(p,1,length,f_in) != length)
-	{
-		fclose(f_in);
-		return(NULL);
-	}
-
-	fclose(f_in);
-	return(p);
+	return(mf->data);
 }  //  end of ReadPhFile
 
 
@@ -112,11 +95,13 @@ int LoadPhData()
 	int result = 1;
 	unsigned char *p;
 
-	if((phoneme_tab_data = (unsigned char *)ReadPhFile((void *)(phoneme_tab_data),"phontab")) == NULL)
+	// phondata is large, and only the spectra and wave files of the
+	// phonemes in use are read
+	if((phoneme_tab_data = (unsigned char *)ReadPhFile(&phontab_file,"phontab",MAP_FILE_SEQUENTIAL)) == NULL)
 		return(-1);
-	if((phoneme_index = (unsigned int *)ReadPhFile((void *)(phoneme_index),"phonindex")) == NULL)
+	if((phoneme_index = (unsigned int *)ReadPhFile(&phonindex_file,"phonindex",MAP_FILE_RANDOM)) == NULL)
 		return(-1);
-	if((spects_data = ReadPhFile((void *)(spects_data),"phondata")) == NULL)
+	if((spects_data = ReadPhFile(&phondata_file,"phondata",MAP_FILE_RANDOM)) == NULL)
 		return(-1);
    wavefile_data = (unsigned char *)spects_data;
 
@@ -158,9 +143,9 @@ int LoadPhData()
 
 void FreePhData(void)
 {//==================
-	Free(phoneme_tab_data);
-	Free(phoneme_index);
-	Free(spects_data);
+	UnmapFile(&phontab_file);
+	UnmapFile(&phonindex_file);
+	UnmapFile(&phondata_file);
 	phoneme_tab_data=NULL;
 	phoneme_index=NULL;
 	spects_data=NULL;
@@ -380,7 +365,7 @@ frameref_t *LookupSpect(PHONEME_TAB *this_ph, PHONEME_TAB *prev_ph, PHONEME_TAB
 	SPECT_SEQK *seqk, *seqk2;
 	PHONEME_TAB *next2_ph;
 	frame_t *frame;
-	static frameref_t frames_buf[N_SEQ_FRAMES];
+	static ESPEAK_TLS frameref_t frames_buf[N_SEQ_FRAMES];
 	
 	PHONEME_TAB *other_ph;
 	if(which == 1)
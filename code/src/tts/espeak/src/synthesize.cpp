@@ -34,35 +34,35 @@
 #include "translate.h"
 
 
-extern FILE *f_log;
+extern ESPEAK_TLS FILE *f_log;
 static void SmoothSpect(void);
 
 
 // list of phonemes in a clause
-int n_phoneme_list=0;
-PHONEME_LIST phoneme_list[N_PHONEME_LIST];
+ESPEAK_TLS int n_phoneme_list=0;
+ESPEAK_TLS PHONEME_LIST phoneme_list[N_PHONEME_LIST];
 
-int mbrola_delay;
-char mbrola_name[20];
+ESPEAK_TLS int mbrola_delay;
+ESPEAK_TLS char mbrola_name[20];
 
-SPEED_FACTORS speed;
+ESPEAK_TLS SPEED_FACTORS speed;
 
-static int  last_pitch_cmd;
-static int  last_amp_cmd;
-static frame_t  *last_frame;
-static int  last_wcmdq;
-static int  pitch_length;
-static int  amp_length;
-static int  modn_flags;
+static ESPEAK_TLS int  last_pitch_cmd;
+static ESPEAK_TLS int  last_amp_cmd;
+static ESPEAK_TLS frame_t  *last_frame;
+static ESPEAK_TLS int  last_wcmdq;
+static ESPEAK_TLS int  pitch_length;
+static ESPEAK_TLS int  amp_length;
+static ESPEAK_TLS int  modn_flags;
 
-static int  syllable_start;
-static int  syllable_end;
-static int  syllable_centre;
+static ESPEAK_TLS int  syllable_start;
+static ESPEAK_TLS int  syllable_end;
+static ESPEAK_TLS int  syllable_centre;
 
-static voice_t *new_voice=NULL;
+static ESPEAK_TLS voice_t *new_voice=NULL;
 
-int n_soundicon_tab=N_SOUNDICON_SLOTS;
-SOUND_ICON soundicon_tab[N_SOUNDICON_TAB];
+ESPEAK_TLS int n_soundicon_tab=N_SOUNDICON_SLOTS;
+ESPEAK_TLS SOUND_ICON soundicon_tab[N_SOUNDICON_TAB];
 
 #define RMS_GLOTTAL1 35   // vowel before glottal stop
 #define RMS_START 28  // 28
@@ -79,7 +79,7 @@ const char *WordToString(unsigned int word)
 {//========================================
 // Convert a phoneme mnemonic word into a string
 	int  ix;
-	static char buf[5];
+	static ESPEAK_TLS char buf[5];
 
 	for(ix=0; ix<3; ix++)
 		buf[ix] = word >> (ix*8);
@@ -216,7 +216,7 @@ static void DoPause(int length, int control)
 }  // end of Synthesize::DoPause
 
 
-extern int seq_len_adjust;   // temporary fix to advance the start point for playing the wav sample
+extern ESPEAK_TLS int seq_len_adjust;   // temporary fix to advance the start point for playing the wav sample
 
 
 static int DoSample2(int index, int which, int length_mod, int amp)
@@ -319,8 +319,8 @@ static frame_t *AllocFrame()
 	// Only needed for modifying spectra for blending to consonants
 
 #define N_FRAME_POOL  N_WCMDQ
-	static int ix=0;
-	static frame_t frame_pool[N_FRAME_POOL];
+	static ESPEAK_TLS int ix=0;
+	static ESPEAK_TLS frame_t frame_pool[N_FRAME_POOL];
 
 	ix++;
 	if(ix >= N_FRAME_POOL)
@@ -886,7 +886,7 @@ int DoSpect(PHONEME_TAB *this_ph, PHONEME_TAB *prev_ph, PHONEME_TAB *next_ph,
 	int  length_factor;
 	int  length_mod;
 	int  total_len = 0;
-	static int wave_flag = 0;
+	static ESPEAK_TLS int wave_flag = 0;
 	int wcmd_spect = WCMD_SPECT;
 
 	length_mod = plist->length;
@@ -1110,9 +1110,9 @@ static void DoEmbedded(int &embix, int sourceix)
 
 int Generate(PHONEME_LIST *phoneme_list, int *n_ph, int resume)
 {//============================================================
-	static int  ix;
-	static int  embedded_ix;
-	static int  word_count;
+	static ESPEAK_TLS int  ix;
+	static ESPEAK_TLS int  embedded_ix;
+	static ESPEAK_TLS int  word_count;
 	PHONEME_LIST *prev;
 	PHONEME_LIST *next;
 	PHONEME_LIST *next2;
@@ -1126,7 +1126,7 @@ int Generate(PHONEME_LIST *phoneme_list, int *n_ph, int resume)
 	unsigned char *amp_env;
 	PHONEME_TAB *ph;
 	PHONEME_TAB *prev_ph;
-	static int sourceix=0;
+	static ESPEAK_TLS int sourceix=0;
 
 #ifdef TEST_MBROLA
 	if(mbrola_name[0] != 0)
@@ -1466,8 +1466,8 @@ int Generate(PHONEME_LIST *phoneme_list, int *n_ph, int resume)
 
 
 
-static int timer_on = 0;
-static int paused = 0;
+static ESPEAK_TLS int timer_on = 0;
+static ESPEAK_TLS int paused = 0;
 
 int SynthOnTimer()
 {//===============
@@ -1512,8 +1512,8 @@ int SpeakNextClause(FILE *f_in, const void *text_in, int control)
 
 	int clause_tone;
 	char *voice_change;
-	static FILE *f_text=NULL;
-	static const void *p_text=NULL;
+	static ESPEAK_TLS FILE *f_text=NULL;
+	static ESPEAK_TLS const void *p_text=NULL;
 
 	if(control == 4)
 	{
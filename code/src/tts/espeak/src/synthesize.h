@@ -63,7 +63,7 @@
 #define EMBED_F    13   // emphasis
 
 #define N_EMBEDDED_VALUES    14
-extern int embedded_value[N_EMBEDDED_VALUES];
+extern ESPEAK_TLS int embedded_value[N_EMBEDDED_VALUES];
 extern int embedded_default[N_EMBEDDED_VALUES];
 
 
@@ -223,12 +223,12 @@ typedef struct {
 
 
 // phoneme table
-extern PHONEME_TAB *phoneme_tab[N_PHONEME_TAB];
+extern ESPEAK_TLS PHONEME_TAB *phoneme_tab[N_PHONEME_TAB];
 
 // list of phonemes in a clause
-extern int n_phoneme_list;
-extern PHONEME_LIST phoneme_list[N_PHONEME_LIST];
-extern unsigned int embedded_list[];
+extern ESPEAK_TLS int n_phoneme_list;
+extern ESPEAK_TLS PHONEME_LIST phoneme_list[N_PHONEME_LIST];
+extern ESPEAK_TLS unsigned int embedded_list[];
 
 extern unsigned char env_fall[128];
 extern unsigned char env_rise[128];
@@ -255,9 +255,9 @@ extern unsigned char pitch_adjust_tab[MAX_PITCH_VALUE+1];
 #define N_WCMDQ   160
 #define MIN_WCMDQ  22   // need this many free entries before adding new phoneme
 
-extern long wcmdq[N_WCMDQ][4];
-extern int wcmdq_head;
-extern int wcmdq_tail;
+extern ESPEAK_TLS long wcmdq[N_WCMDQ][4];
+extern ESPEAK_TLS int wcmdq_head;
+extern ESPEAK_TLS int wcmdq_tail;
 
 // from Wavegen file
 int  WcmdqFree();
@@ -273,19 +273,19 @@ int WavegenFill(int fill_zeros);
 void MarkerEvent(int type, unsigned int char_position, int value, unsigned char *out_ptr);
 
 
-extern unsigned char *wavefile_data;
-extern int samplerate;
-extern int samplerate_native;
+extern ESPEAK_TLS unsigned char *wavefile_data;
+extern ESPEAK_TLS int samplerate;
+extern ESPEAK_TLS int samplerate_native;
 
-extern int wavefile_ix;
-extern int wavefile_amp;
-extern int wavefile_ix2;
-extern int wavefile_amp2;
-extern int vowel_transition[4];
-extern int vowel_transition0, vowel_transition1;
+extern ESPEAK_TLS int wavefile_ix;
+extern ESPEAK_TLS int wavefile_amp;
+extern ESPEAK_TLS int wavefile_ix2;
+extern ESPEAK_TLS int wavefile_amp2;
+extern ESPEAK_TLS int vowel_transition[4];
+extern ESPEAK_TLS int vowel_transition0, vowel_transition1;
 
-extern int mbrola_delay;
-extern char mbrola_name[20];
+extern ESPEAK_TLS int mbrola_delay;
+extern ESPEAK_TLS char mbrola_name[20];
 
 // from synthdata file
 unsigned int LookupSound(PHONEME_TAB *ph1, PHONEME_TAB *ph2, int which, int *match_level, int control);
@@ -311,25 +311,25 @@ int CompileDictionary(const char *dsource, const char *dict_name, FILE *log, cha
 
 
 extern unsigned char *envelope_data[18];
-extern int formant_rate[];         // max rate of change of each formant
-extern SPEED_FACTORS speed;
-
-extern long count_samples;
-extern int outbuf_size;
-extern unsigned char *out_ptr;
-extern unsigned char *out_start;
-extern unsigned char *out_end;
-extern int event_list_ix;
-extern espeak_EVENT *event_list;
-extern t_espeak_callback* synth_callback;
-extern int option_log_frames;
+extern ESPEAK_TLS int formant_rate[];         // max rate of change of each formant
+extern ESPEAK_TLS SPEED_FACTORS speed;
+
+extern ESPEAK_TLS long count_samples;
+extern ESPEAK_TLS int outbuf_size;
+extern ESPEAK_TLS unsigned char *out_ptr;
+extern ESPEAK_TLS unsigned char *out_start;
+extern ESPEAK_TLS unsigned char *out_end;
+extern ESPEAK_TLS int event_list_ix;
+extern ESPEAK_TLS espeak_EVENT *event_list;
+extern ESPEAK_TLS t_espeak_callback* synth_callback;
+extern ESPEAK_TLS int option_log_frames;
 extern const char *version_string;
 extern const int version_phdata;
 
 #define N_SOUNDICON_TAB  80   // total entries in soundicon_tab
 #define N_SOUNDICON_SLOTS 4    // number of slots reserved for dynamic loading of audio files
-extern int n_soundicon_tab;
-extern SOUND_ICON soundicon_tab[N_SOUNDICON_TAB];
+extern ESPEAK_TLS int n_soundicon_tab;
+extern ESPEAK_TLS SOUND_ICON soundicon_tab[N_SOUNDICON_TAB];
 
 espeak_ERROR SetVoiceByName(const char *name);
 espeak_ERROR SetVoiceByProperties(espeak_VOICE *voice_selector);
@@ -114,6 +114,7 @@ static Translator* NewTranslator(void)
 	tr->dict_condition=0;
 	tr->data_dictrules = NULL;     // language_1   translation rules file
 	tr->data_dictlist = NULL;      // language_2   dictionary lookup file
+	memset(&tr->dict_file,0,sizeof(tr->dict_file));
 
 	tr->transpose_offset = 0;
 
@@ -33,74 +33,75 @@
 #include "synthesize.h"
 #include "voice.h"
 #include "translate.h"
+#include "wordcache.h"
 
 #define WORD_STRESS_CHAR   '*'
 
 
-Translator *translator = NULL;    // the main translator
-Translator *translator2 = NULL;   // secondary translator for certain words
-static char translator2_language[20] = {0};
-
-FILE *f_trans = NULL;     // phoneme output text
-int option_tone2 = 0;
-int option_tone_flags = 0;   // bit 8=emphasize allcaps, bit 9=emphasize penultimate stress
-int option_phonemes = 0;
-int option_phoneme_events = 0;
-int option_quiet = 0;
-int option_endpause = 0;  // suppress pause after end of text
-int option_capitals = 0;
-int option_punctuation = 0;
-int option_sayas = 0;
-static int option_sayas2 = 0;  // used in translate_clause()
-static int option_emphasis = 0;  // 0=normal, 1=normal, 2=weak, 3=moderate, 4=strong
-int option_ssml = 0;
-int option_phoneme_input = 0;  // allow [[phonemes]] in input
-int option_phoneme_variants = 0;  // 0= don't display phoneme variant mnemonics
-int option_wordgap = 0;
-
-static int count_sayas_digits;
-int skip_sentences;
-int skip_words;
-int skip_characters;
-char skip_marker[N_MARKER_LENGTH];
-int skipping_text;   // waiting until word count, sentence count, or named marker is reached
-int end_character_position;
-int count_sentences;
-int count_words;
-int clause_start_char;
-int clause_start_word;
-int new_sentence;
-static int word_emphasis = 0;    // set if emphasis level 3 or 4
+ESPEAK_TLS Translator *translator = NULL;    // the main translator
+ESPEAK_TLS Translator *translator2 = NULL;   // secondary translator for certain words
+static ESPEAK_TLS char translator2_language[20] = {0};
+
+ESPEAK_TLS FILE *f_trans = NULL;     // phoneme output text
+ESPEAK_TLS int option_tone2 = 0;
+ESPEAK_TLS int option_tone_flags = 0;   // bit 8=emphasize allcaps, bit 9=emphasize penultimate stress
+ESPEAK_TLS int option_phonemes = 0;
+ESPEAK_TLS int option_phoneme_events = 0;
+ESPEAK_TLS int option_quiet = 0;
+ESPEAK_TLS int option_endpause = 0;  // suppress pause after end of text
+ESPEAK_TLS int option_capitals = 0;
+ESPEAK_TLS int option_punctuation = 0;
+ESPEAK_TLS int option_sayas = 0;
+static ESPEAK_TLS int option_sayas2 = 0;  // used in translate_clause()
+static ESPEAK_TLS int option_emphasis = 0;  // 0=normal, 1=normal, 2=weak, 3=moderate, 4=strong
+ESPEAK_TLS int option_ssml = 0;
+ESPEAK_TLS int option_phoneme_input = 0;  // allow [[phonemes]] in input
+ESPEAK_TLS int option_phoneme_variants = 0;  // 0= don't display phoneme variant mnemonics
+ESPEAK_TLS int option_wordgap = 0;
+
+static ESPEAK_TLS int count_sayas_digits;
+ESPEAK_TLS int skip_sentences;
+ESPEAK_TLS int skip_words;
+ESPEAK_TLS int skip_characters;
+ESPEAK_TLS char skip_marker[N_MARKER_LENGTH];
+ESPEAK_TLS int skipping_text;   // waiting until word count, sentence count, or named marker is reached
+ESPEAK_TLS int end_character_position;
+ESPEAK_TLS int count_sentences;
+ESPEAK_TLS int count_words;
+ESPEAK_TLS int clause_start_char;
+ESPEAK_TLS int clause_start_word;
+ESPEAK_TLS int new_sentence;
+static ESPEAK_TLS int word_emphasis = 0;    // set if emphasis level 3 or 4
 
 static int prev_clause_pause=0;
-static int max_clause_pause = 0;
+static ESPEAK_TLS int max_clause_pause = 0;
 
 
 // these were previously in translator class
-char word_phonemes[N_WORD_PHONEMES];    // a word translated into phoneme codes
-int n_ph_list2;
-PHONEME_LIST2 ph_list2[N_PHONEME_LIST];	// first stage of text->phonemes
+ESPEAK_TLS char word_phonemes[N_WORD_PHONEMES];    // a word translated into phoneme codes
+ESPEAK_TLS int n_ph_list2;
+ESPEAK_TLS PHONEME_LIST2 ph_list2[N_PHONEME_LIST];	// first stage of text->phonemes
 
 
 
-wchar_t option_punctlist[N_PUNCTLIST]={0};
+ESPEAK_TLS wchar_t option_punctlist[N_PUNCTLIST]={0};
 char ctrl_embedded = '\001';    // to allow an alternative CTRL for embedded commands
-int option_multibyte=espeakCHARS_AUTO;   // 0=auto, 1=utf8, 2=8bit, 3=wchar
+ESPEAK_TLS int option_multibyte=espeakCHARS_AUTO;   // 0=auto, 1=utf8, 2=8bit, 3=wchar
 
 // these are overridden by defaults set in the "speak" file
-int option_linelength = 0;
+ESPEAK_TLS int option_linelength = 0;
 
 #define N_EMBEDDED_LIST  250
-static int embedded_ix;
-static int embedded_read;
-unsigned int embedded_list[N_EMBEDDED_LIST];
+static ESPEAK_TLS int embedded_ix;
+static ESPEAK_TLS int embedded_read;
+ESPEAK_TLS unsigned int embedded_list[N_EMBEDDED_LIST];
 
 // the source text of a single clause (UTF8 bytes)
 #define N_TR_SOURCE    700
-static char source[N_TR_SOURCE+40];     // extra space for embedded command & voice change info at end
+static ESPEAK_TLS char source[N_TR_SOURCE+40];     // extra space for embedded command & voice change info at end
 
-int n_replace_phonemes;
-REPLACE_PHONEMES replace_phonemes[N_REPLACE_PHONEMES];
+ESPEAK_TLS int n_replace_phonemes;
+ESPEAK_TLS REPLACE_PHONEMES replace_phonemes[N_REPLACE_PHONEMES];
 
 
 // brackets, also 0x2014 to 0x021f which don't need to be in this list
@@ -417,8 +418,8 @@ int IsSpace(unsigned int c)
 
 void DeleteTranslator(Translator *tr)
 {//==================================
-	if(tr->data_dictlist != NULL)
-		Free(tr->data_dictlist);
+	WordCacheClear();
+	UnmapFile(&tr->dict_file);
 	Free(tr);
 }
 
@@ -559,8 +560,8 @@ char *strchr_w(const char *s, int c)
 
 
 
-int TranslateWord(Translator *tr, char *word1, int next_pause, WORD_TAB *wtab)
-{//===========================================================================
+static int TranslateWord1(Translator *tr, char *word1, int next_pause, WORD_TAB *wtab)
+{//===================================================================================
 // word1 is terminated by space (0x20) character
 
 	int length;
@@ -1201,6 +1202,176 @@ strcpy(phonemes2,phonemes);
 	}
 
 	return(dictionary_flags[0]);
+}  //  end of TranslateWord1
+
+
+
+static int MakeWordCacheKey(Translator *tr, const char *word1, int next_pause, WORD_TAB *wtab, WORD_CACHE_KEY *key)
+{//===============================================================================================================
+// Returns 0 if the word can not be cached. Only plain words are: numbers,
+// abbreviations with dots etc. depend on more of the text around them.
+	const char *p;
+	int c;
+	int n_chars = 0;
+	int offset;
+
+	if((option_sayas != 0) || (option_phonemes != 0) || (tr->phonemes_repeat_count != 0) || (word1[-1] != ' '))
+		return(0);
+
+	for(p = word1; *p != ' '; n_chars++)
+	{
+		if(*p == 0)
+			return(0);
+		p += utf8_in(&c,p);
+		if(!iswalpha(c) && (c != '\'') && (c != 0x2019))
+			return(0);
+	}
+	if((n_chars < 2) || ((p - word1) >= N_WORD_CACHE_WORD))
+		return(0);
+
+	memset(key,0,sizeof(WORD_CACHE_KEY));
+	key->tr = tr;
+	key->wflags = wtab->flags;
+	key->wmark = wtab->wmark;
+	key->next_pause = next_pause;
+	key->dict_condition = tr->dict_condition;
+	key->tone_flags = option_tone_flags;
+	key->phoneme_variants = option_phoneme_variants;
+	key->expect_verb = tr->expect_verb;
+	key->expect_verb_s = tr->expect_verb_s;
+	key->expect_past = tr->expect_past;
+	key->expect_noun = tr->expect_noun;
+	key->prev_last_stress = tr->prev_last_stress;
+	key->lower_clause = (tr->clause_lower_count > 3) && (tr->clause_upper_count <= tr->clause_lower_count);
+
+	// FLAG_ATEND entries compare the start of the word, or of the word without
+	// a prefix, with the end of the clause
+	offset = tr->clause_end - word1;
+	if(offset < 0)
+		offset = 0;
+	if(offset > (p - word1))
+		offset = (p - word1) + 1;
+	key->clause_end = offset;
+
+	memcpy(key->word,word1,p - word1);
+	return(1);
+}
+
+
+static void SetWordCacheContext(WORD_CACHE_KEY *key, const char *word1, int before, int after)
+{//=========================================================================================
+// Add the text around the word to the key. The clause buffer starts with a
+// zero byte and ends with one, the rest of the key is left as zeros.
+	int ix;
+	const char *p;
+
+	key->context_before = before;
+	key->context_after = after;
+	memset(key->before,0,sizeof(key->before));
+	memset(key->after,0,sizeof(key->after));
+
+	p = word1 - 2;
+	for(ix=0; (ix < before) && ((key->before[ix] = *p--) != 0); ix++);
+
+	p = word1 + strlen(key->word) + 1;
+	for(ix=0; (ix < after) && ((key->after[ix] = *p++) != 0); ix++);
+}
+
+
+int TranslateWord(Translator *tr, char *word1, int next_pause, WORD_TAB *wtab)
+{//===========================================================================
+// Looks up the word in the cache before translating it
+	int flags;
+	int length;
+	int word_length;
+	int generation;
+	int found;
+	int before = 0;
+	int after = 0;
+	WORD_CACHE_KEY key;
+	WORD_CACHE_VALUE value;
+
+	if(!WordCacheEnabled())
+		return(TranslateWord1(tr, word1, next_pause, wtab));
+
+	if(MakeWordCacheKey(tr, word1, next_pause, wtab, &key) == 0)
+	{
+		WordCacheCount(WORD_CACHE_BYPASS);
+		return(TranslateWord1(tr, word1, next_pause, wtab));
+	}
+	word_length = strlen(key.word);
+
+	found = WordCacheLookup(&key, &value);
+	while(found && (value.context_before | value.context_after))
+	{
+		// The word depends on the text around it. Look again with as much of
+		// it as this entry says, there may be more entries for longer text.
+		before = value.context_before;
+		after = value.context_after;
+		SetWordCacheContext(&key, word1, before, after);
+		found = WordCacheLookup(&key, &value);
+	}
+
+	if(found)
+	{
+		WordCacheCount(WORD_CACHE_HIT);
+		memcpy(word1, value.word, word_length);
+		strcpy(word_phonemes, value.phonemes);
+		tr->expect_verb = value.expect_verb;
+		tr->expect_verb_s = value.expect_verb_s;
+		tr->expect_past = value.expect_past;
+		tr->expect_noun = value.expect_noun;
+		tr->prev_last_stress = value.prev_last_stress;
+		dictionary_skipwords = 0;
+		return(value.flags);
+	}
+
+	WordCacheCount(WORD_CACHE_MISS);
+	generation = WordCacheGeneration();
+	memset(&word_context, 0, sizeof(word_context));
+	word_context.start = word1;
+	word_context.end = word1 + word_length;
+	flags = TranslateWord1(tr, word1, next_pause, wtab);
+	word_context.start = NULL;
+
+	// don't keep words which switched language, or which changed more than
+	// the word in the text
+	length = strlen(word_phonemes);
+	if((dictionary_skipwords != 0) || word_context.unbounded || (tr->phonemes_repeat_count != 0)
+		|| (word_phonemes[0] == phonSWITCH) || (length >= N_WORD_CACHE_PHONEMES)
+		|| (word_context.before > N_WORD_CACHE_CONTEXT) || (word_context.after > N_WORD_CACHE_CONTEXT)
+		|| (generation != WordCacheGeneration()) || (word1[-1] != ' ') || (word1[word_length] != ' '))
+	{
+		return(flags);
+	}
+
+	if((word_context.before > before) || (word_context.after > after))
+	{
+		// This text needed more context than the key has. Leave an entry
+		// which sends the lookups on to a key with more.
+		if(word_context.before > before)
+			before = word_context.before;
+		if(word_context.after > after)
+			after = word_context.after;
+
+		memset(&value, 0, sizeof(value));
+		value.context_before = before;
+		value.context_after = after;
+		WordCacheAdd(&key, &value);
+		SetWordCacheContext(&key, word1, before, after);
+	}
+
+	memset(&value, 0, sizeof(value));
+	value.flags = flags;
+	value.expect_verb = tr->expect_verb;
+	value.expect_verb_s = tr->expect_verb_s;
+	value.expect_past = tr->expect_past;
+	value.expect_noun = tr->expect_noun;
+	value.prev_last_stress = tr->prev_last_stress;
+	memcpy(value.phonemes, word_phonemes, length+1);
+	memcpy(value.word, word1, word_length);
+	WordCacheAdd(&key, &value);
+	return(flags);
 }  //  end of TranslateWord
 
 
@@ -1795,7 +1966,7 @@ static int SubstituteChar(Translator *tr, unsigned int c, unsigned int next_in,
 	unsigned int word;
 	unsigned int new_c, c2, c_lower;
 	int upper_case = 0;
-	static int ignore_next = 0;
+	static ESPEAK_TLS int ignore_next = 0;
 	const unsigned int *replace_chars;
 
 	if(ignore_next)
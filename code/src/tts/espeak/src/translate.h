@@ -219,6 +219,16 @@ typedef struct{
 	unsigned char length;
 } WORD_TAB;
 
+// Set while TranslateWord() translates a word for the word cache, to find
+// out how much of the text around the word the translation looks at
+typedef struct {
+	const char *start;     // the word, NULL if not wanted
+	const char *end;       // the space after the word
+	int before;            // bytes looked at before the space before the word
+	int after;             // bytes looked at after the space after the word
+	int unbounded;         // scanned the text around the word
+} WORD_CONTEXT;
+
 // a clause translated into phoneme codes (first stage)
 typedef struct {
 	unsigned char phcode;
@@ -234,7 +244,7 @@ typedef struct {
 	int parameter[N_SPEECH_PARAM];
 } PARAM_STACK;
 
-extern PARAM_STACK param_stack[];
+extern ESPEAK_TLS PARAM_STACK param_stack[];
 extern const int param_defaults[N_SPEECH_PARAM];
 
 
@@ -432,6 +442,7 @@ struct Translator
 
 	char *data_dictrules;     // language_1   translation rules file
 	char *data_dictlist;      // language_2   dictionary lookup file
+	MAPPED_FILE dict_file;    // the _dict file, data_dictlist points into it
 	char *dict_hashtab[N_HASH_DICT];   // hash table to index dictionary lookup file
 	char *letterGroups[N_LETTER_GROUPS];
 
@@ -466,57 +477,58 @@ struct Translator
 }; //  end of class Translator
 
 
-extern int option_tone2;
+extern ESPEAK_TLS int option_tone2;
 #define OPTION_EMPHASIZE_ALLCAPS  0x100
 #define OPTION_EMPHASIZE_PENULTIMATE 0x200
-extern int option_tone_flags;
-extern int option_waveout;
-extern int option_quiet;
-extern int option_phonemes;
-extern int option_phoneme_events;
-extern int option_linelength;     // treat lines shorter than this as end-of-clause
-extern int option_multibyte;
-extern int option_capitals;
-extern int option_punctuation;
-extern int option_endpause;
-extern int option_ssml;
-extern int option_phoneme_input;   // allow [[phonemes]] in input text
-extern int option_phoneme_variants;
-extern int option_sayas;
-extern int option_wordgap;
-
-extern int count_characters;
-extern int count_words;
-extern int count_sentences;
-extern int skip_characters;
-extern int skip_words;
-extern int skip_sentences;
-extern int skipping_text;
-extern int end_character_position;
-extern int clause_start_char;
-extern int clause_start_word;
-extern char *namedata;
+extern ESPEAK_TLS int option_tone_flags;
+extern ESPEAK_TLS int option_waveout;
+extern ESPEAK_TLS int option_quiet;
+extern ESPEAK_TLS int option_phonemes;
+extern ESPEAK_TLS int option_phoneme_events;
+extern ESPEAK_TLS int option_linelength;     // treat lines shorter than this as end-of-clause
+extern ESPEAK_TLS int option_multibyte;
+extern ESPEAK_TLS int option_capitals;
+extern ESPEAK_TLS int option_punctuation;
+extern ESPEAK_TLS int option_endpause;
+extern ESPEAK_TLS int option_ssml;
+extern ESPEAK_TLS int option_phoneme_input;   // allow [[phonemes]] in input text
+extern ESPEAK_TLS int option_phoneme_variants;
+extern ESPEAK_TLS int option_sayas;
+extern ESPEAK_TLS int option_wordgap;
+
+extern ESPEAK_TLS int count_characters;
+extern ESPEAK_TLS int count_words;
+extern ESPEAK_TLS int count_sentences;
+extern ESPEAK_TLS int skip_characters;
+extern ESPEAK_TLS int skip_words;
+extern ESPEAK_TLS int skip_sentences;
+extern ESPEAK_TLS int skipping_text;
+extern ESPEAK_TLS int end_character_position;
+extern ESPEAK_TLS int clause_start_char;
+extern ESPEAK_TLS int clause_start_word;
+extern ESPEAK_TLS char *namedata;
 
 
 
 #define N_MARKER_LENGTH 50   // max.length of a mark name
-extern char skip_marker[N_MARKER_LENGTH];
+extern ESPEAK_TLS char skip_marker[N_MARKER_LENGTH];
 
 #define N_PUNCTLIST  60
-extern wchar_t option_punctlist[N_PUNCTLIST];  // which punctuation characters to announce
+extern ESPEAK_TLS wchar_t option_punctlist[N_PUNCTLIST];  // which punctuation characters to announce
 extern unsigned char punctuation_to_tone[INTONATION_TYPES][PUNCT_INTONATIONS];
 
-extern Translator *translator;
-extern Translator *translator2;
+extern ESPEAK_TLS Translator *translator;
+extern ESPEAK_TLS Translator *translator2;
 extern const unsigned short *charsets[N_CHARSETS];
-extern char dictionary_name[40];
+extern ESPEAK_TLS char dictionary_name[40];
 extern char ctrl_embedded;    // to allow an alternative CTRL for embedded commands
-extern char *p_textinput;
-extern wchar_t *p_wchar_input;
-extern int dictionary_skipwords;
+extern ESPEAK_TLS char *p_textinput;
+extern ESPEAK_TLS wchar_t *p_wchar_input;
+extern ESPEAK_TLS int dictionary_skipwords;
+extern ESPEAK_TLS WORD_CONTEXT word_context;
 
-extern int (* uri_callback)(int, const char *, const char *);
-extern int (* phoneme_callback)(const char *);
+extern ESPEAK_TLS int (* uri_callback)(int, const char *, const char *);
+extern ESPEAK_TLS int (* phoneme_callback)(const char *);
 extern void SetLengthMods(Translator *tr, int value);
 
 void LoadConfig(void);
@@ -573,4 +585,4 @@ int ReadClause(Translator *tr, FILE *f_in, char *buf, short *charix, int n_buf,
 
 void SetVoiceStack(espeak_VOICE *v);
 
-extern FILE *f_trans;		// for logging
+extern ESPEAK_TLS FILE *f_trans;		// for logging
@@ -68,11 +68,12 @@ typedef struct {
 extern USHORT voice_pcnt[N_PEAKS+1][3];
 
 
-extern voice_t *voice;
-extern int tone_points[12];
+extern ESPEAK_TLS voice_t *voice;
+extern ESPEAK_TLS int tone_points[12];
 
 const char *SelectVoice(espeak_VOICE *voice_select, int *found);
 espeak_VOICE *SelectVoiceByName(espeak_VOICE **voices, const char *name);
+void InitVoiceData(void);
 voice_t *LoadVoice(const char *voice_name, int control);
 voice_t *LoadVoiceVariant(const char *voice_name, int variant);
 void DoVoiceChange(voice_t *v);
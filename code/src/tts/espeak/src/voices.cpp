@@ -41,6 +41,7 @@
 #include "synthesize.h"
 #include "voice.h"
 #include "translate.h"
+#include "wordcache.h"
 
 
 MNEM_TAB genders [] = {
@@ -49,24 +50,24 @@ MNEM_TAB genders [] = {
 	{"female", 2},
 	{NULL, 0 }};
 
-int tone_points[12] = {600,170, 1200,135, 2000,110, 3000,110, -1,0};
+ESPEAK_TLS int tone_points[12] = {600,170, 1200,135, 2000,110, 3000,110, -1,0};
 //int tone_points[12] = {250,200,  400,170, 600,170, 1200,135, 2000,110, -1,0};
 
 // limit the rate of change for each formant number
 //static int formant_rate_22050[9] = {50, 104, 165, 230, 220, 220, 220, 220, 220};  // values for 22kHz sample rate
 //static int formant_rate_22050[9] = {240, 180, 180, 180, 180, 180, 180, 180, 180};  // values for 22kHz sample rate
 static int formant_rate_22050[9] = {240, 170, 170, 170, 170, 170, 170, 170, 170};  // values for 22kHz sample rate
-int formant_rate[9];         // values adjusted for actual sample rate
+ESPEAK_TLS int formant_rate[9];         // values adjusted for actual sample rate
 
 
 
 #define DEFAULT_LANGUAGE_PRIORITY  5
 #define N_VOICES_LIST  150
-static int n_voices_list = 0;
-static espeak_VOICE *voices_list[N_VOICES_LIST];
-static int len_path_voices;
+static ESPEAK_TLS int n_voices_list = 0;
+static ESPEAK_TLS espeak_VOICE *voices_list[N_VOICES_LIST];
+static ESPEAK_TLS int len_path_voices;
 
-espeak_VOICE voice_selected;
+ESPEAK_TLS espeak_VOICE voice_selected;
 
 
 enum {
@@ -167,8 +168,16 @@ const char variants_male[N_VOICE_VARIANTS] = {1,2,3,4,5,0};
 const char variants_female[N_VOICE_VARIANTS] = {11,12,13,14,0};
 const char *variant_lists[3] = {variants_either, variants_male, variants_female};
 
-static voice_t voicedata;
-voice_t *voice = &voicedata;
+static ESPEAK_TLS voice_t voicedata;
+ESPEAK_TLS voice_t *voice = NULL;   // set by InitVoiceData()
+
+
+void InitVoiceData(void)
+{//=====================
+// A thread local pointer can not be initialised with the address of
+// another thread local variable, so do it when the synthesizer starts.
+	voice = &voicedata;
+}
 
 
 static char *fgets_strip(char *buf, int size, FILE *f_in)
@@ -525,6 +534,7 @@ voice_t *LoadVoice(const char *vname, int control)
 	char new_dictionary[40];
 	char phonemes_name[40];
 	const char *language_type;
+	char *strtok_state;
 	char buf[200];
 	char path_voices[sizeof(path_home)+12];
 	char langname[4];
@@ -536,9 +546,9 @@ voice_t *LoadVoice(const char *vname, int control)
 	int pitch1;
 	int pitch2;
 
-	static char voice_identifier[40];  // file name for  voice_selected
-	static char voice_name[40];        // voice name for voice_selected
-	static char voice_languages[100];  // list of languages and priorities for voice_selected
+	static ESPEAK_TLS char voice_identifier[40];  // file name for  voice_selected
+	static ESPEAK_TLS char voice_name[40];        // voice name for voice_selected
+	static ESPEAK_TLS char voice_languages[100];  // list of languages and priorities for voice_selected
 
 	strcpy(voicename,vname);
 	if(voicename[0]==0)
@@ -668,7 +678,7 @@ voice_t *LoadVoice(const char *vname, int control)
 				// only act on the first language line
 				if(language_set == 0)
 				{
-					language_type = strtok(language_name,"-");
+					language_type = strtok_r(language_name,"-",&strtok_state);
 					language_set = 1;
 					strcpy(translator_name,language_type);
 					strcpy(new_dictionary,language_type);
@@ -947,6 +957,8 @@ voice_t *LoadVoice(const char *vname, int control)
 
 	voice->width[0] = (voice->width[0] * 105)/100;
 
+	// the cached words depend on the language options, which a variant may change
+	WordCacheClear();
 	if(!tone_only)
 	{
 		translator = new_translator;
@@ -977,7 +989,7 @@ static char *ExtractVoiceVariantName(char *vname, int variant_num)
 // Returns the voice variant name
 
 	char *p;
-	static char variant_name[20];
+	static ESPEAK_TLS char variant_name[20];
 	char variant_prefix[5];
 
 	variant_name[0] = 0;
@@ -1335,8 +1347,8 @@ char const *SelectVoice(espeak_VOICE *voice_select, int *found)
 	espeak_VOICE voice_select2;
 	espeak_VOICE *voices[N_VOICES_LIST]; // list of candidates
 	espeak_VOICE *voices2[N_VOICES_LIST+N_VOICE_VARIANTS];
-	static espeak_VOICE voice_variants[N_VOICE_VARIANTS];
-	static char voice_id[50];
+	static ESPEAK_TLS espeak_VOICE voice_variants[N_VOICE_VARIANTS];
+	static ESPEAK_TLS char voice_id[50];
 
 	*found = 1;
 	memcpy(&voice_select2,voice_select,sizeof(voice_select2));
@@ -1347,7 +1359,7 @@ char const *SelectVoice(espeak_VOICE *voice_select, int *found)
 	if((voice_select2.languages == NULL) || (voice_select2.languages[0] == 0))
 	{
 		// no language is specified. Get language from the named voice
-		static char buf[60];
+		static ESPEAK_TLS char buf[60];
 	
 		if(voice_select2.name == NULL)
 		{
@@ -1608,7 +1620,7 @@ espeak_ERROR SetVoiceByName(const char *name)
 	espeak_VOICE *v;
 	espeak_VOICE voice_selector;
 	char *variant_name;
-	static char buf[60];
+	static ESPEAK_TLS char buf[60];
 
 	strncpy0(buf,name,sizeof(buf));
 	variant_name = ExtractVoiceVariantName(buf,0);
@@ -1685,7 +1697,7 @@ ESPEAK_API const espeak_VOICE **espeak_ListVoices(espeak_VOICE *voice_spec)
 	int ix;
 	int j;
 	espeak_VOICE *v;
-	static espeak_VOICE *voices[N_VOICES_LIST];
+	static ESPEAK_TLS espeak_VOICE *voices[N_VOICES_LIST];
 	char path_voices[sizeof(path_home)+12];
 
 	// free previous voice list data
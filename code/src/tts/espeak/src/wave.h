@@ -7,7 +7,7 @@
 
 typedef unsigned int uint32_t;
 
-extern int option_device_number;
+extern ESPEAK_TLS int option_device_number;
 
 extern void wave_init();
 // TBD: the arg could be "alsa", "oss",...
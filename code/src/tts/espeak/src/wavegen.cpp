@@ -33,6 +33,7 @@
 #include "phoneme.h"
 #include "synthesize.h"
 #include "voice.h"
+#include "wavegen_kernels.h"
 
 //#undef INCLUDE_KLATT
 
@@ -55,90 +56,91 @@
 #define PI2 6.283185307
 #define N_WAV_BUF   10
 
-voice_t *wvoice;
+ESPEAK_TLS voice_t *wvoice;
 
-FILE *f_log = NULL;
-int option_waveout = 0;
-static int option_harmonic1 = 10;   // 10
-int option_log_frames = 0;
-static int flutter_amp = 64;
+ESPEAK_TLS FILE *f_log = NULL;
+ESPEAK_TLS int option_waveout = 0;
+static ESPEAK_TLS int option_harmonic1 = 10;   // 10
+ESPEAK_TLS int option_log_frames = 0;
+static ESPEAK_TLS int flutter_amp = 64;
 
-static int general_amplitude = 60;
-static int consonant_amp = 26;   // 24
+static ESPEAK_TLS int general_amplitude = 60;
+static ESPEAK_TLS int consonant_amp = 26;   // 24
 
-int embedded_value[N_EMBEDDED_VALUES];
+ESPEAK_TLS int embedded_value[N_EMBEDDED_VALUES];
 
-static int PHASE_INC_FACTOR;
-int samplerate = 0;       // this is set by Wavegeninit()
-int samplerate_native=0;
-extern int option_device_number;
-extern int option_quiet;
+static ESPEAK_TLS int PHASE_INC_FACTOR;
+ESPEAK_TLS int samplerate = 0;       // this is set by Wavegeninit()
+ESPEAK_TLS int samplerate_native=0;
+extern ESPEAK_TLS int option_device_number;
+extern ESPEAK_TLS int option_quiet;
 
-static wavegen_peaks_t peaks[N_PEAKS];
-static int peak_harmonic[N_PEAKS];
-static int peak_height[N_PEAKS];
+static ESPEAK_TLS wavegen_peaks_t peaks[N_PEAKS];
+static ESPEAK_TLS int peak_harmonic[N_PEAKS];
+static ESPEAK_TLS int peak_height[N_PEAKS];
 
-#define N_ECHO_BUF 5500   // max of 250mS at 22050 Hz
-static int echo_head;
-static int echo_tail;
-static int echo_length = 0;   // period (in sample\) to ensure completion of echo at the end of speech, set in WavegenSetEcho()
-static int echo_amp = 0;
-static short echo_buf[N_ECHO_BUF];
+#define N_ECHO_BUF 11025   // max of 250mS at 44100 Hz
+static ESPEAK_TLS int echo_head;
+static ESPEAK_TLS int echo_tail;
+static ESPEAK_TLS int echo_length = 0;   // period (in sample\) to ensure completion of echo at the end of speech, set in WavegenSetEcho()
+static ESPEAK_TLS int echo_amp = 0;
+static ESPEAK_TLS short echo_buf[N_ECHO_BUF];
 
-static int voicing;
-static RESONATOR rbreath[N_PEAKS];
+static ESPEAK_TLS int voicing;
+static ESPEAK_TLS RESONATOR_BANK rbreath;
+static ESPEAK_TLS const WAVEGEN_KERNELS *kernels = NULL;
 
-static int harm_sqrt_n = 0;
+static ESPEAK_TLS int harm_sqrt_n = 0;
 
 
 #define N_LOWHARM  30
-static int harm_inc[N_LOWHARM];    // only for these harmonics do we interpolate amplitude between steps
-static int *harmspect;
-static int hswitch=0;
-static int hspect[2][MAX_HARMONIC];         // 2 copies, we interpolate between then
-static int max_hval=0;
+static ESPEAK_TLS int harm_inc[N_LOWHARM];    // only for these harmonics do we interpolate amplitude between steps
+static ESPEAK_TLS int *harmspect;
+static ESPEAK_TLS int hswitch=0;
+static ESPEAK_TLS int hspect[2][MAX_HARMONIC];         // 2 copies, we interpolate between then
+static ESPEAK_TLS int max_hval=0;
 
-static int nsamples=0;       // number to do
-static int modulation_type = 0;
-static int glottal_flag = 0;
-static int glottal_reduce = 0;
+static ESPEAK_TLS int nsamples=0;       // number to do
+static ESPEAK_TLS int modulation_type = 0;
+static ESPEAK_TLS int glottal_flag = 0;
+static ESPEAK_TLS int glottal_reduce = 0;
 
 
-WGEN_DATA wdata;
+ESPEAK_TLS WGEN_DATA wdata;
 
-static int amp_ix;
-static int amp_inc;
-static unsigned char *amplitude_env = NULL;
+static ESPEAK_TLS int amp_ix;
+static ESPEAK_TLS int amp_inc;
+static ESPEAK_TLS unsigned char *amplitude_env = NULL;
 
-static int samplecount=0;    // number done
-static int samplecount_start=0;  // count at start of this segment
-static int end_wave=0;      // continue to end of wave cycle
-static int wavephase;
-static int phaseinc;
-static int cycle_samples;         // number of samples in a cycle at current pitch
-static int cbytes;
-static int hf_factor;
+static ESPEAK_TLS int samplecount=0;    // number done
+static ESPEAK_TLS int samplecount_start=0;  // count at start of this segment
+static ESPEAK_TLS int end_wave=0;      // continue to end of wave cycle
+static ESPEAK_TLS int wavephase;
+static ESPEAK_TLS int phaseinc;
+static ESPEAK_TLS int cycle_samples;         // number of samples in a cycle at current pitch
+static ESPEAK_TLS int cbytes;
+static ESPEAK_TLS int hf_factor;
 
-static double minus_pi_t;
-static double two_pi_t;
+static ESPEAK_TLS double minus_pi_t;
+static ESPEAK_TLS double two_pi_t;
 
 
-unsigned char *out_ptr;
-unsigned char *out_start;
-unsigned char *out_end;
-int outbuf_size = 0;
+ESPEAK_TLS unsigned char *out_ptr;
+ESPEAK_TLS unsigned char *out_start;
+ESPEAK_TLS unsigned char *out_end;
+ESPEAK_TLS int outbuf_size = 0;
 
 // the queue of operations passed to wavegen from sythesize
-long wcmdq[N_WCMDQ][4];
-int wcmdq_head=0;
-int wcmdq_tail=0;
+ESPEAK_TLS long wcmdq[N_WCMDQ][4];
+ESPEAK_TLS int wcmdq_head=0;
+ESPEAK_TLS int wcmdq_tail=0;
 
 // pitch,speed,
 int embedded_default[N_EMBEDDED_VALUES]        = {0,50,170,100,50, 0,0, 0,170,0,0,0,0,0};
 static int embedded_max[N_EMBEDDED_VALUES]     = {0,0x7fff,600,300,99,99,99, 0,600,0,0,0,0,4};
 
 #define N_CALLBACK_IX N_WAV_BUF-2   // adjust this delay to match display with the currently spoken word
-int current_source_index=0;
+ESPEAK_TLS int current_source_index=0;
 
 extern FILE *f_wave;
 
@@ -196,7 +198,7 @@ static unsigned char modulation_tab[N_ROUGHNESS][8] = {
 
 // Flutter table, to add natural variations to the pitch
 #define N_FLUTTER  0x170
-static int Flutter_inc;
+static ESPEAK_TLS int Flutter_inc;
 static const unsigned char Flutter_tab[N_FLUTTER] = {
    0x80, 0x9b, 0xb5, 0xcb, 0xdc, 0xe8, 0xed, 0xec,
    0xe6, 0xdc, 0xce, 0xbf, 0xb0, 0xa3, 0x98, 0x90,
@@ -253,12 +255,12 @@ static const unsigned char Flutter_tab[N_FLUTTER] = {
 
 // waveform shape table for HF peaks, formants 6,7,8
 #define N_WAVEMULT 128
-static int wavemult_offset=0;
-static int wavemult_max=0;
+static ESPEAK_TLS int wavemult_offset=0;
+static ESPEAK_TLS int wavemult_max=0;
 
 // the presets are for 22050 Hz sample rate.
 // A different rate will need to recalculate the presets in WavegenInit()
-static unsigned char wavemult[N_WAVEMULT] = {
+static ESPEAK_TLS unsigned char wavemult[N_WAVEMULT] = {
   0,  0,  0,  2,  3,  5,  8, 11, 14, 18, 22, 27, 32, 37, 43, 49,
     55, 62, 69, 76, 83, 90, 98,105,113,121,128,136,144,152,159,166,
    174,181,188,194,201,207,213,218,224,228,233,237,240,244,246,249,
@@ -395,7 +397,7 @@ static unsigned char pk_shape2[PEAKSHAPEW+1] = {
      0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
      0 };
 
-static unsigned char *pk_shape;
+static ESPEAK_TLS unsigned char *pk_shape;
 
 
 static void WavegenInitPkData(int which)
@@ -722,6 +724,8 @@ void WavegenInit(int rate, int wavemult_fact)
 	wdata.amplitude = 32;
 	wdata.prev_was_synth = 0;
 
+	kernels = GetWavegenKernels(WAVEGEN_KERNEL_AUTO);
+
 	for(ix=0; ix<N_EMBEDDED_VALUES; ix++)
 		embedded_value[ix] = embedded_default[ix];
 
@@ -780,8 +784,6 @@ static void WavegenSetEcho(void)
 	delay = wvoice->echo_delay;
 	amp = wvoice->echo_amp;
 
-	if(delay >= N_ECHO_BUF)
-		delay = N_ECHO_BUF-1;
 	if(amp > 100)
 		amp = 100;
 
@@ -805,6 +807,8 @@ static void WavegenSetEcho(void)
 		amp = 0;
 
 	echo_head = (delay * samplerate)/1000;
+	if(echo_head >= N_ECHO_BUF)
+		echo_head = N_ECHO_BUF-1;
 	echo_length = echo_head;       // ensure completion of echo at the end of speech. Use 1 delay period?
 	if(amp == 0)
 		echo_length = 0;
@@ -957,7 +961,7 @@ static void AdvanceParameters()
 
 	int x;
 	int ix;
-	static int Flutter_ix = 0;
+	static ESPEAK_TLS int Flutter_ix = 0;
 
 	// advance the pitch
 	wdata.pitch_ix += wdata.pitch_inc;
@@ -1013,21 +1017,9 @@ static void AdvanceParameters()
 
 
 #ifndef PLATFORM_RISCOS
-static double resonator(RESONATOR *r, double input)
-{//================================================
-	double x;
-
-	x = r->a * input + r->b * r->x1 + r->c * r->x2;
-	r->x2 = r->x1;
-	r->x1 = x;
-
- return x;
-}
-
-
-
-static void setresonator(RESONATOR *rp, int freq, int bwidth, int init)
-{//====================================================================
+static void setresonator(RESONATOR_BANK *rp, int ix, int freq, int bwidth, int init)
+{//=================================================================================
+// ix      Resonator in the bank
 // freq    Frequency of resonator in Hz
 // bwidth  Bandwidth of resonator in Hz
 // init    Initialize internal data
@@ -1037,8 +1029,8 @@ static void setresonator(RESONATOR *rp, int freq, int bwidth, int init)
 
 	if(init)
 	{
-		rp->x1 = 0;
-		rp->x2 = 0;
+		rp->x1[ix] = 0;
+		rp->x2[ix] = 0;
 	}
 
    // x  =  exp(-pi * bwidth * t)
@@ -1046,19 +1038,30 @@ static void setresonator(RESONATOR *rp, int freq, int bwidth, int init)
 	x = exp(arg);
 
 	// c  =  -(x*x)
-	rp->c = -(x * x);
+	rp->c[ix] = -(x * x);
 
 	// b = x * 2*cos(2 pi * freq * t)
 
 	arg = two_pi_t * freq;
-	rp->b = x * cos(arg) * 2.0;
+	rp->b[ix] = x * cos(arg) * 2.0;
 
 	// a = 1.0 - b - c
-	rp->a = 1.0 - rp->b - rp->c;
+	rp->a[ix] = 1.0 - rp->b[ix] - rp->c[ix];
 }  // end if setresonator
 #endif
 
 
+int SelectWavegenKernels(int kernel)
+{//==================================
+	const WAVEGEN_KERNELS *k;
+
+	if((k = GetWavegenKernels(kernel)) == NULL)
+		return(0);
+	kernels = k;
+	return(1);
+}
+
+
 void InitBreath(void)
 {//==================
 #ifndef PLATFORM_RISCOS
@@ -1069,7 +1072,7 @@ void InitBreath(void)
 
 	for(ix=0; ix<N_PEAKS; ix++)
 	{
-		setresonator(&rbreath[ix],2000,200,1);
+		setresonator(&rbreath,ix,2000,200,1);
 	}
 #endif
 }  // end of InitBreath
@@ -1090,32 +1093,31 @@ static void SetBreath()
 		{
 			// breath[0] indicates that some breath formants are needed
 			// set the freq from the current ynthesis formant and the width from the voice data
-			setresonator(&rbreath[pk], peaks[pk].freq >> 16, wvoice->breathw[pk],0);
+			setresonator(&rbreath, pk, peaks[pk].freq >> 16, wvoice->breathw[pk],0);
 		}
 	}
 #endif
 }  // end of SetBreath
 
 
+static ESPEAK_TLS unsigned int breath_seed = 1;  // rand() state is shared by all threads
+
 static int ApplyBreath(void)
 {//=========================
 	int value = 0;
 #ifndef PLATFORM_RISCOS
 	int noise;
 	int ix;
-	int amp;
+	int amp[N_PEAKS];
 
 	// use two random numbers, for alternate formants
-	noise = (rand() & 0x3fff) - 0x2000;
+	noise = (rand_r(&breath_seed) & 0x3fff) - 0x2000;
 
 	for(ix=1; ix < N_PEAKS; ix++)
 	{
-		if((amp = wvoice->breath[ix]) != 0)
-		{
-			amp *= (peaks[ix].height >> 14);
-			value += int(resonator(&rbreath[ix],noise) * amp);
-		}
+		amp[ix] = wvoice->breath[ix] * (peaks[ix].height >> 14);
 	}
+	value = kernels->resonators(&rbreath, wvoice->breath, amp, noise);
 #endif
 	return (value);
 }
@@ -1132,16 +1134,16 @@ int Wavegen()
 	int z, z1, z2;
 	int echo;
 	int ov;
-	static int maxh, maxh2;
+	static ESPEAK_TLS int maxh, maxh2;
 	int pk;
 	signed char c;
 	int sample;
 	int amp;
 	int modn_amp, modn_period;
-	static int agc = 256;
-	static int h_switch_sign = 0;
-	static int cycle_count = 0;
-	static int amplitude2 = 0;   // adjusted for pitch
+	static ESPEAK_TLS int agc = 256;
+	static ESPEAK_TLS int h_switch_sign = 0;
+	static ESPEAK_TLS int cycle_count = 0;
+	static ESPEAK_TLS int amplitude2 = 0;   // adjusted for pitch
 
 	// continue until the output buffer is full, or
 	// the required number of samples have been produced
@@ -1303,24 +1305,7 @@ int Wavegen()
 		}
 
 		// apply main peaks, formants 0 to 5
-#ifdef USE_ASSEMBLER_1
-		// use an optimised routine for this loop, if available
-		total += AddSineWaves(waveph, h_switch_sign, maxh, harmspect);  // call an assembler code routine
-#else
-		theta = waveph;
-
-		for(h=1; h<=h_switch_sign; h++)
-		{
-			total += (int(sin_tab[theta >> 5]) * harmspect[h]);
-			theta += waveph;
-		}
-		while(h<=maxh)
-		{
-			total -= (int(sin_tab[theta >> 5]) * harmspect[h]);
-			theta += waveph;
-			h++;
-		}
-#endif
+		total += kernels->sine_waves(waveph, h_switch_sign, maxh, harmspect);
 
 		if(voicing != 64)
 		{
@@ -1393,7 +1378,7 @@ int Wavegen()
 
 static int PlaySilence(int length, int resume)
 {//===========================================
-	static int n_samples;
+	static ESPEAK_TLS int n_samples;
 	int value=0;
 
 	if(length == 0)
@@ -1429,8 +1414,8 @@ static int PlaySilence(int length, int resume)
 
 static int PlayWave(int length, int resume, unsigned char *data, int scale, int amp)
 {//=================================================================================
-	static int n_samples;
-	static int ix=0;
+	static ESPEAK_TLS int n_samples;
+	static ESPEAK_TLS int ix=0;
 	int value;
 	signed char c;
 
@@ -1558,7 +1543,7 @@ void SetEmbedded(int control, int value)
 
 void WavegenSetVoice(voice_t *v)
 {//=============================
-	static voice_t v2;
+	static ESPEAK_TLS voice_t v2;
 
 	memcpy(&v2,v,sizeof(v2));
 	wvoice = &v2;
@@ -1792,8 +1777,8 @@ int WavegenFill(int fill_zeros)
 	long *q;
 	int length;
 	int result;
-	static int resume=0;
-	static int echo_complete=0;
+	static ESPEAK_TLS int resume=0;
+	static ESPEAK_TLS int echo_complete=0;
 
 #ifdef TEST_MBROLA
 	if(mbrola_name[0] != 0)
@@ -0,0 +1,357 @@
+#include "StdAfx.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#define WAVEGEN_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON__) || defined(__aarch64__)
+#define WAVEGEN_NEON
+#include <arm_neon.h>
+#if defined(__linux__) && !defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+#include "wavegen_kernels.h"
+
+// in sintab.h, included by wavegen.cpp
+extern short int sin_tab[2048];
+
+
+// sin_tab widened to 32 bits, for the lanes of the SIMD kernels.
+// Filled before main(), sin_tab is constant initialised.
+static int sin_tab32[2048];
+
+static struct SinTab32Init {
+	SinTab32Init()
+	{
+		for(int ix=0; ix<2048; ix++)
+			sin_tab32[ix] = sin_tab[ix];
+	}
+} sin_tab32_init;
+
+
+
+static int SineWaves_scalar(unsigned short waveph, int h_switch_sign, int maxh, const int *harmspect)
+{//==================================================================================================
+	unsigned short theta;
+	int total = 0;
+	int h;
+
+	theta = waveph;
+
+	for(h=1; h<=h_switch_sign; h++)
+	{
+		total += (int(sin_tab[theta >> 5]) * harmspect[h]);
+		theta += waveph;
+	}
+	while(h<=maxh)
+	{
+		total -= (int(sin_tab[theta >> 5]) * harmspect[h]);
+		theta += waveph;
+		h++;
+	}
+	return(total);
+}
+
+
+static int Resonators_scalar(RESONATOR_BANK *r, const int *breath, const int *amp, double input)
+{//==============================================================================================
+	int ix;
+	int value = 0;
+	double x;
+
+	for(ix=1; ix<N_KERNEL_PEAKS; ix++)
+	{
+		if(breath[ix] != 0)
+		{
+			x = r->a[ix] * input + r->b[ix] * r->x1[ix] + r->c[ix] * r->x2[ix];
+			r->x2[ix] = r->x1[ix];
+			r->x1[ix] = x;
+			value += int(x * amp[ix]);
+		}
+	}
+	return(value);
+}
+
+
+// The harmonics are (h * waveph) mod 65536, so the lanes hold h*waveph
+// in 32 bits, which can not overflow for h <= MAX_HARMONIC, and are
+// masked before the table lookup.
+
+
+#ifdef WAVEGEN_X86
+
+__attribute__((target("sse4.1")))
+static int SumSines_sse41(unsigned int waveph, int h, int maxh, const int *harmspect)
+{//==================================================================================
+	int total;
+	unsigned short theta;
+	unsigned short t1, t2, t3;
+	__m128i acc = _mm_setzero_si128();
+	__m128i sines;
+
+	// no gather before AVX2, the lookups are scalar
+	theta = h * waveph;
+	for(; h+3 <= maxh; h+=4)
+	{
+		t1 = theta + waveph;
+		t2 = theta + 2 * waveph;
+		t3 = theta + 3 * waveph;
+		sines = _mm_setr_epi32(sin_tab32[theta >> 5], sin_tab32[t1 >> 5], sin_tab32[t2 >> 5], sin_tab32[t3 >> 5]);
+		acc = _mm_add_epi32(acc, _mm_mullo_epi32(sines, _mm_loadu_si128((const __m128i *)&harmspect[h])));
+		theta += 4 * waveph;
+	}
+
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+	total = _mm_cvtsi128_si32(acc);
+
+	for(; h<=maxh; h++)
+	{
+		total += sin_tab32[theta >> 5] * harmspect[h];
+		theta += waveph;
+	}
+	return(total);
+}
+
+__attribute__((target("sse4.1")))
+static int SineWaves_sse41(unsigned short waveph, int h_switch_sign, int maxh, const int *harmspect)
+{//=================================================================================================
+	// the first loop of the scalar code is not bounded by maxh
+	return(SumSines_sse41(waveph, 1, h_switch_sign, harmspect)
+	     - SumSines_sse41(waveph, h_switch_sign+1, maxh, harmspect));
+}
+
+
+__attribute__((target("avx2")))
+static int SumSines_avx2(unsigned int waveph, int h, int maxh, const int *harmspect)
+{//=================================================================================
+	int total = 0;
+	unsigned short theta;
+	__m256i acc = _mm256_setzero_si256();
+	__m256i mask = _mm256_set1_epi32(0xffff);
+	__m256i step = _mm256_set1_epi32(8 * waveph);
+	__m256i vtheta = _mm256_mullo_epi32(_mm256_set1_epi32(waveph), _mm256_setr_epi32(h, h+1, h+2, h+3, h+4, h+5, h+6, h+7));
+	__m256i ix;
+	__m256i sines;
+	__m128i acc128;
+
+	for(; h+7 <= maxh; h+=8)
+	{
+		ix = _mm256_srli_epi32(_mm256_and_si256(vtheta, mask), 5);
+		sines = _mm256_i32gather_epi32(sin_tab32, ix, 4);
+		acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(sines, _mm256_loadu_si256((const __m256i *)&harmspect[h])));
+		vtheta = _mm256_add_epi32(vtheta, step);
+	}
+
+	acc128 = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+	acc128 = _mm_add_epi32(acc128, _mm_shuffle_epi32(acc128, _MM_SHUFFLE(1, 0, 3, 2)));
+	acc128 = _mm_add_epi32(acc128, _mm_shuffle_epi32(acc128, _MM_SHUFFLE(2, 3, 0, 1)));
+	total = _mm_cvtsi128_si32(acc128);
+
+	theta = h * waveph;
+	for(; h<=maxh; h++)
+	{
+		total += sin_tab32[theta >> 5] * harmspect[h];
+		theta += waveph;
+	}
+	return(total);
+}
+
+__attribute__((target("avx2")))
+static int SineWaves_avx2(unsigned short waveph, int h_switch_sign, int maxh, const int *harmspect)
+{//================================================================================================
+	return(SumSines_avx2(waveph, 1, h_switch_sign, harmspect)
+	     - SumSines_avx2(waveph, h_switch_sign+1, maxh, harmspect));
+}
+
+
+// Two peaks per register. New state is only stored for peaks with some
+// breath, like the scalar code, which skips the others.
+__attribute__((target("sse4.1")))
+static int Resonators_sse41(RESONATOR_BANK *r, const int *breath, const int *amp, double input)
+{//=============================================================================================
+	int ix;
+	__m128d in = _mm_set1_pd(input);
+	__m128d x, x1, a;
+	__m128d inactive;
+	__m128i value = _mm_setzero_si128();
+	__m128i on2;
+
+	for(ix=1; ix<N_KERNEL_PEAKS; ix+=2)
+	{
+		if((breath[ix] | breath[ix+1]) == 0)
+			continue;
+
+		x1 = _mm_loadu_pd(&r->x1[ix]);
+		x = _mm_mul_pd(_mm_loadu_pd(&r->a[ix]), in);
+		x = _mm_add_pd(x, _mm_mul_pd(_mm_loadu_pd(&r->b[ix]), x1));
+		x = _mm_add_pd(x, _mm_mul_pd(_mm_loadu_pd(&r->c[ix]), _mm_loadu_pd(&r->x2[ix])));
+
+		on2 = _mm_loadl_epi64((const __m128i *)&breath[ix]);
+		inactive = _mm_castsi128_pd(_mm_cvtepi32_epi64(_mm_cmpeq_epi32(on2, _mm_setzero_si128())));
+		_mm_storeu_pd(&r->x2[ix], _mm_blendv_pd(x1, _mm_loadu_pd(&r->x2[ix]), inactive));
+		_mm_storeu_pd(&r->x1[ix], _mm_blendv_pd(x, x1, inactive));
+
+		// the amplitude is 0 for the peaks without breath, and int(x * 0) is 0
+		a = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i *)&amp[ix]));
+		value = _mm_add_epi32(value, _mm_cvttpd_epi32(_mm_mul_pd(x, a)));
+	}
+	return(_mm_cvtsi128_si32(value) + _mm_extract_epi32(value, 1));
+}
+
+// Four peaks per register. target("avx2") does not enable FMA, so the
+// products are rounded like the scalar code.
+__attribute__((target("avx2")))
+static int Resonators_avx2(RESONATOR_BANK *r, const int *breath, const int *amp, double input)
+{//============================================================================================
+	int ix;
+	__m256d in = _mm256_set1_pd(input);
+	__m256d x, x1, x2, a;
+	__m256d inactive;
+	__m128i on4;
+	__m128i value = _mm_setzero_si128();
+
+	for(ix=1; ix<N_KERNEL_PEAKS; ix+=4)
+	{
+		on4 = _mm_loadu_si128((const __m128i *)&breath[ix]);
+		if(_mm_testz_si128(on4, on4))
+			continue;
+
+		x1 = _mm256_loadu_pd(&r->x1[ix]);
+		x2 = _mm256_loadu_pd(&r->x2[ix]);
+		x = _mm256_mul_pd(_mm256_loadu_pd(&r->a[ix]), in);
+		x = _mm256_add_pd(x, _mm256_mul_pd(_mm256_loadu_pd(&r->b[ix]), x1));
+		x = _mm256_add_pd(x, _mm256_mul_pd(_mm256_loadu_pd(&r->c[ix]), x2));
+
+		inactive = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_cmpeq_epi32(on4, _mm_setzero_si128())));
+		_mm256_storeu_pd(&r->x2[ix], _mm256_blendv_pd(x1, x2, inactive));
+		_mm256_storeu_pd(&r->x1[ix], _mm256_blendv_pd(x, x1, inactive));
+
+		a = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)&amp[ix]));
+		value = _mm_add_epi32(value, _mm256_cvttpd_epi32(_mm256_mul_pd(x, a)));
+	}
+	value = _mm_add_epi32(value, _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2)));
+	value = _mm_add_epi32(value, _mm_shuffle_epi32(value, _MM_SHUFFLE(2, 3, 0, 1)));
+	return(_mm_cvtsi128_si32(value));
+}
+
+#endif  // WAVEGEN_X86
+
+
+#ifdef WAVEGEN_NEON
+
+static int SumSines_neon(unsigned int waveph, int h, int maxh, const int *harmspect)
+{//=================================================================================
+	int total;
+	unsigned short theta;
+	int32x4_t acc = vdupq_n_s32(0);
+	int32x4_t sines = vdupq_n_s32(0);
+	int32x2_t acc2;
+
+	theta = h * waveph;
+	for(; h+3 <= maxh; h+=4)
+	{
+		// NEON has no gather, the loads go lane by lane
+		sines = vsetq_lane_s32(sin_tab32[theta >> 5], sines, 0);
+		theta += waveph;
+		sines = vsetq_lane_s32(sin_tab32[theta >> 5], sines, 1);
+		theta += waveph;
+		sines = vsetq_lane_s32(sin_tab32[theta >> 5], sines, 2);
+		theta += waveph;
+		sines = vsetq_lane_s32(sin_tab32[theta >> 5], sines, 3);
+		theta += waveph;
+		acc = vmlaq_s32(acc, sines, vld1q_s32(&harmspect[h]));
+	}
+
+	acc2 = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+	total = vget_lane_s32(vpadd_s32(acc2, acc2), 0);
+
+	for(; h<=maxh; h++)
+	{
+		total += sin_tab32[theta >> 5] * harmspect[h];
+		theta += waveph;
+	}
+	return(total);
+}
+
+static int SineWaves_neon(unsigned short waveph, int h_switch_sign, int maxh, const int *harmspect)
+{//================================================================================================
+	return(SumSines_neon(waveph, 1, h_switch_sign, harmspect)
+	     - SumSines_neon(waveph, h_switch_sign+1, maxh, harmspect));
+}
+
+#endif  // WAVEGEN_NEON
+
+
+static const WAVEGEN_KERNELS kernels_scalar = {"scalar", SineWaves_scalar, Resonators_scalar};
+#ifdef WAVEGEN_X86
+static const WAVEGEN_KERNELS kernels_sse41 = {"sse4.1", SineWaves_sse41, Resonators_sse41};
+static const WAVEGEN_KERNELS kernels_avx2 = {"avx2", SineWaves_avx2, Resonators_avx2};
+#endif
+#ifdef WAVEGEN_NEON
+// ARMv7 NEON has no double lanes, and single precision resonators would
+// not give the same output.
+static const WAVEGEN_KERNELS kernels_neon = {"neon", SineWaves_neon, Resonators_scalar};
+
+
+static int CpuHasNeon()
+{//====================
+#if defined(__aarch64__)
+	return(1);
+#elif defined(__linux__) && defined(HWCAP_NEON)
+	return((getauxval(AT_HWCAP) & HWCAP_NEON) != 0);
+#else
+	return(1);   // built with -mfpu=neon, so it is required anyway
+#endif
+}
+#endif  // WAVEGEN_NEON
+
+
+const WAVEGEN_KERNELS *GetWavegenKernels(int kernel)
+{//=================================================
+	int ix;
+	const char *name;
+	const WAVEGEN_KERNELS *k;
+
+	switch(kernel)
+	{
+	case WAVEGEN_KERNEL_SCALAR:
+		return(&kernels_scalar);
+
+#ifdef WAVEGEN_X86
+	case WAVEGEN_KERNEL_SSE41:
+		return(__builtin_cpu_supports("sse4.1") ? &kernels_sse41 : NULL);
+	case WAVEGEN_KERNEL_AVX2:
+		return(__builtin_cpu_supports("avx2") ? &kernels_avx2 : NULL);
+#endif
+
+#ifdef WAVEGEN_NEON
+	case WAVEGEN_KERNEL_NEON:
+		return(CpuHasNeon() ? &kernels_neon : NULL);
+#endif
+
+	case WAVEGEN_KERNEL_AUTO:
+		if((name = getenv("ESPEAK_WAVEGEN_KERNEL")) != NULL)
+		{
+			for(ix=WAVEGEN_KERNEL_SCALAR; ix<N_WAVEGEN_KERNELS; ix++)
+			{
+				if(((k = GetWavegenKernels(ix)) != NULL) && (strcmp(k->name, name) == 0))
+					return(k);
+			}
+		}
+		for(ix=N_WAVEGEN_KERNELS-1; ix>WAVEGEN_KERNEL_SCALAR; ix--)
+		{
+			if((k = GetWavegenKernels(ix)) != NULL)
+				return(k);
+		}
+		return(&kernels_scalar);
+	}
+	return(NULL);
+}
@@ -0,0 +1,47 @@
+// Inner loops of Wavegen(), with SIMD versions selected at run time.
+//
+// Every kernel produces exactly the same output as the scalar one:
+// the harmonics are summed in 32 bit integers, where the order does not
+// matter, and the resonators evaluate the same double expression lane
+// by lane, without fused multiply-add.
+
+#define N_KERNEL_PEAKS  9      // same as N_PEAKS
+
+// The breath resonators of Wavegen, one lane per formant peak.
+// x = a*input + b*x1 + c*x2
+typedef struct {
+	double a[N_KERNEL_PEAKS];
+	double b[N_KERNEL_PEAKS];
+	double c[N_KERNEL_PEAKS];
+	double x1[N_KERNEL_PEAKS];
+	double x2[N_KERNEL_PEAKS];
+} RESONATOR_BANK;
+
+typedef struct {
+	const char *name;
+
+	// Sum harmspect[h] * sin(h * waveph) for h = 1 to maxh. The harmonics
+	// above h_switch_sign are subtracted instead.
+	int (*sine_waves)(unsigned short waveph, int h_switch_sign, int maxh, const int *harmspect);
+
+	// Filter the input through the resonators of peaks 1 to N_KERNEL_PEAKS-1
+	// which have some breath, and return the sum of int(output * amp[peak]).
+	// The other resonators are left untouched.
+	int (*resonators)(RESONATOR_BANK *bank, const int *breath, const int *amp, double input);
+} WAVEGEN_KERNELS;
+
+enum {
+	WAVEGEN_KERNEL_AUTO = 0,   // the fastest one this CPU supports, or $ESPEAK_WAVEGEN_KERNEL
+	WAVEGEN_KERNEL_SCALAR,
+	WAVEGEN_KERNEL_SSE41,
+	WAVEGEN_KERNEL_AVX2,
+	WAVEGEN_KERNEL_NEON,
+	N_WAVEGEN_KERNELS
+};
+
+// Returns NULL if the kernel is not compiled in or the CPU lacks it.
+const WAVEGEN_KERNELS *GetWavegenKernels(int kernel);
+
+// Used by Wavegen() in the calling thread. Returns 0 if the kernel is
+// not available, and the current one is kept.
+int SelectWavegenKernels(int kernel);
@@ -0,0 +1,294 @@
+#include "StdAfx.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "speak_lib.h"
+#include "speech.h"
+#include "wordcache.h"
+
+
+typedef struct {
+	WORD_CACHE_KEY key;
+	WORD_CACHE_VALUE value;
+	unsigned int hash;
+	int hash_next;      // next entry in the bucket, or -1
+	int newer;          // LRU list, or -1
+	int older;
+} WORD_CACHE_ENTRY;
+
+typedef struct {
+	int size;
+	int n_entries;
+	unsigned int hash_mask;
+	int *buckets;
+	WORD_CACHE_ENTRY *entries;
+	int newest;         // -1 if empty
+	int oldest;
+} WORD_CACHE;
+
+static ESPEAK_TLS WORD_CACHE *cache = NULL;
+static ESPEAK_TLS int cache_size = N_WORD_CACHE_DEFAULT;
+static ESPEAK_TLS WORD_CACHE_STATS cache_stats;
+static ESPEAK_TLS int cache_generation = 0;
+
+
+
+static unsigned int HashKey(const WORD_CACHE_KEY *key)
+{//===================================================
+// FNV-1a. The keys are cleared before they are filled in, so the padding
+// and the bytes after the word are zero.
+	const unsigned char *p = (const unsigned char *)key;
+	unsigned int hash = 2166136261u;
+	unsigned int ix;
+
+	for(ix=0; ix<sizeof(WORD_CACHE_KEY); ix++)
+	{
+		hash ^= p[ix];
+		hash *= 16777619u;
+	}
+	return(hash);
+}
+
+
+static WORD_CACHE *AllocWordCache(int size)
+{//========================================
+	WORD_CACHE *c;
+	unsigned int n_buckets = 1;
+	unsigned int ix;
+
+	while(n_buckets < (unsigned int)size)
+		n_buckets <<= 1;
+
+	if((c = (WORD_CACHE *)Alloc(sizeof(WORD_CACHE))) == NULL)
+		return(NULL);
+	c->buckets = (int *)Alloc(n_buckets * sizeof(int));
+	c->entries = (WORD_CACHE_ENTRY *)Alloc(size * sizeof(WORD_CACHE_ENTRY));
+	if((c->buckets == NULL) || (c->entries == NULL))
+	{
+		Free(c->buckets);
+		Free(c->entries);
+		Free(c);
+		return(NULL);
+	}
+
+	c->size = size;
+	c->n_entries = 0;
+	c->hash_mask = n_buckets - 1;
+	c->newest = -1;
+	c->oldest = -1;
+	for(ix=0; ix<n_buckets; ix++)
+		c->buckets[ix] = -1;
+	return(c);
+}
+
+
+static void Unlink(WORD_CACHE *c, int ix)
+{//======================================
+	WORD_CACHE_ENTRY *e = &c->entries[ix];
+
+	if(e->newer >= 0)
+		c->entries[e->newer].older = e->older;
+	else
+		c->newest = e->older;
+
+	if(e->older >= 0)
+		c->entries[e->older].newer = e->newer;
+	else
+		c->oldest = e->newer;
+}
+
+
+static void MakeNewest(WORD_CACHE *c, int ix)
+{//==========================================
+	WORD_CACHE_ENTRY *e = &c->entries[ix];
+
+	e->newer = -1;
+	e->older = c->newest;
+	if(c->newest >= 0)
+		c->entries[c->newest].newer = ix;
+	c->newest = ix;
+	if(c->oldest < 0)
+		c->oldest = ix;
+}
+
+
+static void RemoveFromBucket(WORD_CACHE *c, int ix)
+{//================================================
+	int *p = &c->buckets[c->entries[ix].hash & c->hash_mask];
+
+	while(*p != ix)
+		p = &c->entries[*p].hash_next;
+	*p = c->entries[ix].hash_next;
+}
+
+
+static int FindEntry(const WORD_CACHE_KEY *key, unsigned int hash)
+{//===============================================================
+	int ix;
+	WORD_CACHE_ENTRY *e;
+
+	if(cache == NULL)
+		return(-1);
+
+	for(ix = cache->buckets[hash & cache->hash_mask]; ix >= 0; ix = e->hash_next)
+	{
+		e = &cache->entries[ix];
+		if((e->hash == hash) && (memcmp(&e->key, key, sizeof(WORD_CACHE_KEY)) == 0))
+			return(ix);
+	}
+	return(-1);
+}
+
+
+int WordCacheEnabled(void)
+{//=======================
+	return(cache_size > 0);
+}
+
+
+int WordCacheLookup(const WORD_CACHE_KEY *key, WORD_CACHE_VALUE *value)
+{//====================================================================
+// Returns 1 and fills in value if the key is in the cache
+	int ix;
+
+	if((ix = FindEntry(key, HashKey(key))) < 0)
+		return(0);
+
+	if(cache->newest != ix)
+	{
+		Unlink(cache, ix);
+		MakeNewest(cache, ix);
+	}
+	memcpy(value, &cache->entries[ix].value, sizeof(WORD_CACHE_VALUE));
+	return(1);
+}
+
+
+void WordCacheAdd(const WORD_CACHE_KEY *key, const WORD_CACHE_VALUE *value)
+{//========================================================================
+// Adds the key, or replaces its value
+	int ix;
+	unsigned int hash;
+	unsigned int bucket;
+	WORD_CACHE_ENTRY *e;
+
+	if(cache_size <= 0)
+		return;
+
+	if(cache == NULL)
+	{
+		if((cache = AllocWordCache(cache_size)) == NULL)
+			return;
+	}
+
+	hash = HashKey(key);
+	if((ix = FindEntry(key, hash)) >= 0)
+	{
+		memcpy(&cache->entries[ix].value, value, sizeof(WORD_CACHE_VALUE));
+		if(cache->newest != ix)
+		{
+			Unlink(cache, ix);
+			MakeNewest(cache, ix);
+		}
+		return;
+	}
+
+	if(cache->n_entries < cache->size)
+	{
+		ix = cache->n_entries++;
+	}
+	else
+	{
+		// reuse the least recently used entry
+		ix = cache->oldest;
+		Unlink(cache, ix);
+		RemoveFromBucket(cache, ix);
+		cache_stats.evictions++;
+	}
+
+	e = &cache->entries[ix];
+	memcpy(&e->key, key, sizeof(WORD_CACHE_KEY));
+	memcpy(&e->value, value, sizeof(WORD_CACHE_VALUE));
+	e->hash = hash;
+	bucket = hash & cache->hash_mask;
+	e->hash_next = cache->buckets[bucket];
+	cache->buckets[bucket] = ix;
+	MakeNewest(cache, ix);
+}
+
+
+void WordCacheCount(int type)
+{//==========================
+	switch(type)
+	{
+	case WORD_CACHE_HIT:
+		cache_stats.hits++;
+		break;
+	case WORD_CACHE_MISS:
+		cache_stats.misses++;
+		break;
+	case WORD_CACHE_BYPASS:
+		cache_stats.bypassed++;
+		break;
+	}
+}
+
+
+void FreeWordCache(void)
+{//=====================
+	if(cache != NULL)
+	{
+		Free(cache->buckets);
+		Free(cache->entries);
+		Free(cache);
+		cache = NULL;
+	}
+}
+
+
+void WordCacheClear(void)
+{//======================
+// The dictionary or the translator has changed
+	unsigned int ix;
+
+	cache_generation++;
+	if(cache != NULL)
+	{
+		cache->n_entries = 0;
+		cache->newest = -1;
+		cache->oldest = -1;
+		for(ix=0; ix<=cache->hash_mask; ix++)
+			cache->buckets[ix] = -1;
+	}
+}
+
+
+int WordCacheGeneration(void)
+{//==========================
+// Changes whenever the cache is cleared, so that a word which reloads the
+// dictionary or switches the translator is not added afterwards
+	return(cache_generation);
+}
+
+
+void SetWordCacheSize(int entries)
+{//===============================
+	FreeWordCache();
+	cache_generation++;
+	cache_size = entries;
+}
+
+
+void GetWordCacheStats(WORD_CACHE_STATS *stats)
+{//============================================
+	memcpy(stats, &cache_stats, sizeof(WORD_CACHE_STATS));
+	stats->size = cache_size;
+	stats->entries = (cache == NULL) ? 0 : cache->n_entries;
+}
+
+
+void ResetWordCacheStats(void)
+{//===========================
+	memset(&cache_stats, 0, sizeof(cache_stats));
+}
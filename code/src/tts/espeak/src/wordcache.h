@@ -0,0 +1,80 @@
+// LRU cache of TranslateWord() results.
+//
+// Book text repeats the same words all the time, and each of them goes
+// through the dictionary lookups and the rules. The key holds the word
+// and all the translator state which TranslateWord() reads, the value
+// holds its result and the state it leaves behind. TranslateWord() in
+// translate.cpp decides which words can be cached.
+//
+// Some words depend on the text around them, through multi-word dictionary
+// entries or rules which look at the next or the previous word. For those
+// the entry of the plain key only says how much of that text was looked
+// at, and the result is cached under a key which also holds that text.
+
+#define N_WORD_CACHE_WORD      32    // longer words are not cached
+#define N_WORD_CACHE_CONTEXT   16    // text before and after the word
+#define N_WORD_CACHE_PHONEMES  64
+#define N_WORD_CACHE_DEFAULT   4096  // entries, about 1M
+
+typedef struct {
+	const void *tr;
+	int wflags;
+	int wmark;
+	int next_pause;
+	int dict_condition;
+	int tone_flags;         // option_tone_flags
+	int phoneme_variants;   // option_phoneme_variants
+	signed char expect_verb;
+	signed char expect_verb_s;
+	signed char expect_past;
+	signed char expect_noun;
+	signed char prev_last_stress;
+	signed char lower_clause;    // short capitalised words are spelled in a lower case clause
+	signed char clause_end;      // offset of the end of the clause, up to the space after the word
+	signed char context_before;  // number of bytes in 'before' and 'after'
+	signed char context_after;
+	char word[N_WORD_CACHE_WORD];
+	char before[N_WORD_CACHE_CONTEXT];  // backwards, from the space before the word
+	char after[N_WORD_CACHE_CONTEXT];   // from the space after the word
+} WORD_CACHE_KEY;
+
+typedef struct {
+	int flags;              // returned by TranslateWord()
+	signed char expect_verb;
+	signed char expect_verb_s;
+	signed char expect_past;
+	signed char expect_noun;
+	signed char prev_last_stress;
+	signed char context_before;  // not zero: look again, with this much context
+	signed char context_after;
+	char phonemes[N_WORD_CACHE_PHONEMES];
+	char word[N_WORD_CACHE_WORD];     // TranslateWord() removes suffixes from the text
+} WORD_CACHE_VALUE;
+
+typedef struct {
+	int size;               // max entries, 0 if the cache is disabled
+	int entries;
+	unsigned int hits;
+	unsigned int misses;
+	unsigned int bypassed;  // words which can not be cached
+	unsigned int evictions;
+} WORD_CACHE_STATS;
+
+enum {
+	WORD_CACHE_HIT,
+	WORD_CACHE_MISS,
+	WORD_CACHE_BYPASS
+};
+
+int WordCacheEnabled(void);
+int WordCacheLookup(const WORD_CACHE_KEY *key, WORD_CACHE_VALUE *value);
+void WordCacheAdd(const WORD_CACHE_KEY *key, const WORD_CACHE_VALUE *value);
+void WordCacheCount(int type);
+void WordCacheClear(void);
+int WordCacheGeneration(void);
+void FreeWordCache(void);
+
+// The cache belongs to the calling thread, like the rest of the eSpeak state.
+void SetWordCacheSize(int entries);
+void GetWordCacheStats(WORD_CACHE_STATS *stats);
+void ResetWordCacheStats(void);
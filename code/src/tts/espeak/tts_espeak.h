@@ -1,9 +1,10 @@
 #ifndef NABOO_LIB_TTS_AISOUND_H_
 #define NABOO_LIB_TTS_AISOUND_H_
 
+#include "onyx/base/base.h"
 #include "../tts_interface.h"
-#include "src/speak_lib.h"
-#include "bs2b/bs2b.h"
+#include "espeak_context.h"
+#include "onyx/sound/pcm_processor.h"
 
 namespace tts
 {
@@ -18,21 +19,19 @@ public:
 public:
     virtual bool initialize(const QLocale & locale, Sound & sound);
     virtual bool synthText(const QString & text);
-    virtual void stop() { stop_ = true; }
+    virtual void stop();
+
+    bool wordCacheStats(WORD_CACHE_STATS & stats, bool reset = false);
 
 private:
     bool create(const QLocale & locale);
     bool destroy();
-    bool isStopped() { return stop_; }
-    ulong process(char *in_data, const ulong size, char **out_data);
-    static int synthCallback(short *wav, int numsamples, espeak_EVENT *events);
 
 private:
     QFile file_;
-    bool initialized_;
-    bool stop_;
+    scoped_ptr<ESpeakContext> context_;
     QByteArray data_;
-    t_bs2bdp bs2b_handler_;
+    PcmProcessor processor_;    ///< eSpeak mono to the stereo of the device.
 };
 
 }
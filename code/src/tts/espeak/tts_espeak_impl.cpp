@@ -7,41 +7,14 @@ static const int BPS = 16;
 static const int CHANNELS = 2;
 static const int FREQ = 44100;
 
-/// Callback function.
-int ESpeakImpl::synthCallback(short *wav, int numsamples, espeak_EVENT *events)
-{
-    char * d = reinterpret_cast<char *>(wav);
-    ESpeakImpl *object = static_cast<ESpeakImpl *>(events->user_data);
-    if (object)
-    {
-        // Convert mono to stereo. The espeak only generates mono data.
-        for(int i = 0; i < numsamples; ++i)
-        {
-            QByteArray x(d, 2);
-            object->data_.append(x);
-            object->data_.append(x);
-            d += 2;
-        }
-    }
-    return 0;
-}
-
-
 ESpeakImpl::ESpeakImpl()
 {
-    initialized_ = false;
-    stop_ = false;
-
-    // Use bs2b library to convert between different sample rate.
-    bs2b_handler_ = bs2b_open();
-    bs2b_set_level(bs2b_handler_, BS2B_DEFAULT_CLEVEL);
-    bs2b_set_srate(bs2b_handler_, FREQ);
+    processor_.setInput(FREQ, 1, BPS);
+    processor_.setOutput(FREQ, CHANNELS);
 }
 
 ESpeakImpl::~ESpeakImpl()
 {
-    bs2b_clear(bs2b_handler_);
-
     destroy();
 }
 
@@ -55,31 +28,47 @@ bool ESpeakImpl::initialize(const QLocale & locale, Sound & sound)
     return create(locale);
 }
 
-ulong ESpeakImpl::process(char *in_data, const ulong size, char **out_data)
-{
-    memcpy(*out_data, in_data, size);
-    uint samples = size / (BPS / 8) / 2;
-    int16_t * data = reinterpret_cast<int16_t *>(*out_data);
-    bs2b_cross_feed_s16le(bs2b_handler_, data, samples);
-    return size;
-}
-
 bool ESpeakImpl::synthText(const QString & text)
 {
-    stop_ = false;
     data_.clear();
+    if (!context_)
+    {
+        return false;
+    }
 
-    QByteArray d = text.toUtf8();
-    int synth_flags = espeakPHONEMES | espeakENDPAUSE | espeakCHARS_UTF8;
-    espeak_Synth(d.constData(), d.size() + 1, 0, POS_CHARACTER, 0, synth_flags, 0, this);
+    QByteArray mono;
+    bool ok = context_->synthesize(text, mono);
 
-    emit synthDone(true, data_);
-    return true;
+    // The espeak only generates mono data. Every text starts afresh.
+    processor_.reset();
+    processor_.process(mono.constData(), mono.size(), data_);
+
+    emit synthDone(ok, data_);
+    return ok;
+}
+
+void ESpeakImpl::stop()
+{
+    if (context_)
+    {
+        context_->stop();
+    }
+}
+
+/// How well the word translation cache of the synthesizer does, see
+/// ESpeakContext::wordCacheStats().
+bool ESpeakImpl::wordCacheStats(WORD_CACHE_STATS & stats, bool reset)
+{
+    if (!context_)
+    {
+        return false;
+    }
+    return context_->wordCacheStats(stats, reset);
 }
 
 bool ESpeakImpl::create(const QLocale & locale)
 {
-    if (initialized_)
+    if (context_)
     {
         return true;
     }
@@ -92,17 +81,22 @@ bool ESpeakImpl::create(const QLocale & locale)
     }
 
     qDebug("Resource path %s", qPrintable(dir.absolutePath()));
-    espeak_Initialize(AUDIO_OUTPUT_SYNCHRONOUS, 0, dir.absolutePath().toLocal8Bit().constData(), 0);
+    context_.reset(new ESpeakContext(dir.absolutePath()));
+    if (!context_->isValid())
+    {
+        context_.reset(0);
+        return false;
+    }
 
     // Basically, we don't need to the following settings now.
-    espeak_SetParameter(espeakRATE, 130, 0);
-    espeak_SetParameter(espeakVOLUME, 100, 0);
-    espeak_SetParameter(espeakPITCH, 50, 0);
-    espeak_SetParameter(espeakRANGE, 50, 0);
-    espeak_SetParameter(espeakCAPITALS, 0,0);
-    espeak_SetParameter(espeakPUNCTUATION, espeakPUNCT_SOME,0);
-    espeak_SetParameter(espeakWORDGAP, 0,0);
-    espeak_SetVoiceByName("+f1");
+    context_->setParameter(espeakRATE, 130);
+    context_->setParameter(espeakVOLUME, 100);
+    context_->setParameter(espeakPITCH, 50);
+    context_->setParameter(espeakRANGE, 50);
+    context_->setParameter(espeakCAPITALS, 0);
+    context_->setParameter(espeakPUNCTUATION, espeakPUNCT_SOME);
+    context_->setParameter(espeakWORDGAP, 0);
+    context_->setVoiceByName("+f1");
 
     /*
     espeak_SetParameter(espeakLINELENGTH,0,0);
@@ -110,21 +104,18 @@ bool ESpeakImpl::create(const QLocale & locale)
     espeak_SetPhonemeTrace(option_phonemes,f_phonemes_out);
     */
 
-    espeak_SetSynthCallback(synthCallback);
-    initialized_ = true;
     return true;
 }
 
 bool ESpeakImpl::destroy()
 {
-    if (!initialized_)
+    if (!context_)
     {
         return false;
     }
 
-    espeak_Terminate();
-
-    initialized_ = false;
+    // Terminates eSpeak in the context thread.
+    context_.reset(0);
     return true;
 }
 
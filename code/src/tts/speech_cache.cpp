@@ -0,0 +1,318 @@
+#include <utime.h>
+
+#include "onyx/tts/speech_cache.h"
+
+namespace tts
+{
+
+static const quint32 MAGIC = 0x4f545343;     // "OTSC"
+static const quint32 VERSION = 1;
+
+/// Speech hardly compresses better at higher levels, and the file is
+/// written by the synthesis thread while the previous chunk plays.
+static const int COMPRESSION_LEVEL = 1;
+
+static const char *SUFFIX = ".pcm";
+static const char *TEMP_SUFFIX = ".tmp";
+
+SpeechCache::SpeechCache(const QString & path, qint64 capacity)
+    : path_(path)
+    , capacity_(capacity)
+    , used_(0)
+    , clock_(0)
+    , hits_(0)
+    , misses_(0)
+    , evictions_(0)
+{
+    QDir().mkpath(path_);
+    load();
+    evictUntil(capacity_);
+}
+
+SpeechCache::~SpeechCache()
+{
+}
+
+QString SpeechCache::defaultPath()
+{
+    return QDir::home().filePath("tts_cache");
+}
+
+QByteArray SpeechCache::key(const QString & engine, const QString & speaker,
+                            int speed, int style, const QString & text)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(engine.toUtf8());
+    hash.addData("\n", 1);
+    hash.addData(speaker.toUtf8());
+    hash.addData(QString("\n%1\n%2\n").arg(speed).arg(style).toUtf8());
+    hash.addData(text.simplified().toUtf8());
+    return hash.result().toHex();
+}
+
+/// Change the capacity in bytes of compressed data. Files are evicted at
+/// once if needed.
+void SpeechCache::setCapacity(qint64 bytes)
+{
+    QMutexLocker locker(&mutex_);
+    capacity_ = bytes;
+    evictUntil(capacity_);
+}
+
+qint64 SpeechCache::capacity() const
+{
+    QMutexLocker locker(&mutex_);
+    return capacity_;
+}
+
+qint64 SpeechCache::usedBytes() const
+{
+    QMutexLocker locker(&mutex_);
+    return used_;
+}
+
+int SpeechCache::count() const
+{
+    QMutexLocker locker(&mutex_);
+    return items_.size();
+}
+
+/// Store the PCM, replacing the one with the same key. Returns false if
+/// it can not be written or is larger than the cache.
+bool SpeechCache::insert(const QByteArray & key, const QByteArray & pcm)
+{
+    if (key.isEmpty() || pcm.isEmpty())
+    {
+        return false;
+    }
+
+    QByteArray data;
+    {
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream << MAGIC << VERSION << qChecksum(pcm.constData(), pcm.size())
+               << qCompress(pcm, COMPRESSION_LEVEL);
+    }
+
+    QMutexLocker locker(&mutex_);
+    if (data.size() > capacity_)
+    {
+        return false;
+    }
+
+    // Written aside and renamed, so a crash never leaves half a file.
+    const QString path = filePath(key);
+    QFile file(path + TEMP_SUFFIX);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size())
+    {
+        file.remove();
+        return false;
+    }
+    file.close();
+
+    removeItem(key);
+    if (!file.rename(path))
+    {
+        file.remove();
+        return false;
+    }
+
+    Item item;
+    item.bytes = data.size();
+    item.last_access = ++clock_;
+    items_.insert(key, item);
+    used_ += item.bytes;
+    evictUntil(capacity_);
+    return true;
+}
+
+bool SpeechCache::contains(const QByteArray & key) const
+{
+    QMutexLocker locker(&mutex_);
+    return items_.contains(key);
+}
+
+/// Read the PCM of key. Counts a hit or a miss. A file that can not be
+/// read back is dropped. The file is read without the lock, so that the
+/// statistics and insert() do not wait for it.
+bool SpeechCache::find(const QByteArray & key, QByteArray & pcm)
+{
+    QString path;
+    unsigned int last_access = 0;
+    {
+        QMutexLocker locker(&mutex_);
+        Items::const_iterator it = items_.find(key);
+        if (it == items_.end())
+        {
+            ++misses_;
+            return false;
+        }
+        path = filePath(key);
+        last_access = it.value().last_access;
+    }
+
+    // A file replaced meanwhile is renamed over, the open one is still
+    // read entirely.
+    const bool ok = readFile(path, pcm);
+    if (ok)
+    {
+        // The file time keeps the order for the next run.
+        utime(QFile::encodeName(path).constData(), 0);
+    }
+
+    QMutexLocker locker(&mutex_);
+    Items::iterator it = items_.find(key);
+    if (!ok)
+    {
+        // Unless it has been replaced or removed meanwhile.
+        if (it != items_.end() && it.value().last_access == last_access)
+        {
+            qWarning("Drop broken speech cache file %s", qPrintable(path));
+            removeItem(key);
+        }
+        pcm.clear();
+        ++misses_;
+        return false;
+    }
+
+    if (it != items_.end())
+    {
+        it.value().last_access = ++clock_;
+    }
+    ++hits_;
+    return true;
+}
+
+void SpeechCache::remove(const QByteArray & key)
+{
+    QMutexLocker locker(&mutex_);
+    removeItem(key);
+}
+
+void SpeechCache::clear()
+{
+    QMutexLocker locker(&mutex_);
+    while (!items_.isEmpty())
+    {
+        const QByteArray key = items_.begin().key();
+        removeItem(key);
+    }
+}
+
+int SpeechCache::hits() const
+{
+    QMutexLocker locker(&mutex_);
+    return hits_;
+}
+
+int SpeechCache::misses() const
+{
+    QMutexLocker locker(&mutex_);
+    return misses_;
+}
+
+int SpeechCache::evictions() const
+{
+    QMutexLocker locker(&mutex_);
+    return evictions_;
+}
+
+double SpeechCache::hitRate() const
+{
+    QMutexLocker locker(&mutex_);
+    int total = hits_ + misses_;
+    return total > 0 ? static_cast<double>(hits_) / total : 0.0;
+}
+
+void SpeechCache::resetStatistics()
+{
+    QMutexLocker locker(&mutex_);
+    hits_ = 0;
+    misses_ = 0;
+    evictions_ = 0;
+}
+
+/// Index the files of the directory, oldest first. Leftovers of an
+/// interrupted insert are removed.
+void SpeechCache::load()
+{
+    QDir dir(path_);
+    dir.setSorting(QDir::Time | QDir::Reversed);
+    foreach(const QFileInfo & info, dir.entryInfoList(QDir::Files))
+    {
+        if (info.fileName().endsWith(TEMP_SUFFIX))
+        {
+            QFile::remove(info.absoluteFilePath());
+            continue;
+        }
+        if (!info.fileName().endsWith(SUFFIX))
+        {
+            continue;
+        }
+
+        Item item;
+        item.bytes = info.size();
+        item.last_access = ++clock_;
+        items_.insert(info.completeBaseName().toAscii(), item);
+        used_ += item.bytes;
+    }
+}
+
+/// Called with mutex_ locked.
+void SpeechCache::evictUntil(qint64 target)
+{
+    while (used_ > target && !items_.isEmpty())
+    {
+        Items::iterator victim = items_.begin();
+        for (Items::iterator it = items_.begin(); it != items_.end(); ++it)
+        {
+            if (it.value().last_access < victim.value().last_access)
+            {
+                victim = it;
+            }
+        }
+        const QByteArray key = victim.key();
+        removeItem(key);
+        ++evictions_;
+    }
+}
+
+/// Called with mutex_ locked.
+void SpeechCache::removeItem(const QByteArray & key)
+{
+    Items::iterator it = items_.find(key);
+    if (it != items_.end())
+    {
+        used_ -= it.value().bytes;
+        items_.erase(it);
+    }
+    QFile::remove(filePath(key));
+}
+
+/// Uncompress the PCM of a file written by insert() and verify it.
+bool SpeechCache::readFile(const QString & path, QByteArray & pcm)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    quint32 magic = 0, version = 0;
+    quint16 checksum = 0;
+    QByteArray compressed;
+    stream >> magic >> version >> checksum >> compressed;
+    if (stream.status() != QDataStream::Ok || magic != MAGIC || version != VERSION)
+    {
+        return false;
+    }
+    pcm = qUncompress(compressed);
+    return !pcm.isEmpty() && qChecksum(pcm.constData(), pcm.size()) == checksum;
+}
+
+QString SpeechCache::filePath(const QByteArray & key) const
+{
+    return QDir(path_).filePath(QString::fromAscii(key) + SUFFIX);
+}
+
+}   // namespace tts
@@ -30,15 +30,8 @@ void TTS::init(const QLocale & locale)
     {
         if(loadPreferPlugin(plugin))
         {
-            if (tts_impl_->initialize(locale, sound()))
+            if (initEngine(locale))
             {
-                connect(tts_impl_.get(), SIGNAL(synthDone(bool, QByteArray &)),
-                    this, SLOT(onSynthDone(bool, QByteArray &)));
-                connect(&AsyncPlayer::instance(), SIGNAL(playFinished(int)), this, SLOT(onPlayFinished(int)));
-                connect(&timer_, SIGNAL(timeout()), this, SLOT(onTimeout()));
-
-                setState(TTS_STOPPED);
-                setValid(TTS_VALID);
                 return;
             }
         }
@@ -47,17 +40,7 @@ void TTS::init(const QLocale & locale)
 
     if (loadPlugin())
     {
-        if (tts_impl_->initialize(locale, sound()))
-        {
-            connect(tts_impl_.get(), SIGNAL(synthDone(bool, QByteArray &)),
-                    this, SLOT(onSynthDone(bool, QByteArray &)));
-            connect(&AsyncPlayer::instance(), SIGNAL(playFinished(int)), this, SLOT(onPlayFinished(int)));
-            connect(&timer_, SIGNAL(timeout()), this, SLOT(onTimeout()));
-
-            setState(TTS_STOPPED);
-            setValid(TTS_VALID);
-        }
-        else
+        if (!initEngine(locale))
         {
             setValid(TTS_DATA_INVALID);
         }
@@ -68,13 +51,43 @@ void TTS::init(const QLocale & locale)
     }
 }
 
-/// Synthesis the text to speech. The data will be ready later.
+/// Initialize the loaded backend and stream its output.
+bool TTS::initEngine(const QLocale & locale)
+{
+    if (!tts_impl_->initialize(locale, sound()))
+    {
+        return false;
+    }
+
+    pipeline_.reset(new SpeechPipeline(*tts_impl_));
+    connect(pipeline_.get(), SIGNAL(finished()), this, SLOT(onSpeechFinished()));
+
+    // Passages read again are played from the disk. TTS_CACHE_SIZE is in
+    // MB, 0 disables the cache.
+    QByteArray size = qgetenv("TTS_CACHE_SIZE");
+    qint64 capacity = size.isEmpty() ? SpeechCache::DEFAULT_CAPACITY : size.toLongLong() * 1024 * 1024;
+    if (capacity > 0)
+    {
+        if (cache_.get() == 0)
+        {
+            cache_.reset(new SpeechCache(SpeechCache::defaultPath(), capacity));
+        }
+        pipeline_->setCache(cache_.get());
+    }
+
+    setState(TTS_STOPPED);
+    setValid(TTS_VALID);
+    return true;
+}
+
+/// Speak the text. The first clause is played as soon as it's
+/// synthesized, speakDone() is emitted after the last one.
 bool TTS::speak(const QString & text)
 {
     setState(TTS_PLAYING);
-    if (tts_impl_)
+    if (pipeline_)
     {
-        return tts_impl_->synthText(text);
+        return pipeline_->start(text, sound());
     }
     return false;
 }
@@ -107,7 +120,6 @@ bool TTS::toggle()
 bool TTS::stop()
 {
     setState(TTS_STOPPED);
-    data_.clear();
     return true;
 }
 
@@ -116,48 +128,6 @@ void TTS::changeVolume(int v, bool m)
     sound().setVolume(v);
 }
 
-/// Segment of sentence has been finished. But it does not mean that
-/// the whole input message has been finished.
-void TTS::onSynthDone(bool ok, QByteArray &data)
-{
-    qDebug("TTS::onSynthDone data length %d", data.length());
-    QApplication::processEvents();
-
-    // If stopped, just ignore the chunk.
-    if (state() == TTS_STOPPED)
-    {
-        data_.clear();
-        return;
-    }
-
-    data_.append(data);
-
-    // Send the data to async player. Before that, it's necessary to
-    // check the state.
-    if (state() == TTS_PLAYING)
-    {
-        onTimeout();
-        // timer_.stop();
-        // timer_.start(span_);
-    }
-}
-
-void TTS::onTimeout()
-{
-    /* Dump to file.
-    QFile file("dump.tts");
-    if (file.open(QIODevice::Append))
-    {
-        file.write(data_);
-        file.flush();
-        file.close();
-    }
-    */
-    qDebug("Send to play.");
-    AsyncPlayer::instance().play(sound(), data_);
-    data_.clear();
-}
-
 void TTS::setValid(TTS_Valid valid)
 {
     valid_ = valid;
@@ -169,24 +139,31 @@ void TTS::setState(TTS_State state)
     state_ = state;
     sound().enable(state == TTS_PLAYING);
 
-    if (state == TTS_STOPPED)
+    // Disabling the device above interrupts the current slice, the
+    // pipeline returns once the device is released.
+    if (state == TTS_STOPPED && pipeline_)
     {
-        tts_impl_->stop();
+        pipeline_->stop();
     }
 
-    if (state == TTS_PAUSED)
+    if (state == TTS_PAUSED && pipeline_)
     {
         tts_impl_->pause();
+        pipeline_->pause();
     }
 
     if (state == TTS_STOPPED || state == TTS_PAUSED)
     {
-        AsyncPlayer::instance().waitForDone();
         sound_.reset(0);
     }
 
     if (state == TTS_PLAYING)
     {
+        if (pipeline_ && pipeline_->isPaused())
+        {
+            pipeline_->resume(sound());
+        }
+
         if (idle_count_ <= 0)
         {
             sys::SysStatus::instance().enableIdle(false);
@@ -203,7 +180,7 @@ void TTS::setState(TTS_State state)
     }
 }
 
-void TTS::onPlayFinished(int)
+void TTS::onSpeechFinished()
 {
     if (isPlaying())
     {
@@ -222,6 +199,7 @@ bool TTS::speakers(QStringList & list)
 {
     if (tts_impl_)
     {
+        QMutexLocker locker(engineMutex());
         return tts_impl_->speakers(list);
     }
     return false;
@@ -229,18 +207,18 @@ bool TTS::speakers(QStringList & list)
 
 bool TTS::currentSpeaker(QString & speaker)
 {
-    if (tts_impl_)
+    if (pipeline_)
     {
-        return tts_impl_->currentSpeaker(speaker);
+        return pipeline_->currentSpeaker(speaker);
     }
     return false;
 }
 
 bool TTS::setSpeaker(const QString & speaker)
 {
-    if (tts_impl_)
+    if (pipeline_)
     {
-        return tts_impl_->setSpeaker(speaker);
+        return pipeline_->setSpeaker(speaker);
     }
     return false;
 }
@@ -249,6 +227,7 @@ bool TTS::speeds(QVector<int> & list)
 {
     if (tts_impl_)
     {
+        QMutexLocker locker(engineMutex());
         return tts_impl_->speeds(list);
     }
     return false;
@@ -256,9 +235,9 @@ bool TTS::speeds(QVector<int> & list)
 
 bool TTS::currentSpeed(int & speed)
 {
-    if (tts_impl_)
+    if (pipeline_)
     {
-        return tts_impl_->currentSpeed(speed);
+        return pipeline_->currentSpeed(speed);
     }
     return false;
 }
@@ -266,9 +245,9 @@ bool TTS::currentSpeed(int & speed)
 
 bool TTS::setSpeed(int speed)
 {
-    if (tts_impl_)
+    if (pipeline_)
     {
-        return tts_impl_->setSpeed(speed);
+        return pipeline_->setSpeed(speed);
     }
     return false;
 }
@@ -277,6 +256,7 @@ bool TTS::styles(QVector<int> & styles)
 {
     if (tts_impl_)
     {
+        QMutexLocker locker(engineMutex());
         return tts_impl_->styles(styles);
     }
     return false;
@@ -284,22 +264,28 @@ bool TTS::styles(QVector<int> & styles)
 
 bool TTS::currentStyle(int & style)
 {
-    if (tts_impl_)
+    if (pipeline_)
     {
-        return tts_impl_->currentStyle(style);
+        return pipeline_->currentStyle(style);
     }
     return false;
 }
 
 bool TTS::setStyle(int style)
 {
-    if (tts_impl_)
+    if (pipeline_)
     {
-        return tts_impl_->setStyle(style);
+        return pipeline_->setStyle(style);
     }
     return false;
 }
 
+/// The synthesis thread must not use the engine while it's changed.
+QMutex * TTS::engineMutex()
+{
+    return pipeline_ ? &pipeline_->engineMutex() : 0;
+}
+
 Sound & TTS::sound()
 {
     if (!sound_)
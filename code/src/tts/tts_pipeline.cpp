@@ -0,0 +1,596 @@
+#include <limits.h>
+
+#include "onyx/tts/tts_pipeline.h"
+
+namespace tts
+{
+
+/// Clauses shorter than this are merged with the next one, so that the
+/// engine is not restarted for every "Yes," or "Mr.".
+static const int MIN_CLAUSE = 24;
+
+/// Long clauses are cut at the next space after this length.
+static const int MAX_CLAUSE = 320;
+
+/// Synthesized chunks allowed to wait for the device.
+static const int QUEUE_LIMIT = 2;
+
+/// Bytes written to the device at a time. About 46ms of 16 bits stereo
+/// at 44.1KHz, which bounds the pause and stop latency.
+static const int SLICE_BYTES = 8 * 1024;
+
+class PipelineThread : public QThread
+{
+public:
+    typedef void (SpeechPipeline::*Loop)();
+
+    PipelineThread(SpeechPipeline *pipeline, Loop loop)
+        : pipeline_(pipeline)
+        , loop_(loop)
+    {
+    }
+
+protected:
+    void run() { (pipeline_->*loop_)(); }
+
+private:
+    SpeechPipeline *pipeline_;
+    Loop loop_;
+};
+
+static bool isClauseEnd(const QChar & ch)
+{
+    switch (ch.unicode())
+    {
+    case '.': case '!': case '?': case ';': case ':': case ',':
+    case 0x3002: case 0xff01: case 0xff1f: case 0xff1b:    // CJK . ! ? ;
+    case 0xff1a: case 0xff0c: case 0x3001:                  // CJK : , ,
+        return true;
+    default:
+        return false;
+    }
+}
+
+/// Split the text at clause boundaries. A latin punctuation mark ends a
+/// clause only when followed by a space, so "3.14" and "e.g." inside a
+/// word are kept. Line breaks always end a clause.
+QStringList splitClauses(const QString & text, int min_length, int max_length)
+{
+    QStringList result;
+    QString current;
+    for (int i = 0; i < text.size(); ++i)
+    {
+        const QChar ch = text.at(i);
+        current.append(ch);
+
+        bool boundary = false;
+        if (ch == QLatin1Char('\n'))
+        {
+            boundary = true;
+        }
+        else if (isClauseEnd(ch))
+        {
+            boundary = (ch.unicode() >= 0x3000 ||
+                        i + 1 >= text.size() ||
+                        text.at(i + 1).isSpace());
+        }
+        else if (current.size() >= max_length)
+        {
+            // Text without punctuation, cut at a space or give up.
+            boundary = ch.isSpace() || current.size() >= max_length * 2;
+        }
+
+        if (boundary && current.trimmed().size() >= min_length)
+        {
+            result.push_back(current.trimmed());
+            current.clear();
+        }
+    }
+
+    current = current.trimmed();
+    if (!current.isEmpty())
+    {
+        result.push_back(current);
+    }
+    return result;
+}
+
+SpeechPipeline::SpeechPipeline(TTSInterface & engine, QObject *parent)
+    : QObject(parent)
+    , engine_(engine)
+    , play_offset_(0)
+    , sound_(0)
+    , cache_(0)
+    , generation_(0)
+    , streaming_(true)
+    , queue_limit_(QUEUE_LIMIT)
+    , active_(false)
+    , paused_(false)
+    , synthesizing_(false)
+    , playing_(false)
+    , quit_(false)
+    , pending_(0)
+    , pending_speed_(0)
+    , pending_style_(0)
+    , first_audio_(-1)
+    , chunks_(0)
+    , played_(0)
+{
+    // Called in the synthesis thread, inside synthText().
+    connect(&engine_, SIGNAL(synthDone(bool, QByteArray &)),
+            this, SLOT(onSynthDone(bool, QByteArray &)), Qt::DirectConnection);
+
+    synth_thread_.reset(new PipelineThread(this, &SpeechPipeline::synthLoop));
+    play_thread_.reset(new PipelineThread(this, &SpeechPipeline::playLoop));
+    synth_thread_->start();
+    play_thread_->start();
+}
+
+SpeechPipeline::~SpeechPipeline()
+{
+    stop();
+    {
+        QMutexLocker locker(&mutex_);
+        quit_ = true;
+        has_text_.wakeAll();
+        has_audio_.wakeAll();
+    }
+    synth_thread_->wait();
+    play_thread_->wait();
+}
+
+/// When streaming is disabled, the whole text is synthesized before it's
+/// played. Engines that can not be restarted cheaply may need it.
+void SpeechPipeline::setStreaming(bool streaming)
+{
+    QMutexLocker locker(&mutex_);
+    streaming_ = streaming;
+}
+
+bool SpeechPipeline::isStreaming() const
+{
+    QMutexLocker locker(&mutex_);
+    return streaming_;
+}
+
+void SpeechPipeline::setQueueLimit(int chunks)
+{
+    QMutexLocker locker(&mutex_);
+    queue_limit_ = qMax(chunks, 1);
+    has_text_.wakeAll();
+}
+
+void SpeechPipeline::setCache(SpeechCache *cache)
+{
+    QMutexLocker locker(&mutex_);
+    cache_ = cache;
+}
+
+SpeechCache * SpeechPipeline::cache() const
+{
+    QMutexLocker locker(&mutex_);
+    return cache_;
+}
+
+/// Speak the text on the sound device. Text not spoken yet is dropped.
+bool SpeechPipeline::start(const QString & text, Sound & sound)
+{
+    stop();
+
+    QStringList chunks;
+    if (isStreaming())
+    {
+        chunks = splitClauses(text, MIN_CLAUSE, MAX_CLAUSE);
+    }
+    else if (!text.trimmed().isEmpty())
+    {
+        chunks.push_back(text);
+    }
+    if (chunks.isEmpty())
+    {
+        return false;
+    }
+
+    QMutexLocker locker(&mutex_);
+    foreach(const QString & chunk, chunks)
+    {
+        texts_.enqueue(chunk);
+    }
+    sound_ = &sound;
+    active_ = true;
+    paused_ = false;
+    first_audio_ = -1;
+    chunks_ = chunks.size();
+    played_ = 0;
+    clock_.start();
+    has_text_.wakeAll();
+    return true;
+}
+
+/// Stop feeding the device. Returns when the playback thread does not
+/// use the device any more, so the caller can close it. Synthesis goes
+/// on until the queue is full.
+void SpeechPipeline::pause()
+{
+    QMutexLocker locker(&mutex_);
+    paused_ = true;
+    while (playing_)
+    {
+        idle_.wait(&mutex_);
+    }
+}
+
+/// Continue with the device, which may have been reopened.
+void SpeechPipeline::resume(Sound & sound)
+{
+    QMutexLocker locker(&mutex_);
+    sound_ = &sound;
+    paused_ = false;
+    has_audio_.wakeAll();
+}
+
+/// Drop all text and audio. Returns when the device is released.
+void SpeechPipeline::stop()
+{
+    {
+        // Before the engine is interrupted, so that a chunk cut short is
+        // never queued nor cached.
+        QMutexLocker locker(&mutex_);
+        ++generation_;
+        texts_.clear();
+        pcm_.clear();
+        play_offset_ = 0;
+        active_ = false;
+        paused_ = false;
+        has_text_.wakeAll();
+    }
+    engine_.stop();
+
+    QMutexLocker locker(&mutex_);
+    while (playing_)
+    {
+        idle_.wait(&mutex_);
+    }
+    idle_.wakeAll();
+}
+
+bool SpeechPipeline::isActive() const
+{
+    QMutexLocker locker(&mutex_);
+    return active_;
+}
+
+bool SpeechPipeline::isPaused() const
+{
+    QMutexLocker locker(&mutex_);
+    return paused_;
+}
+
+/// Wait until the text has been played or stopped.
+bool SpeechPipeline::waitForDone(int timeout)
+{
+    QMutexLocker locker(&mutex_);
+    QTime t;
+    t.start();
+    while (active_)
+    {
+        unsigned long remain = ULONG_MAX;
+        if (timeout >= 0)
+        {
+            if (t.elapsed() >= timeout)
+            {
+                return false;
+            }
+            remain = timeout - t.elapsed();
+        }
+        idle_.wait(&mutex_, remain);
+    }
+    return true;
+}
+
+/// Milliseconds between start() and the first PCM written to the device,
+/// or -1 if nothing has been played yet.
+int SpeechPipeline::firstAudioLatency() const
+{
+    QMutexLocker locker(&mutex_);
+    return first_audio_;
+}
+
+int SpeechPipeline::chunkCount() const
+{
+    QMutexLocker locker(&mutex_);
+    return chunks_;
+}
+
+int SpeechPipeline::playedChunks() const
+{
+    QMutexLocker locker(&mutex_);
+    return played_;
+}
+
+/// A setting changed while a chunk is synthesized is returned by the
+/// getter before the engine uses it.
+bool SpeechPipeline::currentSpeaker(QString & speaker)
+{
+    {
+        QMutexLocker locker(&mutex_);
+        if (pending_ & SPEAKER)
+        {
+            speaker = pending_speaker_;
+            return true;
+        }
+    }
+    QMutexLocker engine(&engine_mutex_);
+    return engine_.currentSpeaker(speaker);
+}
+
+/// The engine is changed at once when it's idle. Otherwise the setting
+/// is applied before the next chunk, the caller does not wait for the
+/// chunk being synthesized.
+bool SpeechPipeline::setSpeaker(const QString & speaker)
+{
+    if (engine_mutex_.tryLock())
+    {
+        {
+            QMutexLocker locker(&mutex_);
+            pending_ &= ~SPEAKER;
+        }
+        bool ok = engine_.setSpeaker(speaker);
+        engine_mutex_.unlock();
+        return ok;
+    }
+
+    QMutexLocker locker(&mutex_);
+    pending_speaker_ = speaker;
+    pending_ |= SPEAKER;
+    return true;
+}
+
+bool SpeechPipeline::currentSpeed(int & speed)
+{
+    {
+        QMutexLocker locker(&mutex_);
+        if (pending_ & SPEED)
+        {
+            speed = pending_speed_;
+            return true;
+        }
+    }
+    QMutexLocker engine(&engine_mutex_);
+    return engine_.currentSpeed(speed);
+}
+
+bool SpeechPipeline::setSpeed(int speed)
+{
+    if (engine_mutex_.tryLock())
+    {
+        {
+            QMutexLocker locker(&mutex_);
+            pending_ &= ~SPEED;
+        }
+        bool ok = engine_.setSpeed(speed);
+        engine_mutex_.unlock();
+        return ok;
+    }
+
+    QMutexLocker locker(&mutex_);
+    pending_speed_ = speed;
+    pending_ |= SPEED;
+    return true;
+}
+
+bool SpeechPipeline::currentStyle(int & style)
+{
+    {
+        QMutexLocker locker(&mutex_);
+        if (pending_ & STYLE)
+        {
+            style = pending_style_;
+            return true;
+        }
+    }
+    QMutexLocker engine(&engine_mutex_);
+    return engine_.currentStyle(style);
+}
+
+bool SpeechPipeline::setStyle(int style)
+{
+    if (engine_mutex_.tryLock())
+    {
+        {
+            QMutexLocker locker(&mutex_);
+            pending_ &= ~STYLE;
+        }
+        bool ok = engine_.setStyle(style);
+        engine_mutex_.unlock();
+        return ok;
+    }
+
+    QMutexLocker locker(&mutex_);
+    pending_style_ = style;
+    pending_ |= STYLE;
+    return true;
+}
+
+void SpeechPipeline::onSynthDone(bool ok, QByteArray & data)
+{
+    if (ok)
+    {
+        synth_data_.append(data);
+    }
+}
+
+/// Called with mutex_ locked.
+bool SpeechPipeline::isDone() const
+{
+    return active_ && !paused_ && !synthesizing_ && texts_.isEmpty() && pcm_.isEmpty();
+}
+
+/// Hand the settings changed during the last chunk to the engine. Called
+/// in the synthesis thread with engine_mutex_ locked.
+void SpeechPipeline::applySettings()
+{
+    QMutexLocker locker(&mutex_);
+    const int pending = pending_;
+    const QString speaker = pending_speaker_;
+    const int speed = pending_speed_;
+    const int style = pending_style_;
+    pending_ = 0;
+    locker.unlock();
+
+    if (pending & SPEAKER)
+    {
+        engine_.setSpeaker(speaker);
+    }
+    if (pending & SPEED)
+    {
+        engine_.setSpeed(speed);
+    }
+    if (pending & STYLE)
+    {
+        engine_.setStyle(style);
+    }
+}
+
+/// The engine and its settings make part of the key. Called in the
+/// synthesis thread with engine_mutex_ locked.
+QByteArray SpeechPipeline::cacheKey(const QString & text)
+{
+    QString speaker;
+    int speed = 0;
+    int style = 0;
+    engine_.currentSpeaker(speaker);
+    engine_.currentSpeed(speed);
+    engine_.currentStyle(style);
+    return SpeechCache::key(engine_.metaObject()->className(), speaker, speed, style, text);
+}
+
+/// Synthesis thread loop.
+void SpeechPipeline::synthLoop()
+{
+    QMutexLocker locker(&mutex_);
+    while (!quit_)
+    {
+        if (texts_.isEmpty() || pcm_.size() >= queue_limit_)
+        {
+            has_text_.wait(&mutex_);
+            continue;
+        }
+
+        QString text = texts_.dequeue();
+        unsigned int generation = generation_;
+        SpeechCache *cache = cache_;
+        synthesizing_ = true;
+        locker.unlock();
+
+        QByteArray pcm;
+        QByteArray key;
+        bool cached = false;
+        {
+            QMutexLocker engine(&engine_mutex_);
+            applySettings();
+            if (cache)
+            {
+                key = cacheKey(text);
+                cached = cache->find(key, pcm);
+            }
+            if (!cached)
+            {
+                synth_data_.clear();
+                engine_.synthText(text);
+                pcm = synth_data_;
+                synth_data_.clear();
+            }
+        }
+
+        locker.relock();
+        synthesizing_ = false;
+        if (generation != generation_)
+        {
+            continue;
+        }
+        if (pcm.isEmpty())
+        {
+            --chunks_;
+        }
+        else
+        {
+            pcm_.enqueue(pcm);
+        }
+        // Also lets the player notice the end of text.
+        has_audio_.wakeAll();
+
+        // Written while the player goes on.
+        if (cache && !cached && !pcm.isEmpty())
+        {
+            locker.unlock();
+            cache->insert(key, pcm);
+            locker.relock();
+        }
+    }
+}
+
+/// Playback thread loop.
+void SpeechPipeline::playLoop()
+{
+    QMutexLocker locker(&mutex_);
+    while (!quit_)
+    {
+        if (isDone())
+        {
+            active_ = false;
+            idle_.wakeAll();
+            locker.unlock();
+            emit finished();
+            locker.relock();
+            continue;
+        }
+        if (paused_ || pcm_.isEmpty() || sound_ == 0)
+        {
+            has_audio_.wait(&mutex_);
+            continue;
+        }
+
+        // Keep a reference, stop() may clear the queue meanwhile.
+        QByteArray pcm = pcm_.head();
+        const int offset = play_offset_;
+        const int size = qMin(SLICE_BYTES, pcm.size() - offset);
+        const unsigned int generation = generation_;
+        Sound *sound = sound_;
+        int first_audio = -1;
+        if (first_audio_ < 0)
+        {
+            first_audio_ = clock_.elapsed();
+            first_audio = first_audio_;
+        }
+        playing_ = true;
+        locker.unlock();
+
+        if (first_audio >= 0)
+        {
+            emit firstAudio(first_audio);
+        }
+
+        sound->play(pcm.constData() + offset, size);
+
+        locker.relock();
+        playing_ = false;
+        idle_.wakeAll();
+        // A slice interrupted by pause is played again on resume.
+        if (generation != generation_ || paused_)
+        {
+            continue;
+        }
+
+        play_offset_ += size;
+        if (play_offset_ >= pcm.size())
+        {
+            pcm_.dequeue();
+            play_offset_ = 0;
+            ++played_;
+            has_text_.wakeAll();
+        }
+    }
+}
+
+}   // namespace tts
@@ -0,0 +1,145 @@
+#include <unistd.h>
+
+#include "onyx/base/base.h"
+#include "gtest/gtest.h"
+#include "espeak_context.h"
+
+using namespace tts;
+
+namespace
+{
+
+static const int ROUNDS = 6;
+
+static const char *TEXTS[] =
+{
+    "The quick brown fox jumps over the lazy dog, while the cat watches.",
+    "A completely different text, with numbers like 3.14 and 2011. Does it work?",
+};
+
+/// Synthesize TEXTS in turn, starting from the given one.
+class Speaker : public QThread
+{
+public:
+    Speaker(ESpeakContext & context, int first)
+        : context_(context)
+        , first_(first)
+    {
+    }
+
+    void run()
+    {
+        for (int i = 0; i < ROUNDS; ++i)
+        {
+            QByteArray pcm;
+            context_.synthesize(TEXTS[(first_ + i) % 2], pcm);
+            output_.push_back(pcm);
+        }
+    }
+
+    QList<QByteArray> output_;
+
+private:
+    ESpeakContext & context_;
+    int first_;
+};
+
+static QList<QByteArray> speak(int first)
+{
+    ESpeakContext context(ESPEAK_DATA_ROOT);
+    Speaker speaker(context, first);
+    speaker.run();
+    return speaker.output_;
+}
+
+TEST(ESpeakContextTest, Synthesize)
+{
+    ESpeakContext context(ESPEAK_DATA_ROOT);
+    ASSERT_TRUE(context.isValid());
+    EXPECT_TRUE(context.setVoiceByName("+f1"));
+    EXPECT_TRUE(context.setParameter(espeakRATE, 130));
+
+    QByteArray pcm;
+    EXPECT_TRUE(context.synthesize(TEXTS[0], pcm));
+    // At least a second of audio.
+    EXPECT_GT(pcm.size(), context.sampleRate() * 2);
+}
+
+/// Two contexts synthesizing at the same time must produce exactly what
+/// they produce one after the other.
+TEST(ESpeakContextTest, ConcurrentEqualsSequential)
+{
+    QList<QByteArray> expected0 = speak(0);
+    QList<QByteArray> expected1 = speak(1);
+    ASSERT_EQ(ROUNDS, expected0.size());
+    ASSERT_EQ(ROUNDS, expected1.size());
+
+    ESpeakContext context0(ESPEAK_DATA_ROOT);
+    ESpeakContext context1(ESPEAK_DATA_ROOT);
+    Speaker speaker0(context0, 0);
+    Speaker speaker1(context1, 1);
+
+    QTime t;
+    t.start();
+    speaker0.start();
+    speaker1.start();
+    speaker0.wait();
+    speaker1.wait();
+    printf("%d utterances synthesized concurrently in %d ms\n", ROUNDS * 2, t.elapsed());
+
+    ASSERT_EQ(ROUNDS, speaker0.output_.size());
+    ASSERT_EQ(ROUNDS, speaker1.output_.size());
+    for (int i = 0; i < ROUNDS; ++i)
+    {
+        EXPECT_FALSE(speaker0.output_[i].isEmpty());
+        EXPECT_TRUE(speaker0.output_[i] == expected0[i]);
+        EXPECT_TRUE(speaker1.output_[i] == expected1[i]);
+    }
+}
+
+/// Synthesize a long text once.
+class LongSpeaker : public QThread
+{
+public:
+    LongSpeaker(ESpeakContext & context, const QString & text)
+        : context_(context)
+        , text_(text)
+    {
+    }
+
+    void run() { context_.synthesize(text_, pcm_); }
+
+    QByteArray pcm_;
+
+private:
+    ESpeakContext & context_;
+    QString text_;
+};
+
+TEST(ESpeakContextTest, Stop)
+{
+    const QString text = QString(TEXTS[0]).repeated(40);
+    ESpeakContext context(ESPEAK_DATA_ROOT);
+    QByteArray full;
+    ASSERT_TRUE(context.synthesize(text, full));
+
+    LongSpeaker speaker(context, text);
+    speaker.start();
+    usleep(100 * 1000);
+    context.stop();
+    speaker.wait();
+    EXPECT_LT(speaker.pcm_.size(), full.size() / 2);
+
+    // The next text is not affected.
+    QByteArray again;
+    EXPECT_TRUE(context.synthesize(TEXTS[1], again));
+    EXPECT_FALSE(again.isEmpty());
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,122 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "onyx/base/base.h"
+#include "gtest/gtest.h"
+#include "espeak_context.h"
+
+using namespace tts;
+
+namespace
+{
+
+static const char *TEXT = "The quick brown fox jumps over the lazy dog, while the cat watches.";
+
+/// Private and file backed resident memory of the process, in KB.
+static void residentMemory(int & anon, int & file)
+{
+    anon = file = 0;
+    QFile status("/proc/self/status");
+    if (!status.open(QIODevice::ReadOnly))
+    {
+        return;
+    }
+    foreach(const QByteArray & line, status.readAll().split('\n'))
+    {
+        if (line.startsWith("RssAnon:"))
+        {
+            anon = line.mid(8).trimmed().split(' ').front().toInt();
+        }
+        else if (line.startsWith("RssFile:"))
+        {
+            file = line.mid(8).trimmed().split(' ').front().toInt();
+        }
+    }
+}
+
+/// Drops the espeak-data files from the page cache, as after a reboot.
+static void evictDataFiles()
+{
+    QDir dir(QString(ESPEAK_DATA_ROOT) + "/espeak-data");
+    foreach(const QFileInfo & info, dir.entryInfoList(QDir::Files))
+    {
+        int fd = open(QFile::encodeName(info.absoluteFilePath()).constData(), O_RDONLY);
+        if (fd >= 0)
+        {
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            close(fd);
+        }
+    }
+}
+
+/// What ESpeakImpl::create() does.
+static void create(const char *label)
+{
+    int anon0, file0, anon1, file1;
+    residentMemory(anon0, file0);
+
+    QTime t;
+    t.start();
+    ESpeakContext context(ESPEAK_DATA_ROOT);
+    ASSERT_TRUE(context.isValid());
+    ASSERT_TRUE(context.setVoiceByName("+f1"));
+    const int created = t.elapsed();
+
+    QByteArray pcm;
+    ASSERT_TRUE(context.synthesize(TEXT, pcm));
+    EXPECT_FALSE(pcm.isEmpty());
+    residentMemory(anon1, file1);
+    printf("%s: create %d ms, first text %d ms, private %+d KB, file backed %+d KB\n",
+           label, created, t.elapsed() - created, anon1 - anon0, file1 - file0);
+}
+
+TEST(ESpeakDataFilesTest, Startup)
+{
+    evictDataFiles();
+    create("cold");
+    create("warm");
+}
+
+/// Switching the dictionary replaces the mapping. The phonemes are the
+/// same as with a new context.
+TEST(ESpeakDataFilesTest, SwitchVoices)
+{
+    const char *voices[] = { "en", "de", "fr", "en+f2" };
+    ESpeakContext context(ESPEAK_DATA_ROOT);
+    for (int round = 0; round < 2; ++round)
+    {
+        for (size_t v = 0; v < sizeof(voices) / sizeof(voices[0]); ++v)
+        {
+            QByteArray expected, phonemes;
+            {
+                ESpeakContext fresh(ESPEAK_DATA_ROOT);
+                ASSERT_TRUE(fresh.setVoiceByName(voices[v]));
+                ASSERT_TRUE(fresh.translate(TEXT, expected));
+            }
+            ASSERT_TRUE(context.setVoiceByName(voices[v]));
+            ASSERT_TRUE(context.translate(TEXT, phonemes));
+            EXPECT_FALSE(phonemes.isEmpty());
+            EXPECT_TRUE(phonemes == expected) << voices[v];
+        }
+    }
+}
+
+/// A missing voice keeps the current dictionary.
+TEST(ESpeakDataFilesTest, MissingVoice)
+{
+    ESpeakContext context(ESPEAK_DATA_ROOT);
+    QByteArray expected, phonemes;
+    ASSERT_TRUE(context.setVoiceByName("de"));
+    ASSERT_TRUE(context.translate(TEXT, expected));
+    EXPECT_FALSE(context.setVoiceByName("no-such-voice"));
+    ASSERT_TRUE(context.translate(TEXT, phonemes));
+    EXPECT_TRUE(phonemes == expected);
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,194 @@
+#include "onyx/base/base.h"
+#include "gtest/gtest.h"
+#include "espeak_context.h"
+
+using namespace tts;
+
+namespace
+{
+
+/// Jane Austen, Pride and Prejudice, chapter 1.
+static const char *PASSAGE =
+    "It is a truth universally acknowledged, that a single man in possession "
+    "of a good fortune, must be in want of a wife.\n"
+    "However little known the feelings or views of such a man may be on his "
+    "first entering a neighbourhood, this truth is so well fixed in the minds "
+    "of the surrounding families, that he is considered the rightful property "
+    "of some one or other of their daughters.\n"
+    "\"My dear Mr. Bennet,\" said his lady to him one day, \"have you heard "
+    "that Netherfield Park is let at last?\"\n"
+    "Mr. Bennet replied that he had not.\n"
+    "\"But it is,\" returned she; \"for Mrs. Long has just been here, and she "
+    "told me all about it.\"\n"
+    "Mr. Bennet made no answer.\n"
+    "\"Do you not want to know who has taken it?\" cried his wife impatiently.\n"
+    "\"You want to tell me, and I have no objection to hearing it.\"\n"
+    "This was invitation enough.\n"
+    "\"Why, my dear, you must know, Mrs. Long says that Netherfield is taken "
+    "by a young man of large fortune from the north of England; that he came "
+    "down on Monday in a chaise and four to see the place, and was so much "
+    "delighted with it, that he agreed with Mr. Morris immediately; that he "
+    "is to take possession before Michaelmas, and some of his servants are "
+    "to be in the house by the end of next week.\"\n"
+    "\"What is his name?\"\n"
+    "\"Bingley.\"\n"
+    "\"Is he married or single?\"\n"
+    "\"Oh! Single, my dear, to be sure! A single man of large fortune; four or "
+    "five thousand a year. What a fine thing for our girls!\"\n"
+    "\"How so? How can it affect them?\"\n"
+    "\"My dear Mr. Bennet,\" replied his wife, \"how can you be so tiresome! "
+    "You must know that I am thinking of his marrying one of them.\"\n";
+
+/// The text of a book, from $ESPEAK_WORD_CACHE_BOOK (a plain UTF-8 text of
+/// a novel, from Project Gutenberg for instance), or the passage above.
+static QString bookText()
+{
+    QByteArray path = qgetenv("ESPEAK_WORD_CACHE_BOOK");
+    if (!path.isEmpty())
+    {
+        QFile file(QString::fromLocal8Bit(path.constData()));
+        if (file.open(QIODevice::ReadOnly))
+        {
+            return QString::fromUtf8(file.readAll());
+        }
+        printf("Can not read %s\n", path.constData());
+    }
+    return QString::fromUtf8(PASSAGE);
+}
+
+static QByteArray translate(const QString & voice, int cache_size, const QString & text)
+{
+    ESpeakContext context(ESPEAK_DATA_ROOT);
+    EXPECT_TRUE(context.setVoiceByName(voice));
+    EXPECT_TRUE(context.setWordCacheSize(cache_size));
+
+    QByteArray phonemes;
+    EXPECT_TRUE(context.translate(text, phonemes));
+    return phonemes;
+}
+
+TEST(ESpeakWordCacheTest, SamePhonemes)
+{
+    const QString text = QString::fromUtf8(PASSAGE);
+    const char *voices[] = { "en", "en-us", "en+f2", "de", "fr" };
+    for (size_t v = 0; v < sizeof(voices) / sizeof(voices[0]); ++v)
+    {
+        const QByteArray expected = translate(voices[v], 0, text);
+        ASSERT_FALSE(expected.isEmpty());
+
+        // A tiny cache evicts all the time.
+        EXPECT_TRUE(translate(voices[v], 16, text) == expected) << voices[v];
+        EXPECT_TRUE(translate(voices[v], N_WORD_CACHE_DEFAULT, text) == expected) << voices[v];
+    }
+}
+
+TEST(ESpeakWordCacheTest, SameSound)
+{
+    const QString text = QString::fromUtf8(PASSAGE).left(600);
+    QByteArray expected, pcm;
+    {
+        ESpeakContext context(ESPEAK_DATA_ROOT);
+        ASSERT_TRUE(context.setWordCacheSize(0));
+        ASSERT_TRUE(context.synthesize(text, expected));
+    }
+
+    ESpeakContext context(ESPEAK_DATA_ROOT);
+    ASSERT_TRUE(context.synthesize(text, pcm));
+    EXPECT_TRUE(pcm == expected);
+
+    // The second time most words come from the cache.
+    WORD_CACHE_STATS stats;
+    ASSERT_TRUE(context.wordCacheStats(stats, true));
+    pcm.clear();
+    ASSERT_TRUE(context.synthesize(text, pcm));
+    EXPECT_TRUE(pcm == expected);
+
+    ASSERT_TRUE(context.wordCacheStats(stats));
+    EXPECT_GT(stats.hits, stats.misses);
+}
+
+TEST(ESpeakWordCacheTest, VoiceChange)
+{
+    const QString text = QString::fromUtf8(PASSAGE).left(300);
+    const QByteArray english = translate("en", 0, text);
+    const QByteArray german = translate("de", 0, text);
+
+    ESpeakContext context(ESPEAK_DATA_ROOT);
+    QByteArray phonemes;
+    ASSERT_TRUE(context.setVoiceByName("en"));
+    ASSERT_TRUE(context.translate(text, phonemes));
+    EXPECT_TRUE(phonemes == english);
+
+    phonemes.clear();
+    ASSERT_TRUE(context.setVoiceByName("de"));
+    ASSERT_TRUE(context.translate(text, phonemes));
+    EXPECT_TRUE(phonemes == german);
+}
+
+TEST(ESpeakWordCacheTest, Stats)
+{
+    ESpeakContext context(ESPEAK_DATA_ROOT);
+    ASSERT_TRUE(context.setWordCacheSize(64));
+
+    QByteArray phonemes;
+    ASSERT_TRUE(context.translate(QString::fromUtf8(PASSAGE), phonemes));
+
+    WORD_CACHE_STATS stats;
+    ASSERT_TRUE(context.wordCacheStats(stats, true));
+    EXPECT_EQ(64, stats.size);
+    EXPECT_EQ(64, stats.entries);
+    EXPECT_GT(stats.hits, 0u);
+    EXPECT_GT(stats.misses, 0u);
+    EXPECT_GT(stats.bypassed, 0u);    // "a", "Mr."
+    EXPECT_GT(stats.evictions, 0u);
+
+    ASSERT_TRUE(context.wordCacheStats(stats));
+    EXPECT_EQ(0u, stats.hits + stats.misses + stats.bypassed + stats.evictions);
+
+    ASSERT_TRUE(context.setWordCacheSize(0));
+    ASSERT_TRUE(context.translate(QString::fromUtf8(PASSAGE), phonemes));
+    ASSERT_TRUE(context.wordCacheStats(stats));
+    EXPECT_EQ(0, stats.size);
+    EXPECT_EQ(0, stats.entries);
+    EXPECT_EQ(0u, stats.hits + stats.misses);
+}
+
+/// Translates a book with several cache sizes, and prints the hit rate and
+/// the translation speed.
+TEST(ESpeakWordCacheTest, Benchmark)
+{
+    const QString text = bookText();
+    const int sizes[] = { 0, 1024, N_WORD_CACHE_DEFAULT, 16384 };
+    QByteArray expected;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+        ESpeakContext context(ESPEAK_DATA_ROOT);
+        ASSERT_TRUE(context.setWordCacheSize(sizes[i]));
+
+        QTime t;
+        t.start();
+        QByteArray phonemes;
+        ASSERT_TRUE(context.translate(text, phonemes));
+        const int elapsed = qMax(t.elapsed(), 1);
+
+        WORD_CACHE_STATS stats;
+        ASSERT_TRUE(context.wordCacheStats(stats));
+        const unsigned int words = stats.hits + stats.misses + stats.bypassed;
+        printf("cache %5d: %6d ms, hits %5.1f%%, %u evictions\n", sizes[i], elapsed,
+               words > 0 ? stats.hits * 100.0 / words : 0.0, stats.evictions);
+
+        if (expected.isEmpty())
+        {
+            expected = phonemes;
+        }
+        EXPECT_TRUE(phonemes == expected) << sizes[i];
+    }
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
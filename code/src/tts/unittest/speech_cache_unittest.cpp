@@ -0,0 +1,305 @@
+#include <unistd.h>
+
+#include "onyx/base/base.h"
+#include "gtest/gtest.h"
+#include "onyx/tts/tts_pipeline.h"
+
+using namespace tts;
+
+namespace
+{
+
+/// Engine with an output that depends on the text only.
+class FakeEngine : public TTSInterface
+{
+public:
+    explicit FakeEngine(int us_per_char) : us_per_char_(us_per_char), stop_(false) {}
+
+    bool initialize(const QLocale &, Sound &) { return true; }
+    bool synthText(const QString & text)
+    {
+        stop_ = false;
+        QByteArray data;
+        for (int i = 0; i < text.size() && !stop_; ++i)
+        {
+            usleep(us_per_char_);
+            data.append(QByteArray(16, static_cast<char>(text.at(i).unicode() + i)));
+        }
+        texts_.push_back(text);
+        emit synthDone(true, data);
+        return true;
+    }
+    void stop() { stop_ = true; }
+
+    bool speakers(QStringList &) { return false; }
+    bool currentSpeaker(QString &) { return false; }
+    bool setSpeaker(const QString &) { return false; }
+    bool speeds(QVector<int> &) { return false; }
+    bool currentSpeed(int &) { return false; }
+    bool setSpeed(int) { return false; }
+    bool styles(QVector<int> &) { return false; }
+    bool currentStyle(int &) { return false; }
+    bool setStyle(int) { return false; }
+
+    QStringList texts_;
+
+private:
+    int us_per_char_;
+    volatile bool stop_;
+};
+
+/// Cache in its own empty directory, removed at the end of the test.
+class TempCache
+{
+public:
+    explicit TempCache(const char *name)
+        : path_(QDir::temp().filePath(QString("speech_cache_unittest_%1_%2").arg(name).arg(getpid())))
+    {
+        cleanup();
+    }
+
+    ~TempCache()
+    {
+        cleanup();
+    }
+
+    const QString & path() const { return path_; }
+
+private:
+    void cleanup()
+    {
+        QDir dir(path_);
+        foreach(const QString & name, dir.entryList(QDir::Files))
+        {
+            dir.remove(name);
+        }
+        QDir().rmdir(path_);
+    }
+
+    QString path_;
+};
+
+static QByteArray pcm(int size, int seed)
+{
+    QByteArray result(size, 0);
+    for (int i = 0; i < size; ++i)
+    {
+        // Like speech, not too regular.
+        result[i] = static_cast<char>((static_cast<unsigned int>(i) * i + seed) >> (i % 3));
+    }
+    return result;
+}
+
+static QString page()
+{
+    QString text;
+    for (int i = 0; i < 20; ++i)
+    {
+        text += QString("Sentence number %1 of the page, read again and again. ").arg(i);
+    }
+    return text;
+}
+
+/// Speak the text on a device that is a file in dir, and return what the
+/// device received.
+static QByteArray playToFile(SpeechPipeline & pipeline, const QString & text,
+                             const QString & dir, const char *name)
+{
+    const QString path = QDir(dir).filePath(name);
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return QByteArray();
+    }
+    file.close();
+
+    {
+        Sound sound(true, QFile::encodeName(path).constData());
+        if (!pipeline.start(text, sound) || !pipeline.waitForDone(30000))
+        {
+            return QByteArray();
+        }
+    }
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return QByteArray();
+    }
+    return file.readAll();
+}
+
+/// The synthesis thread stores the last chunk after it's queued.
+static bool waitForCount(SpeechCache & cache, int count)
+{
+    for (int i = 0; i < 200 && cache.count() < count; ++i)
+    {
+        usleep(10 * 1000);
+    }
+    return cache.count() == count;
+}
+
+TEST(SpeechCacheTest, Key)
+{
+    const QByteArray key = SpeechCache::key("espeak", "f1", 130, 0, "Hello,  world.\n");
+    EXPECT_EQ(40, key.size());
+    EXPECT_TRUE(key == SpeechCache::key("espeak", "f1", 130, 0, " Hello, world. "));
+    EXPECT_FALSE(key == SpeechCache::key("espeak", "f1", 130, 0, "hello, world."));
+    EXPECT_FALSE(key == SpeechCache::key("espeak", "m1", 130, 0, "Hello, world."));
+    EXPECT_FALSE(key == SpeechCache::key("espeak", "f1", 150, 0, "Hello, world."));
+    EXPECT_FALSE(key == SpeechCache::key("espeak", "f1", 130, 1, "Hello, world."));
+    EXPECT_FALSE(key == SpeechCache::key("aisound", "f1", 130, 0, "Hello, world."));
+}
+
+TEST(SpeechCacheTest, InsertAndFind)
+{
+    TempCache dir("insert");
+    SpeechCache cache(dir.path());
+    const QByteArray a = SpeechCache::key("e", "", 0, 0, "a");
+    const QByteArray b = SpeechCache::key("e", "", 0, 0, "b");
+    const QByteArray data = pcm(100000, 1);
+
+    QByteArray result;
+    EXPECT_FALSE(cache.find(a, result));
+    ASSERT_TRUE(cache.insert(a, data));
+    EXPECT_TRUE(cache.contains(a));
+    EXPECT_FALSE(cache.contains(b));
+    EXPECT_TRUE(cache.find(a, result));
+    EXPECT_TRUE(result == data);
+    EXPECT_FALSE(cache.find(b, result));
+
+    EXPECT_EQ(1, cache.hits());
+    EXPECT_EQ(2, cache.misses());
+    EXPECT_DOUBLE_EQ(1.0 / 3.0, cache.hitRate());
+    EXPECT_LT(cache.usedBytes(), data.size());
+
+    // Replaced.
+    ASSERT_TRUE(cache.insert(a, pcm(5000, 2)));
+    EXPECT_EQ(1, cache.count());
+    EXPECT_TRUE(cache.find(a, result));
+    EXPECT_TRUE(result == pcm(5000, 2));
+
+    cache.clear();
+    EXPECT_EQ(0, cache.count());
+    EXPECT_EQ(0, cache.usedBytes());
+    EXPECT_FALSE(cache.find(a, result));
+}
+
+/// Least recently used first, and the order survives a new instance.
+TEST(SpeechCacheTest, Eviction)
+{
+    TempCache dir("eviction");
+    QByteArray keys[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        keys[i] = SpeechCache::key("e", "", 0, 0, QString::number(i));
+    }
+
+    qint64 entry = 0;
+    {
+        SpeechCache cache(dir.path());
+        ASSERT_TRUE(cache.insert(keys[0], pcm(20000, 0)));
+        entry = cache.usedBytes();
+        ASSERT_TRUE(cache.insert(keys[1], pcm(20000, 1)));
+        sleep(1);
+        ASSERT_TRUE(cache.insert(keys[2], pcm(20000, 2)));
+        sleep(1);
+
+        QByteArray result;
+        ASSERT_TRUE(cache.find(keys[0], result));
+        cache.setCapacity(entry * 3 + entry / 2);
+        ASSERT_TRUE(cache.insert(keys[3], pcm(20000, 3)));
+        EXPECT_EQ(1, cache.evictions());
+        EXPECT_FALSE(cache.contains(keys[1]));
+        EXPECT_TRUE(cache.contains(keys[0]));
+
+        // Too large for the cache.
+        EXPECT_FALSE(cache.insert(keys[1], pcm(1000000, 1)));
+    }
+
+    // keys[2] is the oldest file now.
+    SpeechCache cache(dir.path(), entry * 2 + entry / 2);
+    EXPECT_EQ(2, cache.count());
+    EXPECT_FALSE(cache.contains(keys[2]));
+    QByteArray result;
+    EXPECT_TRUE(cache.find(keys[3], result));
+    EXPECT_TRUE(result == pcm(20000, 3));
+    cache.clear();
+}
+
+/// A file that can not be read back is a miss, and is removed.
+TEST(SpeechCacheTest, BrokenFile)
+{
+    TempCache dir("broken");
+    SpeechCache cache(dir.path());
+    const QByteArray key = SpeechCache::key("e", "", 0, 0, "broken");
+    ASSERT_TRUE(cache.insert(key, pcm(10000, 5)));
+
+    QFile file(QDir(dir.path()).filePath(QString(key) + ".pcm"));
+    ASSERT_TRUE(file.open(QIODevice::ReadWrite));
+    file.seek(file.size() / 2);
+    file.write("garbage");
+    file.close();
+
+    QByteArray result;
+    EXPECT_FALSE(cache.find(key, result));
+    EXPECT_TRUE(result.isEmpty());
+    EXPECT_FALSE(cache.contains(key));
+    EXPECT_FALSE(file.exists());
+}
+
+/// The second time the page is read, the engine is not used and the
+/// device gets exactly what it got when the page was synthesized.
+TEST(SpeechCacheTest, CachedPlaybackIsIdentical)
+{
+    TempCache dir("pipeline");
+    SpeechCache cache(dir.path());
+    FakeEngine engine(20);
+    SpeechPipeline pipeline(engine);
+    pipeline.setCache(&cache);
+
+    const QByteArray uncached = playToFile(pipeline, page(), dir.path(), "uncached.raw");
+    const int chunks = pipeline.chunkCount();
+    EXPECT_GT(chunks, 5);
+    EXPECT_EQ(chunks, pipeline.playedChunks());
+    EXPECT_EQ(chunks, engine.texts_.size());
+    EXPECT_TRUE(waitForCount(cache, chunks));
+    EXPECT_EQ(0, cache.hits());
+    EXPECT_FALSE(uncached.isEmpty());
+
+    engine.texts_.clear();
+    cache.resetStatistics();
+    const QByteArray cached = playToFile(pipeline, page(), dir.path(), "cached.raw");
+    EXPECT_EQ(chunks, pipeline.playedChunks());
+    EXPECT_TRUE(engine.texts_.isEmpty());
+    EXPECT_EQ(chunks, cache.hits());
+    EXPECT_DOUBLE_EQ(1.0, cache.hitRate());
+
+    EXPECT_EQ(uncached.size(), cached.size());
+    EXPECT_TRUE(cached == uncached);
+    cache.clear();
+}
+
+/// A chunk cut short by stop() is not stored.
+TEST(SpeechCacheTest, StopDoesNotCache)
+{
+    TempCache dir("stop");
+    SpeechCache cache(dir.path());
+    FakeEngine engine(2000);
+    Sound sound(false);
+    SpeechPipeline pipeline(engine);
+    pipeline.setCache(&cache);
+
+    ASSERT_TRUE(pipeline.start(page(), sound));
+    usleep(30 * 1000);
+    pipeline.stop();
+    usleep(200 * 1000);
+    EXPECT_EQ(0, cache.count());
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
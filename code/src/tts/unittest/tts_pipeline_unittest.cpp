@@ -0,0 +1,194 @@
+#include <unistd.h>
+
+#include "onyx/base/base.h"
+#include "gtest/gtest.h"
+#include "onyx/tts/tts_pipeline.h"
+
+using namespace tts;
+
+namespace
+{
+
+/// Engine whose synthesis time grows with the text, like eSpeak.
+class FakeEngine : public TTSInterface
+{
+public:
+    explicit FakeEngine(int us_per_char) : us_per_char_(us_per_char), speed_(0), stop_(false) {}
+
+    bool initialize(const QLocale &, Sound &) { return true; }
+    bool synthText(const QString & text)
+    {
+        stop_ = false;
+        QByteArray data;
+        for (int i = 0; i < text.size() && !stop_; ++i)
+        {
+            usleep(us_per_char_);
+            data.append(QByteArray(16, static_cast<char>(i)));
+        }
+        texts_.push_back(text);
+        speeds_.push_back(speed_);
+        emit synthDone(true, data);
+        return true;
+    }
+    void stop() { stop_ = true; }
+
+    bool speakers(QStringList &) { return false; }
+    bool currentSpeaker(QString &) { return false; }
+    bool setSpeaker(const QString &) { return false; }
+    bool speeds(QVector<int> &) { return false; }
+    bool currentSpeed(int & speed) { speed = speed_; return true; }
+    bool setSpeed(int speed) { speed_ = speed; return true; }
+    bool styles(QVector<int> &) { return false; }
+    bool currentStyle(int &) { return false; }
+    bool setStyle(int) { return false; }
+
+    QStringList texts_;
+    QList<int> speeds_;     ///< Speed used for each text.
+
+private:
+    int us_per_char_;
+    int speed_;
+    volatile bool stop_;
+};
+
+/// About 2000 words.
+static QString page()
+{
+    QString text;
+    for (int i = 0; i < 125; ++i)
+    {
+        text += "The quick brown fox jumps over the lazy dog, while the old "
+                "cat watches it from the kitchen window. ";
+        if (i % 10 == 9)
+        {
+            text += "\n";
+        }
+    }
+    return text;
+}
+
+TEST(TTSPipelineTest, SplitClauses)
+{
+    QStringList clauses = splitClauses(
+        "Yes, it costs 3.14 dollars. Really? The list goes on and on, "
+        "and on, and on.\nNext line", 10, 40);
+    ASSERT_EQ(4, clauses.size());
+    EXPECT_EQ(QString("Yes, it costs 3.14 dollars."), clauses[0]);
+    EXPECT_EQ(QString("Really? The list goes on and on,"), clauses[1]);
+    EXPECT_EQ(QString("and on, and on."), clauses[2]);
+    EXPECT_EQ(QString("Next line"), clauses[3]);
+
+    QString cjk = QString::fromUtf8("\xe4\xbd\xa0\xe5\xa5\xbd\xe3\x80\x82\xe5\x86\x8d\xe8\xa7\x81");
+    EXPECT_EQ(2, splitClauses(cjk, 1, 40).size());
+
+    QString words = QString("word ").repeated(100);
+    foreach(const QString & clause, splitClauses(words, 10, 40))
+    {
+        EXPECT_LE(clause.size(), 41);
+    }
+    EXPECT_TRUE(splitClauses("  \n ", 10, 40).isEmpty());
+}
+
+TEST(TTSPipelineTest, TimeToFirstAudio)
+{
+    FakeEngine engine(20);
+    Sound sound(false);
+    SpeechPipeline pipeline(engine);
+    const QString text = page();
+
+    // Synthesize the page, then play it. This is what TTS used to do.
+    pipeline.setStreaming(false);
+    ASSERT_TRUE(pipeline.start(text, sound));
+    ASSERT_TRUE(pipeline.waitForDone(30000));
+    const int whole = pipeline.firstAudioLatency();
+    EXPECT_EQ(1, pipeline.playedChunks());
+
+    pipeline.setStreaming(true);
+    ASSERT_TRUE(pipeline.start(text, sound));
+    ASSERT_TRUE(pipeline.waitForDone(30000));
+    const int streaming = pipeline.firstAudioLatency();
+    EXPECT_GT(pipeline.chunkCount(), 100);
+    EXPECT_EQ(pipeline.chunkCount(), pipeline.playedChunks());
+
+    printf("Time to first audio for %d chars: %d ms whole page, %d ms streaming\n",
+           text.size(), whole, streaming);
+    EXPECT_LT(streaming * 4, whole);
+}
+
+TEST(TTSPipelineTest, PauseAndResume)
+{
+    FakeEngine engine(500);
+    Sound sound(false);
+    SpeechPipeline pipeline(engine);
+    pipeline.setQueueLimit(2);
+
+    ASSERT_TRUE(pipeline.start(page().left(2000), sound));
+    pipeline.pause();
+    usleep(300 * 1000);
+    EXPECT_EQ(0, pipeline.playedChunks());
+    EXPECT_TRUE(pipeline.isActive());
+
+    // Synthesis stops when the queue is full.
+    EXPECT_LE(engine.texts_.size(), 3);
+
+    pipeline.resume(sound);
+    ASSERT_TRUE(pipeline.waitForDone(30000));
+    EXPECT_EQ(pipeline.chunkCount(), pipeline.playedChunks());
+}
+
+TEST(TTSPipelineTest, Stop)
+{
+    FakeEngine engine(200);
+    Sound sound(false);
+    SpeechPipeline pipeline(engine);
+
+    ASSERT_TRUE(pipeline.start(page(), sound));
+    usleep(50 * 1000);
+    pipeline.stop();
+    EXPECT_FALSE(pipeline.isActive());
+    EXPECT_TRUE(pipeline.waitForDone(0));
+    EXPECT_LT(pipeline.playedChunks(), pipeline.chunkCount());
+
+    // The pipeline can be used again.
+    ASSERT_TRUE(pipeline.start("Short text, spoken again.", sound));
+    ASSERT_TRUE(pipeline.waitForDone(30000));
+    EXPECT_EQ(1, pipeline.playedChunks());
+}
+
+/// The speed is changed without waiting for the chunk being
+/// synthesized, the engine uses it from the next chunk.
+TEST(TTSPipelineTest, SetSpeedDuringSynthesis)
+{
+    FakeEngine engine(500);
+    Sound sound(false);
+    SpeechPipeline pipeline(engine);
+    pipeline.setStreaming(false);
+
+    // One chunk of about one second.
+    ASSERT_TRUE(pipeline.start(page().left(2000), sound));
+    usleep(100 * 1000);
+
+    QTime t;
+    t.start();
+    EXPECT_TRUE(pipeline.setSpeed(3));
+    const int elapsed = t.elapsed();
+    int speed = 0;
+    EXPECT_TRUE(pipeline.currentSpeed(speed));
+    EXPECT_EQ(3, speed);
+    EXPECT_LT(elapsed, 500);
+
+    ASSERT_TRUE(pipeline.waitForDone(30000));
+    ASSERT_TRUE(pipeline.start("Short text, spoken again.", sound));
+    ASSERT_TRUE(pipeline.waitForDone(30000));
+    ASSERT_EQ(2, engine.speeds_.size());
+    EXPECT_EQ(0, engine.speeds_[0]);
+    EXPECT_EQ(3, engine.speeds_[1]);
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,199 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "onyx/base/base.h"
+#include "gtest/gtest.h"
+#include "espeak_context.h"
+#include "src/wavegen_kernels.h"
+
+using namespace tts;
+
+namespace
+{
+
+static const int MAX_HARMONIC = 400;
+
+static const char *TEXT =
+    "The quick brown fox jumps over the lazy dog, while the cat watches. "
+    "A completely different text, with numbers like 3.14 and 2011.";
+
+/// Voices with and without breath resonators.
+static const char *VOICES[] = { "en", "en+whisper", "en+f2" };
+
+static QList<const WAVEGEN_KERNELS *> simdKernels()
+{
+    QList<const WAVEGEN_KERNELS *> result;
+    for (int i = WAVEGEN_KERNEL_SCALAR + 1; i < N_WAVEGEN_KERNELS; ++i)
+    {
+        const WAVEGEN_KERNELS *kernels = GetWavegenKernels(i);
+        if (kernels != 0)
+        {
+            result.push_back(kernels);
+        }
+    }
+    return result;
+}
+
+/// A bank like the breath resonators, 200Hz to 4.2KHz at 44.1KHz.
+static void initBank(RESONATOR_BANK & bank)
+{
+    memset(&bank, 0, sizeof(bank));
+    for (int i = 0; i < N_KERNEL_PEAKS; ++i)
+    {
+        const double x = exp(-M_PI * (150 + 50 * i) / 44100.0);
+        bank.c[i] = -(x * x);
+        bank.b[i] = x * cos(2 * M_PI * (200 + 500 * i) / 44100.0) * 2.0;
+        bank.a[i] = 1.0 - bank.b[i] - bank.c[i];
+    }
+}
+
+TEST(WavegenKernelsTest, Auto)
+{
+    ASSERT_TRUE(GetWavegenKernels(WAVEGEN_KERNEL_AUTO) != 0);
+    ASSERT_TRUE(GetWavegenKernels(WAVEGEN_KERNEL_SCALAR) != 0);
+    EXPECT_TRUE(GetWavegenKernels(N_WAVEGEN_KERNELS) == 0);
+    printf("Wavegen kernel: %s\n", GetWavegenKernels(WAVEGEN_KERNEL_AUTO)->name);
+}
+
+TEST(WavegenKernelsTest, SineWavesMatchScalar)
+{
+    const WAVEGEN_KERNELS *scalar = GetWavegenKernels(WAVEGEN_KERNEL_SCALAR);
+    int harmspect[MAX_HARMONIC + 1];
+    srand(1);
+    for (int h = 0; h <= MAX_HARMONIC; ++h)
+    {
+        harmspect[h] = rand() % 400000 - 200000;
+    }
+
+    foreach(const WAVEGEN_KERNELS *kernels, simdKernels())
+    {
+        for (int i = 0; i < 20000; ++i)
+        {
+            const unsigned short waveph = rand();
+            const int maxh = rand() % MAX_HARMONIC;
+            // Above maxh too, the scalar loop sums up to h_switch_sign anyway.
+            const int h_switch_sign = rand() % MAX_HARMONIC;
+            ASSERT_EQ(scalar->sine_waves(waveph, h_switch_sign, maxh, harmspect),
+                      kernels->sine_waves(waveph, h_switch_sign, maxh, harmspect))
+                << kernels->name << " waveph " << waveph << " maxh " << maxh;
+        }
+    }
+}
+
+TEST(WavegenKernelsTest, ResonatorsMatchScalar)
+{
+    const WAVEGEN_KERNELS *scalar = GetWavegenKernels(WAVEGEN_KERNEL_SCALAR);
+    foreach(const WAVEGEN_KERNELS *kernels, simdKernels())
+    {
+        RESONATOR_BANK expected, actual;
+        initBank(expected);
+        initBank(actual);
+        srand(2);
+
+        int breath[N_KERNEL_PEAKS] = { 0 };
+        int amp[N_KERNEL_PEAKS] = { 0 };
+        for (int i = 0; i < 100000; ++i)
+        {
+            if (i % 1000 == 0)
+            {
+                // Some peaks without breath, whose state must be kept.
+                for (int pk = 1; pk < N_KERNEL_PEAKS; ++pk)
+                {
+                    breath[pk] = (rand() % 3 == 0) ? 0 : rand() % 80;
+                }
+            }
+            for (int pk = 1; pk < N_KERNEL_PEAKS; ++pk)
+            {
+                amp[pk] = breath[pk] * (rand() % 64);
+            }
+
+            const double noise = (rand() & 0x3fff) - 0x2000;
+            ASSERT_EQ(scalar->resonators(&expected, breath, amp, noise),
+                      kernels->resonators(&actual, breath, amp, noise))
+                << kernels->name << " sample " << i;
+        }
+        EXPECT_EQ(0, memcmp(&expected, &actual, sizeof(expected))) << kernels->name;
+    }
+}
+
+/// Same PCM out of the synthesizer, whatever the kernel. Also prints the
+/// synthesis speed in samples per second.
+TEST(WavegenKernelsTest, GoldenOutput)
+{
+    QList<int> kernels;
+    for (int i = WAVEGEN_KERNEL_SCALAR; i < N_WAVEGEN_KERNELS; ++i)
+    {
+        if (GetWavegenKernels(i) != 0)
+        {
+            kernels.push_back(i);
+        }
+    }
+
+    for (size_t v = 0; v < sizeof(VOICES) / sizeof(VOICES[0]); ++v)
+    {
+        QByteArray golden;
+        foreach(int kernel, kernels)
+        {
+            ESpeakContext context(ESPEAK_DATA_ROOT);
+            ASSERT_TRUE(context.setVoiceByName(VOICES[v]));
+            ASSERT_TRUE(context.setWavegenKernel(kernel));
+
+            QTime t;
+            t.start();
+            QByteArray pcm;
+            for (int i = 0; i < 4; ++i)
+            {
+                ASSERT_TRUE(context.synthesize(TEXT, pcm));
+            }
+            const int samples = pcm.size() / sizeof(short);
+            printf("%-10s %-7s %9.0f samples/s\n", VOICES[v], GetWavegenKernels(kernel)->name,
+                   samples * 1000.0 / qMax(t.elapsed(), 1));
+
+            if (golden.isEmpty())
+            {
+                golden = pcm;
+            }
+            EXPECT_TRUE(pcm == golden) << VOICES[v] << " " << GetWavegenKernels(kernel)->name;
+        }
+    }
+}
+
+/// The harmonics loop alone, with about as many harmonics as a male
+/// voice at 44.1KHz.
+TEST(WavegenKernelsTest, Benchmark)
+{
+    int harmspect[MAX_HARMONIC + 1];
+    for (int h = 0; h <= MAX_HARMONIC; ++h)
+    {
+        harmspect[h] = (h * 7919) % 200000 - 100000;
+    }
+
+    const int SAMPLES = 2000000;
+    for (int i = WAVEGEN_KERNEL_SCALAR; i < N_WAVEGEN_KERNELS; ++i)
+    {
+        const WAVEGEN_KERNELS *kernels = GetWavegenKernels(i);
+        if (kernels == 0)
+        {
+            continue;
+        }
+
+        QTime t;
+        t.start();
+        int sum = 0;
+        for (int s = 0; s < SAMPLES; ++s)
+        {
+            sum += kernels->sine_waves(static_cast<unsigned short>(s * 397), 20, 60 + (s & 31), harmspect);
+        }
+        printf("%-7s %6.1f Msamples/s (%d)\n", kernels->name,
+               SAMPLES / 1000.0 / qMax(t.elapsed(), 1), sum);
+    }
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
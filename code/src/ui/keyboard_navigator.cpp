@@ -3,248 +3,280 @@
 
 namespace ui
 {
-typedef QList<QWidget *> QWidgets;
 static const int THRES_HOLD = 5;
 
-// Return screen x position of a widget.
-static int screen_x_pos(QWidget *widget)
-{
-    return widget->mapToGlobal(widget->rect().topLeft()).x();
-}
+typedef QHash<QWidget *, FocusIndex *> FocusIndexes;
 
-static int screen_y_pos(QWidget *widget)
+static FocusIndexes & indexes()
 {
-    return widget->mapToGlobal(widget->rect().topLeft()).y();
+    static FocusIndexes instances;
+    return instances;
 }
 
-static int screen_y_center(QWidget *widget)
+// Map the widget to the parent once. Only the relative positions of
+// the widgets matter, and they do not change when the parent moves.
+static FocusEntry focusEntry(QWidget *parent, QWidget *widget, int order)
 {
-    int y = widget->mapToGlobal(widget->rect().topLeft()).y();
-    return y + widget->size().height() / 2;
+    QPoint pos = widget->mapTo(parent, widget->rect().topLeft());
+    FocusEntry entry;
+    entry.widget = widget;
+    entry.x = pos.x();
+    entry.y = pos.y();
+    entry.center = pos.y() + widget->size().height() / 2;
+    entry.order = order;
+    return entry;
 }
 
-struct LessByYCenter
+struct LessByXPos
 {
-    bool operator()( QWidget * a, QWidget *b ) const
+    bool operator()(const FocusEntry & a, const FocusEntry & b) const
     {
-        return (screen_y_center(a) < screen_y_center(b));
+        return (a.x < b.x);
     }
 };
 
-struct GreaterByYCenter
+struct LessByYCenter
 {
-    bool operator() ( QWidget *a, QWidget * b) const
+    bool operator()(const FocusEntry & a, const FocusEntry & b) const
     {
-        return (screen_y_center(a) > screen_y_center(b));
+        return (a.center < b.center);
     }
 };
 
-struct LessByXPos
+// Up and down move along y and pick the nearest x position, left and
+// right move along x and pick the nearest y center.
+static int primary(const FocusEntry & entry, bool vertical)
 {
-    bool operator () (QWidget *a, QWidget *b) const
-    {
-        return (screen_x_pos(a) < screen_x_pos(b));
-    }
-};
+    return vertical ? entry.y : entry.x;
+}
 
-struct GreaterByXPos
+static int secondary(const FocusEntry & entry, bool vertical)
 {
-    bool operator() ( QWidget *a, QWidget *b) const
-    {
-        return (screen_x_pos(a) > screen_x_pos(b));
-    }
-};
+    return vertical ? entry.x : entry.center;
+}
 
-struct LessByYPos
+// Nearest row or column first, then the first one in the widget tree.
+static bool before(const FocusEntry & a, const FocusEntry & b, bool vertical, int sign)
 {
-    bool operator() ( QWidget * a, QWidget * b) const
-    {
-        return (screen_y_pos(a) < screen_y_pos(b));
-    }
-};
+    int diff = vertical ? a.center - b.center : a.x - b.x;
+    diff *= sign;
+    return (diff < 0 || (diff == 0 && a.order < b.order));
+}
 
-struct GreaterByYPos
+static int lowerBound(const QVector<FocusEntry> & entries, int value, bool vertical)
 {
-    bool operator() ( QWidget *a, QWidget * b) const
+    int begin = 0;
+    int end = entries.size();
+    while (begin < end)
     {
-        return (screen_y_pos(a) > screen_y_pos(b));
+        int middle = (begin + end) / 2;
+        if (secondary(entries[middle], vertical) < value)
+        {
+            begin = middle + 1;
+        }
+        else
+        {
+            end = middle;
+        }
     }
-};
+    return begin;
+}
 
-template<class Comp>
-bool collect(QWidget * current, QWidgets & children, QWidgets & candidates, Comp c)
+FocusIndex & FocusIndex::instance(QWidget *parent)
 {
-    foreach(QWidget *p, children)
+    FocusIndexes::iterator it = indexes().find(parent);
+    if (it != indexes().end())
     {
-        if (c(p, current))
-        {
-            candidates.push_back(p);
-        }
+        return *it.value();
     }
-    return (candidates.size() > 0);
+
+    // Owned by the parent.
+    FocusIndex *index = new FocusIndex(parent);
+    indexes().insert(parent, index);
+    return *index;
 }
 
-static QWidget * searchYLess(QWidget *parent,
-                             QWidgets & children,
-                             QWidget *current)
+FocusIndex::FocusIndex(QWidget *parent)
+    : QObject(parent)
+    , parent_(parent)
+    , valid_(false)
+    , rebuilds_(0)
+    , min_x_(0)
+    , max_x_(0)
+    , min_y_(0)
+    , max_y_(0)
 {
+}
 
-    QWidgets candidates;
-    if (!collect(current, children, candidates, LessByYPos()))
-    {
-        if (!collect(current, children, candidates, GreaterByYPos()))
-        {
-            return 0;
-        }
-    }
+FocusIndex::~FocusIndex()
+{
+    indexes().remove(parent_);
+}
 
-    qStableSort(candidates.begin(), candidates.end(), GreaterByYCenter());
-    int dist = INT_MAX;
-    QWidget * result = candidates.front();
-    foreach(QWidget *p, candidates)
+void FocusIndex::invalidate()
+{
+    valid_ = false;
+}
+
+int FocusIndex::size()
+{
+    update();
+    return by_x_.size();
+}
+
+bool FocusIndex::eventFilter(QObject *obj, QEvent *event)
+{
+    switch (event->type())
     {
-        int diff = abs(screen_x_pos(p) - screen_x_pos(current));
-        if (dist > diff && dist > THRES_HOLD)
+    case QEvent::Move:
+    case QEvent::Resize:
+    case QEvent::Show:
+    case QEvent::Hide:
+    case QEvent::ParentChange:
+        valid_ = false;
+        break;
+    case QEvent::ChildAdded:
+    case QEvent::ChildRemoved:
+        if (static_cast<QChildEvent *>(event)->child()->isWidgetType())
         {
-            dist = diff;
-            result = p;
+            valid_ = false;
         }
+        break;
+    default:
+        break;
     }
-    return result;
+    return QObject::eventFilter(obj, event);
 }
 
-static QWidget * searchYGreater(QWidget *parent,
-                                QWidgets & children,
-                                QWidget *current)
+void FocusIndex::collect(QWidget *parent)
 {
-    QWidgets candidates;
-    if (!collect(current, children, candidates, GreaterByYPos()))
+    const QObjectList & all = parent->children();
+    foreach(QObject *object, all)
     {
-        if (!collect(current, children, candidates, LessByYPos()))
+        if (!object->isWidgetType())
         {
-            return 0;
+            continue;
         }
-    }
-    qStableSort(candidates.begin(), candidates.end(), LessByYCenter());
-    int dist = INT_MAX;
-    QWidget * result = candidates.front();
-    foreach(QWidget *p, candidates)
-    {
-        if (dist > abs(screen_x_pos(p)- screen_x_pos(current)))
+
+        // Hidden widgets are watched as well, to know when they are shown.
+        QWidget * wnd = static_cast<QWidget *>(object);
+        wnd->installEventFilter(this);
+        if (wnd->isVisible())
         {
-            dist = abs(screen_x_pos(p)- screen_x_pos(current));
-            result = p;
+            if (wnd->focusPolicy() != Qt::NoFocus)
+            {
+                by_x_.push_back(focusEntry(parent_, wnd, by_x_.size()));
+            }
+            collect(wnd);
         }
     }
-    return result;
 }
 
-static QWidget * searchXLess(QWidget *parent,
-                             QWidgets & children,
-                             QWidget *current)
+void FocusIndex::update()
 {
-    QWidgets candidates;
-    if (!collect(current, children, candidates, LessByXPos()))
+    if (valid_)
     {
-        if (!collect(current, children, candidates, GreaterByXPos()))
-        {
-            return 0;
-        }
+        return;
     }
 
-    qStableSort(candidates.begin(), candidates.end(), GreaterByXPos());
-    int dist = INT_MAX;
-    QWidget * result = candidates.front();
-    foreach(QWidget *p, candidates)
+    by_x_.clear();
+    parent_->installEventFilter(this);
+    collect(parent_);
+
+    by_center_ = by_x_;
+    qStableSort(by_x_.begin(), by_x_.end(), LessByXPos());
+    qStableSort(by_center_.begin(), by_center_.end(), LessByYCenter());
+
+    min_x_ = min_y_ = INT_MAX;
+    max_x_ = max_y_ = INT_MIN;
+    foreach(const FocusEntry & entry, by_x_)
     {
-        int value = abs(screen_y_center(p) - screen_y_center(current));
-        if (dist > value)
-        {
-            dist = value;
-            result = p;
-        }
+        min_x_ = qMin(min_x_, entry.x);
+        max_x_ = qMax(max_x_, entry.x);
+        min_y_ = qMin(min_y_, entry.y);
+        max_y_ = qMax(max_y_, entry.y);
     }
-    return result;
+
+    valid_ = true;
+    ++rebuilds_;
 }
 
-static QWidget * searchXGreater(QWidget *parent,
-                                QWidgets & children,
-                                QWidget *current)
+/// The candidates are the widgets before current in the direction of
+/// sign, or after it when wrapping. The nearest one on the other axis
+/// wins, ties going to the nearest row or column. Moving up, every
+/// candidate within THRES_HOLD is considered aligned.
+QWidget * FocusIndex::nearest(const FocusEntry & from, bool vertical, int sign, bool wrap)
 {
-    QWidgets candidates;
-    if (!collect(current, children, candidates, GreaterByXPos()))
+    const QVector<FocusEntry> & entries = vertical ? by_x_ : by_center_;
+    int threshold = (vertical && sign < 0) ? THRES_HOLD : 0;
+    int filter = wrap ? -sign : sign;
+    int value = secondary(from, vertical);
+
+    // Walk from the nearest entries on the other axis to the farthest.
+    int right = lowerBound(entries, value, vertical);
+    int left = right - 1;
+    int limit = INT_MAX;
+    const FocusEntry *result = 0;
+    while (left >= 0 || right < entries.size())
     {
-        if (!collect(current, children, candidates, LessByXPos()))
+        int left_dist = (left >= 0) ? value - secondary(entries[left], vertical) : INT_MAX;
+        int right_dist = (right < entries.size()) ? secondary(entries[right], vertical) - value : INT_MAX;
+        int dist = qMin(left_dist, right_dist);
+        if (dist > limit)
         {
-            return 0;
+            break;
         }
-    }
 
-    qStableSort(candidates.begin(), candidates.end(), LessByXPos());
-    int dist = INT_MAX;
-    QWidget * result = candidates.front();
-    foreach(QWidget *p, candidates)
-    {
-        int value = abs(screen_y_center(p) - screen_y_center(current));
-        if (dist > value)
+        const FocusEntry & entry = (left_dist <= right_dist) ? entries[left--] : entries[right++];
+        if (filter * (primary(entry, vertical) - primary(from, vertical)) <= 0)
         {
-            dist = value;
-            result = p;
+            continue;
         }
-    }
-    return result;
-}
 
-static void collectWidgets(const QObject *parent,
-                           QWidgets &widgets)
-{
-    const QObjectList & all = parent->children();
-    foreach(const QObject *object, all)
-    {
-        if (object->isWidgetType())
+        if (result == 0)
         {
-            QWidget * wnd = const_cast<QWidget *>(static_cast<const QWidget *>(object));
-            if (wnd && wnd->isVisible())
-            {
-                if (wnd->focusPolicy() != Qt::NoFocus)
-                {
-                    widgets.push_back(wnd);
-                }
-                collectWidgets(wnd, widgets);
-            }
+            result = &entry;
+            limit = qMax(dist, threshold);
+        }
+        else if (before(entry, *result, vertical, sign))
+        {
+            result = &entry;
         }
     }
+    return result ? result->widget : 0;
 }
 
-static QWidget * search(QWidget *parent,
-                        QWidget *current,
-                        int key)
+QWidget * FocusIndex::search(QWidget *current, int key)
 {
-    if (parent == 0)
+    update();
+    if (current == 0 || by_x_.isEmpty())
     {
         return 0;
     }
 
-    // Need to find out which widgets need to be compared.
-    QWidgets widgets;
-    collectWidgets(parent, widgets);
+    // mapTo only works for widgets under the parent.
+    if (current != parent_ && !parent_->isAncestorOf(current))
+    {
+        return 0;
+    }
 
-    // Sort them based on key.
+    // Wrap around when there is nothing in the direction of the key.
+    FocusEntry from = focusEntry(parent_, current, -1);
     if (key == Qt::Key_Up)
     {
-        return searchYLess(parent, widgets, current);
+        return nearest(from, true, -1, min_y_ >= from.y);
     }
     else if (key == Qt::Key_Down)
     {
-        return searchYGreater(parent, widgets, current);
+        return nearest(from, true, 1, max_y_ <= from.y);
     }
     else if (key == Qt::Key_Left || key == Qt::Key_PageUp)
     {
-       return searchXLess(parent, widgets, current);
+        return nearest(from, false, -1, min_x_ >= from.x);
     }
     else if (key == Qt::Key_Right || key == Qt::Key_PageDown)
     {
-        return searchXGreater(parent, widgets, current);
+        return nearest(from, false, 1, max_x_ <= from.x);
     }
     return 0;
 }
@@ -254,7 +286,7 @@ QWidget * moveFocus(QWidget *parent, int key)
     QWidget *current = parent->focusWidget();
     if (current)
     {
-        return search(parent, current, key);
+        return FocusIndex::instance(parent).search(current, key);
     }
     return 0;
 }
@@ -267,5 +299,3 @@ QWidget * moveFocusCircularly(QWidget *parent, int key)
 }
 
 }
-
-
@@ -0,0 +1,270 @@
+#include "onyx/ui/page_cache.h"
+#include "onyx/sys/sys_utils.h"
+
+namespace vbf
+{
+
+uint qHash(const PageCacheKey & key)
+{
+    return (static_cast<uint>(key.page) * 31u + static_cast<uint>(key.zoom)) * 31u +
+           static_cast<uint>(key.rotation) * 7u + static_cast<uint>(key.settings);
+}
+
+PageCache::PageCache(size_t budget)
+    : items_()
+    , budget_(budget)
+    , used_(0)
+    , policy_(0)
+    , current_page_(0)
+    , clock_(0)
+    , hits_(0)
+    , misses_(0)
+    , evictions_(0)
+{
+}
+
+PageCache::~PageCache()
+{
+}
+
+/// Change the byte budget. Images are evicted at once if needed.
+void PageCache::setBudget(size_t bytes)
+{
+    QMutexLocker locker(&mutex_);
+    budget_ = bytes;
+    evictUntil(budget_);
+}
+
+size_t PageCache::usedBytes() const
+{
+    QMutexLocker locker(&mutex_);
+    return used_;
+}
+
+int PageCache::count() const
+{
+    QMutexLocker locker(&mutex_);
+    return items_.size();
+}
+
+/// The policy is used to weight eviction. It is not owned.
+void PageCache::setRenderPolicy(RenderPolicy *policy)
+{
+    QMutexLocker locker(&mutex_);
+    policy_ = policy;
+}
+
+void PageCache::setCurrentPage(int page)
+{
+    QMutexLocker locker(&mutex_);
+    current_page_ = page;
+}
+
+int PageCache::currentPage() const
+{
+    QMutexLocker locker(&mutex_);
+    return current_page_;
+}
+
+/// Add the image, replacing the one with the same key.
+/// Returns false if the image alone is larger than the budget.
+bool PageCache::insert(const PageCacheKey & key, const QImage & image)
+{
+    size_t bytes = imageBytes(image);
+    {
+        QMutexLocker locker(&mutex_);
+        if (image.isNull() || bytes > budget_)
+        {
+            return false;
+        }
+
+        Items::iterator it = items_.find(key);
+        if (it != items_.end())
+        {
+            used_ -= it.value().bytes;
+            items_.erase(it);
+        }
+
+        evictUntil(budget_ - bytes);
+        Item item;
+        item.image = image;
+        item.bytes = bytes;
+        item.last_access = ++clock_;
+        items_.insert(key, item);
+        used_ += bytes;
+    }
+    checkMemory();
+    return true;
+}
+
+bool PageCache::contains(const PageCacheKey & key) const
+{
+    QMutexLocker locker(&mutex_);
+    return items_.contains(key);
+}
+
+/// Retrieve the image. A null image is returned if it's not cached.
+QImage PageCache::find(const PageCacheKey & key)
+{
+    QMutexLocker locker(&mutex_);
+    Items::iterator it = items_.find(key);
+    if (it == items_.end())
+    {
+        ++misses_;
+        return QImage();
+    }
+    ++hits_;
+    it.value().last_access = ++clock_;
+    return it.value().image;
+}
+
+void PageCache::remove(const PageCacheKey & key)
+{
+    QMutexLocker locker(&mutex_);
+    Items::iterator it = items_.find(key);
+    if (it != items_.end())
+    {
+        used_ -= it.value().bytes;
+        items_.erase(it);
+    }
+}
+
+/// Remove all images of the page, whatever the zoom and rotation.
+void PageCache::removePage(int page)
+{
+    QMutexLocker locker(&mutex_);
+    Items::iterator it = items_.begin();
+    while (it != items_.end())
+    {
+        if (it.key().page == page)
+        {
+            used_ -= it.value().bytes;
+            it = items_.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void PageCache::clear()
+{
+    QMutexLocker locker(&mutex_);
+    items_.clear();
+    used_ = 0;
+}
+
+/// Evict images until at most target bytes are used.
+/// Returns the number of bytes released.
+size_t PageCache::shrink(size_t target)
+{
+    QMutexLocker locker(&mutex_);
+    size_t before = used_;
+    evictUntil(target);
+    return before - used_;
+}
+
+/// Shrink the cache when the system runs out of memory.
+size_t PageCache::checkMemory()
+{
+    return checkMemory(sys::systemFreeMemory());
+}
+
+/// Release what's missing to reach the safe memory limit, plus a quarter
+/// of the budget so that the next insert does not trigger it again.
+size_t PageCache::checkMemory(unsigned long free_memory)
+{
+    const unsigned long limit = sys::safeMemoryLimit();
+    if (free_memory > limit)
+    {
+        return 0;
+    }
+
+    size_t wanted = (limit - free_memory) + budget_ / 4;
+    size_t used = usedBytes();
+    return shrink(used > wanted ? used - wanted : 0);
+}
+
+int PageCache::hits() const
+{
+    QMutexLocker locker(&mutex_);
+    return hits_;
+}
+
+int PageCache::misses() const
+{
+    QMutexLocker locker(&mutex_);
+    return misses_;
+}
+
+int PageCache::evictions() const
+{
+    QMutexLocker locker(&mutex_);
+    return evictions_;
+}
+
+double PageCache::hitRate() const
+{
+    QMutexLocker locker(&mutex_);
+    int total = hits_ + misses_;
+    return total > 0 ? static_cast<double>(hits_) / total : 0.0;
+}
+
+void PageCache::resetStatistics()
+{
+    QMutexLocker locker(&mutex_);
+    hits_ = 0;
+    misses_ = 0;
+    evictions_ = 0;
+}
+
+/// Called with mutex_ locked.
+void PageCache::evictUntil(size_t target)
+{
+    while (used_ > target && !items_.isEmpty())
+    {
+        Items::iterator victim = items_.begin();
+        for (Items::iterator it = items_.begin(); it != items_.end(); ++it)
+        {
+            if (isBetterVictim(it.key(), it.value(), victim.key(), victim.value()))
+            {
+                victim = it;
+            }
+        }
+        used_ -= victim.value().bytes;
+        items_.erase(victim);
+        ++evictions_;
+    }
+}
+
+/// Check if a should be evicted before b.
+bool PageCache::isBetterVictim(const PageCacheKey & a, const Item & ia,
+                               const PageCacheKey & b, const Item & ib)
+{
+    if (policy_)
+    {
+        int pa = policy_->getPriority(a.page);
+        int pb = policy_->getPriority(b.page);
+        if (pa != pb)
+        {
+            return pa > pb;
+        }
+    }
+
+    int da = qAbs(a.page - current_page_);
+    int db = qAbs(b.page - current_page_);
+    if (da != db)
+    {
+        return da > db;
+    }
+    return ia.last_access < ib.last_access;
+}
+
+size_t PageCache::imageBytes(const QImage & image)
+{
+    return static_cast<size_t>(image.bytesPerLine()) * image.height() +
+           image.colorTable().size() * sizeof(QRgb);
+}
+
+}
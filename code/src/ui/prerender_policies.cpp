@@ -0,0 +1,287 @@
+#include "onyx/ui/prerender_policies.h"
+#include "onyx/ui/continuous_page_layout.h"
+
+namespace vbf
+{
+
+// Turns longer than this are jumps (TOC, search result, bookmark)
+// and do not tell the reading direction.
+static const int MAX_TURN_STEP = 2;
+
+DirectionalRenderPolicy::DirectionalRenderPolicy(int ahead, int behind, int history)
+    : ahead_(qMax(ahead, 0))
+    , behind_(qMax(behind, 0))
+    , history_size_(qMax(history, 1))
+{
+}
+
+DirectionalRenderPolicy::~DirectionalRenderPolicy()
+{
+}
+
+void DirectionalRenderPolicy::getRenderRequests(const int current_page,
+                                                const int previous_page,
+                                                const int total,
+                                                QVector<int> & result)
+{
+    recordTurn(current_page, previous_page);
+    buildRequests(current_page, total, ahead_, result);
+}
+
+/// The dominant direction of recent turns, 1 for forward and -1 for
+/// backward. Newer turns weigh more. Forward by default.
+int DirectionalRenderPolicy::direction() const
+{
+    int sum = 0;
+    for (int i = 0; i < history_.size(); ++i)
+    {
+        sum += history_[i] * (i + 1);
+    }
+    return sum < 0 ? -1 : 1;
+}
+
+void DirectionalRenderPolicy::reset()
+{
+    history_.clear();
+}
+
+void DirectionalRenderPolicy::recordTurn(const int current_page, const int previous_page)
+{
+    int step = current_page - previous_page;
+    if (step == 0 || qAbs(step) > MAX_TURN_STEP)
+    {
+        return;
+    }
+
+    history_.push_back(step > 0 ? 1 : -1);
+    while (history_.size() > history_size_)
+    {
+        history_.pop_front();
+    }
+}
+
+/// Current page first, then ahead pages in reading direction, then the
+/// pages behind.
+void DirectionalRenderPolicy::buildRequests(const int current_page,
+                                            const int total,
+                                            const int ahead,
+                                            QVector<int> & result)
+{
+    result.clear();
+    if (current_page < 0 || current_page >= total)
+    {
+        updateRequests(result);
+        return;
+    }
+
+    result.push_back(current_page);
+    if (needPrerender())
+    {
+        const int dir = direction();
+        for (int i = 1; i <= ahead; ++i)
+        {
+            int page = current_page + dir * i;
+            if (page < 0 || page >= total)
+            {
+                break;
+            }
+            result.push_back(page);
+        }
+        for (int i = 1; i <= behind_; ++i)
+        {
+            int page = current_page - dir * i;
+            if (page < 0 || page >= total)
+            {
+                break;
+            }
+            result.push_back(page);
+        }
+    }
+    updateRequests(result);
+}
+
+AdaptiveRenderPolicy::AdaptiveRenderPolicy(int min_ahead, int max_ahead, int window_ms)
+    : DirectionalRenderPolicy(min_ahead)
+    , min_ahead_(qMax(min_ahead, 0))
+    , max_ahead_(qMax(max_ahead, min_ahead))
+    , window_ms_(window_ms)
+    , current_ahead_(min_ahead_)
+{
+    clock_.start();
+}
+
+AdaptiveRenderPolicy::~AdaptiveRenderPolicy()
+{
+}
+
+/// Count the turns in the last window_ms and add one page to the window
+/// for every two of them.
+void AdaptiveRenderPolicy::getRenderRequests(const int current_page,
+                                             const int previous_page,
+                                             const int total,
+                                             QVector<int> & result)
+{
+    const qint64 time = now();
+    if (current_page != previous_page)
+    {
+        turns_.enqueue(time);
+    }
+    while (!turns_.isEmpty() && time - turns_.head() > window_ms_)
+    {
+        turns_.dequeue();
+    }
+
+    current_ahead_ = qBound(min_ahead_, min_ahead_ + (turns_.size() - 1) / 2, max_ahead_);
+    setAhead(current_ahead_);
+    recordTurn(current_page, previous_page);
+    buildRequests(current_page, total, current_ahead_, result);
+}
+
+qint64 AdaptiveRenderPolicy::now()
+{
+    return clock_.elapsed();
+}
+
+ContinuousRenderPolicy::ContinuousRenderPolicy(ContinuousPageLayout *layout,
+                                               qreal screens,
+                                               int max_pages)
+    : layout_(layout)
+    , screens_(screens)
+    , max_pages_(qMax(max_pages, 1))
+{
+}
+
+ContinuousRenderPolicy::~ContinuousRenderPolicy()
+{
+}
+
+int ContinuousRenderPolicy::pageLength(int page_number, int fallback)
+{
+    PagePtr page = layout_->getPage(page_number);
+    if (page == 0 || !page->displayArea().isValid())
+    {
+        return fallback;
+    }
+    return layout_->isHorizontal() ? page->displayArea().width() :
+                                     page->displayArea().height();
+}
+
+struct PageDistance
+{
+    int page;
+    int distance;
+    bool ahead;
+};
+
+static bool lessForward(const PageDistance & a, const PageDistance & b)
+{
+    if (a.distance != b.distance)
+    {
+        return a.distance < b.distance;
+    }
+    return a.ahead && !b.ahead;
+}
+
+static bool lessBackward(const PageDistance & a, const PageDistance & b)
+{
+    if (a.distance != b.distance)
+    {
+        return a.distance < b.distance;
+    }
+    return !a.ahead && b.ahead;
+}
+
+/// Pages are requested by the distance between the page and the view
+/// port. Positions of pages not laid out yet are estimated from the
+/// visible pages.
+void ContinuousRenderPolicy::getRenderRequests(const int current_page,
+                                               const int previous_page,
+                                               const int total,
+                                               QVector<int> & result)
+{
+    result.clear();
+    VisiblePages visible;
+    layout_->getVisiblePages(visible);
+    if (visible.isEmpty())
+    {
+        if (current_page >= 0 && current_page < total)
+        {
+            result.push_back(current_page);
+        }
+        updateRequests(result);
+        return;
+    }
+
+    const bool horizontal = layout_->isHorizontal();
+    const QRect & view = layout_->viewPort();
+    const int view_start = horizontal ? view.left() : view.top();
+    const int view_end = horizontal ? view.right() : view.bottom();
+    const int reach = static_cast<int>((view_end - view_start + 1) * screens_);
+    const int spacing = layout_->spacing();
+
+    // Visible pages, the current one first.
+    int first = visible.front()->key();
+    int last = first;
+    int length_sum = 0;
+    result.push_back(current_page);
+    foreach(PagePtr page, visible)
+    {
+        first = qMin(first, page->key());
+        last = qMax(last, page->key());
+        length_sum += horizontal ? page->displayArea().width() : page->displayArea().height();
+        if (page->key() != current_page)
+        {
+            result.push_back(page->key());
+        }
+    }
+    const int average = qMax(length_sum / visible.size(), 1);
+
+    if (needPrerender())
+    {
+        QVector<PageDistance> candidates;
+        PagePtr last_page = layout_->getPage(last);
+        PagePtr first_page = layout_->getPage(first);
+
+        int pos = (horizontal ? last_page->displayArea().right() :
+                                last_page->displayArea().bottom()) + spacing + 1;
+        for (int key = last + 1; key < total; ++key)
+        {
+            PageDistance item = { key, pos - view_end, true };
+            if (item.distance > reach)
+            {
+                break;
+            }
+            candidates.push_back(item);
+            pos += pageLength(key, average) + spacing;
+        }
+
+        int end = (horizontal ? first_page->displayArea().left() :
+                                first_page->displayArea().top()) - spacing - 1;
+        for (int key = first - 1; key >= 0; --key)
+        {
+            PageDistance item = { key, view_start - end, false };
+            if (item.distance > reach)
+            {
+                break;
+            }
+            candidates.push_back(item);
+            end -= pageLength(key, average) + spacing;
+        }
+
+        if (current_page >= previous_page)
+        {
+            qStableSort(candidates.begin(), candidates.end(), lessForward);
+        }
+        else
+        {
+            qStableSort(candidates.begin(), candidates.end(), lessBackward);
+        }
+        for (int i = 0; i < candidates.size() && result.size() < max_pages_; ++i)
+        {
+            result.push_back(candidates[i].page);
+        }
+    }
+    updateRequests(result);
+}
+
+}
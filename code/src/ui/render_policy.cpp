@@ -8,6 +8,7 @@ static const int MIN_PRIORITY = 0xffff;
 RenderPolicy::RenderPolicy()
     : need_prerender_(true)
     , requests_()
+    , sources_()
 {
 }
 
@@ -30,9 +31,16 @@ int RenderPolicy::getPriority(int page_number)
 }
 
 
+/// Rebuild the requests only when they changed, which is the common case
+/// when the same page is repainted.
 void RenderPolicy::updateRequests(const QVector<int> & sources)
 {
     QMutexLocker mtx(&mutex_);
+    if (sources == sources_)
+    {
+        return;
+    }
+    sources_ = sources;
     requests_.clear();
     for (int idx = 0; idx < sources.size(); ++idx)
     {
@@ -298,7 +298,7 @@ void StatusBar::onProgressChanging(const int current,
     }
     QApplication::processEvents();
     onyx::screen::instance().enableUpdate(true);
-    onyx::screen::instance().updateWidget(this, onyx::screen::ScreenProxy::GC, false);
+    onyx::screen::instance().updateWidgetWithGCInterval(this, 0, onyx::screen::ScreenProxy::GU, false);
 }
 
 void StatusBar::onProgressChanged(const int percent,
@@ -94,7 +94,7 @@ void StatusBarItemClock::mouseReleaseEvent(QMouseEvent *me)
     {
         onyx::screen::instance().enableUpdate(false);
         repaint();
-        onyx::screen::instance().updateWidget(this,
+        onyx::screen::instance().updateWidgetWithGCInterval(this, 0,
                 onyx::screen::ScreenProxy::GU);
         onyx::screen::instance().enableUpdate(true);
     }
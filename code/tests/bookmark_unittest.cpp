@@ -2,6 +2,7 @@
 #include "onyx/base/base.h"
 #include "onyx/ui/ui.h"
 #include "onyx/data/bookmark.h"
+#include "onyx/cms/content_manager.h"
 #include "gtest/gtest.h"
 
 
@@ -71,3 +72,75 @@ TEST(BookmarkTest, Bookmarks)
     }
 }
 
+
+static bool lessPage(const vbf::Bookmark & a, const vbf::Bookmark & b)
+{
+    return a.data().toInt() < b.data().toInt();
+}
+
+/// Insert bookmarks in random order and check they are sorted and
+/// that the same bookmark is refused.
+TEST(BookmarkTest, InsertSorted)
+{
+    using namespace vbf;
+
+    Bookmarks a;
+    static const int SIZE = 200;
+    for(int i = 0; i < SIZE; ++i)
+    {
+        int page = (i * 7) % SIZE;
+        EXPECT_TRUE(insertBookmark(a, Bookmark(QString("page %1").arg(page), page), lessPage));
+    }
+    EXPECT_FALSE(insertBookmark(a, Bookmark("page 5", 5), lessPage));
+    EXPECT_TRUE(insertBookmark(a, Bookmark("another 5", 5), lessPage));
+
+    ASSERT_EQ(SIZE + 1, a.size());
+    for(int i = 1; i < a.size(); ++i)
+    {
+        EXPECT_FALSE(lessPage(a[i], a[i - 1]));
+    }
+}
+
+/// Bookmarks added one by one in any order are loaded sorted, so that
+/// insertBookmark can search them.
+TEST(BookmarkTest, AddLoadInsert)
+{
+    using namespace vbf;
+
+    QDir current = QDir::current();
+    QString db_path = current.filePath("bookmark_unittest.db");
+    current.remove(db_path);
+    QString doc_path = current.filePath("bookmark_unittest.pdf");
+    QFile file(doc_path);
+    file.open(QIODevice::WriteOnly);
+    file.write(QByteArray(100, 'x'));
+    file.close();
+
+    {
+        cms::ContentManager db;
+        ASSERT_TRUE(db.open(db_path));
+        static const int PAGES[] = { 30, 10, 50, 20, 40, 10 };
+        for(size_t i = 0; i < sizeof(PAGES) / sizeof(PAGES[0]); ++i)
+        {
+            int page = PAGES[i];
+            addBookmark(db, doc_path, Bookmark(QString("page %1").arg(page), page));
+        }
+
+        Bookmarks bookmarks;
+        ASSERT_TRUE(loadBookmarks(db, doc_path, bookmarks));
+        ASSERT_EQ(5, bookmarks.size());
+        for(int i = 1; i < bookmarks.size(); ++i)
+        {
+            EXPECT_FALSE(lessPage(bookmarks[i], bookmarks[i - 1]));
+        }
+
+        EXPECT_FALSE(insertBookmark(bookmarks, Bookmark("page 40", 40), lessPage));
+        EXPECT_TRUE(insertBookmark(bookmarks, Bookmark("page 25", 25), lessPage));
+        ASSERT_EQ(6, bookmarks.size());
+        EXPECT_EQ(25, bookmarks[2].data().toInt());
+        db.close();
+    }
+
+    current.remove(db_path);
+    current.remove(doc_path);
+}
@@ -268,6 +268,129 @@ TEST(ContentManagerTest, GetBookmark)
     current.remove(db);
 }
 
+/// Bookmarks stored one row each, added in position order and read by
+/// range in position order.
+TEST(ContentManagerTest, BookmarkEntries)
+{
+    QDir current = QDir::current();
+    QString db = current.filePath("temp.db");
+    current.remove(db);
+
+    ContentManager mgr;
+    EXPECT_TRUE(mgr.open(db));
+
+    ContentNode node;
+    node.mutable_name() = "bookmarks.file";
+    node.mutable_location() = current.absolutePath();
+    mgr.createContentNode(node);
+
+    static const int COUNT = 300;
+    for(int i = COUNT - 1; i >= 0; --i)
+    {
+        EXPECT_TRUE(mgr.addBookmarkEntry(node.id(), BookmarkEntry(QString("page %1").arg(i), i)));
+    }
+    EXPECT_TRUE(mgr.addBookmarkEntry(node.id(), BookmarkEntry("chapter", QString("ch1"))));
+    EXPECT_FALSE(mgr.addBookmarkEntry(node.id(), BookmarkEntry("page 7", 7)));
+    EXPECT_EQ(COUNT + 1, mgr.bookmarkCount(node.id()));
+
+    BookmarkEntries entries;
+    EXPECT_TRUE(mgr.getBookmarkEntries(node.id(), entries));
+    ASSERT_EQ(COUNT + 1, entries.size());
+    for(int i = 0; i < COUNT; ++i)
+    {
+        EXPECT_EQ(i, entries[i].second.toInt());
+    }
+    EXPECT_TRUE(entries[COUNT].second == QVariant(QString("ch1")));
+
+    // Between two others, and before the first one.
+    EXPECT_TRUE(mgr.addBookmarkEntry(node.id(), BookmarkEntry("again 7", 7)));
+    EXPECT_TRUE(mgr.addBookmarkEntry(node.id(), BookmarkEntry("first", -1)));
+    EXPECT_TRUE(mgr.getBookmarkEntries(node.id(), entries));
+    ASSERT_EQ(COUNT + 3, entries.size());
+    EXPECT_TRUE(entries[0].first == "first");
+    EXPECT_TRUE(entries[8].first == "page 7");
+    EXPECT_TRUE(entries[9].first == "again 7");
+    EXPECT_TRUE(entries[10].first == "page 8");
+    EXPECT_TRUE(mgr.removeBookmarkEntry(node.id(), BookmarkEntry("again 7", 7)));
+    EXPECT_TRUE(mgr.removeBookmarkEntry(node.id(), BookmarkEntry("first", -1)));
+
+    EXPECT_TRUE(mgr.getBookmarkEntries(node.id(), 100, 104, entries));
+    ASSERT_EQ(5, entries.size());
+    EXPECT_TRUE(entries[0].first == "page 100");
+    EXPECT_TRUE(entries[4].first == "page 104");
+
+    EXPECT_TRUE(mgr.removeBookmarkEntry(node.id(), BookmarkEntry("page 102", 102)));
+    EXPECT_FALSE(mgr.removeBookmarkEntry(node.id(), BookmarkEntry("page 102", 102)));
+    EXPECT_TRUE(mgr.getBookmarkEntries(node.id(), 100, 104, entries));
+    EXPECT_EQ(4, entries.size());
+
+    entries.clear();
+    entries.push_back(BookmarkEntry("only", 1));
+    EXPECT_TRUE(mgr.replaceBookmarkEntries(node.id(), entries));
+    EXPECT_EQ(1, mgr.bookmarkCount(node.id()));
+
+    cms_long id = node.id();
+    mgr.removeContentNode(node);
+    EXPECT_EQ(0, mgr.bookmarkCount(id));
+
+    mgr.close();
+    current.remove(db);
+}
+
+/// A bookmark blob of an old database is moved to the rows when the
+/// database is opened.
+TEST(ContentManagerTest, BookmarkMigration)
+{
+    QDir current = QDir::current();
+    QString db = current.filePath("temp.db");
+    current.remove(db);
+
+    static const int COUNT = 10;
+    cms_long id = CMS_INVALID_ID;
+    {
+        ContentManager mgr;
+        EXPECT_TRUE(mgr.open(db));
+        ContentNode node;
+        node.mutable_name() = "old.file";
+        node.mutable_location() = current.absolutePath();
+        mgr.createContentNode(node);
+        id = node.id();
+
+        // Same layout as QVector<vbf::Bookmark>.
+        cms_blob blob;
+        QDataStream stream(&blob, QIODevice::WriteOnly);
+        stream << static_cast<quint32>(COUNT);
+        for(int i = 0; i < COUNT; ++i)
+        {
+            stream << QString("mark %1").arg(i) << QVariant(COUNT - i);
+        }
+        EXPECT_TRUE(mgr.updateBookmarks(id, blob));
+
+        // Rows left by a newer version are replaced by the blob.
+        EXPECT_TRUE(mgr.addBookmarkEntry(id, BookmarkEntry("mark 0", COUNT)));
+        EXPECT_TRUE(mgr.addBookmarkEntry(id, BookmarkEntry("stale", 1000)));
+        mgr.close();
+    }
+
+    ContentManager mgr;
+    EXPECT_TRUE(mgr.open(db));
+    cms_blob blob;
+    mgr.getBookmarks(id, blob);
+    EXPECT_TRUE(blob.isEmpty());
+
+    BookmarkEntries entries;
+    EXPECT_TRUE(mgr.getBookmarkEntries(id, entries));
+    ASSERT_EQ(COUNT, entries.size());
+    for(int i = 0; i < COUNT; ++i)
+    {
+        EXPECT_EQ(COUNT - i, entries[i].second.toInt());
+        EXPECT_TRUE(entries[i].first == QString("mark %1").arg(i));
+    }
+
+    mgr.close();
+    current.remove(db);
+}
+
 TEST(ContentManagerTest, RecentDocuments)
 {
     QDir current = QDir::current();
@@ -314,6 +437,227 @@ TEST(ContentManagerTest, RecentDocuments)
     current.remove(db);
 }
 
+/// Pages of the recent documents come in access time order, whatever
+/// the order they were added in.
+TEST(ContentManagerTest, RecentDocumentsPaged)
+{
+    QDir current = QDir::current();
+    QString db = current.filePath("temp.db");
+    current.remove(db);
+
+    ContentManager mgr;
+    EXPECT_TRUE(mgr.open(db));
+
+    static const int COUNT = 10;
+    cms_long ids[COUNT] = {CMS_INVALID_ID};
+    for(int i = 0; i < COUNT; ++i)
+    {
+        // Day 1 is the most recent.
+        int day = (i * 7) % COUNT + 1;
+        ContentNode node;
+        node.mutable_name() = QString("recent_%1.file").arg(day);
+        node.mutable_location() = current.absolutePath();
+        node.mutable_last_access() = QString("2010-03-%1 10:00:00").arg(31 - day);
+        EXPECT_TRUE(mgr.createContentNode(node));
+        EXPECT_TRUE(mgr.addToRecentDocuments(node.id()));
+        ids[day - 1] = node.id();
+    }
+    EXPECT_EQ(COUNT, mgr.recentDocumentCount());
+
+    ContentNodes nodes;
+    EXPECT_TRUE(mgr.getRecentDocuments(nodes));
+    ASSERT_EQ(static_cast<size_t>(COUNT), nodes.size());
+    for(int i = 0; i < COUNT; ++i)
+    {
+        EXPECT_EQ(ids[i], nodes[i].id());
+        EXPECT_TRUE(nodes[i].name() == QString("recent_%1.file").arg(i + 1));
+    }
+
+    EXPECT_TRUE(mgr.getRecentDocuments(nodes, 4, 3));
+    ASSERT_EQ(3u, nodes.size());
+    EXPECT_EQ(ids[4], nodes[0].id());
+    EXPECT_EQ(ids[6], nodes[2].id());
+
+    EXPECT_TRUE(mgr.getRecentDocuments(nodes, COUNT, 3));
+    EXPECT_TRUE(nodes.empty());
+
+    cms_ids result;
+    EXPECT_TRUE(mgr.getRecentDocuments(result));
+    ASSERT_EQ(static_cast<size_t>(COUNT), result.size());
+    for(int i = 0; i < COUNT; ++i)
+    {
+        EXPECT_EQ(ids[i], result[i]);
+    }
+
+    // Reading the oldest one again moves it to the front.
+    ContentNode node;
+    EXPECT_TRUE(mgr.getContentNode(ids[COUNT - 1], node));
+    node.mutable_last_access() = "2010-04-01 08:00:00";
+    EXPECT_TRUE(mgr.updateContentNode(node));
+    EXPECT_TRUE(mgr.getRecentDocuments(nodes, 0, 1));
+    ASSERT_EQ(1u, nodes.size());
+    EXPECT_EQ(ids[COUNT - 1], nodes[0].id());
+
+    mgr.close();
+    current.remove(db);
+}
+
+/// The numeric access time is computed from the text one when a
+/// database of an older version is opened.
+TEST(ContentManagerTest, AccessTimeMigration)
+{
+    QDir current = QDir::current();
+    QString db = current.filePath("temp.db");
+    current.remove(db);
+
+    static const int COUNT = 5;
+    {
+        QSqlDatabase old = QSqlDatabase::addDatabase("QSQLITE", "old_cms");
+        old.setDatabaseName(db);
+        ASSERT_TRUE(old.open());
+        QSqlQuery query(old);
+        ASSERT_TRUE(query.exec("create table content ("
+                               "id integer primary key, name text, location text, "
+                               "title text, authors text, description text, "
+                               "last_access text, publisher text, md5 text, "
+                               "size integer, rating integer, read_time integer, "
+                               "read_count integer, progress text, attributes blob)"));
+        ASSERT_TRUE(query.exec("create table content_category ("
+                               "id integer primary key, content_id integer, "
+                               "category_id integer)"));
+        for(int i = 0; i < COUNT; ++i)
+        {
+            query.prepare("insert into content (id, name, last_access) values (?, ?, ?)");
+            query.addBindValue(i + 1);
+            query.addBindValue(QString("old_%1.file").arg(i));
+            query.addBindValue(QString("2009-12-31 23:5%1:00").arg(i));
+            ASSERT_TRUE(query.exec());
+            query.prepare("insert into content_category (content_id, category_id) values (?, ?)");
+            query.addBindValue(i + 1);
+            query.addBindValue(ContentManager::RECENT_DOCUMENTS_ID);
+            ASSERT_TRUE(query.exec());
+        }
+        old.close();
+    }
+    QSqlDatabase::removeDatabase("old_cms");
+
+    ContentManager mgr;
+    EXPECT_TRUE(mgr.open(db));
+    ContentNodes nodes;
+    EXPECT_TRUE(mgr.getRecentDocuments(nodes));
+    ASSERT_EQ(static_cast<size_t>(COUNT), nodes.size());
+    for(int i = 0; i < COUNT; ++i)
+    {
+        EXPECT_EQ(COUNT - i, nodes[i].id());
+        EXPECT_TRUE(nodes[i].last_access() == QString("2009-12-31 23:5%1:00").arg(COUNT - 1 - i));
+    }
+
+    mgr.close();
+    current.remove(db);
+}
+
+TEST(ContentManagerTest, AnnotationIndexTokenize)
+{
+    QString cjk = QString::fromUtf8("\xe4\xb8\xad\xe6\x96\x87");
+    QStringList words = AnnotationIndex::tokenize("Hello, World-2010 " + cjk + "ok");
+    ASSERT_EQ(6, words.size());
+    EXPECT_TRUE(words[0] == "hello");
+    EXPECT_TRUE(words[1] == "world");
+    EXPECT_TRUE(words[2] == "2010");
+    EXPECT_TRUE(words[3] == cjk.left(1));
+    EXPECT_TRUE(words[4] == cjk.right(1));
+    EXPECT_TRUE(words[5] == "ok");
+}
+
+TEST(ContentManagerTest, AnnotationIndex)
+{
+    QDir current = QDir::current();
+    QString db = current.filePath("temp.db");
+    current.remove(db);
+
+    ContentManager mgr;
+    EXPECT_TRUE(mgr.open(db));
+
+    QStringList page;
+    page << "The quick brown fox" << "jumps over" << "the lazy dog";
+    EXPECT_TRUE(mgr.updateAnnotationIndex("/books/a.pdf", 3, page));
+    page.clear();
+    page << "" << "Quickly now";
+    EXPECT_TRUE(mgr.updateAnnotationIndex("/books/b.pdf", 10, page));
+    EXPECT_EQ(4, mgr.annotationIndexSize());
+
+    AnnotationHits hits;
+    EXPECT_TRUE(mgr.searchAnnotations("QUICK", hits));
+    ASSERT_EQ(2, hits.size());
+    EXPECT_TRUE(hits[0].document == "/books/a.pdf");
+    EXPECT_EQ(3, hits[0].page);
+    EXPECT_EQ(0, hits[0].annotation);
+    EXPECT_TRUE(hits[1].document == "/books/b.pdf");
+    EXPECT_EQ(1, hits[1].annotation);
+    EXPECT_TRUE(hits[1].title == "Quickly now");
+
+    EXPECT_TRUE(mgr.searchAnnotations("quick fox", hits));
+    EXPECT_EQ(1, hits.size());
+    EXPECT_TRUE(mgr.searchAnnotations("quick cat", hits));
+    EXPECT_EQ(0, hits.size());
+    EXPECT_TRUE(mgr.searchAnnotations("the", hits, 1));
+    EXPECT_EQ(1, hits.size());
+
+    // Saving the page again replaces its annotations.
+    page.clear();
+    page << "slow brown fox";
+    EXPECT_TRUE(mgr.updateAnnotationIndex("/books/a.pdf", 3, page));
+    EXPECT_TRUE(mgr.searchAnnotations("quick", hits));
+    EXPECT_EQ(1, hits.size());
+    EXPECT_TRUE(mgr.searchAnnotations("slow", hits));
+    EXPECT_EQ(1, hits.size());
+
+    EXPECT_TRUE(mgr.removeAnnotationIndex("/books/b.pdf"));
+    EXPECT_TRUE(mgr.searchAnnotations("quick", hits));
+    EXPECT_EQ(0, hits.size());
+    EXPECT_EQ(1, mgr.annotationIndexSize());
+
+    mgr.close();
+    current.remove(db);
+}
+
+/// Thousands of books with annotations on many pages.
+TEST(ContentManagerTest, AnnotationIndexSearchTime)
+{
+    QDir current = QDir::current();
+    QString db = current.filePath("temp.db");
+    current.remove(db);
+
+    ContentManager mgr;
+    EXPECT_TRUE(mgr.open(db));
+
+    static const int BOOKS = 2000;
+    static const int PAGES = 2;
+    for(int i = 0; i < BOOKS; ++i)
+    {
+        for(int j = 0; j < PAGES; ++j)
+        {
+            QStringList page;
+            page << QString("highlight %1 of book %2").arg(j).arg(i)
+                 << QString("note w%1x%2 about chapter %3").arg(i).arg(j).arg(j);
+            mgr.updateAnnotationIndex(QString("/books/%1.pdf").arg(i), j, page);
+        }
+    }
+    EXPECT_EQ(BOOKS * PAGES * 2, mgr.annotationIndexSize());
+
+    QTime t;
+    t.start();
+    AnnotationHits hits;
+    EXPECT_TRUE(mgr.searchAnnotations("w1234x1", hits));
+    EXPECT_EQ(1, hits.size());
+    EXPECT_TRUE(mgr.searchAnnotations("chapter 1 about", hits, 100));
+    EXPECT_EQ(100, hits.size());
+    EXPECT_LT(t.elapsed(), 1000);
+
+    mgr.close();
+    current.remove(db);
+}
+
 TEST(ContentManagerTest, sketchDB)
 {
     QString db = getSketchDB("a.pdf");
@@ -0,0 +1,119 @@
+#include "gtest/gtest.h"
+#include "onyx/base/base.h"
+#include "onyx/cms/content_manager.h"
+
+namespace
+{
+using namespace cms;
+
+static const int NOTES = 5000;
+static const int PAGE = 9;
+
+static QString noteName(int i)
+{
+    return QString("scribble_%1_2013-05-01_10:%2").arg(i).arg(i % 60, 2, 10, QChar('0'));
+}
+
+/// Notes table of the previous versions, without the sequence column
+/// and with two rows for the first note.
+static void writeNotes(const QString & path)
+{
+    {
+        QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", "notes_manager_unittest");
+        database.setDatabaseName(path);
+        ASSERT_TRUE(database.open());
+
+        QImage image(60, 80, QImage::Format_RGB32);
+        database.transaction();
+        QSqlQuery query(database);
+        ASSERT_TRUE(query.exec("create table notes (id integer primary key, name text, thumbnail blob)"));
+        query.prepare("insert into notes (name, thumbnail) values(?, ?)");
+        for(int i = 1; i <= NOTES + 1; ++i)
+        {
+            NoteInfo note;
+            note.mutable_name() = noteName(i <= NOTES ? i : 1);
+            image.fill(qRgb(i % 256, i % 256, i % 256));
+            note.mutable_thumbnail() = image;
+            QByteArray data;
+            note.thumbnail(data);
+            query.bindValue(0, note.name());
+            query.bindValue(1, data);
+            ASSERT_TRUE(query.exec());
+        }
+        database.commit();
+        database.close();
+    }
+    QSqlDatabase::removeDatabase("notes_manager_unittest");
+}
+
+TEST(NotesManagerTest, Latency)
+{
+    QDir current = QDir::current();
+    QString db = current.filePath("temp.db");
+    current.remove(db);
+    writeNotes(db);
+
+    // The table is converted once.
+    ContentManager mgr;
+    QTime timer;
+    timer.start();
+    ASSERT_TRUE(mgr.open(db));
+    int open = timer.elapsed();
+    EXPECT_EQ(NOTES, mgr.noteCount());
+
+    timer.restart();
+    QString name = mgr.suggestedNoteName();
+    int suggest = timer.elapsed();
+    EXPECT_TRUE(name.startsWith(QString("scribble_%1_").arg(NOTES + 1)));
+
+    timer.restart();
+    Notes names;
+    EXPECT_TRUE(mgr.listNotes(names));
+    int list = timer.elapsed();
+    ASSERT_EQ(NOTES, names.size());
+    EXPECT_TRUE(names.front().thumbnail().isNull());
+
+    // One page of the notes dialog. The first note is the last one, its
+    // first row has been dropped.
+    timer.restart();
+    Notes page;
+    EXPECT_TRUE(mgr.listNotes(page, 900, PAGE));
+    EXPECT_TRUE(mgr.loadNoteThumbnails(page));
+    int page_time = timer.elapsed();
+    ASSERT_EQ(PAGE, page.size());
+    EXPECT_EQ(noteName(902), page.front().name());
+    EXPECT_FALSE(page.front().thumbnail().isNull());
+
+    QImage image;
+    EXPECT_TRUE(mgr.noteThumbnail(noteName(1), image));
+    EXPECT_FALSE(image.isNull());
+
+    timer.restart();
+    Notes notes;
+    mgr.allNotes(notes);
+    int all = timer.elapsed();
+    EXPECT_EQ(NOTES, notes.size());
+
+    printf("%d notes: conversion %d ms, suggested name %d ms, list %d ms, "
+           "page of %d %d ms, all with thumbnails %d ms\n",
+           NOTES, open, suggest, list, PAGE, page_time, all);
+    EXPECT_LT(suggest, all);
+    EXPECT_LT(page_time, all);
+    EXPECT_LT(list, all);
+
+    // Adding a note again replaces it.
+    NoteInfo note;
+    note.mutable_name() = noteName(1);
+    EXPECT_TRUE(mgr.addNoteIndex(note));
+    EXPECT_EQ(NOTES, mgr.noteCount());
+
+    note.mutable_name() = name;
+    EXPECT_TRUE(mgr.addNoteIndex(note));
+    EXPECT_EQ(NOTES + 1, mgr.noteCount());
+    EXPECT_TRUE(mgr.suggestedNoteName().startsWith(QString("scribble_%1_").arg(NOTES + 2)));
+
+    mgr.close();
+    current.remove(db);
+}
+
+}
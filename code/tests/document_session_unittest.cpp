@@ -0,0 +1,227 @@
+#include <stdlib.h>
+
+#include "gtest/gtest.h"
+#include "onyx/base/base.h"
+#include "onyx/data/document_session.h"
+#include "onyx/data/annotation_agent.h"
+
+using namespace vbf;
+using namespace cms;
+
+namespace
+{
+
+/// Document with options, bookmarks and a thumbnail, in a directory
+/// also used as home so that the content database is a new one.
+class Document
+{
+public:
+    Document()
+        : dir_(QDir::temp().filePath(QString("document_session_unittest_%1").arg(QCoreApplication::applicationPid())))
+    {
+        QDir().mkpath(dir_.absolutePath());
+        setenv("HOME", qPrintable(dir_.absolutePath()), 1);
+        path_ = dir_.filePath("book.pdf");
+
+        QFile file(path_);
+        file.open(QIODevice::WriteOnly);
+        file.write(QByteArray(4096, 'x'));
+        file.close();
+
+        ContentManager db;
+        openDatabase(path_, db);
+        configuration_.options[CONFIG_PAGE_NUMBER] = 42;
+        configuration_.options[CONFIG_FONT_SIZE] = 12;
+        saveDocumentOptions(db, path_, configuration_);
+
+        Bookmarks bookmarks;
+        for (int i = 0; i < 20; ++i)
+        {
+            bookmarks.push_back(Bookmark(QString("mark %1").arg(i), i * 3));
+        }
+        saveBookmarks(db, path_, bookmarks);
+        bookmark_count_ = bookmarks.size();
+
+        QImage image(thumbnailSize(THUMBNAIL_LARGE), QImage::Format_RGB32);
+        image.fill(0xff808080);
+        ContentThumbnail thumbs(dir_.absolutePath());
+        thumbs.storeThumbnail("book.pdf", THUMBNAIL_LARGE, image);
+    }
+
+    const QString & path() const { return path_; }
+    const Configuration & configuration() const { return configuration_; }
+    int bookmarkCount() const { return bookmark_count_; }
+
+private:
+    QDir dir_;
+    QString path_;
+    Configuration configuration_;
+    int bookmark_count_;
+};
+
+TEST(DocumentSessionTest, LoadsAllPieces)
+{
+    Document doc;
+    DocumentSession session(doc.path());
+    ASSERT_TRUE(session.waitForAll(10000));
+    for (int i = 0; i < PIECE_COUNT; ++i)
+    {
+        EXPECT_TRUE(session.isReady(static_cast<DocumentPiece>(i)));
+        EXPECT_GE(session.elapsed(static_cast<DocumentPiece>(i)), 0);
+    }
+
+    EXPECT_TRUE(session.configuration().options == doc.configuration().options);
+    EXPECT_NE(CMS_INVALID_ID, session.configuration().info.id());
+    EXPECT_EQ(doc.bookmarkCount(), session.bookmarks().size());
+    EXPECT_FALSE(session.thumbnail().isNull());
+    EXPECT_EQ(-1, session.timeToFirstPage());
+}
+
+/// A document never opened before gets its content node once.
+TEST(DocumentSessionTest, NewDocument)
+{
+    Document doc;
+    QString path = QFileInfo(doc.path()).dir().filePath("new.pdf");
+    QFile file(path);
+    file.open(QIODevice::WriteOnly);
+    file.write(QByteArray(1000, 'y'));
+    file.close();
+
+    DocumentSession session(path);
+    ASSERT_TRUE(session.waitForAll(10000));
+    EXPECT_TRUE(session.configuration().options.isEmpty());
+    EXPECT_TRUE(session.bookmarks().isEmpty());
+    EXPECT_TRUE(session.thumbnail().isNull());
+
+    ContentManager db;
+    openDatabase(path, db);
+    cms_ids ids;
+    db.allNodes(ids);
+    int count = 0;
+    for (cms_ids_iter it = ids.begin(); it != ids.end(); ++it)
+    {
+        ContentNode node;
+        db.getContentNode(*it, node);
+        count += (node.name() == "new.pdf");
+    }
+    EXPECT_EQ(1, count);
+}
+
+/// The workers open a database which does not exist yet at the same
+/// time, the categories are created once.
+TEST(DocumentSessionTest, NewDatabase)
+{
+    Document doc;
+    QString database_path;
+    getDatabasePath(doc.path(), database_path);
+    for (int i = 0; i < 5; ++i)
+    {
+        QFile::remove(database_path);
+        DocumentSession session(doc.path());
+        ASSERT_TRUE(session.waitForAll(10000));
+    }
+
+    {
+        QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", "document_session_unittest");
+        database.setDatabaseName(database_path);
+        ASSERT_TRUE(database.open());
+        QSqlQuery query(database);
+        ASSERT_TRUE(query.exec("select count(*) from category_category group by "
+                               "child_category_id, parent_category_id having count(*) > 1"));
+        EXPECT_FALSE(query.next());
+        ASSERT_TRUE(query.exec("select count(*) from category group by name having count(*) > 1"));
+        EXPECT_FALSE(query.next());
+        database.close();
+    }
+    QSqlDatabase::removeDatabase("document_session_unittest");
+}
+
+/// The notes are opened when the viewer goes back to the event loop
+/// after the first page.
+TEST(DocumentSessionTest, NotesAfterFirstPage)
+{
+    Document doc;
+    anno::AnnotationAgent agent;
+    DocumentSession session(doc.path());
+    session.setNotes(&agent, 0);
+
+    ASSERT_TRUE(session.waitFor(PIECE_OPTIONS, 10000));
+    session.firstPageShown();
+    EXPECT_GE(session.timeToFirstPage(), 0);
+    EXPECT_FALSE(session.areNotesOpened());
+
+    QTime t;
+    t.start();
+    while (!session.areNotesOpened() && t.elapsed() < 10000)
+    {
+        QCoreApplication::processEvents();
+    }
+    EXPECT_TRUE(session.areNotesOpened());
+    EXPECT_TRUE(session.isReady(PIECE_NOTES));
+
+    // The annotations are in the file read ahead.
+    EXPECT_TRUE(QFile::exists(getSketchDB(doc.path())));
+}
+
+/// Prints the time to first page when the viewer loads everything in
+/// sequence, and when it only waits for the options.
+TEST(DocumentSessionTest, TimeToFirstPage)
+{
+    Document doc;
+    const int ROUNDS = 10;
+
+    int sequential = 0;
+    for (int i = 0; i < ROUNDS; ++i)
+    {
+        QTime t;
+        t.start();
+        ContentManager db;
+        openDatabase(doc.path(), db);
+        Configuration conf;
+        loadDocumentOptions(db, doc.path(), conf);
+        Bookmarks bookmarks;
+        loadBookmarks(db, doc.path(), bookmarks);
+        anno::AnnotationAgent agent;
+        agent.open(doc.path());
+        QImage image;
+        ContentThumbnail thumbs(QFileInfo(doc.path()).path());
+        thumbs.loadThumbnail(QFileInfo(doc.path()).fileName(), THUMBNAIL_LARGE, image);
+        sequential += t.elapsed();
+    }
+
+    int session_total = 0;
+    int pieces[PIECE_COUNT] = { 0 };
+    for (int i = 0; i < ROUNDS; ++i)
+    {
+        anno::AnnotationAgent agent;
+        DocumentSession session(doc.path());
+        session.setNotes(&agent, 0);
+        session.waitFor(PIECE_OPTIONS);
+        session.firstPageShown();
+        session_total += session.timeToFirstPage();
+        session.waitForAll();
+        session.openNotes();
+        for (int j = 0; j < PIECE_COUNT; ++j)
+        {
+            pieces[j] += session.elapsed(static_cast<DocumentPiece>(j));
+        }
+    }
+
+    printf("Time to first page: %.1f ms in sequence, %.1f ms with DocumentSession\n",
+           static_cast<double>(sequential) / ROUNDS,
+           static_cast<double>(session_total) / ROUNDS);
+    for (int j = 0; j < PIECE_COUNT; ++j)
+    {
+        printf("  piece %d ready after %.1f ms\n", j,
+               static_cast<double>(pieces[j]) / ROUNDS);
+    }
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,263 @@
+#include <limits.h>
+
+#include "gtest/gtest.h"
+#include "onyx/base/base.h"
+#include "onyx/ui/keyboard_navigator.h"
+
+namespace
+{
+using namespace ui;
+
+static const int ROWS = 25;
+static const int COLUMNS = 20;
+static const int KEYS[] = { Qt::Key_Up, Qt::Key_Down, Qt::Key_Left, Qt::Key_Right };
+
+/// A dialog of ROWS x COLUMNS keys, each row in its own container, with
+/// keys of different sizes so that rows and columns are not aligned.
+class Layout
+{
+public:
+    Layout()
+        : top_(new QWidget)
+    {
+        qsrand(7);
+        top_->setGeometry(0, 0, 600, 800);
+        for(int row = 0; row < ROWS; ++row)
+        {
+            QWidget *line = new QWidget(top_.get());
+            line->setGeometry(0, row * 32, 600, 32);
+            for(int column = 0; column < COLUMNS; ++column)
+            {
+                QWidget *key = new QWidget(line);
+                key->setFocusPolicy(Qt::StrongFocus);
+                key->setGeometry(column * 30 + qrand() % 4, qrand() % 6,
+                                 24 + qrand() % 6, 20 + qrand() % 8);
+                keys_.push_back(key);
+            }
+        }
+        top_->show();
+    }
+
+    QWidget * top() { return top_.get(); }
+    QList<QWidget *> & keys() { return keys_; }
+
+private:
+    scoped_ptr<QWidget> top_;
+    QList<QWidget *> keys_;
+};
+
+static void collectWidgets(QWidget *parent, QList<QWidget *> & widgets)
+{
+    foreach(QObject *object, parent->children())
+    {
+        if (object->isWidgetType())
+        {
+            QWidget *wnd = static_cast<QWidget *>(object);
+            if (wnd->isVisible())
+            {
+                if (wnd->focusPolicy() != Qt::NoFocus)
+                {
+                    widgets.push_back(wnd);
+                }
+                collectWidgets(wnd, widgets);
+            }
+        }
+    }
+}
+
+static QPoint screenPos(QWidget *widget)
+{
+    return widget->mapToGlobal(QPoint(0, 0));
+}
+
+static int screenCenter(QWidget *widget)
+{
+    return screenPos(widget).y() + widget->height() / 2;
+}
+
+static QList<QWidget *> inDirection(const QList<QWidget *> & widgets,
+                                    QWidget *current,
+                                    bool vertical,
+                                    int sign)
+{
+    QList<QWidget *> result;
+    foreach(QWidget *p, widgets)
+    {
+        int diff = vertical ? screenPos(p).y() - screenPos(current).y() :
+                              screenPos(p).x() - screenPos(current).x();
+        if (sign * diff > 0)
+        {
+            result.push_back(p);
+        }
+    }
+    return result;
+}
+
+/// Nearest row or column first.
+struct NearestFirst
+{
+    NearestFirst(bool vertical, int sign) : vertical_(vertical), sign_(sign) {}
+
+    bool operator()(QWidget *a, QWidget *b) const
+    {
+        int diff = vertical_ ? screenCenter(a) - screenCenter(b) : screenPos(a).x() - screenPos(b).x();
+        return (sign_ * diff < 0);
+    }
+
+    bool vertical_;
+    int sign_;
+};
+
+/// The search of moveFocus before FocusIndex: collect every widget, map
+/// them to the screen and scan them in the order of the key.
+static QWidget * linearSearch(QWidget *parent, QWidget *current, int key)
+{
+    QList<QWidget *> widgets;
+    collectWidgets(parent, widgets);
+
+    bool vertical = (key == Qt::Key_Up || key == Qt::Key_Down);
+    int sign = (key == Qt::Key_Up || key == Qt::Key_Left) ? -1 : 1;
+    QList<QWidget *> candidates = inDirection(widgets, current, vertical, sign);
+    if (candidates.isEmpty())
+    {
+        candidates = inDirection(widgets, current, vertical, -sign);
+    }
+    if (candidates.isEmpty())
+    {
+        return 0;
+    }
+
+    qStableSort(candidates.begin(), candidates.end(), NearestFirst(vertical, sign));
+    int threshold = (key == Qt::Key_Up) ? 5 : -1;
+    int dist = INT_MAX;
+    QWidget *result = candidates.front();
+    foreach(QWidget *p, candidates)
+    {
+        int diff = vertical ? abs(screenPos(p).x() - screenPos(current).x()) :
+                              abs(screenCenter(p) - screenCenter(current));
+        if (dist > diff && dist > threshold)
+        {
+            dist = diff;
+            result = p;
+        }
+    }
+    return result;
+}
+
+TEST(KeyboardNavigatorTest, SameAsLinearSearch)
+{
+    Layout layout;
+    FocusIndex & index = FocusIndex::instance(layout.top());
+    ASSERT_EQ(ROWS * COLUMNS, index.size());
+
+    foreach(QWidget *key, layout.keys())
+    {
+        for(size_t k = 0; k < sizeof(KEYS) / sizeof(KEYS[0]); ++k)
+        {
+            ASSERT_EQ(linearSearch(layout.top(), key, KEYS[k]),
+                      index.search(key, KEYS[k]));
+        }
+    }
+    EXPECT_EQ(1, index.rebuilds());
+}
+
+TEST(KeyboardNavigatorTest, Invalidate)
+{
+    Layout layout;
+    FocusIndex & index = FocusIndex::instance(layout.top());
+    QWidget *first = layout.keys().front();
+    QWidget *second = layout.keys().at(1);
+    EXPECT_EQ(linearSearch(layout.top(), first, Qt::Key_Right),
+              index.search(first, Qt::Key_Right));
+    EXPECT_TRUE(index.isValid());
+
+    // Hidden keys are skipped.
+    second->hide();
+    EXPECT_FALSE(index.isValid());
+    EXPECT_NE(second, index.search(first, Qt::Key_Right));
+    EXPECT_EQ(linearSearch(layout.top(), first, Qt::Key_Right),
+              index.search(first, Qt::Key_Right));
+    EXPECT_EQ(ROWS * COLUMNS - 1, index.size());
+
+    // Moving a row moves its keys on the screen.
+    second->show();
+    QWidget *line = first->parentWidget();
+    line->move(line->x() + 1000, line->y());
+    EXPECT_FALSE(index.isValid());
+    EXPECT_EQ(linearSearch(layout.top(), first, Qt::Key_Down),
+              index.search(first, Qt::Key_Down));
+    EXPECT_EQ(3, index.rebuilds());
+}
+
+/// A container inside the dialog, as the keyboard of a search widget.
+/// Moving the dialog does not make its geometry stale.
+TEST(KeyboardNavigatorTest, ChildParent)
+{
+    Layout layout;
+    QWidget *line = layout.keys().front()->parentWidget();
+    FocusIndex & index = FocusIndex::instance(line);
+    EXPECT_EQ(COLUMNS, index.size());
+
+    layout.top()->move(layout.top()->x() + 50, layout.top()->y() + 30);
+    QCoreApplication::processEvents();
+    EXPECT_TRUE(index.isValid());
+    for (int column = 0; column < COLUMNS; ++column)
+    {
+        QWidget *key = layout.keys().at(column);
+        for(size_t k = 0; k < sizeof(KEYS) / sizeof(KEYS[0]); ++k)
+        {
+            EXPECT_EQ(linearSearch(line, key, KEYS[k]), index.search(key, KEYS[k]));
+        }
+    }
+    EXPECT_EQ(1, index.rebuilds());
+}
+
+/// Every key of the layout and every direction, as on a virtual keyboard.
+TEST(KeyboardNavigatorTest, Benchmark)
+{
+    Layout layout;
+    static const int ROUNDS = 2;
+
+    QTime timer;
+    timer.start();
+    for(int round = 0; round < ROUNDS; ++round)
+    {
+        foreach(QWidget *key, layout.keys())
+        {
+            for(size_t k = 0; k < sizeof(KEYS) / sizeof(KEYS[0]); ++k)
+            {
+                linearSearch(layout.top(), key, KEYS[k]);
+            }
+        }
+    }
+    int linear = timer.elapsed();
+
+    FocusIndex & index = FocusIndex::instance(layout.top());
+    timer.restart();
+    for(int round = 0; round < ROUNDS; ++round)
+    {
+        foreach(QWidget *key, layout.keys())
+        {
+            for(size_t k = 0; k < sizeof(KEYS) / sizeof(KEYS[0]); ++k)
+            {
+                index.search(key, KEYS[k]);
+            }
+        }
+    }
+    int indexed = timer.elapsed();
+
+    int searches = ROUNDS * layout.keys().size() * 4;
+    printf("%d widgets, %d searches: %d ms with linear search, %d ms with FocusIndex\n",
+           layout.keys().size(), searches, linear, indexed);
+    EXPECT_EQ(1, index.rebuilds());
+    EXPECT_LE(indexed, linear);
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    QApplication app(argc, argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,238 @@
+#include <limits.h>
+
+#include "gtest/gtest.h"
+#include "onyx/base/base.h"
+#include "onyx/sys/sys_utils.h"
+#include "onyx/ui/page_cache.h"
+
+namespace
+{
+using namespace vbf;
+
+static const int PAGE_WIDTH = 600;
+static const int PAGE_HEIGHT = 800;
+
+static QImage renderPage(int page)
+{
+    QImage image(PAGE_WIDTH, PAGE_HEIGHT, QImage::Format_Indexed8);
+    image.setNumColors(256);
+    image.fill(page & 0xff);
+    return image;
+}
+
+static size_t pageBytes()
+{
+    QImage image = renderPage(0);
+    return image.bytesPerLine() * image.height() + 256 * sizeof(QRgb);
+}
+
+/// Requests the current page, two pages in reading direction and one
+/// page behind.
+class AheadPolicy : public RenderPolicy
+{
+public:
+    void getRenderRequests(const int current_page,
+                           const int previous_page,
+                           const int total,
+                           QVector<int> & result)
+    {
+        result.clear();
+        result.push_back(current_page);
+        int direction = (current_page >= previous_page ? 1 : -1);
+        for (int i = 1; i <= 2; ++i)
+        {
+            int page = current_page + direction * i;
+            if (page >= 0 && page < total)
+            {
+                result.push_back(page);
+            }
+        }
+        int behind = current_page - direction;
+        if (behind >= 0 && behind < total)
+        {
+            result.push_back(behind);
+        }
+        updateRequests(result);
+    }
+};
+
+TEST(PageCacheTest, Budget)
+{
+    PageCache cache(pageBytes() * 3);
+    for (int i = 0; i < 5; ++i)
+    {
+        cache.setCurrentPage(i);
+        EXPECT_TRUE(cache.insert(PageCacheKey(i, 1.0f), renderPage(i)));
+    }
+    EXPECT_EQ(3, cache.count());
+    EXPECT_LE(cache.usedBytes(), cache.budget());
+    EXPECT_EQ(2, cache.evictions());
+
+    // Far pages are evicted first.
+    EXPECT_FALSE(cache.contains(PageCacheKey(0, 1.0f)));
+    EXPECT_FALSE(cache.contains(PageCacheKey(1, 1.0f)));
+    EXPECT_TRUE(cache.contains(PageCacheKey(4, 1.0f)));
+
+    // Too large for the budget.
+    PageCache small(100);
+    EXPECT_FALSE(small.insert(PageCacheKey(0, 1.0f), renderPage(0)));
+}
+
+TEST(PageCacheTest, Key)
+{
+    PageCache cache;
+    EXPECT_TRUE(cache.insert(PageCacheKey(1, 1.0f), renderPage(1)));
+    EXPECT_TRUE(cache.insert(PageCacheKey(1, 1.5f), renderPage(1)));
+    EXPECT_TRUE(cache.insert(PageCacheKey(1, 1.0f, ROTATE_90_DEGREE), renderPage(1)));
+    EXPECT_TRUE(cache.insert(PageCacheKey(1, 1.0f, ROTATE_0_DEGREE, IMAGE_NEED_DITHER), renderPage(1)));
+    EXPECT_EQ(4, cache.count());
+
+    // Replace the same key.
+    EXPECT_TRUE(cache.insert(PageCacheKey(1, 1.0f), renderPage(2)));
+    EXPECT_EQ(4, cache.count());
+    EXPECT_EQ(pageBytes() * 4, cache.usedBytes());
+
+    EXPECT_FALSE(cache.find(PageCacheKey(1, 1.0f)).isNull());
+    EXPECT_TRUE(cache.find(PageCacheKey(2, 1.0f)).isNull());
+    EXPECT_EQ(1, cache.hits());
+    EXPECT_EQ(1, cache.misses());
+
+    cache.removePage(1);
+    EXPECT_EQ(0, cache.count());
+    EXPECT_EQ(0u, cache.usedBytes());
+}
+
+TEST(PageCacheTest, PolicyWeighted)
+{
+    AheadPolicy policy;
+    PageCache cache(pageBytes() * 5);
+    cache.setRenderPolicy(&policy);
+
+    // Reading backward: 10, 9.
+    QVector<int> requests;
+    policy.getRenderRequests(9, 10, 100, requests);
+    cache.setCurrentPage(9);
+    cache.insert(PageCacheKey(10, 1.0f), renderPage(10));
+    cache.insert(PageCacheKey(9, 1.0f), renderPage(9));
+    cache.insert(PageCacheKey(8, 1.0f), renderPage(8));
+    cache.insert(PageCacheKey(7, 1.0f), renderPage(7));
+    cache.insert(PageCacheKey(11, 1.0f), renderPage(11));
+
+    // Page 11 is as close as page 7 and more recent, but it's not
+    // requested, so it goes first.
+    cache.insert(PageCacheKey(12, 1.0f), renderPage(12));
+    EXPECT_TRUE(cache.contains(PageCacheKey(7, 1.0f)));
+    EXPECT_TRUE(cache.contains(PageCacheKey(8, 1.0f)));
+    EXPECT_TRUE(cache.contains(PageCacheKey(10, 1.0f)));
+    EXPECT_FALSE(cache.contains(PageCacheKey(11, 1.0f)));
+}
+
+TEST(PageCacheTest, MemoryPressure)
+{
+    PageCache cache(pageBytes() * 8);
+    for (int i = 0; i < 8; ++i)
+    {
+        cache.insert(PageCacheKey(i, 1.0f), renderPage(i));
+    }
+    EXPECT_EQ(0u, cache.checkMemory(ULONG_MAX));
+    EXPECT_EQ(8, cache.count());
+
+    const unsigned long limit = sys::safeMemoryLimit();
+    size_t released = cache.checkMemory(limit - pageBytes());
+    EXPECT_GE(released, pageBytes() * 3);
+    EXPECT_LE(cache.count(), 5);
+
+    cache.checkMemory(0);
+    EXPECT_EQ(0, cache.count());
+}
+
+/// Replay a reading pattern, prerendering what the policy requests, and
+/// return how often the page the user turned to was already rendered.
+static double simulate(const QVector<int> & pattern, bool use_policy, size_t budget)
+{
+    static const int TOTAL = 300;
+    AheadPolicy policy;
+    PageCache cache(budget);
+    if (use_policy)
+    {
+        cache.setRenderPolicy(&policy);
+    }
+
+    int previous = pattern.front();
+    QVector<int> requests;
+    for (int i = 0; i < pattern.size(); ++i)
+    {
+        int current = pattern[i];
+        cache.setCurrentPage(current);
+        if (cache.find(PageCacheKey(current, 1.0f)).isNull())
+        {
+            cache.insert(PageCacheKey(current, 1.0f), renderPage(current));
+        }
+
+        policy.getRenderRequests(current, previous, TOTAL, requests);
+        foreach(int page, requests)
+        {
+            if (!cache.contains(PageCacheKey(page, 1.0f)))
+            {
+                cache.insert(PageCacheKey(page, 1.0f), renderPage(page));
+            }
+        }
+        previous = current;
+    }
+    return cache.hitRate();
+}
+
+TEST(PageCacheTest, ReadingPatterns)
+{
+    QVector<int> forward, backward, review, random;
+    for (int i = 0; i < 300; ++i)
+    {
+        forward.push_back(i);
+        backward.push_back(299 - i);
+    }
+    // Read forward, every ten pages go back three pages to check something.
+    int page = 0;
+    while (page < 290)
+    {
+        for (int i = 0; i < 10; ++i)
+        {
+            review.push_back(page++);
+        }
+        for (int i = 0; i < 3; ++i)
+        {
+            review.push_back(--page);
+        }
+    }
+    qsrand(3);
+    for (int i = 0; i < 300; ++i)
+    {
+        random.push_back(qrand() % 300);
+    }
+
+    const size_t budget = pageBytes() * 5;
+    struct
+    {
+        const char *name;
+        QVector<int> *pattern;
+    } patterns[] = {
+        { "forward", &forward },
+        { "backward", &backward },
+        { "review", &review },
+        { "random", &random },
+    };
+
+    double rates[4][2];
+    for (int i = 0; i < 4; ++i)
+    {
+        rates[i][0] = simulate(*patterns[i].pattern, false, budget);
+        rates[i][1] = simulate(*patterns[i].pattern, true, budget);
+        printf("%-10s hit rate: distance/LRU %.3f, policy weighted %.3f\n",
+               patterns[i].name, rates[i][0], rates[i][1]);
+    }
+
+    EXPECT_GT(rates[0][1], 0.95);
+    EXPECT_GT(rates[1][1], 0.95);
+    EXPECT_GT(rates[2][1], 0.75);
+}
+
+}
@@ -0,0 +1,323 @@
+#include <stdio.h>
+
+#include <QtCore/QtCore>
+
+#include "gtest/gtest.h"
+#include "onyx/base/base.h"
+#include "onyx/ui/prerender_policies.h"
+
+namespace
+{
+using namespace vbf;
+
+static const int TOTAL = 400;
+
+struct Turn
+{
+    qint64 time;    ///< ms since the book was opened
+    int page;
+};
+typedef QVector<Turn> Trace;
+
+/// Adaptive policy driven by the trace time instead of the wall clock.
+class ReplayAdaptivePolicy : public AdaptiveRenderPolicy
+{
+public:
+    ReplayAdaptivePolicy() : time_(0) {}
+    void setTime(qint64 t) { time_ = t; }
+
+protected:
+    qint64 now() { return time_; }
+
+private:
+    qint64 time_;
+};
+
+/// What most viewers do: the current page and the next one.
+class NextPagePolicy : public RenderPolicy
+{
+public:
+    void getRenderRequests(const int current_page,
+                           const int previous_page,
+                           const int total,
+                           QVector<int> & result)
+    {
+        result.clear();
+        result.push_back(current_page);
+        if (current_page + 1 < total)
+        {
+            result.push_back(current_page + 1);
+        }
+        updateRequests(result);
+    }
+};
+
+/// Replay the trace. Between two turns the renderer works through the
+/// pages requested at the previous turn, one page every render_ms.
+/// Returns how often the page turned to was already prerendered.
+static double replay(RenderPolicy & policy,
+                     const Trace & trace,
+                     int render_ms,
+                     int cache_pages,
+                     ReplayAdaptivePolicy *clock = 0)
+{
+    QList<int> rendered;     // Most recent last.
+    QVector<int> requests;
+    qint64 budget = 0;
+    int hits = 0;
+    int previous = trace.front().page;
+
+    for (int i = 0; i < trace.size(); ++i)
+    {
+        const Turn & turn = trace[i];
+        if (i > 0)
+        {
+            budget += turn.time - trace[i - 1].time;
+            foreach(int page, requests)
+            {
+                if (budget < render_ms)
+                {
+                    break;
+                }
+                if (!rendered.contains(page))
+                {
+                    rendered.push_back(page);
+                    budget -= render_ms;
+                }
+            }
+            // Idle time can not be saved for later.
+            budget = qMin(budget, static_cast<qint64>(0));
+        }
+
+        if (rendered.contains(turn.page))
+        {
+            if (i > 0)
+            {
+                ++hits;
+            }
+            rendered.removeAll(turn.page);
+        }
+        else
+        {
+            budget -= render_ms;
+        }
+        rendered.push_back(turn.page);
+
+        if (clock)
+        {
+            clock->setTime(turn.time);
+        }
+        policy.getRenderRequests(turn.page, previous, TOTAL, requests);
+        previous = turn.page;
+
+        // Keep the requested pages, drop the oldest others.
+        while (rendered.size() > cache_pages)
+        {
+            int victim = 0;
+            while (victim < rendered.size() - 1 && requests.contains(rendered[victim]))
+            {
+                ++victim;
+            }
+            rendered.removeAt(victim);
+        }
+    }
+    return trace.size() > 1 ? static_cast<double>(hits) / (trace.size() - 1) : 0.0;
+}
+
+static Trace readingTrace(int start, int direction, int turns, int interval)
+{
+    Trace trace;
+    qint64 time = 0;
+    int page = start;
+    for (int i = 0; i < turns; ++i)
+    {
+        Turn turn = { time, page };
+        trace.push_back(turn);
+        time += interval + qrand() % interval;
+        page += direction;
+    }
+    return trace;
+}
+
+/// Reading forward, every few pages going back to re-read one or two.
+static Trace rereadingTrace()
+{
+    Trace trace;
+    qint64 time = 0;
+    int page = 0;
+    while (trace.size() < 300)
+    {
+        int forward = 4 + qrand() % 6;
+        for (int i = 0; i < forward; ++i)
+        {
+            Turn turn = { time, page++ };
+            trace.push_back(turn);
+            time += 15000 + qrand() % 15000;
+        }
+        int back = 1 + qrand() % 2;
+        for (int i = 0; i < back; ++i)
+        {
+            Turn turn = { time, --page };
+            trace.push_back(turn);
+            time += 3000;
+        }
+    }
+    return trace;
+}
+
+/// Bursts of fast page turns separated by short pauses.
+static Trace skimmingTrace()
+{
+    Trace trace;
+    qint64 time = 0;
+    int page = 0;
+    while (page < TOTAL - 20)
+    {
+        int burst = 5 + qrand() % 10;
+        for (int i = 0; i < burst; ++i)
+        {
+            Turn turn = { time, page++ };
+            trace.push_back(turn);
+            time += 150 + qrand() % 150;
+        }
+        time += 3000 + qrand() % 5000;
+    }
+    return trace;
+}
+
+/// Recorded trace, one "<ms> <page>" per line.
+static Trace loadTrace(const QString & path)
+{
+    Trace trace;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        return trace;
+    }
+    QTextStream stream(&file);
+    while (!stream.atEnd())
+    {
+        QStringList fields = stream.readLine().simplified().split(' ');
+        if (fields.size() >= 2)
+        {
+            Turn turn = { fields[0].toLongLong(), fields[1].toInt() };
+            trace.push_back(turn);
+        }
+    }
+    return trace;
+}
+
+struct Rates
+{
+    double next;
+    double directional;
+    double adaptive;
+};
+
+static Rates report(const char *name, const Trace & trace, int render_ms = 400)
+{
+    static const int CACHE_PAGES = 10;
+    NextPagePolicy next;
+    DirectionalRenderPolicy directional;
+    ReplayAdaptivePolicy adaptive;
+
+    Rates rates;
+    rates.next = replay(next, trace, render_ms, CACHE_PAGES);
+    rates.directional = replay(directional, trace, render_ms, CACHE_PAGES);
+    rates.adaptive = replay(adaptive, trace, render_ms, CACHE_PAGES, &adaptive);
+    printf("%-10s %4d turns prerendered: next page %.3f, directional %.3f, adaptive %.3f\n",
+           name, trace.size(), rates.next, rates.directional, rates.adaptive);
+    return rates;
+}
+
+TEST(RenderPolicyTest, Direction)
+{
+    DirectionalRenderPolicy policy(2, 1);
+    QVector<int> result;
+
+    policy.getRenderRequests(10, 9, TOTAL, result);
+    ASSERT_EQ(4, result.size());
+    EXPECT_EQ(10, result[0]);
+    EXPECT_EQ(11, result[1]);
+    EXPECT_EQ(12, result[2]);
+    EXPECT_EQ(9, result[3]);
+
+    // One step back does not change the direction.
+    policy.getRenderRequests(11, 10, TOTAL, result);
+    policy.getRenderRequests(10, 11, TOTAL, result);
+    EXPECT_EQ(1, policy.direction());
+
+    // Reading backward for a while does.
+    policy.getRenderRequests(9, 10, TOTAL, result);
+    policy.getRenderRequests(8, 9, TOTAL, result);
+    EXPECT_EQ(-1, policy.direction());
+    EXPECT_EQ(7, result[1]);
+    EXPECT_EQ(0, policy.getPriority(8));
+    EXPECT_EQ(1, policy.getPriority(7));
+
+    // Jumps are ignored.
+    policy.getRenderRequests(100, 8, TOTAL, result);
+    EXPECT_EQ(-1, policy.direction());
+
+    // Stay in range.
+    policy.getRenderRequests(0, 1, TOTAL, result);
+    EXPECT_EQ(2, result.size());
+    EXPECT_TRUE(policy.isRenderingPage(1));
+}
+
+TEST(RenderPolicyTest, AdaptiveWindow)
+{
+    ReplayAdaptivePolicy policy;
+    QVector<int> result;
+
+    qint64 time = 0;
+    for (int page = 1; page < 4; ++page)
+    {
+        time += 30000;
+        policy.setTime(time);
+        policy.getRenderRequests(page, page - 1, TOTAL, result);
+    }
+    EXPECT_EQ(2, policy.currentAhead());
+
+    for (int page = 4; page < 20; ++page)
+    {
+        time += 200;
+        policy.setTime(time);
+        policy.getRenderRequests(page, page - 1, TOTAL, result);
+    }
+    EXPECT_EQ(8, policy.currentAhead());
+    EXPECT_EQ(1 + 8 + 1, result.size());
+
+    time += 60000;
+    policy.setTime(time);
+    policy.getRenderRequests(20, 19, TOTAL, result);
+    EXPECT_EQ(2, policy.currentAhead());
+}
+
+TEST(RenderPolicyTest, TraceReplay)
+{
+    qsrand(5);
+    Rates forward = report("forward", readingTrace(0, 1, 300, 20000));
+    Rates backward = report("backward", readingTrace(TOTAL - 1, -1, 300, 20000));
+    Rates rereading = report("rereading", rereadingTrace());
+    Rates skimming = report("skimming", skimmingTrace());
+
+    EXPECT_GT(forward.directional, 0.95);
+    EXPECT_GT(backward.directional, 0.95);
+    EXPECT_GT(backward.directional, backward.next);
+    EXPECT_GE(rereading.directional, rereading.next);
+    EXPECT_GT(skimming.adaptive, skimming.directional);
+
+    // Replay a recorded trace if there is one.
+    QByteArray path = qgetenv("RENDER_POLICY_TRACE");
+    if (!path.isEmpty())
+    {
+        Trace recorded = loadTrace(path);
+        if (recorded.size() > 1)
+        {
+            report("recorded", recorded);
+        }
+    }
+}
+
+}
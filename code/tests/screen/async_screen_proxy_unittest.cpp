@@ -0,0 +1,173 @@
+// -*- mode: c++; c-basic-offset: 4; -*-
+
+#include "gtest/gtest.h"
+#include "onyx/base/base.h"
+#include "onyx/screen/async_screen_proxy.h"
+#include "fake_screen_server.h"
+
+namespace
+{
+using namespace onyx::screen;
+
+static const QString SERVER_NAME = "async_screen_proxy_unittest";
+
+static void waitFor(AsyncScreenProxy & proxy, int ms)
+{
+    QTime t;
+    t.start();
+    while (t.elapsed() < ms)
+    {
+        proxy.waitForAll(ms - t.elapsed());
+        QCoreApplication::processEvents();
+    }
+}
+
+static bool connectTo(FakeScreenServer & server, AsyncScreenProxy & proxy)
+{
+    QTime t;
+    t.start();
+    while (!proxy.isConnected() && t.elapsed() < 1000)
+    {
+        QCoreApplication::processEvents();
+    }
+    // Make sure the server has accepted the connection.
+    QCoreApplication::processEvents();
+    return proxy.isConnected();
+}
+
+/// Sending commands must not wait for the server.
+TEST(AsyncScreenProxyTest, SendDoesNotBlock)
+{
+    static const int LATENCY = 200;
+    FakeScreenServer server(SERVER_NAME, LATENCY);
+    ASSERT_TRUE(server.listen());
+    AsyncScreenProxy proxy(SERVER_NAME, 8);
+    ASSERT_TRUE(connectTo(server, proxy));
+
+    QTime t;
+    t.start();
+    unsigned int first = proxy.updateScreenRegion(QRect(0, 0, 100, 100), ScreenProxy::GU);
+    unsigned int second = proxy.updateScreenRegion(QRect(0, 100, 100, 100), ScreenProxy::GU);
+    EXPECT_LT(t.elapsed(), LATENCY);
+    EXPECT_LT(first, second);
+    EXPECT_FALSE(proxy.isFinished(first));
+
+    EXPECT_TRUE(proxy.waitForFinished(second, LATENCY * 4));
+    EXPECT_TRUE(proxy.isFinished(first));
+    EXPECT_EQ(2, server.processed());
+}
+
+/// Completions are delivered in order with matching sequence numbers.
+TEST(AsyncScreenProxyTest, CompletionOrder)
+{
+    static const int COUNT = 32;
+    FakeScreenServer server(SERVER_NAME, 2);
+    ASSERT_TRUE(server.listen());
+    AsyncScreenProxy proxy(SERVER_NAME, 4);
+    ASSERT_TRUE(connectTo(server, proxy));
+
+    CompletionRecorder recorder;
+    QObject::connect(&proxy, SIGNAL(commandFinished(unsigned int, bool)),
+                     &recorder, SLOT(onCommandFinished(unsigned int, bool)));
+
+    QList<unsigned int> sent;
+    for (int i = 0; i < COUNT; ++i)
+    {
+        sent.push_back(proxy.updateScreenRegion(QRect(0, i * 10, 600, 10)));
+    }
+    EXPECT_TRUE(proxy.waitForAll(5000));
+    EXPECT_EQ(sent, recorder.finished());
+    EXPECT_EQ(0, recorder.failed());
+
+    // The server sees the regions in the same order.
+    ASSERT_EQ(COUNT, server.commands().size());
+    for (int i = 0; i < COUNT; ++i)
+    {
+        EXPECT_EQ(i * 10, server.commands().at(i).top);
+        EXPECT_TRUE(server.commands().at(i).wait_flags & ScreenCommand::WAIT_COMMAND_FINISH);
+    }
+}
+
+/// A lost or duplicated reply does not shift the following completions.
+TEST(AsyncScreenProxyTest, LostAndDuplicatedReplies)
+{
+    static const int COUNT = 8;
+    FakeScreenServer server(SERVER_NAME, 2);
+    server.setReplyCopies(2, 0);
+    server.setReplyCopies(5, 2);
+    ASSERT_TRUE(server.listen());
+    AsyncScreenProxy proxy(SERVER_NAME, 4);
+    ASSERT_TRUE(connectTo(server, proxy));
+
+    CompletionRecorder recorder;
+    QObject::connect(&proxy, SIGNAL(commandFinished(unsigned int, bool)),
+                     &recorder, SLOT(onCommandFinished(unsigned int, bool)));
+
+    QList<unsigned int> sent;
+    for (int i = 0; i < COUNT; ++i)
+    {
+        sent.push_back(proxy.updateScreenRegion(QRect(0, i * 10, 600, 10)));
+    }
+    EXPECT_TRUE(proxy.waitForAll(5000));
+    EXPECT_EQ(sent, recorder.finished());
+    EXPECT_EQ(0, recorder.failed());
+
+    // The next command is not finished by the extra reply.
+    unsigned int last = proxy.updateScreen(ScreenProxy::GU);
+    EXPECT_FALSE(proxy.isFinished(last));
+    EXPECT_TRUE(proxy.waitForFinished(last, 1000));
+    EXPECT_EQ(COUNT + 1, server.processed());
+}
+
+/// No more than window() commands reach the server at the same time.
+TEST(AsyncScreenProxyTest, Window)
+{
+    FakeScreenServer server(SERVER_NAME, 100);
+    ASSERT_TRUE(server.listen());
+    AsyncScreenProxy proxy(SERVER_NAME, 3);
+    ASSERT_TRUE(connectTo(server, proxy));
+
+    for (int i = 0; i < 10; ++i)
+    {
+        proxy.updateScreen(ScreenProxy::GU);
+    }
+    EXPECT_EQ(3, proxy.inFlightCount());
+    EXPECT_EQ(7, proxy.pendingCount());
+
+    waitFor(proxy, 50);
+    EXPECT_LE(server.received(), 3);
+
+    EXPECT_TRUE(proxy.waitForAll(5000));
+    EXPECT_EQ(10, server.processed());
+}
+
+/// A hung server does not block the window forever.
+TEST(AsyncScreenProxyTest, Timeout)
+{
+    FakeScreenServer server(SERVER_NAME, 0);
+    server.setReplyEnabled(false);
+    ASSERT_TRUE(server.listen());
+    AsyncScreenProxy proxy(SERVER_NAME, 2);
+    proxy.setTimeout(100);
+    ASSERT_TRUE(connectTo(server, proxy));
+
+    CompletionRecorder recorder;
+    QObject::connect(&proxy, SIGNAL(commandFinished(unsigned int, bool)),
+                     &recorder, SLOT(onCommandFinished(unsigned int, bool)));
+    for (int i = 0; i < 4; ++i)
+    {
+        proxy.ensureUpdateFinished();
+    }
+    EXPECT_TRUE(proxy.waitForAll(2000));
+    EXPECT_EQ(4, recorder.finished().size());
+    EXPECT_EQ(4, recorder.failed());
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,135 @@
+// -*- mode: c++; c-basic-offset: 4; -*-
+
+#include "fake_screen_server.h"
+
+namespace onyx
+{
+namespace screen
+{
+
+FakeScreenServer::FakeScreenServer(const QString & name, int latency)
+: name_(name)
+, latency_(latency)
+, reply_(true)
+, busy_(false)
+, received_(0)
+, processed_(0)
+, client_(0)
+, frames_consumed_(0)
+, bytes_consumed_(0)
+, checksum_(0)
+{
+    connect(&server_, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+}
+
+FakeScreenServer::~FakeScreenServer()
+{
+    server_.close();
+}
+
+bool FakeScreenServer::listen()
+{
+    QLocalServer::removeServer(name_);
+    return server_.listen(name_);
+}
+
+void FakeScreenServer::onNewConnection()
+{
+    client_ = server_.nextPendingConnection();
+    connect(client_, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+}
+
+void FakeScreenServer::onReadyRead()
+{
+    buffer_.append(client_->readAll());
+    const int size = sizeof(ScreenCommand);
+    while (buffer_.size() >= size)
+    {
+        ScreenCommand command;
+        memcpy(&command, buffer_.constData(), size);
+        buffer_.remove(0, size);
+        ++received_;
+        commands_.push_back(command);
+        queue_.enqueue(command);
+    }
+    processNext();
+}
+
+void FakeScreenServer::processNext()
+{
+    if (busy_ || queue_.isEmpty())
+    {
+        return;
+    }
+    busy_ = true;
+    QTimer::singleShot(latency_, this, SLOT(onProcessed()));
+}
+
+void FakeScreenServer::onProcessed()
+{
+    ScreenCommand command = queue_.dequeue();
+    ++processed_;
+    busy_ = false;
+    process(command);
+    if (reply_ && (command.wait_flags & ScreenCommand::WAIT_COMMAND_FINISH))
+    {
+        int copies = reply_copies_.value(processed_ - 1, 1);
+        for (int i = 0; i < copies; ++i)
+        {
+            client_->write(reinterpret_cast<const char *>(&command), sizeof(command));
+        }
+        client_->flush();
+    }
+    processNext();
+}
+
+void FakeScreenServer::process(ScreenCommand & command)
+{
+    switch (command.type)
+    {
+    case ScreenCommand::SHM_ATTACH:
+        if (shared_fb_.attach(SharedFrameBuffer::segmentName(command.color)))
+        {
+            command.point_count = ScreenCommand::SHM_ACCEPTED;
+        }
+        break;
+    case ScreenCommand::SHM_DETACH:
+        shared_fb_.close();
+        break;
+    case ScreenCommand::SHM_SYNC:
+    case ScreenCommand::SHM_SYNC_AND_UPDATE:
+        consume(static_cast<unsigned int>(command.size));
+        break;
+    default:
+        break;
+    }
+}
+
+/// Read the damaged pixels straight from the mapping, like the daemon
+/// copying them to the display controller.
+void FakeScreenServer::consume(unsigned int frame)
+{
+    if (!shared_fb_.isValid())
+    {
+        return;
+    }
+
+    QVector<QRect> damage = shared_fb_.damage();
+    foreach(const QRect & rc, damage)
+    {
+        for (int y = rc.top(); y <= rc.bottom(); ++y)
+        {
+            const uchar * line = shared_fb_.scanLine(y);
+            for (int x = rc.left(); x <= rc.right(); ++x)
+            {
+                checksum_ += line[x];
+            }
+        }
+        bytes_consumed_ += rc.width() * rc.height();
+    }
+    ++frames_consumed_;
+    shared_fb_.markConsumed(frame);
+}
+
+}  // namespace screen
+}  // namespace onyx
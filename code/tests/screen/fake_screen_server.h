@@ -0,0 +1,108 @@
+// -*- mode: c++; c-basic-offset: 4; -*-
+
+#ifndef FAKE_SCREEN_SERVER_H_
+#define FAKE_SCREEN_SERVER_H_
+
+#include <QtNetwork/QtNetwork>
+
+#include "onyx/screen/screen_proxy.h"
+#include "onyx/screen/shared_framebuffer.h"
+
+namespace onyx
+{
+namespace screen
+{
+
+/// Stand-in for the screen manager daemon used by tests. It accepts one
+/// client on a local socket, processes commands one after another and
+/// takes latency() ms for each, like the e-ink controller would.
+class FakeScreenServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FakeScreenServer(const QString & name, int latency = 0);
+    ~FakeScreenServer();
+
+    bool listen();
+    QString name() const { return name_; }
+
+    void setLatency(int ms) { latency_ = ms; }
+    int latency() const { return latency_; }
+
+    /// Stop replying to simulate a hung server.
+    void setReplyEnabled(bool enable) { reply_ = enable; }
+
+    /// Send copies replies for the index-th processed command instead of
+    /// one, 0 to lose it.
+    void setReplyCopies(int index, int copies) { reply_copies_.insert(index, copies); }
+
+    int received() const { return received_; }
+    int processed() const { return processed_; }
+    const QList<ScreenCommand> & commands() const { return commands_; }
+
+    /// Frames and bytes read from the client's shared frame buffer, and
+    /// the sum of all pixel values read.
+    int framesConsumed() const { return frames_consumed_; }
+    qint64 bytesConsumed() const { return bytes_consumed_; }
+    quint64 checksum() const { return checksum_; }
+
+private Q_SLOTS:
+    void onNewConnection();
+    void onReadyRead();
+    void onProcessed();
+
+private:
+    void processNext();
+    void process(ScreenCommand & command);
+    void consume(unsigned int frame);
+
+private:
+    QString name_;
+    int latency_;
+    bool reply_;
+    QHash<int, int> reply_copies_;
+    bool busy_;
+    int received_;
+    int processed_;
+    QLocalServer server_;
+    QLocalSocket *client_;
+    QByteArray buffer_;
+    QQueue<ScreenCommand> queue_;
+    QList<ScreenCommand> commands_;
+    SharedFrameBuffer shared_fb_;
+    int frames_consumed_;
+    qint64 bytes_consumed_;
+    quint64 checksum_;
+};
+
+/// Collects commandFinished() notifications of AsyncScreenProxy.
+class CompletionRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    CompletionRecorder() : failed_(0) {}
+
+    const QList<unsigned int> & finished() const { return finished_; }
+    int failed() const { return failed_; }
+
+public Q_SLOTS:
+    void onCommandFinished(unsigned int sequence, bool ok)
+    {
+        finished_.push_back(sequence);
+        if (!ok)
+        {
+            ++failed_;
+        }
+    }
+
+private:
+    QList<unsigned int> finished_;
+    int failed_;
+};
+
+}  // namespace screen
+}  // namespace onyx
+
+#endif
@@ -0,0 +1,229 @@
+// -*- mode: c++; c-basic-offset: 4; -*-
+
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+#include "onyx/base/base.h"
+#include "onyx/screen/screen_proxy.h"
+#include "onyx/screen/shared_framebuffer.h"
+#include "fake_screen_server.h"
+
+namespace
+{
+using namespace onyx::screen;
+
+static const QString SERVER_NAME = "shared_framebuffer_unittest";
+
+static QImage grayImage(int width, int height, int seed)
+{
+    QImage image(width, height, QImage::Format_Indexed8);
+    QVector<QRgb> colors;
+    for (int i = 0; i < 256; ++i)
+    {
+        colors.push_back(qRgb(i, i, i));
+    }
+    image.setColorTable(colors);
+    for (int y = 0; y < height; ++y)
+    {
+        uchar * line = image.scanLine(y);
+        for (int x = 0; x < width; ++x)
+        {
+            line[x] = static_cast<uchar>((x + y + seed) & 0xff);
+        }
+    }
+    return image;
+}
+
+static quint64 sum(const QImage & image)
+{
+    quint64 result = 0;
+    for (int y = 0; y < image.height(); ++y)
+    {
+        const uchar * line = image.scanLine(y);
+        for (int x = 0; x < image.width(); ++x)
+        {
+            result += line[x];
+        }
+    }
+    return result;
+}
+
+/// Runs the fake screen server in its own thread, so that the blocking
+/// ScreenProxy in the test thread can talk to it.
+class ServerThread : public QThread
+{
+public:
+    ServerThread() : frames_(0), bytes_(0), checksum_(0) {}
+
+    void startAndWait()
+    {
+        start();
+        ready_.acquire();
+    }
+
+    int frames_;
+    qint64 bytes_;
+    quint64 checksum_;
+
+protected:
+    void run()
+    {
+        FakeScreenServer server(SERVER_NAME, 0);
+        server.listen();
+        ready_.release();
+        exec();
+        frames_ = server.framesConsumed();
+        bytes_ = server.bytesConsumed();
+        checksum_ = server.checksum();
+    }
+
+private:
+    QSemaphore ready_;
+};
+
+TEST(SharedFrameBufferTest, CreateAndAttach)
+{
+    const QString name = SharedFrameBuffer::segmentName(getpid());
+    SharedFrameBuffer client;
+    ASSERT_TRUE(client.create(name, 601, 800));
+    EXPECT_EQ(604, client.stride());
+
+    SharedFrameBuffer server;
+    ASSERT_TRUE(server.attach(name));
+    EXPECT_EQ(601, server.width());
+    EXPECT_EQ(800, server.height());
+
+    QImage image = grayImage(100, 50, 7);
+    client.copyFrom(image, QPoint(10, 20));
+    QVector<QRect> damage;
+    damage.push_back(QRect(10, 20, 100, 50));
+    unsigned int frame = client.publish(damage);
+    EXPECT_EQ(1u, frame);
+    EXPECT_FALSE(client.waitForConsumed(10));
+
+    // The server sees the same pixels without any copy.
+    ASSERT_EQ(1, server.damage().size());
+    EXPECT_EQ(damage.front(), server.damage().front());
+    EXPECT_EQ(image.scanLine(3)[5], server.scanLine(23)[15]);
+    server.markConsumed(frame);
+    EXPECT_TRUE(client.waitForConsumed(10));
+
+    client.close();
+    SharedFrameBuffer late;
+    EXPECT_FALSE(late.attach(name));
+}
+
+TEST(SharedFrameBufferTest, ConvertToGray)
+{
+    SharedFrameBuffer fb;
+    ASSERT_TRUE(fb.create(SharedFrameBuffer::segmentName(getpid()), 16, 16));
+
+    QImage rgb(4, 4, QImage::Format_RGB32);
+    rgb.fill(qRgb(200, 100, 50));
+    fb.copyFrom(rgb, QPoint(-2, -2));
+    EXPECT_EQ(qGray(qRgb(200, 100, 50)), fb.scanLine(0)[0]);
+    EXPECT_EQ(qGray(qRgb(200, 100, 50)), fb.scanLine(1)[1]);
+    EXPECT_EQ(0, fb.scanLine(2)[2]);
+
+    // Too many damage rectangles are merged.
+    QVector<QRect> damage;
+    for (int i = 0; i < SharedFrameHeader::MAX_DAMAGE + 4; ++i)
+    {
+        damage.push_back(QRect(0, i % 16, 1, 1));
+    }
+    fb.publish(damage);
+    EXPECT_EQ(SharedFrameHeader::MAX_DAMAGE, fb.damage().size());
+}
+
+/// Pixels rendered on a rotated screen land where mapToScreen puts their
+/// rectangle.
+TEST(SharedFrameBufferTest, Rotation)
+{
+    const QRect desk(0, 0, 600, 800);
+    const QRect rect(10, 20, 100, 50);
+    QImage image = grayImage(rect.width(), rect.height(), 3);
+    static const int DEGREES[] = { 0, 90, 180, 270 };
+    for (size_t i = 0; i < sizeof(DEGREES) / sizeof(DEGREES[0]); ++i)
+    {
+        int degree = DEGREES[i];
+        QRect screen = mapToScreen(desk, desk, degree);
+        SharedFrameBuffer fb;
+        ASSERT_TRUE(fb.create(SharedFrameBuffer::segmentName(getpid()), screen.width(), screen.height()));
+
+        QRect rotated = mapToScreen(rect, desk, degree);
+        fb.copyFrom(mapToScreen(image, degree), rotated.topLeft());
+        for (int y = 0; y < rect.height(); y += 7)
+        {
+            for (int x = 0; x < rect.width(); x += 11)
+            {
+                QRect pixel = mapToScreen(QRect(rect.x() + x, rect.y() + y, 1, 1), desk, degree);
+                ASSERT_TRUE(rotated.contains(pixel.topLeft()));
+                EXPECT_EQ(image.scanLine(y)[x], fb.scanLine(pixel.y())[pixel.x()])
+                    << degree << " degrees, at " << x << "," << y;
+            }
+        }
+    }
+}
+
+/// Push full page 8-bit grayscale frames through the shared frame buffer
+/// and report the throughput.
+TEST(SharedFrameBufferTest, Throughput)
+{
+    static const int FRAMES = 100;
+    static const int SIZES[][2] = { { 600, 800 }, { 824, 1200 } };
+
+    qputenv("USE_UNIX_SOCKET", "1");
+    qputenv("SCREEN_SERVER_ADDRESS", SERVER_NAME.toLocal8Bit());
+    ServerThread server;
+    server.startAndWait();
+
+    ScreenProxy & proxy = ScreenProxy::instance();
+    quint64 expected = 0;
+    int frames = 0;
+    for (unsigned int s = 0; s < sizeof(SIZES) / sizeof(SIZES[0]); ++s)
+    {
+        const int width = SIZES[s][0];
+        const int height = SIZES[s][1];
+        ASSERT_TRUE(proxy.openSharedFrameBuffer(width, height));
+
+        QList<QImage> pages;
+        for (int i = 0; i < 4; ++i)
+        {
+            pages.push_back(grayImage(width, height, i));
+        }
+        QVector<QRect> damage;
+        damage.push_back(QRect(0, 0, width, height));
+
+        QTime t;
+        t.start();
+        for (int i = 0; i < FRAMES; ++i)
+        {
+            const QImage & page = pages[i % pages.size()];
+            ASSERT_TRUE(proxy.publish(page, QPoint(), damage));
+            expected += sum(page);
+        }
+        ASSERT_TRUE(proxy.sharedFrameBuffer()->waitForConsumed());
+        const int elapsed = qMax(t.elapsed(), 1);
+        frames += FRAMES;
+
+        const double mb = static_cast<double>(width) * height * FRAMES / (1024 * 1024);
+        printf("%dx%d: %d frames in %d ms, %.1f frames/s, %.1f MB/s\n",
+               width, height, FRAMES, elapsed,
+               FRAMES * 1000.0 / elapsed, mb * 1000.0 / elapsed);
+        proxy.closeSharedFrameBuffer();
+    }
+
+    server.quit();
+    server.wait();
+    EXPECT_EQ(frames, server.frames_);
+    EXPECT_EQ(expected, server.checksum_);
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,244 @@
+// -*- mode: c++; c-basic-offset: 4; -*-
+
+#include <cstdio>
+#include "gtest/gtest.h"
+#include "onyx/base/base.h"
+#include "onyx/screen/waveform_scheduler.h"
+
+namespace
+{
+using namespace onyx::screen;
+
+static const QRect SCREEN(0, 0, 600, 800);
+static const int TILE = 64;
+static const int BUDGET = 8;
+
+static qint64 area(const QRect & rect)
+{
+    return static_cast<qint64>(rect.width()) * rect.height();
+}
+
+/// The waveform choice of ScreenProxy before the scheduler: one counter
+/// of partial updates for the whole screen, and the update that reaches
+/// the interval is done with GC. Also sums the GC area of the widgets
+/// asking for GC themselves.
+class GlobalCounter
+{
+public:
+    GlobalCounter() : count_(0), gc_area_(0) {}
+
+    ScreenProxy::Waveform schedule(const QRect & rect, ScreenProxy::Waveform waveform)
+    {
+        if (WaveformScheduler::isCounted(waveform) && ++count_ >= BUDGET)
+        {
+            waveform = ScreenProxy::GC;
+        }
+        if (waveform == ScreenProxy::GC)
+        {
+            count_ = 0;
+            gc_area_ += area(rect);
+        }
+        return waveform;
+    }
+
+    /// GC update of a widget, not counted by ScreenProxy.
+    void clear(const QRect & rect) { gc_area_ += area(rect); }
+
+    qint64 gcArea() const { return gc_area_; }
+
+private:
+    int count_;
+    qint64 gc_area_;
+};
+
+/// Partial updates of every tile since its last GC, to check how much
+/// ghosting a policy lets through.
+class GhostingMap
+{
+public:
+    GhostingMap() : max_(0) {}
+
+    /// Count one update of every tile intersecting region.
+    void update(const QRegion & region, ScreenProxy::Waveform waveform)
+    {
+        QRect bounding = region.boundingRect();
+        if (bounding.isEmpty())
+        {
+            return;
+        }
+        for(int y = bounding.top() / TILE; y <= bounding.bottom() / TILE; ++y)
+        {
+            for(int x = bounding.left() / TILE; x <= bounding.right() / TILE; ++x)
+            {
+                QRect tile(x * TILE, y * TILE, TILE, TILE);
+                tile &= SCREEN;
+                if (!region.intersects(tile))
+                {
+                    continue;
+                }
+                int & count = counts_[qMakePair(y, x)];
+                if (WaveformScheduler::isClearing(waveform) && (QRegion(tile) - region).isEmpty())
+                {
+                    count = 0;
+                }
+                else if (WaveformScheduler::isCounted(waveform))
+                {
+                    max_ = qMax(max_, ++count);
+                }
+            }
+        }
+    }
+
+    int max() const { return max_; }
+
+private:
+    QHash<QPair<int, int>, int> counts_;
+    int max_;
+};
+
+/// legacy is the waveform the widget asked for before the scheduler,
+/// INVALID when it went through updateWidgetWithGCInterval.
+struct TraceUpdate
+{
+    QRect rect;
+    ScreenProxy::Waveform waveform;
+    ScreenProxy::Waveform legacy;
+};
+
+/// A reading session: page turns, the progress of the status bar on
+/// every page, the clock and the menu from time to time.
+static QVector<TraceUpdate> readingTrace()
+{
+    static const QRect PAGE(0, 0, 600, 760);
+    static const QRect PROGRESS(0, 760, 520, 40);
+    static const QRect CLOCK(540, 770, 60, 20);
+    static const QRect MENU(100, 300, 400, 200);
+    static const QRect BUTTON(110, 310, 120, 40);
+
+    QVector<TraceUpdate> trace;
+    for(int page = 0; page < 300; ++page)
+    {
+        TraceUpdate turn = { PAGE, ScreenProxy::GU, ScreenProxy::INVALID };
+        TraceUpdate progress = { PROGRESS, ScreenProxy::GU, ScreenProxy::GC };
+        trace << turn << progress;
+        if (page % 3 == 0)
+        {
+            TraceUpdate clock = { CLOCK, ScreenProxy::GU, ScreenProxy::GU };
+            trace << clock;
+        }
+        if (page % 25 == 0)
+        {
+            TraceUpdate menu = { MENU, ScreenProxy::GU, ScreenProxy::INVALID };
+            TraceUpdate pressed = { BUTTON, ScreenProxy::DW, ScreenProxy::DW };
+            TraceUpdate button = { BUTTON, ScreenProxy::GU, ScreenProxy::INVALID };
+            trace << menu << pressed << button << turn;
+        }
+    }
+    return trace;
+}
+
+TEST(WaveformSchedulerTest, PromoteTile)
+{
+    WaveformScheduler scheduler(TILE, 3);
+    scheduler.setScreenRect(SCREEN);
+
+    // The clock stays in one tile.
+    QRect clock(10, 10, 40, 20);
+    WaveformUpdates updates;
+    for(int i = 0; i < 2; ++i)
+    {
+        scheduler.schedule(clock, ScreenProxy::GU, updates);
+        ASSERT_EQ(1, updates.size());
+        EXPECT_EQ(ScreenProxy::GU, updates.front().waveform);
+    }
+    EXPECT_EQ(2, scheduler.partialUpdates(clock.topLeft()));
+
+    // Across two tiles: the first one reaches the budget.
+    QRect wide(10, 10, 100, 20);
+    scheduler.schedule(wide, ScreenProxy::GU, updates);
+    ASSERT_EQ(2, updates.size());
+    EXPECT_EQ(ScreenProxy::GU, updates[0].waveform);
+    EXPECT_TRUE(updates[0].rect == QRect(64, 10, 46, 20));
+    EXPECT_EQ(ScreenProxy::GC, updates[1].waveform);
+    EXPECT_TRUE(updates[1].rect == QRect(0, 0, 64, 64));
+    EXPECT_EQ(0, scheduler.partialUpdates(clock.topLeft()));
+    EXPECT_EQ(1, scheduler.partialUpdates(QPoint(100, 10)));
+
+    // DW does not count, GC cleans the tiles it covers.
+    scheduler.schedule(wide, ScreenProxy::DW, updates);
+    EXPECT_EQ(1, scheduler.partialUpdates(QPoint(100, 10)));
+    scheduler.schedule(QRect(64, 0, 64, 64), ScreenProxy::GC, updates);
+    EXPECT_EQ(0, scheduler.partialUpdates(QPoint(100, 10)));
+}
+
+TEST(WaveformSchedulerTest, NoBudget)
+{
+    WaveformScheduler scheduler(TILE, 0);
+    WaveformUpdates updates;
+    for(int i = 0; i < 100; ++i)
+    {
+        scheduler.schedule(SCREEN, ScreenProxy::GU, updates);
+        ASSERT_EQ(1, updates.size());
+        EXPECT_EQ(ScreenProxy::GU, updates.front().waveform);
+    }
+    EXPECT_EQ(0, scheduler.promotedArea());
+}
+
+/// Replay a reading session with both policies. The scheduler must keep
+/// every tile under the budget and refresh less area with GC than the
+/// global counter and the hard-coded waveforms of the status bar.
+TEST(WaveformSchedulerTest, ReplayTrace)
+{
+    QVector<TraceUpdate> trace = readingTrace();
+
+    GlobalCounter global;
+    GhostingMap global_ghosting;
+    foreach(const TraceUpdate & update, trace)
+    {
+        ScreenProxy::Waveform waveform = update.legacy;
+        if (waveform == ScreenProxy::INVALID)
+        {
+            waveform = global.schedule(update.rect, update.waveform);
+        }
+        else if (waveform == ScreenProxy::GC)
+        {
+            global.clear(update.rect);
+        }
+        global_ghosting.update(update.rect, waveform);
+    }
+
+    WaveformScheduler scheduler(TILE, BUDGET);
+    scheduler.setScreenRect(SCREEN);
+    GhostingMap tile_ghosting;
+    WaveformUpdates updates;
+    foreach(const TraceUpdate & update, trace)
+    {
+        scheduler.schedule(update.rect, update.waveform, updates);
+        QRegion partial, clearing;
+        foreach(const WaveformUpdate & u, updates)
+        {
+            if (u.waveform == update.waveform)
+            {
+                partial += u.rect;
+            }
+            else
+            {
+                clearing += u.rect;
+            }
+        }
+        tile_ghosting.update(partial, update.waveform);
+        tile_ghosting.update(clearing, ScreenProxy::GC);
+    }
+
+    qint64 saved = global.gcArea() - scheduler.promotedArea();
+    printf("%d updates, GC area: global %lld, per tile %lld, saved %lld pixels (%lld%%)\n",
+           trace.size(), global.gcArea(), scheduler.promotedArea(), saved,
+           global.gcArea() > 0 ? saved * 100 / global.gcArea() : 0);
+    printf("Most partial updates of a tile: global %d, per tile %d\n",
+           global_ghosting.max(), tile_ghosting.max());
+
+    EXPECT_LT(tile_ghosting.max(), BUDGET);
+    EXPECT_GT(saved, 0);
+}
+
+}
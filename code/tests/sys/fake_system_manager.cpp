@@ -0,0 +1,160 @@
+// -*- mode: c++; c-basic-offset: 4; -*-
+
+#include "fake_system_manager.h"
+#include "onyx/sys/service.h"
+
+namespace sys
+{
+
+static const QString CONNECTION_NAME = "fake_system_manager";
+static const int MAX_BRIGHTNESS = 100;
+
+SystemManagerStub::SystemManagerStub(QAtomicInt & calls)
+: calls_(calls)
+, volume_(50)
+, mute_(false)
+, gray_scale_(16)
+, brightness_(80)
+, suspend_interval_(60000)
+{
+}
+
+SystemManagerStub::~SystemManagerStub()
+{
+}
+
+bool SystemManagerStub::batteryStatus(int & current, int & status)
+{
+    calls_.ref();
+    current = 75;
+    status = 0;
+    return true;
+}
+
+int SystemManagerStub::volume()
+{
+    calls_.ref();
+    return volume_;
+}
+
+bool SystemManagerStub::setVolume(int volume)
+{
+    calls_.ref();
+    volume_ = volume;
+    return true;
+}
+
+bool SystemManagerStub::isMute()
+{
+    calls_.ref();
+    return mute_;
+}
+
+bool SystemManagerStub::mute(bool m)
+{
+    calls_.ref();
+    mute_ = m;
+    return true;
+}
+
+int SystemManagerStub::grayScale()
+{
+    calls_.ref();
+    return gray_scale_;
+}
+
+bool SystemManagerStub::setGrayScale(int colors)
+{
+    calls_.ref();
+    gray_scale_ = colors;
+    return true;
+}
+
+int SystemManagerStub::backlightBrightness()
+{
+    calls_.ref();
+    return brightness_;
+}
+
+/// Refuses values out of range, like the backlight driver.
+bool SystemManagerStub::setBacklightBrightness(int brightness)
+{
+    calls_.ref();
+    if (brightness < 0 || brightness > MAX_BRIGHTNESS)
+    {
+        return false;
+    }
+    brightness_ = brightness;
+    return true;
+}
+
+int SystemManagerStub::suspendInterval()
+{
+    calls_.ref();
+    return suspend_interval_;
+}
+
+bool SystemManagerStub::setSuspendInterval(int ms)
+{
+    calls_.ref();
+    suspend_interval_ = ms;
+    return true;
+}
+
+FakeSystemManager::FakeSystemManager(const QString & address)
+: address_(address)
+, calls_(0)
+, registered_(false)
+{
+}
+
+FakeSystemManager::~FakeSystemManager()
+{
+    stop();
+}
+
+/// Start the thread and wait until the service is registered.
+bool FakeSystemManager::startAndWait()
+{
+    start();
+    ready_.acquire();
+    return registered_;
+}
+
+void FakeSystemManager::stop()
+{
+    if (isRunning())
+    {
+        quit();
+        wait();
+    }
+}
+
+/// Emit a signal of system manager.
+bool FakeSystemManager::broadcast(const QString & signal,
+                                  const QList<QVariant> & args)
+{
+    QDBusMessage message = QDBusMessage::createSignal(object, iface, signal);
+    message.setArguments(args);
+    return QDBusConnection(CONNECTION_NAME).send(message);
+}
+
+void FakeSystemManager::run()
+{
+    QDBusConnection connection = QDBusConnection::connectToBus(address_, CONNECTION_NAME);
+    SystemManagerStub stub(calls_);
+    registered_ = connection.isConnected() &&
+                  connection.registerObject(object, &stub, QDBusConnection::ExportAllSlots) &&
+                  connection.registerService(service);
+    ready_.release();
+
+    if (registered_)
+    {
+        exec();
+        connection.unregisterService(service);
+        connection.unregisterObject(object);
+    }
+    QDBusConnection::disconnectFromBus(CONNECTION_NAME);
+}
+
+}
@@ -0,0 +1,74 @@
+// -*- mode: c++; c-basic-offset: 4; -*-
+
+#ifndef FAKE_SYSTEM_MANAGER_H_
+#define FAKE_SYSTEM_MANAGER_H_
+
+#include "onyx/base/dbus.h"
+
+namespace sys
+{
+
+/// The methods of system manager used by the status bar. Every call is
+/// counted, so that tests can tell how many round trips a client made.
+class SystemManagerStub : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "com.onyx.interface.system_manager")
+
+public:
+    explicit SystemManagerStub(QAtomicInt & calls);
+    ~SystemManagerStub();
+
+public Q_SLOTS:
+    bool batteryStatus(int & current, int & status);
+    int volume();
+    bool setVolume(int volume);
+    bool isMute();
+    bool mute(bool m);
+    int grayScale();
+    bool setGrayScale(int colors);
+    int backlightBrightness();
+    bool setBacklightBrightness(int brightness);
+    int suspendInterval();
+    bool setSuspendInterval(int ms);
+
+private:
+    QAtomicInt & calls_;
+    int volume_;
+    bool mute_;
+    int gray_scale_;
+    int brightness_;
+    int suspend_interval_;
+};
+
+/// Stand-in for system manager. It owns the system manager service on
+/// the bus at address and answers from its own thread, as the real
+/// daemon does from its own process.
+class FakeSystemManager : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit FakeSystemManager(const QString & address);
+    ~FakeSystemManager();
+
+    bool startAndWait();
+    void stop();
+
+    int calls() { return calls_; }
+
+    bool broadcast(const QString & signal, const QList<QVariant> & args);
+
+protected:
+    void run();
+
+private:
+    QString address_;
+    QAtomicInt calls_;
+    QSemaphore ready_;
+    bool registered_;
+};
+
+}
+
+#endif  // FAKE_SYSTEM_MANAGER_H_
@@ -0,0 +1,225 @@
+// -*- mode: c++; c-basic-offset: 4; -*-
+
+#include <poll.h>
+#include <unistd.h>
+#include "fake_wpa_supplicant.h"
+
+static const int POLL_INTERVAL = 50;
+static const int LENGTH = 4096;
+
+FakeWpaSupplicant::FakeWpaSupplicant(const QString & dir,
+                                     const QString & iface,
+                                     int access_points)
+: path_(dir + "/" + iface)
+, iface_(iface)
+, access_points_(access_points)
+, fd_(-1)
+, stop_(false)
+{
+}
+
+FakeWpaSupplicant::~FakeWpaSupplicant()
+{
+    stop();
+}
+
+/// Start the thread and wait until the socket is bound.
+bool FakeWpaSupplicant::startAndWait()
+{
+    QFile::remove(path_);
+    fd_ = socket(PF_UNIX, SOCK_DGRAM, 0);
+    if (fd_ < 0)
+    {
+        return false;
+    }
+
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path_.toLocal8Bit().constData(), sizeof(addr.sun_path) - 1);
+    if (bind(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+    {
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    start();
+    ready_.acquire();
+    return true;
+}
+
+void FakeWpaSupplicant::stop()
+{
+    if (isRunning())
+    {
+        stop_ = true;
+        wait();
+    }
+    if (fd_ >= 0)
+    {
+        close(fd_);
+        fd_ = -1;
+        QFile::remove(path_);
+    }
+}
+
+int FakeWpaSupplicant::requests(const QByteArray & command)
+{
+    QMutexLocker locker(&mutex_);
+    if (command.isEmpty())
+    {
+        return commands_.size();
+    }
+
+    int count = 0;
+    foreach(const QByteArray & received, commands_)
+    {
+        if (received == command || received.startsWith(command + " "))
+        {
+            ++count;
+        }
+    }
+    return count;
+}
+
+void FakeWpaSupplicant::resetRequests()
+{
+    QMutexLocker locker(&mutex_);
+    commands_.clear();
+}
+
+int FakeWpaSupplicant::monitors()
+{
+    QMutexLocker locker(&mutex_);
+    return monitors_.size();
+}
+
+/// Send an unsolicited message, like "CTRL-EVENT-SCAN-RESULTS ", to the
+/// attached monitors.
+bool FakeWpaSupplicant::sendEvent(const QByteArray & event)
+{
+    QByteArray message = "<2>" + event;
+    QMutexLocker locker(&mutex_);
+    bool ok = !monitors_.isEmpty();
+    foreach(const sockaddr_un & monitor, monitors_)
+    {
+        ok = sendto(fd_, message.constData(), message.size(), 0,
+                    reinterpret_cast<const sockaddr *>(&monitor), sizeof(monitor)) >= 0 && ok;
+    }
+    return ok;
+}
+
+void FakeWpaSupplicant::run()
+{
+    ready_.release();
+
+    char buffer[LENGTH];
+    while (!stop_)
+    {
+        pollfd fd;
+        fd.fd = fd_;
+        fd.events = POLLIN;
+        if (poll(&fd, 1, POLL_INTERVAL) <= 0)
+        {
+            continue;
+        }
+
+        sockaddr_un from;
+        socklen_t from_length = sizeof(from);
+        ssize_t size = recvfrom(fd_, buffer, sizeof(buffer), 0,
+                                reinterpret_cast<sockaddr *>(&from), &from_length);
+        if (size < 0)
+        {
+            continue;
+        }
+
+        QByteArray command(buffer, static_cast<int>(size));
+        {
+            QMutexLocker locker(&mutex_);
+            commands_.push_back(command);
+        }
+        QByteArray data = reply(command, from);
+        sendto(fd_, data.constData(), data.size(), 0,
+               reinterpret_cast<sockaddr *>(&from), from_length);
+
+        if (command == "SCAN")
+        {
+            sendEvent("CTRL-EVENT-SCAN-RESULTS ");
+        }
+    }
+}
+
+QByteArray FakeWpaSupplicant::reply(const QByteArray & command,
+                                    const sockaddr_un & from)
+{
+    if (command == "PING")
+    {
+        return "PONG\n";
+    }
+    if (command == "ATTACH")
+    {
+        QMutexLocker locker(&mutex_);
+        monitors_.push_back(from);
+        return "OK\n";
+    }
+    if (command == "DETACH")
+    {
+        QMutexLocker locker(&mutex_);
+        for(int i = 0; i < monitors_.size(); ++i)
+        {
+            if (strcmp(monitors_[i].sun_path, from.sun_path) == 0)
+            {
+                monitors_.removeAt(i);
+                break;
+            }
+        }
+        return "OK\n";
+    }
+    if (command == "INTERFACES")
+    {
+        return iface_.toAscii() + "\n";
+    }
+    if (command == "SCAN")
+    {
+        return "OK\n";
+    }
+    if (command == "SCAN_RESULTS")
+    {
+        return scanResults();
+    }
+    if (command.startsWith("BSS "))
+    {
+        return bss(command.mid(4).toInt());
+    }
+    if (command == "STATUS")
+    {
+        return "wpa_state=SCANNING\naddress=00:11:22:33:44:55\n";
+    }
+    if (command == "LIST_NETWORKS")
+    {
+        return "network id / ssid / bssid / flags\n";
+    }
+    return "FAIL\n";
+}
+
+QByteArray FakeWpaSupplicant::scanResults()
+{
+    QByteArray data("bssid / frequency / signal level / flags / ssid\n");
+    for(int i = 0; i < access_points_; ++i)
+    {
+        data += QString("00:24:01:1e:55:%1\t2412\t-%2\t[WPA2-PSK-CCMP][ESS]\tap%3\n")
+                .arg(i, 2, 16, QChar('0')).arg(40 + i).arg(i).toAscii();
+    }
+    return data;
+}
+
+QByteArray FakeWpaSupplicant::bss(int id)
+{
+    if (id < 0 || id >= access_points_)
+    {
+        return QByteArray();
+    }
+    return QString("id=%1\nbssid=00:24:01:1e:55:%2\nfreq=2412\nqual=%3\nnoise=-90\nlevel=-%4\n")
+           .arg(id).arg(id, 2, 16, QChar('0')).arg(50 - id).arg(40 + id).toAscii();
+}
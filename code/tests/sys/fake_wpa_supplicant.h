@@ -0,0 +1,73 @@
+// -*- mode: c++; c-basic-offset: 4; -*-
+
+#ifndef FAKE_WPA_SUPPLICANT_H_
+#define FAKE_WPA_SUPPLICANT_H_
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <QtCore/QtCore>
+
+#include "onyx/sys/wpa_connection.h"
+
+/// Stand-in for the control interface of wpa_supplicant. It listens on
+/// a unix datagram socket in dir, answers the commands used by
+/// WpaConnection from its own thread and sends events to the attached
+/// monitors. Every command is counted.
+class FakeWpaSupplicant : public QThread
+{
+public:
+    FakeWpaSupplicant(const QString & dir, const QString & iface, int access_points);
+    ~FakeWpaSupplicant();
+
+    bool startAndWait();
+    void stop();
+
+    /// Number of commands received, or of the commands starting with
+    /// command when it's not empty.
+    int requests(const QByteArray & command = QByteArray());
+    void resetRequests();
+
+    bool sendEvent(const QByteArray & event);
+    int monitors();
+
+protected:
+    void run();
+
+private:
+    QByteArray reply(const QByteArray & command, const sockaddr_un & from);
+    QByteArray scanResults();
+    QByteArray bss(int id);
+
+private:
+    QString path_;
+    QString iface_;
+    int access_points_;
+    int fd_;
+    volatile bool stop_;
+    QSemaphore ready_;
+
+    QMutex mutex_;
+    QList<QByteArray> commands_;
+    QList<sockaddr_un> monitors_;
+};
+
+/// Records the scan results broadcast by WpaConnection.
+class ScanRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    ScanRecorder() : count_(0) {}
+
+    int count() const { return count_; }
+    const WifiProfiles & last() const { return last_; }
+
+public Q_SLOTS:
+    void onScanResults(WifiProfiles & aps) { ++count_; last_ = aps; }
+
+private:
+    int count_;
+    WifiProfiles last_;
+};
+
+#endif  // FAKE_WPA_SUPPLICANT_H_
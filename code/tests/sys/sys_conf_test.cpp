@@ -3,6 +3,11 @@
 
 #include "onyx/base/qt_support.h"
 #include "onyx/sys/sys_conf.h"
+#include "onyx/sys/sys_conf_cache.h"
+#include "onyx/sys/dict_conf.h"
+#include "onyx/sys/page_turning_conf.h"
+#include "onyx/sys/pm_conf.h"
+#include "onyx/sys/volume_conf.h"
 #include "gtest/gtest.h"
 
 using namespace sys;
@@ -42,6 +47,63 @@ TEST(SysConfTest, ServiceConf)
 }
 
 
+TEST(SysConfTest, ServiceForFile)
+{
+    SystemConfig conf;
+    Service service;
+    EXPECT_TRUE(conf.serviceForFile("/media/flash/a.PDF", service));
+    EXPECT_TRUE(service.extensions().contains("pdf"));
+    EXPECT_FALSE(conf.serviceForFile("/media/flash/a.dummy", service));
+
+    Service dummy(".dummy", ".dummy", ".dummy", ".dummy", ".dummy");
+    dummy.mutable_extensions().push_back("dummy");
+    EXPECT_TRUE(conf.registerService(dummy, "dummy"));
+    EXPECT_TRUE(conf.serviceForFile("/media/flash/a.Dummy", service));
+    EXPECT_TRUE(service.app_name() == ".dummy");
+
+    EXPECT_TRUE(conf.unRegisterService(dummy));
+    EXPECT_FALSE(conf.serviceForFile("/media/flash/a.dummy", service));
+}
+
+/// Prints the cost of finding the service of a file by loading all
+/// services and by the extension index.
+TEST(SysConfTest, ServiceForFileCost)
+{
+    static const int COUNT = 1000;
+    SystemConfig conf;
+    QStringList files;
+    files << "a.pdf" << "b.txt" << "c.epub" << "d.jpg" << "e.mobi" << "f.unknown";
+
+    QTime t;
+    t.start();
+    for(int i = 0; i < COUNT; ++i)
+    {
+        QString ext = QFileInfo(files[i % files.size()]).suffix();
+        Services services;
+        SystemConfigCache::instance().invalidate();
+        conf.loadAllServices(services);
+        for(ServicesIter it = services.begin(); it != services.end(); ++it)
+        {
+            if (it->extensions().contains(ext))
+            {
+                break;
+            }
+        }
+    }
+    int scan = t.elapsed();
+
+    t.restart();
+    Service service;
+    for(int i = 0; i < COUNT; ++i)
+    {
+        conf.serviceForFile(files[i % files.size()], service);
+    }
+    int indexed = t.elapsed();
+
+    printf("%d service lookups: %d ms loading all services, %d ms indexed\n",
+           COUNT, scan, indexed);
+}
+
 TEST(SysConfTest, VolumeConf)
 {
     SystemConfig conf;
@@ -58,6 +120,89 @@ TEST(SysConfTest, VolumeConf)
     EXPECT_TRUE(mute == conf.isMute());
 }
 
+/// A value written by another connection, as by another process, is
+/// read again.
+TEST(SysConfTest, CacheInvalidation)
+{
+    SystemConfig conf;
+    EXPECT_TRUE(conf.setVolume(30));
+    EXPECT_EQ(30, conf.volume());
+    EXPECT_EQ(30, SystemConfig().volume());
+
+    {
+        QSqlDatabase other = QSqlDatabase::addDatabase("QSQLITE", "other_process");
+        other.setDatabaseName(QDir::home().filePath("system_config.db"));
+        ASSERT_TRUE(other.open());
+        QSqlQuery query(other);
+        EXPECT_TRUE(query.exec("INSERT OR REPLACE into volume (key, value) values('volume', 70)"));
+        other.close();
+    }
+    QSqlDatabase::removeDatabase("other_process");
+
+    EXPECT_EQ(70, conf.volume());
+    EXPECT_EQ(70, SystemConfig().volume());
+}
+
+/// Reads the locale and the volume as SystemConfig did before the
+/// connection was shared: open a connection, create the tables and
+/// query the database.
+static int readFromNewConnection()
+{
+    int volume = -1;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "sys_conf_baseline");
+        db.setDatabaseName(QDir::home().filePath("system_config.db"));
+        if (db.open())
+        {
+            DictConfig::makeSureTableExist(db);
+            PMConfig::makeSureTableExist(db);
+            LocaleConfig::makeSureTableExist(db);
+            ServiceConfig::makeSureTableExist(db);
+            VolumeConfig::makeSureTableExist(db);
+            WifiConfig::makeSureTableExist(db);
+            DialupConfig::makeSureTableExist(db);
+            PageTurningConfig::makeSureTableExist(db);
+            FontConfig::makeSureTableExist(db);
+            MiscConfig::makeSureTableExist(db);
+
+            LocaleConfig::locale(db);
+            volume = VolumeConfig::volume(db);
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase("sys_conf_baseline");
+    return volume;
+}
+
+/// Prints the cost of reading the locale and the volume with a new
+/// connection each time, and with a new SystemConfig each time from
+/// the shared connection and the cache.
+TEST(SysConfTest, ReadCost)
+{
+    static const int COUNT = 1000;
+    SystemConfig().setVolume(50);
+
+    QTime t;
+    t.start();
+    for(int i = 0; i < COUNT; ++i)
+    {
+        EXPECT_EQ(50, readFromNewConnection());
+    }
+    int baseline = t.elapsed();
+
+    t.restart();
+    for(int i = 0; i < COUNT; ++i)
+    {
+        SystemConfig conf;
+        conf.locale();
+        EXPECT_EQ(50, conf.volume());
+    }
+    int cached = t.elapsed();
+
+    printf("%d locale() and volume() reads: %d ms opening the database, %d ms shared and cached\n",
+           COUNT, baseline, cached);
+}
+
 TEST(SysConfTest, WifiConf)
 {
     SystemConfig conf;
@@ -0,0 +1,206 @@
+// -*- mode: c++; c-basic-offset: 4; -*-
+
+#include "gtest/gtest.h"
+#include "onyx/base/base.h"
+#include "onyx/sys/sys_status.h"
+#include "fake_system_manager.h"
+
+using namespace sys;
+
+namespace
+{
+
+/// The private bus and the system manager on it, shared by all tests.
+QProcess *bus_daemon = 0;
+FakeSystemManager *manager = 0;
+
+/// Start a bus daemon of our own, so that the test does not depend on
+/// the system bus, and make SysStatus use it.
+bool startBus()
+{
+    bus_daemon = new QProcess;
+    bus_daemon->start("dbus-daemon", QStringList() << "--session" << "--nofork" << "--print-address");
+    if (!bus_daemon->waitForStarted() || !bus_daemon->waitForReadyRead())
+    {
+        return false;
+    }
+    QByteArray address = bus_daemon->readLine().trimmed();
+    qputenv("DBUS_SYSTEM_BUS_ADDRESS", address);
+
+    manager = new FakeSystemManager(address);
+    return manager->startAndWait();
+}
+
+void stopBus()
+{
+    delete manager;
+    if (bus_daemon)
+    {
+        bus_daemon->terminate();
+        bus_daemon->waitForFinished();
+        delete bus_daemon;
+    }
+}
+
+/// Process events until condition is true or ms elapsed.
+template <typename Condition>
+bool waitUntil(Condition condition, int ms = 2000)
+{
+    QTime t;
+    t.start();
+    while (!condition() && t.elapsed() < ms)
+    {
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    }
+    return condition();
+}
+
+struct VolumeIs
+{
+    explicit VolumeIs(int v) : value(v) {}
+    bool operator()() const { return SysStatus::instance().volume() == value; }
+    int value;
+};
+
+struct CallsAre
+{
+    explicit CallsAre(int c) : value(c) {}
+    bool operator()() const { return manager->calls() == value; }
+    int value;
+};
+
+struct BrightnessIsNot
+{
+    explicit BrightnessIsNot(int v) : value(v) {}
+    bool operator()() const { return SysStatus::instance().brightness() != value; }
+    int value;
+};
+
+/// What the status bar reads when it is repainted after a page turn.
+void paintStatusBar(SysStatus & status)
+{
+    int current = 0, battery = 0;
+    status.batteryStatus(current, battery);
+    status.volume();
+    status.isMute();
+    status.brightness();
+    status.grayScale();
+}
+
+/// Turning pages asks system manager once per property.
+TEST(SysStatusCacheTest, PageTurns)
+{
+    SysStatus & status = SysStatus::instance();
+    status.invalidateProperties();
+    int before = manager->calls();
+
+    static const int PAGES = 100;
+    for(int i = 0; i < PAGES; ++i)
+    {
+        paintStatusBar(status);
+    }
+    EXPECT_EQ(before + 5, manager->calls());
+
+    int current = 0, battery = 0;
+    EXPECT_TRUE(status.batteryStatus(current, battery));
+    EXPECT_EQ(75, current);
+    EXPECT_EQ(80, status.brightness());
+    EXPECT_EQ(16, status.grayScale());
+}
+
+/// Broadcast signals update the cache without a round trip.
+TEST(SysStatusCacheTest, Broadcast)
+{
+    SysStatus & status = SysStatus::instance();
+    status.volume();
+    int before = manager->calls();
+
+    EXPECT_TRUE(manager->broadcast("volumeChanged", QList<QVariant>() << 30 << true));
+    EXPECT_TRUE(waitUntil(VolumeIs(30)));
+    EXPECT_TRUE(status.isMute());
+
+    EXPECT_TRUE(manager->broadcast("batterySignal", QList<QVariant>() << 20 << 1));
+    int current = 0, battery = 0;
+    QTime t;
+    t.start();
+    while (current != 20 && t.elapsed() < 2000)
+    {
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+        status.batteryStatus(current, battery);
+    }
+    EXPECT_EQ(20, current);
+    EXPECT_EQ(1, battery);
+    EXPECT_EQ(before, manager->calls());
+
+    // Wakeup drops everything.
+    EXPECT_TRUE(manager->broadcast("wakeup", QList<QVariant>()));
+    EXPECT_TRUE(waitUntil(VolumeIs(50)));
+    EXPECT_EQ(before + 1, manager->calls());
+}
+
+/// Setters return before system manager replies and cost one call each.
+TEST(SysStatusCacheTest, AsyncSetters)
+{
+    SysStatus & status = SysStatus::instance();
+    status.invalidateProperties();
+    paintStatusBar(status);
+    int before = manager->calls();
+
+    status.setVolumeAsync(70);
+    status.setGrayScaleAsync(4);
+    EXPECT_EQ(70, status.volume());
+    EXPECT_EQ(4, status.grayScale());
+    EXPECT_TRUE(waitUntil(CallsAre(before + 2)));
+
+    // The previous value is restored when system manager refuses it.
+    status.setBrightnessAsync(150);
+    EXPECT_EQ(150, status.brightness());
+    EXPECT_TRUE(waitUntil(BrightnessIsNot(150)));
+    EXPECT_EQ(80, status.brightness());
+    EXPECT_EQ(before + 3, manager->calls());
+
+    // Synchronous setters update the cache too.
+    EXPECT_TRUE(status.setSuspendInterval(1000));
+    EXPECT_EQ(1000, status.suspendInterval());
+    EXPECT_EQ(before + 4, manager->calls());
+}
+
+struct Never
+{
+    bool operator()() const { return false; }
+};
+
+/// Properties without a change signal are asked again after a while,
+/// the broadcast ones are not.
+TEST(SysStatusCacheTest, Timeout)
+{
+    SysStatus & status = SysStatus::instance();
+    status.invalidateProperties();
+    paintStatusBar(status);
+    int before = manager->calls();
+
+    paintStatusBar(status);
+    EXPECT_EQ(before, manager->calls());
+
+    waitUntil(Never(), 1100);
+    paintStatusBar(status);
+    EXPECT_EQ(before + 2, manager->calls());
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    if (!startBus())
+    {
+        qWarning("Could not start dbus-daemon, skipped.");
+        stopBus();
+        return 0;
+    }
+
+    int ret = RUN_ALL_TESTS();
+    stopBus();
+    return ret;
+}
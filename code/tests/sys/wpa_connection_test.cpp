@@ -0,0 +1,208 @@
+// -*- mode: c++; c-basic-offset: 4; -*-
+
+#include "gtest/gtest.h"
+#include "onyx/base/base.h"
+#include "onyx/sys/wpa_connection.h"
+#include "fake_wpa_supplicant.h"
+
+namespace
+{
+
+static const QString IFACE = "wlan0";
+static const int ACCESS_POINTS = 12;
+
+/// Counts the events that wake up the objects of a WpaConnection: the
+/// socket notifier of the monitor connection and any timer.
+class WakeupCounter : public QObject
+{
+public:
+    explicit WakeupCounter(QObject *target) : target_(target), sockets_(0), timers_(0)
+    {
+        QCoreApplication::instance()->installEventFilter(this);
+    }
+
+    ~WakeupCounter()
+    {
+        QCoreApplication::instance()->removeEventFilter(this);
+    }
+
+    int sockets() const { return sockets_; }
+    int timers() const { return timers_; }
+
+protected:
+    bool eventFilter(QObject *receiver, QEvent *event)
+    {
+        if (receiver == target_ || (receiver && receiver->parent() == target_))
+        {
+            if (event->type() == QEvent::SockAct)
+            {
+                ++sockets_;
+            }
+            else if (event->type() == QEvent::Timer)
+            {
+                ++timers_;
+            }
+        }
+        return false;
+    }
+
+private:
+    QObject *target_;
+    int sockets_;
+    int timers_;
+};
+
+static void processEvents(int ms)
+{
+    QTime t;
+    t.start();
+    while (t.elapsed() < ms)
+    {
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    }
+}
+
+static bool waitForScans(const ScanRecorder & recorder, int count)
+{
+    QTime t;
+    t.start();
+    while (recorder.count() < count && t.elapsed() < 2000)
+    {
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    }
+    return recorder.count() >= count;
+}
+
+class WpaConnectionTest : public ::testing::Test
+{
+protected:
+    WpaConnectionTest()
+        : dir_(QDir::temp().absoluteFilePath("wpa_connection_test"))
+        , fake_(dir_, IFACE, ACCESS_POINTS)
+        , connection_(IFACE)
+    {
+    }
+
+    virtual void SetUp()
+    {
+        QDir::temp().mkpath(dir_);
+        ASSERT_TRUE(fake_.startAndWait());
+        connection_.setCtrlInterfaceDir(dir_);
+        ASSERT_EQ(0, connection_.openCtrlConnection(IFACE));
+        ASSERT_EQ(1, fake_.monitors());
+        QObject::connect(&connection_, SIGNAL(scanResultsReady(WifiProfiles &)),
+                         &recorder_, SLOT(onScanResults(WifiProfiles &)));
+        fake_.resetRequests();
+    }
+
+    QString dir_;
+    FakeWpaSupplicant fake_;
+    WpaConnection connection_;
+    ScanRecorder recorder_;
+};
+
+/// The tokenizer gives the same tokens as QByteArray::split.
+TEST(WpaTokenizerTest, Split)
+{
+    QList<QByteArray> samples;
+    samples << "bssid / frequency / signal level / flags / ssid\n"
+               "00:24:01:1e:55:e0\t2412\t-49\t[WPA2-PSK-CCMP]\ttiger\n"
+               "00:24:01:1e:55:e1\t2437\t-60\t[ESS]\t\n"
+            << "wpa_state=COMPLETED\nip_address=192.168.1.2"
+            << "" << "\n\n" << "\t";
+
+    foreach(const QByteArray & sample, samples)
+    {
+        QList<QByteArray> lines = sample.split('\n');
+        WpaTokenizer tokenizer(WpaToken(sample), '\n');
+        EXPECT_EQ(lines.size(), tokenizer.count());
+
+        WpaToken line;
+        for(int i = 0; tokenizer.next(line); ++i)
+        {
+            ASSERT_LT(i, lines.size());
+            EXPECT_TRUE(line.toByteArray() == lines[i]);
+            EXPECT_EQ(lines[i].split('\t').size(), WpaTokenizer(line, '\t').count());
+        }
+    }
+}
+
+TEST(WpaTokenizerTest, Token)
+{
+    QByteArray data("<3>CTRL-EVENT-SCAN-RESULTS ");
+    WpaToken message = WpaToken(data).withoutPriority();
+    EXPECT_TRUE(message.startsWith(WPA_EVENT_SCAN_RESULTS));
+    EXPECT_TRUE(message.contains("SCAN"));
+    EXPECT_FALSE(message.contains("CONNECTED"));
+    EXPECT_TRUE(WpaToken(QByteArray(" ssid \n")).trimmed().toByteArray() == "ssid");
+    EXPECT_EQ(-1, WpaToken().indexOf('='));
+}
+
+/// Scan results are fetched when wpa_supplicant reports them.
+TEST_F(WpaConnectionTest, ScanOnEvent)
+{
+    EXPECT_TRUE(connection_.scan());
+    ASSERT_TRUE(waitForScans(recorder_, 1));
+    EXPECT_EQ(1, fake_.requests("SCAN_RESULTS"));
+    EXPECT_EQ(ACCESS_POINTS + 1, fake_.requests("BSS"));
+
+    ASSERT_EQ(ACCESS_POINTS, recorder_.last().size());
+    WifiProfile ap = recorder_.last().front();
+    EXPECT_TRUE(ap.ssid() == "ap0");
+    EXPECT_TRUE(ap.isWpa2());
+    EXPECT_EQ(-40, ap.level());
+}
+
+/// A burst of scan events costs one fetch.
+TEST_F(WpaConnectionTest, ScanBurst)
+{
+    for(int i = 0; i < 3; ++i)
+    {
+        EXPECT_TRUE(fake_.sendEvent("CTRL-EVENT-SCAN-RESULTS "));
+    }
+    ASSERT_TRUE(waitForScans(recorder_, 1));
+    processEvents(200);
+    EXPECT_EQ(1, recorder_.count());
+    EXPECT_EQ(1, fake_.requests("SCAN_RESULTS"));
+}
+
+/// With the Wi-Fi dialog open, the connection wakes up once per event
+/// of wpa_supplicant and never on its own.
+TEST_F(WpaConnectionTest, WakeupsPerMinute)
+{
+    static const int PERIOD = 3000;
+    static const int EVENTS = 3;
+    WakeupCounter counter(&connection_);
+
+    // Quiet period: nothing to do.
+    processEvents(PERIOD);
+    int idle = counter.sockets() + counter.timers();
+    EXPECT_EQ(0, counter.sockets());
+    EXPECT_EQ(0, counter.timers());
+    EXPECT_EQ(0, fake_.requests());
+
+    // Background scans and noise, one event per second.
+    for(int i = 0; i < EVENTS; ++i)
+    {
+        fake_.sendEvent(i % 2 ? "CTRL-EVENT-BSS-ADDED 1 00:24:01:1e:55:01" :
+                                "CTRL-EVENT-SCAN-RESULTS ");
+        processEvents(PERIOD / EVENTS);
+    }
+
+    int wakeups = counter.sockets() + counter.timers() - idle;
+    printf("%d wakeups per minute idle, %d per minute with one event per second\n",
+           idle * 60000 / PERIOD, wakeups * 60000 / PERIOD);
+    EXPECT_EQ(EVENTS, counter.sockets());
+    EXPECT_EQ(0, counter.timers());
+    EXPECT_EQ(2, fake_.requests("SCAN_RESULTS"));
+    EXPECT_EQ(0, fake_.requests("PING"));
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
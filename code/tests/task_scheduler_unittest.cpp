@@ -0,0 +1,265 @@
+#include <limits.h>
+
+#include "gtest/gtest.h"
+#include "onyx/base/base.h"
+#include "onyx/base/task_scheduler.h"
+#include "onyx/base/tasks_handler.h"
+
+namespace
+{
+using namespace vbf;
+
+enum TestTaskType
+{
+    TYPE_RENDER = 0,
+    TYPE_PRERENDER,
+    TYPE_SEARCH,
+    TYPE_INDEXING,
+    TYPE_COUNT
+};
+
+struct Stats
+{
+    QAtomicInt running;
+    QAtomicInt max_running;
+    QAtomicInt slices;
+    QAtomicInt completed;
+    QAtomicInt deleted;
+    QMutex mutex;
+    QList<int> order;
+};
+
+/// Task doing its work in a number of exec() slices.
+class CountingTask : public BaseTask
+{
+public:
+    CountingTask(int type, int slices, Stats *stats)
+        : BaseTask(type)
+        , slices_(slices)
+        , done_(0)
+        , stats_(stats)
+    {
+    }
+
+    ~CountingTask()
+    {
+        stats_->deleted.ref();
+    }
+
+    void exec()
+    {
+        int running = stats_->running.fetchAndAddOrdered(1) + 1;
+        int max = stats_->max_running;
+        while (running > max && !stats_->max_running.testAndSetOrdered(max, running))
+        {
+            max = stats_->max_running;
+        }
+
+        // Some work.
+        volatile int sum = 0;
+        for (int i = 0; i < 2000; ++i)
+        {
+            sum += i;
+        }
+
+        stats_->slices.ref();
+        if (++done_ >= slices_)
+        {
+            stats_->completed.ref();
+            QMutexLocker locker(&stats_->mutex);
+            stats_->order.push_back(type());
+            abort();
+        }
+        stats_->running.deref();
+    }
+
+private:
+    int slices_;
+    int done_;
+    Stats *stats_;
+};
+
+/// Blocks the worker until released.
+class GateTask : public BaseTask
+{
+public:
+    explicit GateTask(QSemaphore *gate) : BaseTask(TYPE_COUNT), gate_(gate) {}
+
+    void exec()
+    {
+        gate_->acquire();
+        abort();
+    }
+
+private:
+    QSemaphore *gate_;
+};
+
+static bool waitFinished(TaskScheduler & scheduler, int timeout)
+{
+    QTime t;
+    t.start();
+    while (scheduler.unfinishedCount() > 0 && t.elapsed() < timeout)
+    {
+        scheduler.waitForIdle(10);
+        QCoreApplication::processEvents();
+    }
+    return scheduler.unfinishedCount() == 0;
+}
+
+static void setPriorities(TaskScheduler & scheduler)
+{
+    scheduler.setTypePriority(TYPE_RENDER, TASK_PRIORITY_RENDER);
+    scheduler.setTypePriority(TYPE_PRERENDER, TASK_PRIORITY_PRERENDER);
+    scheduler.setTypePriority(TYPE_SEARCH, TASK_PRIORITY_SEARCH);
+    scheduler.setTypePriority(TYPE_INDEXING, TASK_PRIORITY_INDEXING);
+}
+
+/// Thousands of mixed tasks, one type cancelled while running.
+TEST(TaskSchedulerTest, Stress)
+{
+    static const int TASKS = 5000;
+    static const int WORKERS = 4;
+    Stats stats;
+    int per_type[TYPE_COUNT] = { 0 };
+
+    QTime t;
+    t.start();
+    {
+        TaskScheduler scheduler(WORKERS);
+        setPriorities(scheduler);
+        qsrand(1);
+        for (int i = 0; i < TASKS; ++i)
+        {
+            int type = qrand() % TYPE_COUNT;
+            ++per_type[type];
+            scheduler.addTask(new CountingTask(type, 1 + qrand() % 20, &stats));
+            if (i == TASKS / 2)
+            {
+                scheduler.cancelTasks(TYPE_INDEXING);
+            }
+        }
+        EXPECT_TRUE(waitFinished(scheduler, 60000));
+        EXPECT_TRUE(scheduler.isIdle());
+        EXPECT_EQ(0, scheduler.pendingCount());
+    }
+    printf("%d tasks, %d slices in %d ms\n", TASKS, static_cast<int>(stats.slices), t.elapsed());
+
+    EXPECT_EQ(TASKS, static_cast<int>(stats.deleted));
+    EXPECT_LE(static_cast<int>(stats.max_running), WORKERS);
+
+    // Everything except cancelled indexing tasks finished its work.
+    int completed = static_cast<int>(stats.completed);
+    EXPECT_GE(completed, per_type[TYPE_RENDER] + per_type[TYPE_PRERENDER] + per_type[TYPE_SEARCH]);
+    EXPECT_LT(completed, TASKS);
+}
+
+/// With one worker, queued tasks run by priority class.
+TEST(TaskSchedulerTest, Priority)
+{
+    Stats stats;
+    QSemaphore gate;
+    TaskScheduler scheduler(1);
+    setPriorities(scheduler);
+
+    scheduler.addTask(new GateTask(&gate), TASK_PRIORITY_RENDER);
+    for (int i = 0; i < 20; ++i)
+    {
+        scheduler.addTask(new CountingTask(TYPE_INDEXING, 1, &stats));
+        scheduler.addTask(new CountingTask(TYPE_SEARCH, 1, &stats));
+        scheduler.addTask(new CountingTask(TYPE_RENDER, 1, &stats));
+    }
+    gate.release();
+    EXPECT_TRUE(waitFinished(scheduler, 10000));
+
+    ASSERT_EQ(60, stats.order.size());
+    for (int i = 0; i < 60; ++i)
+    {
+        int expected = (i < 20 ? TYPE_RENDER : (i < 40 ? TYPE_SEARCH : TYPE_INDEXING));
+        EXPECT_EQ(expected, stats.order[i]);
+    }
+}
+
+/// A long running low priority task yields to a visible page render.
+TEST(TaskSchedulerTest, Yield)
+{
+    Stats stats;
+    TaskScheduler scheduler(1);
+    setPriorities(scheduler);
+
+    scheduler.addTask(new CountingTask(TYPE_INDEXING, 100000, &stats));
+    while (static_cast<int>(stats.slices) == 0)
+    {
+        QThread::yieldCurrentThread();
+    }
+    scheduler.addTask(new CountingTask(TYPE_RENDER, 1, &stats));
+    QTime t;
+    t.start();
+    while (static_cast<int>(stats.completed) == 0 && t.elapsed() < 5000)
+    {
+        QThread::yieldCurrentThread();
+    }
+    ASSERT_EQ(1, stats.order.size());
+    EXPECT_EQ(TYPE_RENDER, stats.order.front());
+
+    scheduler.cancelTasks(TYPE_INDEXING);
+    EXPECT_TRUE(waitFinished(scheduler, 5000));
+    EXPECT_EQ(2, static_cast<int>(stats.deleted));
+}
+
+/// TasksHandler API on top of the scheduler.
+TEST(TaskSchedulerTest, TasksHandlerShim)
+{
+    Stats stats;
+    QSemaphore gate;
+    TaskScheduler scheduler(1);
+    TasksHandler handler;
+    handler.setScheduler(&scheduler);
+
+    handler.addTask(new GateTask(&gate));
+    handler.addTask(new CountingTask(TYPE_SEARCH, 1, &stats));
+    handler.addTask(new CountingTask(TYPE_SEARCH, 1, &stats));
+    // Prepending drops queued tasks of the same type.
+    handler.addTask(new CountingTask(TYPE_SEARCH, 1, &stats), false);
+    EXPECT_FALSE(handler.isEmpty());
+    gate.release();
+
+    EXPECT_TRUE(waitFinished(scheduler, 5000));
+    EXPECT_TRUE(handler.isEmpty());
+    EXPECT_EQ(1, static_cast<int>(stats.completed));
+    EXPECT_EQ(3, static_cast<int>(stats.deleted));
+}
+
+/// Prepending aborts the running tasks of any type, as it aborts the
+/// current task without a scheduler.
+TEST(TaskSchedulerTest, TasksHandlerShimAbortsRunning)
+{
+    Stats stats;
+    TaskScheduler scheduler(1);
+    TasksHandler handler;
+    handler.setScheduler(&scheduler);
+
+    handler.addTask(new CountingTask(TYPE_INDEXING, INT_MAX, &stats));
+    QTime t;
+    t.start();
+    while (static_cast<int>(stats.slices) == 0 && t.elapsed() < 5000)
+    {
+        QCoreApplication::processEvents();
+    }
+    handler.addTask(new CountingTask(TYPE_SEARCH, 1, &stats), false);
+
+    EXPECT_TRUE(waitFinished(scheduler, 5000));
+    EXPECT_EQ(1, static_cast<int>(stats.completed));
+    ASSERT_EQ(1, stats.order.size());
+    EXPECT_EQ(TYPE_SEARCH, stats.order.front());
+    EXPECT_EQ(2, static_cast<int>(stats.deleted));
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
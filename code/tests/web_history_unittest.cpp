@@ -0,0 +1,236 @@
+#include <stdlib.h>
+
+#include "gtest/gtest.h"
+#include "onyx/base/base.h"
+#include "onyx/data/web_history.h"
+
+using namespace webhistory;
+
+namespace
+{
+
+/// A new home directory, so that web_history.db is a new database.
+class Home
+{
+public:
+    Home()
+        : dir_(QDir::temp().filePath(QString("web_history_unittest_%1").arg(QCoreApplication::applicationPid())))
+    {
+        QDir().mkpath(dir_.absolutePath());
+        QFile::remove(path());
+        setenv("HOME", qPrintable(dir_.absolutePath()), 1);
+    }
+
+    ~Home()
+    {
+        QFile::remove(path());
+        QDir().rmdir(dir_.absolutePath());
+    }
+
+    QString path() const { return dir_.filePath("web_history.db"); }
+
+private:
+    QDir dir_;
+};
+
+static QUrl pageUrl(int i)
+{
+    return QUrl(QString("http://www.example.com/page%1.html").arg(i));
+}
+
+static QImage pageThumbnail(int i)
+{
+    QImage image(ThumbnailItem::size(), QImage::Format_RGB32);
+    image.fill(qRgb(i, i, i));
+    return image;
+}
+
+static ThumbnailItem pageItem(int i, const QString & access)
+{
+    ThumbnailItem item;
+    item.setUrl(pageUrl(i));
+    item.setTitle(QString("Page %1").arg(i));
+    item.setThumbnail(pageThumbnail(i));
+    item.setAccessTime(access);
+    return item;
+}
+
+/// Write a database of the previous versions: one serialized item by row.
+static void writeConfTable(const QString & path, const QVariantList & items)
+{
+    {
+        QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", "web_history_unittest");
+        database.setDatabaseName(path);
+        ASSERT_TRUE(database.open());
+        QSqlQuery query(database);
+        ASSERT_TRUE(query.exec("create table conf (key integer primary key, value blob)"));
+        query.prepare("insert into conf (value) values(?)");
+        foreach(const QVariant & v, items)
+        {
+            QByteArray data;
+            QBuffer buffer(&data);
+            buffer.open(QIODevice::WriteOnly);
+            QDataStream stream(&buffer);
+            stream << v;
+            query.bindValue(0, data);
+            ASSERT_TRUE(query.exec());
+        }
+        database.close();
+    }
+    QSqlDatabase::removeDatabase("web_history_unittest");
+}
+
+TEST(WebHistoryTest, Migrate)
+{
+    Home home;
+    QVariantList items;
+    items << pageItem(3, "2013-05-02 10:00") << pageItem(2, "2013-05-01 10:00") << pageItem(1, "2013-05-01 10:00");
+    writeConfTable(home.path(), items);
+
+    WebHistory history;
+    QVariantList pages;
+    ASSERT_TRUE(history.loadPages(pages));
+    ASSERT_EQ(3, pages.size());
+    for(int i = 0; i < pages.size(); ++i)
+    {
+        ThumbnailItem page(pages.at(i).toMap());
+        ThumbnailItem item(items.at(i).toMap());
+        EXPECT_EQ(item.url(), page.url());
+        EXPECT_EQ(item.title(), page.title());
+        EXPECT_EQ(item.accessTime(), page.accessTime());
+        EXPECT_FALSE(page.contains("thumbnail"));
+    }
+    EXPECT_EQ(pageThumbnail(2).pixel(0, 0), history.thumbnail(pageUrl(2)).pixel(0, 0));
+
+    // Converted once.
+    QVariantList conf;
+    ASSERT_TRUE(history.loadConf(conf));
+    ASSERT_EQ(3, conf.size());
+    EXPECT_FALSE(ThumbnailItem(conf.front().toMap()).thumbnail().isNull());
+}
+
+TEST(WebHistoryTest, VisitKeepsRecentPages)
+{
+    Home home;
+    WebHistory history;
+    for(int i = 0; i < history.maxCount() + 5; ++i)
+    {
+        ASSERT_TRUE(history.visit(pageUrl(i), QString("Page %1").arg(i)));
+        ASSERT_TRUE(history.setThumbnail(pageUrl(i), pageThumbnail(i)));
+    }
+    EXPECT_EQ(history.maxCount(), history.count());
+    EXPECT_TRUE(history.thumbnail(pageUrl(0)).isNull());
+
+    // Visiting a page again moves it first and keeps its thumbnail.
+    int first = history.maxCount() + 5 - history.maxCount();
+    ASSERT_TRUE(history.visit(pageUrl(first), "Again"));
+    EXPECT_EQ(history.maxCount(), history.count());
+    QVariantList pages;
+    ASSERT_TRUE(history.loadPages(pages));
+    ThumbnailItem page(pages.front().toMap());
+    EXPECT_EQ(pageUrl(first), page.url());
+    EXPECT_EQ(QString("Again"), page.title());
+    EXPECT_FALSE(history.thumbnail(pageUrl(first)).isNull());
+
+    // No thumbnail for pages not in the history.
+    EXPECT_FALSE(history.setThumbnail(pageUrl(0), pageThumbnail(0)));
+
+    EXPECT_TRUE(history.remove(pageUrl(first)));
+    EXPECT_EQ(history.maxCount() - 1, history.count());
+    EXPECT_TRUE(history.thumbnail(pageUrl(first)).isNull());
+
+    history.clear();
+    EXPECT_EQ(0, history.count());
+}
+
+/// loadConf() returns the pages in the order they were saved, whatever
+/// their access times, and a visit moves the page first.
+TEST(WebHistoryTest, SaveConfKeepsOrder)
+{
+    Home home;
+    WebHistory history;
+    ASSERT_TRUE(history.visit(pageUrl(0), "Page 0"));
+
+    QVariantList conf;
+    conf << pageItem(1, "2013-05-01 10:00") << pageItem(2, "2013-05-03 10:00") << pageItem(3, "2013-05-02 10:00");
+    ASSERT_TRUE(history.loadConf(conf));
+    ASSERT_TRUE(history.saveConf(conf));
+
+    QVariantList pages;
+    ASSERT_TRUE(history.loadConf(pages));
+    ASSERT_EQ(conf.size(), pages.size());
+    for(int i = 0; i < pages.size(); ++i)
+    {
+        ThumbnailItem page(pages.at(i).toMap());
+        ThumbnailItem item(conf.at(i).toMap());
+        EXPECT_EQ(item.url(), page.url());
+        EXPECT_EQ(item.accessTime(), page.accessTime());
+    }
+
+    ASSERT_TRUE(history.visit(pageUrl(3), "Page 3"));
+    pages.clear();
+    ASSERT_TRUE(history.loadPages(pages));
+    ASSERT_EQ(conf.size(), pages.size());
+    EXPECT_EQ(pageUrl(3), ThumbnailItem(pages.at(0).toMap()).url());
+    EXPECT_EQ(pageUrl(1), ThumbnailItem(pages.at(1).toMap()).url());
+    EXPECT_EQ(pageUrl(2), ThumbnailItem(pages.at(2).toMap()).url());
+    EXPECT_EQ(pageUrl(0), ThumbnailItem(pages.at(3).toMap()).url());
+}
+
+/// A visit with a full history: saving the whole list as before, and
+/// recording the visit only.
+TEST(WebHistoryTest, VisitCost)
+{
+    Home home;
+    WebHistory history;
+    QVariantList conf;
+    for(int i = 0; i < history.maxCount(); ++i)
+    {
+        conf.push_front(pageItem(i, "2013-05-01 10:00"));
+    }
+    ASSERT_TRUE(history.saveConf(conf));
+    EXPECT_EQ(history.maxCount(), history.count());
+
+    static const int VISITS = 20;
+    QTime timer;
+    timer.start();
+    for(int i = 0; i < VISITS; ++i)
+    {
+        ThumbnailItem item(conf.takeLast().toMap());
+        item.updateAccessTime();
+        conf.push_front(item);
+        history.saveConf(conf);
+    }
+    int save_conf = timer.elapsed();
+
+    timer.restart();
+    for(int i = 0; i < VISITS; ++i)
+    {
+        history.visit(pageUrl(i), QString("Page %1").arg(i));
+    }
+    int visit = timer.elapsed();
+
+    timer.restart();
+    QVariantList pages;
+    history.loadPages(pages);
+    int load_pages = timer.elapsed();
+
+    timer.restart();
+    conf.clear();
+    history.loadConf(conf);
+    int load_conf = timer.elapsed();
+
+    printf("%d visits: %d ms with saveConf, %d ms with visit\n", VISITS, save_conf, visit);
+    printf("Listing %d pages: %d ms with thumbnails, %d ms without\n",
+           pages.size(), load_conf, load_pages);
+    EXPECT_EQ(history.maxCount(), pages.size());
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}